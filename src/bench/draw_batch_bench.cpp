@@ -0,0 +1,273 @@
+// draw_batch_bench.cpp  —  headless count of the map's draws with and
+// without texture arrays.
+//
+//   Usage:  ./draw_batch_bench COMPILED_MAP.bsp [-views <N>] [-layers <N>]
+//
+// Looks around from the centres of random empty leaves, culls the render
+// clusters against each view's frustum through the cull tree and builds
+// the renderer's draw list with a binding per texture and lightmap page,
+// and as with TEXTURE_ARRAYS, where every texture is in an array of at most
+// -layers layers shared with the textures of its size, and every lightmap
+// page in one shared with the pages of its width and format. Like the
+// renderer, the per-texture list is sorted front to back within each
+// binding and the arrays' list by index, so ranges that meet in the index
+// buffer merge; the arrays are also counted front to back, to show what
+// keeping depth order would cost. Prints the commands, bindings and sg_draw
+// calls per view of each. Textures are grouped by their size in the .bsp alone;
+// the renderer also needs their formats and mip counts to match.
+
+#include "../render/draw_list.h"
+#include "../render/map_cull.h"
+#include "../utils/bsp_loader.h"
+
+// The loader links asset_pack.cpp, which decodes PNGs through stb_image.
+#define STB_IMAGE_IMPLEMENTATION
+#include "stb_image.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <random>
+#include <utility>
+#include <vector>
+
+namespace {
+
+constexpr float kFarPlane = 4096.0f;
+
+struct BenchCluster {
+    AABB     bounds;
+    uint32_t mesh;
+    int      firstIndex;
+    int      indexCount;
+};
+
+// The key fields of one mesh under either binding scheme.
+struct MeshState {
+    uint32_t lightmap = 0;
+    uint32_t texture = 0;
+};
+
+struct BatchTotals {
+    size_t commands = 0;
+    size_t bindings = 0;
+    size_t draws = 0;
+};
+
+struct BenchView {
+    Matrix  viewProj;
+    Frustum frustum;
+};
+
+BenchView RandomView(const std::vector<Vector3>& eyes, std::mt19937& rng)
+{
+    std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+    const Vector3 eye = eyes[rng() % eyes.size()];
+    const float yaw = unit(rng) * 2.0f * PI;
+    const float pitch = (unit(rng) - 0.5f) * 0.8f;
+    const Vector3 forward = { cosf(pitch) * cosf(yaw), sinf(pitch), cosf(pitch) * sinf(yaw) };
+    const Matrix proj = MatrixPerspective(75.0f * DEG2RAD, 16.0f / 9.0f, 0.1f, kFarPlane);
+    const Matrix view = MatrixLookAt(eye, Vector3Add(eye, forward), Vector3{ 0.0f, 1.0f, 0.0f });
+    BenchView v;
+    v.viewProj = MatrixMultiply(proj, view);
+    v.frustum = FrustumFromVP(v.viewProj);
+    return v;
+}
+
+// A texture slot per texture; a lightmap slot per page.
+std::vector<MeshState> PerMeshStates(const BSPData& bsp)
+{
+    std::vector<MeshState> states;
+    for (const BSPMesh& m : bsp.meshes) {
+        states.push_back({ m.lightmapPage + 1u, m.textureIndex });
+    }
+    return states;
+}
+
+// Gives the items of each group a slot per array of at most `maxLayers`;
+// an item without a partner gets an array of one layer.
+template <typename Key>
+std::vector<uint32_t> ArraySlots(const std::vector<Key>& keys, int maxLayers, size_t* arrayCount)
+{
+    std::map<Key, std::vector<uint32_t>> groups;
+    for (uint32_t i = 0; i < keys.size(); ++i) {
+        groups[keys[i]].push_back(i);
+    }
+    std::vector<uint32_t> slots(keys.size());
+    uint32_t nextSlot = 0;
+    for (const auto& [key, items] : groups) {
+        for (size_t i = 0; i < items.size(); ++i) {
+            if (i % maxLayers == 0) {
+                ++*arrayCount;
+                ++nextSlot;
+            }
+            slots[items[i]] = nextSlot - 1;
+        }
+    }
+    return slots;
+}
+
+// Texture slots per array of same-size textures; lightmap slots per array
+// of pages with the same width and format, which the renderer pads to the
+// tallest.
+std::vector<MeshState> ArrayStates(const BSPData& bsp, int maxLayers, size_t* textureArrays, size_t* lightmapArrays)
+{
+    std::vector<std::pair<uint32_t, uint32_t>> textureKeys;
+    for (const BSPTexture& t : bsp.textures) {
+        textureKeys.push_back({ t.width, t.height });
+    }
+    std::vector<std::pair<int, uint32_t>> pageKeys;
+    for (const BSPDataLightmapPage& page : bsp.lightmapPages) {
+        pageKeys.push_back({ page.width, page.format });
+    }
+    const std::vector<uint32_t> textureSlots = ArraySlots(textureKeys, maxLayers, textureArrays);
+    const std::vector<uint32_t> pageSlots = ArraySlots(pageKeys, maxLayers, lightmapArrays);
+    std::vector<MeshState> states;
+    for (const BSPMesh& m : bsp.meshes) {
+        const uint32_t lightmap = m.lightmapPage < pageSlots.size() ? pageSlots[m.lightmapPage] + 1u : 0u;
+        states.push_back({ lightmap, textureSlots[m.textureIndex] });
+    }
+    return states;
+}
+
+// Builds one view's list the way Renderer_CullMap does, sorts it and adds
+// up what drawing it would cost.
+void CountList(const std::vector<BenchCluster>& clusters, const std::vector<uint8_t>& drawn,
+               const std::vector<MeshState>& states, bool inIndexOrder, const Matrix& viewProj,
+               std::vector<DrawCommand>& commands, std::vector<DrawCommand>& scratch, BatchTotals& totals)
+{
+    commands.clear();
+    DrawCommand cmd;
+    float depth = 0.0f;
+    auto push = [&]() {
+        if (cmd.index_count == 0) return;
+        const MeshState& s = states[cmd.mesh];
+        cmd.key = inIndexOrder ? DrawKeyInOrder(0, s.lightmap, s.texture, (uint32_t)cmd.first_index)
+                               : DrawKey(0, s.lightmap, s.texture, depth);
+        commands.push_back(cmd);
+    };
+    for (size_t i = 0; i < clusters.size(); ++i) {
+        if (!drawn[i]) continue;
+        const BenchCluster& c = clusters[i];
+        const Vector3 centre = Vector3Scale(Vector3Add(c.bounds.min, c.bounds.max), 0.5f);
+        const float w = viewProj.m3 * centre.x + viewProj.m7 * centre.y + viewProj.m11 * centre.z + viewProj.m15;
+        if (cmd.index_count > 0 && cmd.mesh == c.mesh && cmd.first_index + cmd.index_count == c.firstIndex) {
+            cmd.index_count += c.indexCount;
+            depth = std::min(depth, w);
+            continue;
+        }
+        push();
+        cmd = DrawCommand{ 0, c.mesh, c.firstIndex, c.indexCount };
+        depth = w;
+    }
+    push();
+    DrawList_Sort(commands, scratch);
+
+    totals.commands += commands.size();
+    totals.draws += DrawList_CountDraws(commands);
+    for (size_t i = 0; i < commands.size(); ++i) {
+        totals.bindings += i == 0 || DrawKey_State(commands[i].key) != DrawKey_State(commands[i - 1].key);
+    }
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    const char* mapPath = nullptr;
+    int viewCount = 2000;
+    int maxLayers = 256;
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "-views") == 0 && i + 1 < argc) {
+            viewCount = std::max(1, atoi(argv[++i]));
+        } else if (strcmp(argv[i], "-layers") == 0 && i + 1 < argc) {
+            maxLayers = std::max(1, atoi(argv[++i]));
+        } else {
+            mapPath = argv[i];
+        }
+    }
+    if (!mapPath) {
+        fprintf(stderr, "Usage: %s COMPILED_MAP.bsp [-views <N>] [-layers <N>]\n", argv[0]);
+        return 1;
+    }
+
+    BSPData bsp;
+    if (!LoadBSP(mapPath, bsp)) {
+        fprintf(stderr, "[draw_batch_bench] cannot load %s\n", mapPath);
+        return 1;
+    }
+    // Without clusters each mesh is one, as in the renderer.
+    std::vector<BenchCluster> clusters;
+    if (bsp.meshClusters.empty()) {
+        for (uint32_t m = 0; m < bsp.meshes.size(); ++m) {
+            AABB bounds = AABBInvalid();
+            const BSPMesh& mesh = bsp.meshes[m];
+            for (uint32_t i = mesh.firstIndex; i < mesh.firstIndex + mesh.indexCount; ++i) {
+                const uint32_t index = bsp.indices[i];
+                if (bsp.compactVertices.empty()) {
+                    AABBExtend(&bounds, Vector3{ bsp.vertices[index].x, bsp.vertices[index].y, bsp.vertices[index].z });
+                } else {
+                    const BSPVertexCompact& v = bsp.compactVertices[index];
+                    AABBExtend(&bounds, Vector3{ v.x, v.y, v.z });
+                }
+            }
+            clusters.push_back({ bounds, m, (int)mesh.firstIndex, (int)mesh.indexCount });
+        }
+    } else {
+        for (const BSPMeshCluster& c : bsp.meshClusters) {
+            clusters.push_back({ { { c.minX, c.minY, c.minZ }, { c.maxX, c.maxY, c.maxZ } },
+                                 c.meshIndex, (int)c.firstIndex, (int)c.indexCount });
+        }
+    }
+    std::vector<AABB> bounds;
+    for (const BenchCluster& c : clusters) {
+        bounds.push_back(c.bounds);
+    }
+    MapCullTree tree;
+    MapCull_Build(tree, bounds, bsp.bspNodes, bsp.planes, bsp.tree.rootChild);
+
+    std::vector<Vector3> eyes;
+    for (const BSPLeaf& leaf : bsp.bspLeaves) {
+        if (leaf.contents != BSP_CONTENTS_SOLID) {
+            eyes.push_back({ (leaf.minX + leaf.maxX) * 0.5f, (leaf.minY + leaf.maxY) * 0.5f,
+                             (leaf.minZ + leaf.maxZ) * 0.5f });
+        }
+    }
+    size_t textureArrays = 0, lightmapArrays = 0;
+    const std::vector<MeshState> perMesh = PerMeshStates(bsp);
+    const std::vector<MeshState> arrays = ArrayStates(bsp, maxLayers, &textureArrays, &lightmapArrays);
+    const size_t textureCount = bsp.textures.size();
+    const size_t pageCount = bsp.lightmapPages.size();
+    UnloadBSP(bsp);
+    if (eyes.empty() || clusters.empty()) {
+        fprintf(stderr, "[draw_batch_bench] nothing to draw: %zu empty leaves, %zu clusters\n", eyes.size(), clusters.size());
+        return 1;
+    }
+    printf("[draw_batch_bench] %s: %zu meshes, %zu clusters, %zu textures in %zu arrays, "
+           "%zu lightmap pages in %zu arrays, %d views\n",
+           mapPath, perMesh.size(), clusters.size(), textureCount, textureArrays, pageCount, lightmapArrays,
+           viewCount);
+
+    std::mt19937 rng(1234);
+    std::vector<uint8_t> drawn(clusters.size());
+    std::vector<DrawCommand> commands, scratch;
+    BatchTotals before, after, frontToBack;
+    for (int v = 0; v < viewCount; ++v) {
+        const BenchView view = RandomView(eyes, rng);
+        MapCull_Frustum(tree, view.frustum, drawn.data());
+        CountList(clusters, drawn, perMesh, false, view.viewProj, commands, scratch, before);
+        CountList(clusters, drawn, arrays, true, view.viewProj, commands, scratch, after);
+        CountList(clusters, drawn, arrays, false, view.viewProj, commands, scratch, frontToBack);
+    }
+    const double n = (double)viewCount;
+    printf("[draw_batch_bench] per texture: %8.1f commands, %8.1f bindings, %8.1f draws per view\n",
+           before.commands / n, before.bindings / n, before.draws / n);
+    printf("[draw_batch_bench] arrays:      %8.1f commands, %8.1f bindings, %8.1f draws per view\n",
+           after.commands / n, after.bindings / n, after.draws / n);
+    printf("[draw_batch_bench] arrays, depth: %6.1f commands, %8.1f bindings, %8.1f draws per view\n",
+           frontToBack.commands / n, frontToBack.bindings / n, frontToBack.draws / n);
+    return 0;
+}
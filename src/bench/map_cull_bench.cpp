@@ -0,0 +1,218 @@
+// map_cull_bench.cpp  —  headless microbenchmark for the map cull tree.
+//
+//   Usage:  ./map_cull_bench [COMPILED_MAP.bsp] [-views <N>]
+//
+// Culls the render clusters of a compiled map, or without one a synthetic
+// grid of clusters under an axial BSP tree, against random views: once
+// cluster by cluster with FrustumAABB, as the renderer did per pass, and
+// once through MapCull_Frustum. Prints the time per view for both and
+// counts any cluster the two disagree on.
+
+#include "../render/map_cull.h"
+#include "../utils/bsp_loader.h"
+
+// The loader links asset_pack.cpp, which decodes PNGs through stb_image.
+#define STB_IMAGE_IMPLEMENTATION
+#include "stb_image.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace {
+
+struct BenchScene {
+    std::vector<AABB>     clusters;
+    std::vector<BSPNode>  nodes;
+    std::vector<BSPPlane> planes;
+    int32_t               rootChild = -1;
+    AABB                  bounds = AABBInvalid();
+};
+
+constexpr int   kGridX = 48;
+constexpr int   kGridY = 8;
+constexpr int   kGridZ = 48;
+constexpr float kCellSize = 128.0f;
+constexpr float kFarPlane = 4096.0f;
+
+// Splits the cells [x0,x1) x [y0,y1) x [z0,z1) in half along their longest
+// side until one is left; returns the child index of the subtree.
+int32_t BuildGridTree(BenchScene& scene, int x0, int x1, int y0, int y1, int z0, int z1, int32_t* nextLeaf)
+{
+    const int sx = x1 - x0, sy = y1 - y0, sz = z1 - z0;
+    if (sx == 1 && sy == 1 && sz == 1) {
+        return -1 - (*nextLeaf)++;
+    }
+    BSPPlane plane{};
+    int axis = 0;
+    if (sy > sx && sy >= sz) axis = 1;
+    else if (sz > sx && sz > sy) axis = 2;
+    const int lo[3] = { x0, y0, z0 };
+    const int hi[3] = { x1, y1, z1 };
+    const int split = (lo[axis] + hi[axis]) / 2;
+    (&plane.nx)[axis] = 1.0f;
+    plane.d = -(float)split * kCellSize;
+
+    BSPNode node{};
+    node.planeIndex = (int32_t)scene.planes.size();
+    scene.planes.push_back(plane);
+    const size_t index = scene.nodes.size();
+    scene.nodes.push_back(node);
+    int front[6] = { x0, x1, y0, y1, z0, z1 };
+    int back[6] = { x0, x1, y0, y1, z0, z1 };
+    front[axis * 2] = split;
+    back[axis * 2 + 1] = split;
+    const int32_t frontChild = BuildGridTree(scene, front[0], front[1], front[2], front[3], front[4], front[5], nextLeaf);
+    const int32_t backChild = BuildGridTree(scene, back[0], back[1], back[2], back[3], back[4], back[5], nextLeaf);
+    scene.nodes[index].frontChild = frontChild;
+    scene.nodes[index].backChild = backChild;
+    return (int32_t)index;
+}
+
+void BuildSyntheticScene(BenchScene& scene)
+{
+    std::mt19937 rng(7);
+    std::uniform_real_distribution<float> inset(0.0f, 0.3f);
+    for (int x = 0; x < kGridX; ++x) {
+        for (int y = 0; y < kGridY; ++y) {
+            for (int z = 0; z < kGridZ; ++z) {
+                const Vector3 lo = { x * kCellSize, y * kCellSize, z * kCellSize };
+                AABB box;
+                box.min = { lo.x + inset(rng) * kCellSize, lo.y + inset(rng) * kCellSize, lo.z + inset(rng) * kCellSize };
+                box.max = { lo.x + (1.0f - inset(rng)) * kCellSize, lo.y + (1.0f - inset(rng)) * kCellSize,
+                            lo.z + (1.0f - inset(rng)) * kCellSize };
+                scene.clusters.push_back(box);
+                AABBExtend(&scene.bounds, box.min);
+                AABBExtend(&scene.bounds, box.max);
+            }
+        }
+    }
+    int32_t nextLeaf = 0;
+    scene.rootChild = BuildGridTree(scene, 0, kGridX, 0, kGridY, 0, kGridZ, &nextLeaf);
+}
+
+bool LoadScene(const char* path, BenchScene& scene)
+{
+    BSPData bsp;
+    if (!LoadBSP(path, bsp)) {
+        return false;
+    }
+    for (const BSPMeshCluster& c : bsp.meshClusters) {
+        const AABB box = { { c.minX, c.minY, c.minZ }, { c.maxX, c.maxY, c.maxZ } };
+        scene.clusters.push_back(box);
+        AABBExtend(&scene.bounds, box.min);
+        AABBExtend(&scene.bounds, box.max);
+    }
+    scene.nodes.assign(bsp.bspNodes.begin(), bsp.bspNodes.end());
+    scene.planes.assign(bsp.planes.begin(), bsp.planes.end());
+    scene.rootChild = bsp.tree.rootChild;
+    UnloadBSP(bsp);
+    return true;
+}
+
+std::vector<Frustum> RandomViews(const AABB& bounds, int count)
+{
+    std::mt19937 rng(1234);
+    std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+    const Matrix proj = MatrixPerspective(75.0f * DEG2RAD, 16.0f / 9.0f, 0.1f, kFarPlane);
+    std::vector<Frustum> views;
+    views.reserve((size_t)count);
+    for (int i = 0; i < count; ++i) {
+        const Vector3 eye = {
+            bounds.min.x + unit(rng) * (bounds.max.x - bounds.min.x),
+            bounds.min.y + unit(rng) * (bounds.max.y - bounds.min.y),
+            bounds.min.z + unit(rng) * (bounds.max.z - bounds.min.z),
+        };
+        const float yaw = unit(rng) * 2.0f * PI;
+        const float pitch = (unit(rng) - 0.5f) * 1.2f;
+        const Vector3 forward = { cosf(pitch) * cosf(yaw), sinf(pitch), cosf(pitch) * sinf(yaw) };
+        const Matrix view = MatrixLookAt(eye, Vector3Add(eye, forward), Vector3{ 0.0f, 1.0f, 0.0f });
+        views.push_back(FrustumFromVP(MatrixMultiply(proj, view)));
+    }
+    return views;
+}
+
+double NanosecondsPerView(std::chrono::steady_clock::time_point start, size_t views)
+{
+    const double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+    return ns / (double)views;
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    const char* mapPath = nullptr;
+    int viewCount = 20000;
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "-views") == 0 && i + 1 < argc) {
+            viewCount = std::max(1, atoi(argv[++i]));
+        } else {
+            mapPath = argv[i];
+        }
+    }
+
+    BenchScene scene;
+    if (mapPath) {
+        if (!LoadScene(mapPath, scene)) {
+            fprintf(stderr, "[map_cull_bench] cannot load %s\n", mapPath);
+            return 1;
+        }
+    } else {
+        BuildSyntheticScene(scene);
+    }
+    if (scene.clusters.empty()) {
+        fprintf(stderr, "[map_cull_bench] no render clusters to cull\n");
+        return 1;
+    }
+
+    MapCullTree tree;
+    const auto buildStart = std::chrono::steady_clock::now();
+    MapCull_Build(tree, scene.clusters, scene.nodes, scene.planes, scene.rootChild);
+    const double buildMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - buildStart).count();
+    printf("[map_cull_bench] %s: %zu clusters, %zu bsp nodes -> %zu cull nodes in %.2f ms, %d views\n",
+           mapPath ? mapPath : "synthetic grid", scene.clusters.size(), scene.nodes.size(), tree.nodes.size(),
+           buildMs, viewCount);
+
+    const std::vector<Frustum> views = RandomViews(scene.bounds, viewCount);
+    const size_t clusterCount = scene.clusters.size();
+    std::vector<uint8_t> flat(clusterCount);
+    std::vector<uint8_t> culled(clusterCount);
+
+    auto start = std::chrono::steady_clock::now();
+    for (const Frustum& view : views) {
+        for (size_t c = 0; c < clusterCount; ++c) {
+            flat[c] = (uint8_t)FrustumAABB(&view, scene.clusters[c]);
+        }
+    }
+    const double flatNs = NanosecondsPerView(start, views.size());
+
+    start = std::chrono::steady_clock::now();
+    for (const Frustum& view : views) {
+        MapCull_Frustum(tree, view, culled.data());
+    }
+    const double treeNs = NanosecondsPerView(start, views.size());
+
+    // Untimed: both again, compared.
+    size_t visible = 0;
+    size_t mismatches = 0;
+    for (const Frustum& view : views) {
+        MapCull_Frustum(tree, view, culled.data());
+        for (size_t c = 0; c < clusterCount; ++c) {
+            const uint8_t expected = (uint8_t)FrustumAABB(&view, scene.clusters[c]);
+            visible += expected;
+            mismatches += expected != culled[c];
+        }
+    }
+    printf("[map_cull_bench] flat FrustumAABB: %10.1f ns/view\n", flatNs);
+    printf("[map_cull_bench] cull tree (%s): %10.1f ns/view, %.2fx\n", MapCull_SimdName(), treeNs, flatNs / treeNs);
+    printf("[map_cull_bench] %.1f%% of clusters in view on average, %zu mismatches\n",
+           100.0 * (double)visible / (double)(clusterCount * views.size()), mismatches);
+    return mismatches == 0 ? 0 : 1;
+}
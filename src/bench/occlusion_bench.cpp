@@ -0,0 +1,187 @@
+// occlusion_bench.cpp  —  headless benchmark for the software occlusion buffer.
+//
+//   Usage:  ./occlusion_bench COMPILED_MAP.bsp [-path <camera path>] [-views <N>]
+//                             [-size <W>x<H>]
+//
+// Replays a camera path recorded by the engine with WARPED_RECORD_CAMERA
+// (one "position target" line per frame), or without one looks around from
+// the centres of random empty leaves. Each view culls the map's render
+// clusters against the frustum through the cull tree, rasterizes the .bsp's
+// occluders and tests the clusters left; prints the time per view of each
+// step and how many of the clusters in the frustum occlusion removed.
+
+#include "../render/map_cull.h"
+#include "../render/occlusion.h"
+#include "../utils/bsp_loader.h"
+#include "../utils/worker_pool.h"
+
+// The loader links asset_pack.cpp, which decodes PNGs through stb_image.
+#define STB_IMAGE_IMPLEMENTATION
+#include "stb_image.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <vector>
+
+namespace {
+
+constexpr float kFarPlane = 4096.0f;
+
+struct BenchView {
+    Matrix  viewProj;
+    Frustum frustum;
+};
+
+BenchView MakeView(Vector3 eye, Vector3 target)
+{
+    const Matrix proj = MatrixPerspective(75.0f * DEG2RAD, 16.0f / 9.0f, 0.1f, kFarPlane);
+    const Matrix view = MatrixLookAt(eye, target, Vector3{ 0.0f, 1.0f, 0.0f });
+    BenchView v;
+    v.viewProj = MatrixMultiply(proj, view);
+    v.frustum = FrustumFromVP(v.viewProj);
+    return v;
+}
+
+bool LoadPath(const char* path, std::vector<BenchView>& views)
+{
+    FILE* f = fopen(path, "r");
+    if (!f) {
+        return false;
+    }
+    Vector3 eye, target;
+    while (fscanf(f, "%f %f %f %f %f %f", &eye.x, &eye.y, &eye.z, &target.x, &target.y, &target.z) == 6) {
+        views.push_back(MakeView(eye, target));
+    }
+    fclose(f);
+    return true;
+}
+
+void RandomViews(const BSPData& bsp, int count, std::vector<BenchView>& views)
+{
+    std::vector<Vector3> eyes;
+    for (const BSPLeaf& leaf : bsp.bspLeaves) {
+        if (leaf.contents != BSP_CONTENTS_SOLID) {
+            eyes.push_back({ (leaf.minX + leaf.maxX) * 0.5f, (leaf.minY + leaf.maxY) * 0.5f,
+                             (leaf.minZ + leaf.maxZ) * 0.5f });
+        }
+    }
+    if (eyes.empty()) {
+        return;
+    }
+    std::mt19937 rng(1234);
+    std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+    for (int i = 0; i < count; ++i) {
+        const Vector3 eye = eyes[rng() % eyes.size()];
+        const float yaw = unit(rng) * 2.0f * PI;
+        const float pitch = (unit(rng) - 0.5f) * 0.8f;
+        const Vector3 forward = { cosf(pitch) * cosf(yaw), sinf(pitch), cosf(pitch) * sinf(yaw) };
+        views.push_back(MakeView(eye, Vector3Add(eye, forward)));
+    }
+}
+
+double NanosecondsSince(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    const char* mapPath = nullptr;
+    const char* cameraPath = nullptr;
+    int viewCount = 2000;
+    int width = OCCLUSION_DEFAULT_WIDTH;
+    int height = OCCLUSION_DEFAULT_HEIGHT;
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "-path") == 0 && i + 1 < argc) {
+            cameraPath = argv[++i];
+        } else if (strcmp(argv[i], "-views") == 0 && i + 1 < argc) {
+            viewCount = std::max(1, atoi(argv[++i]));
+        } else if (strcmp(argv[i], "-size") == 0 && i + 1 < argc) {
+            if (sscanf(argv[++i], "%dx%d", &width, &height) != 2 || width <= 0 || height <= 0) {
+                fprintf(stderr, "[occlusion_bench] bad -size %s, expected <W>x<H>\n", argv[i]);
+                return 1;
+            }
+        } else {
+            mapPath = argv[i];
+        }
+    }
+    if (!mapPath) {
+        fprintf(stderr, "Usage: %s COMPILED_MAP.bsp [-path <camera path>] [-views <N>] [-size <W>x<H>]\n", argv[0]);
+        return 1;
+    }
+
+    BSPData bsp;
+    if (!LoadBSP(mapPath, bsp)) {
+        fprintf(stderr, "[occlusion_bench] cannot load %s\n", mapPath);
+        return 1;
+    }
+    if (bsp.occluders.empty()) {
+        fprintf(stderr, "[occlusion_bench] %s has no occluders; recompile it\n", mapPath);
+        return 1;
+    }
+    std::vector<AABB> clusters;
+    for (const BSPMeshCluster& c : bsp.meshClusters) {
+        clusters.push_back({ { c.minX, c.minY, c.minZ }, { c.maxX, c.maxY, c.maxZ } });
+    }
+    MapCullTree tree;
+    MapCull_Build(tree, clusters, bsp.bspNodes, bsp.planes, bsp.tree.rootChild);
+    OcclusionBuffer occlusion;
+    Occlusion_Init(occlusion, bsp.occluders, bsp.occluderVerts, width, height);
+
+    std::vector<BenchView> views;
+    if (cameraPath) {
+        if (!LoadPath(cameraPath, views)) {
+            fprintf(stderr, "[occlusion_bench] cannot read %s\n", cameraPath);
+            return 1;
+        }
+    } else {
+        RandomViews(bsp, viewCount, views);
+    }
+    UnloadBSP(bsp);
+    if (views.empty() || clusters.empty()) {
+        fprintf(stderr, "[occlusion_bench] nothing to test: %zu views, %zu clusters\n", views.size(), clusters.size());
+        return 1;
+    }
+    printf("[occlusion_bench] %s: %zu clusters, %zu occluders, %dx%d buffer, %zu views from %s, %zu threads\n",
+           mapPath, clusters.size(), occlusion.occluders.size(), occlusion.width, occlusion.height, views.size(),
+           cameraPath ? cameraPath : "random leaves", FrameWorkerPool().WorkerCount());
+
+    std::vector<uint8_t> inFrustum(clusters.size());
+    double frustumNs = 0.0, rasterNs = 0.0, testNs = 0.0;
+    size_t onScreenPolygons = 0, frustumVisible = 0, occluded = 0;
+    for (const BenchView& view : views) {
+        auto start = std::chrono::steady_clock::now();
+        MapCull_Frustum(tree, view.frustum, inFrustum.data());
+        frustumNs += NanosecondsSince(start);
+
+        start = std::chrono::steady_clock::now();
+        Occlusion_Render(occlusion, view.viewProj);
+        rasterNs += NanosecondsSince(start);
+        onScreenPolygons += occlusion.polygons.size();
+
+        start = std::chrono::steady_clock::now();
+        for (size_t c = 0; c < clusters.size(); ++c) {
+            if (inFrustum[c]) {
+                ++frustumVisible;
+                occluded += !Occlusion_TestAABB(occlusion, clusters[c]);
+            }
+        }
+        testNs += NanosecondsSince(start);
+    }
+    const double n = (double)views.size();
+    printf("[occlusion_bench] frustum cull: %10.1f ns/view\n", frustumNs / n);
+    printf("[occlusion_bench] rasterize:    %10.1f ns/view, %.1f occluders on screen\n", rasterNs / n,
+           (double)onScreenPolygons / n);
+    printf("[occlusion_bench] test boxes:   %10.1f ns/view, %.1f clusters in the frustum\n", testNs / n,
+           (double)frustumVisible / n);
+    printf("[occlusion_bench] occlusion culled %.1f%% of the clusters in the frustum\n",
+           frustumVisible ? 100.0 * (double)occluded / (double)frustumVisible : 0.0);
+    return 0;
+}
@@ -1,33 +1,52 @@
 // compile_map.cpp  —  offline .map → .bsp compiler.
 //
-//   Usage:  ./compile_map <PATH_TO_MAP_FILE> <COMPILED_MAP_NAME> [-cpu|-gpu]
+//   Usage:  ./compile_map <PATH_TO_MAP_FILE> <COMPILED_MAP_NAME> [-cpu|-gpu] [-max-memory <MB>]
+//                   [-lightmap-format <rgba16f|rgb9e5|bc6h|rgba8>] [-texture-format <auto|rgba8|bc1|bc3|bc7>]
+//                   [-vertex-format <auto|full|compact>] [-vis <none|fast|full>]
 //
 // Produces <COMPILED_MAP_NAME>.bsp containing pre-triangulated render
-// geometry with baked lightmap UVs, convex-hull collision data, the
-// entity text block, and the lightmap atlas pixels.
+// geometry in spatial clusters with baked lightmap UVs, convex-hull collision data, the
+// entities (typed, plus the old text block), the lightmap atlas pixels, the
+// structural BSP with per-leaf visibility, and the largest world polygons as
+// occluders for the engine's occlusion culling.
 
 #include "map_parser.h"
 #include "../utils/bsp_format.h"
 #include "../utils/asset_pack.h"
+#include "../utils/bsp_vis.h"
+#include "../utils/entity_table.h"
+#include "../utils/lightmap_codec.h"
+#include "../utils/vertex_codec.h"
 #include "../physx/collision_data.h"
+#include "leaf_vis.h"
 #include "lightmap.h"
+#include "map_entity_props.h"
 #include "map_geometry.h"
+#include "mesh_clusters.h"
+#include "mesh_optimize.h"
+#include "occluders.h"
+#include "outside_fill.h"
 #include "structural_bsp.h"
 
 #define STB_IMAGE_IMPLEMENTATION
 #include "stb_image.h"
 
 #include <algorithm>
+#include <cerrno>
+#include <chrono>
 #include <cmath>
+#include <cstdint>
 #include <cstdio>
+#include <cstdlib>
 #include <cstring>
+#include <filesystem>
 #include <string>
 #include <utility>
 #include <vector>
 #include <unordered_map>
 
 // --------------------------------------------------------------------------
-//  Texture-size probe (no GPU).  Mirrors renderer's lookup path.
+//  Texture ingest (no GPU).  Mirrors renderer's lookup path.
 // --------------------------------------------------------------------------
 struct TexInfo { int w=64, h=64; };   // default if PNG missing
 
@@ -36,22 +55,6 @@ static bool IsPackableTextureName(const std::string& name)
     return name.rfind("__light_brush_", 0) != 0;
 }
 
-static TexInfo ProbeTexture(const std::string& mapDir, const std::string& name,
-                            std::unordered_map<std::string,TexInfo>& cache)
-{
-    auto it = cache.find(name);
-    if (it != cache.end()) return it->second;
-
-    // assets/maps/<file>.map  →  ../textures/<name>.png
-    std::string path = mapDir + "/../textures/" + name + ".png";
-    int w,h,comp;
-    TexInfo ti;
-    if (stbi_info(path.c_str(), &w, &h, &comp)) { ti.w=w; ti.h=h; }
-    else printf("[compile_map] texture '%s' not found, assuming 64x64\n", name.c_str());
-    cache[name] = ti;
-    return ti;
-}
-
 static float Srgb8ToLinearFloat(uint8_t c)
 {
     const float srgb = (float)c / 255.0f;
@@ -61,54 +64,38 @@ static float Srgb8ToLinearFloat(uint8_t c)
     return powf((srgb + 0.055f) / 1.055f, 2.4f);
 }
 
-static Vector3 ProbeTextureAverageColor(const std::string& mapDir,
-                                        const std::string& name,
-                                        std::unordered_map<std::string, Vector3>& cache)
+// Alpha-weighted linear average of a decoded RGBA8 image; grey for sources
+// without colour channels.
+static Vector3 TextureAverageColor(const unsigned char* rgba, const TextureIngestInfo& info)
 {
-    auto it = cache.find(name);
-    if (it != cache.end()) {
-        return it->second;
-    }
-
     Vector3 avgColor{0.5f, 0.5f, 0.5f};
-    if (name.empty() || !IsPackableTextureName(name)) {
-        cache[name] = avgColor;
+    if (info.width <= 0 || info.height <= 0 || info.channels < 3) {
         return avgColor;
     }
 
-    std::string path = mapDir + "/../textures/" + name + ".png";
-    int w = 0, h = 0, comp = 0;
-    unsigned char* pixels = stbi_load(path.c_str(), &w, &h, &comp, 0);
-    if (pixels && w > 0 && h > 0 && comp >= 3) {
-        double accumR = 0.0;
-        double accumG = 0.0;
-        double accumB = 0.0;
-        double accumWeight = 0.0;
-        const size_t pixelCount = (size_t)w * (size_t)h;
-        for (size_t i = 0; i < pixelCount; ++i) {
-            const unsigned char* px = pixels + i * (size_t)comp;
-            const float alpha = (comp >= 4) ? ((float)px[3] / 255.0f) : 1.0f;
-            if (alpha <= 0.0f) {
-                continue;
-            }
-            accumR += (double)Srgb8ToLinearFloat(px[0]) * (double)alpha;
-            accumG += (double)Srgb8ToLinearFloat(px[1]) * (double)alpha;
-            accumB += (double)Srgb8ToLinearFloat(px[2]) * (double)alpha;
-            accumWeight += (double)alpha;
-        }
-        if (accumWeight > 1e-6) {
-            avgColor = {
-                (float)(accumR / accumWeight),
-                (float)(accumG / accumWeight),
-                (float)(accumB / accumWeight)
-            };
+    double accumR = 0.0;
+    double accumG = 0.0;
+    double accumB = 0.0;
+    double accumWeight = 0.0;
+    const size_t pixelCount = (size_t)info.width * (size_t)info.height;
+    for (size_t i = 0; i < pixelCount; ++i) {
+        const unsigned char* px = rgba + i * 4;
+        const float alpha = (info.channels >= 4) ? ((float)px[3] / 255.0f) : 1.0f;
+        if (alpha <= 0.0f) {
+            continue;
         }
+        accumR += (double)Srgb8ToLinearFloat(px[0]) * (double)alpha;
+        accumG += (double)Srgb8ToLinearFloat(px[1]) * (double)alpha;
+        accumB += (double)Srgb8ToLinearFloat(px[2]) * (double)alpha;
+        accumWeight += (double)alpha;
     }
-    if (pixels) {
-        stbi_image_free(pixels);
+    if (accumWeight > 1e-6) {
+        avgColor = {
+            (float)(accumR / accumWeight),
+            (float)(accumG / accumWeight),
+            (float)(accumB / accumWeight)
+        };
     }
-
-    cache[name] = avgColor;
     return avgColor;
 }
 
@@ -118,85 +105,159 @@ static Vector3 ProbeTextureAverageColor(const std::string& mapDir,
 struct LumpWriter {
     FILE* f;
     BSPHeader hdr{};
-    long hdrPos;
+    long hdrPos = 0;
+    bool failed = false;   // a short write, failed seek or out-of-range lump; Finish reports it
+    int error = 0;         // errno of the first failure, 0 for a lump out of range
+
+    void Fail(int err) {
+        if (!failed) error = err;
+        failed = true;
+    }
+
+    void Put(const void* data, size_t size, size_t count) {
+        if (count && fwrite(data, size, count, f) != count) Fail(errno);
+    }
+    void Seek(long offset, int whence) {
+        if (fseek(f, offset, whence) != 0) Fail(errno);
+    }
+    long Tell() {
+        const long offset = ftell(f);
+        if (offset < 0) Fail(errno);
+        return offset;
+    }
+    // Lump offsets and lengths are 32-bit in the header.
+    void SetLump(int lump, long offset, size_t len) {
+        if (offset < 0 || (uint64_t)offset + len > UINT32_MAX) Fail(0);
+        hdr.lumps[lump].offset = (uint32_t)offset;
+        hdr.lumps[lump].length = (uint32_t)len;
+    }
 
     void Begin() {
         hdr.magic = WBSP_MAGIC;
         hdr.version = WBSP_VERSION;
-        hdrPos = ftell(f);
-        fwrite(&hdr, sizeof(hdr), 1, f);      // placeholder
+        hdrPos = Tell();
+        Put(&hdr, sizeof(hdr), 1);      // placeholder
+    }
+    // Lumps start on 4-byte boundaries so the loader can use the uint32_t
+    // lumps in place in its mapping of the file.
+    long Align() {
+        static const uint8_t pad[3] = {};
+        const long offset = Tell();
+        if (offset < 0) return offset;
+        const long padded = (offset + 3) & ~3L;
+        if (padded != offset) Put(pad, 1, (size_t)(padded - offset));
+        return padded;
     }
     template<typename T>
     void Write(int lump, const std::vector<T>& v) {
-        hdr.lumps[lump].offset = (uint32_t)ftell(f);
-        hdr.lumps[lump].length = (uint32_t)(v.size()*sizeof(T));
-        if (!v.empty()) fwrite(v.data(), sizeof(T), v.size(), f);
+        SetLump(lump, Align(), v.size()*sizeof(T));
+        Put(v.data(), sizeof(T), v.size());
     }
     void WriteRaw(int lump, const void* data, size_t len) {
-        hdr.lumps[lump].offset = (uint32_t)ftell(f);
-        hdr.lumps[lump].length = (uint32_t)len;
-        if (len) fwrite(data, 1, len, f);
+        SetLump(lump, Align(), len);
+        Put(data, 1, len);
     }
-    void End() {
-        fseek(f, hdrPos, SEEK_SET);
-        fwrite(&hdr, sizeof(hdr), 1, f);
+    // Zero-fills `len` bytes for a lump whose contents arrive later, in any
+    // order, through WriteAt. Returns the lump's file offset.
+    long Reserve(int lump, size_t len) {
+        const long offset = Align();
+        SetLump(lump, offset, len);
+        static const uint8_t zeros[64 * 1024] = {};
+        for (size_t left = len; left > 0 && !failed;) {
+            const size_t chunk = std::min(left, sizeof(zeros));
+            Put(zeros, 1, chunk);
+            left -= chunk;
+        }
+        return offset;
+    }
+    void WriteAt(long offset, const void* data, size_t len) {
+        Seek(offset, SEEK_SET);
+        Put(data, 1, len);
+        Seek(0, SEEK_END);
+    }
+    // Writes the real header and closes the file. False if any write along
+    // the way fell short, so a full disk never leaves a header pointing past
+    // the end of the file.
+    bool Finish() {
+        Seek(hdrPos, SEEK_SET);
+        Put(&hdr, sizeof(hdr), 1);
+        if (fflush(f) != 0) Fail(errno);
+        if (fclose(f) != 0) Fail(errno);
+        f = nullptr;
+        return !failed;
     }
 };
 
-static uint16_t Float32ToHalfBits(float value)
+static void PrintUsage(const char* exe)
 {
-    uint32_t bits = 0;
-    memcpy(&bits, &value, sizeof(bits));
-
-    const uint32_t sign = (bits >> 16u) & 0x8000u;
-    const uint32_t absBits = bits & 0x7FFFFFFFu;
-
-    if (absBits >= 0x7F800000u) {
-        const uint32_t mantissa = absBits & 0x007FFFFFu;
-        if (mantissa != 0u) {
-            return (uint16_t)(sign | 0x7C00u | std::max<uint32_t>(1u, mantissa >> 13u));
-        }
-        return (uint16_t)(sign | 0x7C00u);
-    }
+    fprintf(stderr, "Usage: %s <PATH_TO_MAP_FILE> <COMPILED_MAP_NAME> [-cpu|-gpu] [-max-memory <MB>]\n"
+                    "       [-lightmap-format <rgba16f|rgb9e5|bc6h|rgba8>] [-texture-format <auto|rgba8|bc1|bc3|bc7>]\n"
+                    "       [-vertex-format <auto|full|compact>] [-vis <none|fast|full>]\n", exe);
+    fprintf(stderr, "  -cpu             Force the CPU reference lightmap baker.\n");
+    fprintf(stderr, "  -gpu             Prefer the GPU compute baker; unsupported pages can still fall back to CPU.\n");
+    fprintf(stderr, "  -max-memory <MB> Budget for float lightmap pages kept live while baking; finished\n");
+    fprintf(stderr, "                   pages are written out early to stay under it where seams allow.\n");
+    fprintf(stderr, "                   Bounce and the stitched resolve keep every page live, so it only\n");
+    fprintf(stderr, "                   holds with worldspawn _bounce 0 and _extra_samples 0; otherwise the\n");
+    fprintf(stderr, "                   bake warns and goes over it.\n");
+    fprintf(stderr, "  -lightmap-format <fmt>\n");
+    fprintf(stderr, "                   Lightmap page encoding; overrides the worldspawn _lightmap_format key.\n");
+    fprintf(stderr, "  -texture-format <fmt>\n");
+    fprintf(stderr, "                   Mip encoding for packed textures. auto (default) picks BC1 for opaque\n");
+    fprintf(stderr, "                   textures and BC7 for textures with alpha.\n");
+    fprintf(stderr, "  -vertex-format <fmt>\n");
+    fprintf(stderr, "                   auto (default) writes 24-byte compact vertices when every vertex\n");
+    fprintf(stderr, "                   round-trips within tolerance, and 40-byte float vertices otherwise.\n");
+    fprintf(stderr, "  -vis <mode>      Leaf visibility: full (default) clips sight lines through portal\n");
+    fprintf(stderr, "                   chains, fast only floods portals that face each other, none skips it.\n");
+}
 
-    if (absBits > 0x477FEFFFu) {
-        return (uint16_t)(sign | 0x7BFFu);
-    }
+enum VertexFormatMode { VERTEX_FORMAT_AUTO, VERTEX_FORMAT_FULL, VERTEX_FORMAT_COMPACT };
 
-    if (absBits < 0x38800000u) {
-        if (absBits < 0x33000000u) {
-            return (uint16_t)sign;
-        }
+// Round-trip limits for compact vertices, in texels of the mesh's texture
+// and luxels of its lightmap page. The lightmap limit sits well inside the
+// baker's seam guard (LIGHTMAP_EDGE_SEAM_GUARD_LUXELS).
+static constexpr float COMPACT_VERTEX_MAX_TEXEL_ERROR = 0.25f;
+static constexpr float COMPACT_VERTEX_MAX_LUXEL_ERROR = 0.1f;
 
-        uint32_t mantissa = (absBits & 0x007FFFFFu) | 0x00800000u;
-        const uint32_t exp = absBits >> 23u;
-        const uint32_t shift = 126u - exp;
-        mantissa = (mantissa + (1u << (shift - 1u))) >> shift;
-        return (uint16_t)(sign | mantissa);
-    }
-
-    uint32_t rounded = absBits + 0x00001000u;
-    if (rounded >= 0x47800000u) {
-        return (uint16_t)(sign | 0x7BFFu);
-    }
-    return (uint16_t)(sign | ((rounded - 0x38000000u) >> 13u));
-}
+struct CompactVertexError {
+    float texels = 0.0f;
+    float luxels = 0.0f;
+    float normalDegrees = 0.0f;
+};
 
-static std::vector<uint8_t> EncodeLightmapPageRGBA16F(const LightmapPage& page)
+// Encodes `vertices` (diffuse UVs already shifted near zero per polygon) and
+// reports the worst round-trip error.
+static std::vector<BSPVertexCompact> EncodeCompactVertices(const std::vector<BSPVertex>& vertices,
+                                                           const std::vector<BSPMesh>& meshes,
+                                                           const std::vector<BSPTexture>& textures,
+                                                           const std::vector<LightmapPage>& pages,
+                                                           CompactVertexError* outError)
 {
-    std::vector<uint8_t> encoded(page.pixels.size() * sizeof(uint16_t), 0);
-    for (size_t i = 0; i < page.pixels.size(); ++i) {
-        const uint16_t half = Float32ToHalfBits(std::max(0.0f, page.pixels[i]));
-        memcpy(encoded.data() + i * sizeof(uint16_t), &half, sizeof(half));
+    std::vector<BSPVertexCompact> compact(vertices.size());
+    CompactVertexError worst;
+    for (const BSPMesh& m : meshes) {
+        const BSPTexture& tex = textures[m.textureIndex];
+        const float texW = (float)std::max(tex.width, 1u);
+        const float texH = (float)std::max(tex.height, 1u);
+        const float pageW = m.lightmapPage < pages.size() ? (float)std::max(pages[m.lightmapPage].width, 1) : 1.0f;
+        const float pageH = m.lightmapPage < pages.size() ? (float)std::max(pages[m.lightmapPage].height, 1) : 1.0f;
+        for (uint32_t i = m.firstVertex; i < m.firstVertex + m.vertexCount; ++i) {
+            const BSPVertex& src = vertices[i];
+            compact[i] = EncodeCompactVertex(src);
+            const BSPVertex back = DecodeCompactVertex(compact[i]);
+            worst.texels = std::max(worst.texels, std::max(fabsf(back.u - src.u) * texW, fabsf(back.v - src.v) * texH));
+            worst.luxels = std::max(worst.luxels, std::max(fabsf(back.lu - src.lu) * pageW, fabsf(back.lv - src.lv) * pageH));
+            const float srcLen = sqrtf(src.nx * src.nx + src.ny * src.ny + src.nz * src.nz);
+            const float backLen = sqrtf(back.nx * back.nx + back.ny * back.ny + back.nz * back.nz);
+            if (srcLen > 0.0f && backLen > 0.0f) {
+                const float cosAngle = (src.nx * back.nx + src.ny * back.ny + src.nz * back.nz) / (srcLen * backLen);
+                worst.normalDegrees = std::max(worst.normalDegrees, acosf(std::clamp(cosAngle, -1.0f, 1.0f)) * RAD2DEG);
+            }
+        }
     }
-    return encoded;
-}
-
-static void PrintUsage(const char* exe)
-{
-    fprintf(stderr, "Usage: %s <PATH_TO_MAP_FILE> <COMPILED_MAP_NAME> [-cpu|-gpu]\n", exe);
-    fprintf(stderr, "  -cpu  Force the CPU reference lightmap baker.\n");
-    fprintf(stderr, "  -gpu  Prefer the GPU compute baker; unsupported pages can still fall back to CPU.\n");
+    *outError = worst;
+    return compact;
 }
 
 // --------------------------------------------------------------------------
@@ -208,6 +269,11 @@ int main(int argc, char** argv)
     }
 
     LightmapBakeBackendMode backendMode = LIGHTMAP_BAKE_BACKEND_AUTO;
+    size_t maxLightmapMemoryBytes = 0;
+    const char* lightmapFormatOverride = nullptr;
+    uint32_t packTextureFormat = ASSET_PACK_TEXTURE_FORMAT_AUTO;
+    VertexFormatMode vertexFormat = VERTEX_FORMAT_AUTO;
+    uint32_t visMode = BSP_VIS_MODE_FULL;
     for (int argIndex = 3; argIndex < argc; ++argIndex) {
         const char* arg = argv[argIndex];
         if (std::strcmp(arg, "-cpu") == 0) {
@@ -224,6 +290,59 @@ int main(int argc, char** argv)
                 return 1;
             }
             backendMode = LIGHTMAP_BAKE_BACKEND_PREFER_GPU;
+        } else if (std::strcmp(arg, "-max-memory") == 0) {
+            const long long megabytes = (argIndex + 1 < argc) ? atoll(argv[argIndex + 1]) : 0;
+            if (megabytes <= 0) {
+                fprintf(stderr, "[compile_map] -max-memory expects a positive size in MB.\n");
+                PrintUsage(argv[0]);
+                return 1;
+            }
+            maxLightmapMemoryBytes = (size_t)megabytes * 1024 * 1024;
+            ++argIndex;
+        } else if (std::strcmp(arg, "-lightmap-format") == 0) {
+            uint32_t format = 0;
+            if (argIndex + 1 >= argc || !LightmapFormatFromName(argv[argIndex + 1], &format)) {
+                fprintf(stderr, "[compile_map] -lightmap-format expects rgba16f, rgb9e5, bc6h or rgba8.\n");
+                PrintUsage(argv[0]);
+                return 1;
+            }
+            lightmapFormatOverride = argv[++argIndex];
+        } else if (std::strcmp(arg, "-texture-format") == 0) {
+            const char* value = (argIndex + 1 < argc) ? argv[argIndex + 1] : "";
+            if (std::strcmp(value, "auto") != 0 && !TexturePixelFormatFromName(value, &packTextureFormat)) {
+                fprintf(stderr, "[compile_map] -texture-format expects auto, rgba8, bc1, bc3 or bc7.\n");
+                PrintUsage(argv[0]);
+                return 1;
+            }
+            ++argIndex;
+        } else if (std::strcmp(arg, "-vertex-format") == 0) {
+            const char* value = (argIndex + 1 < argc) ? argv[argIndex + 1] : "";
+            if (std::strcmp(value, "auto") == 0) {
+                vertexFormat = VERTEX_FORMAT_AUTO;
+            } else if (std::strcmp(value, "full") == 0) {
+                vertexFormat = VERTEX_FORMAT_FULL;
+            } else if (std::strcmp(value, "compact") == 0) {
+                vertexFormat = VERTEX_FORMAT_COMPACT;
+            } else {
+                fprintf(stderr, "[compile_map] -vertex-format expects auto, full or compact.\n");
+                PrintUsage(argv[0]);
+                return 1;
+            }
+            ++argIndex;
+        } else if (std::strcmp(arg, "-vis") == 0) {
+            const char* value = (argIndex + 1 < argc) ? argv[argIndex + 1] : "";
+            if (std::strcmp(value, "none") == 0) {
+                visMode = 0;
+            } else if (std::strcmp(value, "fast") == 0) {
+                visMode = BSP_VIS_MODE_FAST;
+            } else if (std::strcmp(value, "full") == 0) {
+                visMode = BSP_VIS_MODE_FULL;
+            } else {
+                fprintf(stderr, "[compile_map] -vis expects none, fast or full.\n");
+                PrintUsage(argv[0]);
+                return 1;
+            }
+            ++argIndex;
         } else {
             fprintf(stderr, "[compile_map] unknown option: %s\n", arg);
             PrintUsage(argv[0]);
@@ -261,44 +380,221 @@ int main(int argc, char** argv)
     std::vector<PointLight> lights = GetPointLights(map);
     std::vector<SurfaceLightTemplate> surfaceLights = GetSurfaceLightTemplates(map);
     LightBakeSettings lightSettings = GetLightBakeSettings(map);
+    if (lightmapFormatOverride) {
+        LightmapFormatFromName(lightmapFormatOverride, &lightSettings.lightmapFormat);
+    }
+    printf("[compile_map] lightmap format: %s\n", LightmapFormatName(lightSettings.lightmapFormat));
+    if (maxLightmapMemoryBytes > 0 && (lightSettings.bounceCount > 0 || lightSettings.extraSamples > 0)) {
+        printf("[compile_map] warning: -max-memory cannot be met with _bounce %d, _extra_samples %d in worldspawn; "
+               "bounce and the stitched resolve keep every lightmap page live. Set both to 0 to stay under it.\n",
+               lightSettings.bounceCount, lightSettings.extraSamples);
+    }
     if (backendMode == LIGHTMAP_BAKE_BACKEND_FORCE_CPU) {
         printf("[compile_map] lightmap backend: CPU forced\n");
     } else if (backendMode == LIGHTMAP_BAKE_BACKEND_PREFER_GPU) {
         printf("[compile_map] lightmap backend: GPU preferred\n");
     }
     std::unordered_map<std::string,TexInfo> texCache;
-    std::unordered_map<std::string,Vector3> textureColorCache;
     std::unordered_map<std::string,uint32_t> texIdx;
     std::vector<BSPTexture> textures;
-    std::vector<PackagedAssetEntry> packagedAssets;
+    // Parallel to `textures`: assets/maps/<file>.map  ->  ../textures/<name>.png
+    std::vector<std::string> textureNames;
+    std::vector<PackagedAssetEntry> textureSources;
 
+    // Sizes are filled in by the ingest pass once every name is known.
     auto GetTex = [&](const std::string& n)->uint32_t {
         const std::string& resolvedName = n.empty() ? std::string("default") : n;
         auto it = texIdx.find(resolvedName);
         if (it!=texIdx.end()) return it->second;
-        TexInfo ti = ProbeTexture(mapDir, resolvedName, texCache);
+        const TexInfo ti;
         BSPTexture bt{}; strncpy(bt.name, resolvedName.c_str(), 63); bt.width=ti.w; bt.height=ti.h;
         uint32_t idx=(uint32_t)textures.size(); textures.push_back(bt);
-        if (IsPackableTextureName(resolvedName)) {
-            packagedAssets.push_back({
-                "textures/" + resolvedName + ".png",
-                mapDir + "/../textures/" + resolvedName + ".png"
-            });
-        }
+        texCache[resolvedName] = ti;
+        textureNames.push_back(resolvedName);
+        textureSources.push_back({
+            IsPackableTextureName(resolvedName) ? "textures/" + resolvedName + ".png" : std::string(),
+            mapDir + "/../textures/" + resolvedName + ".png"
+        });
         texIdx[resolvedName]=idx; return idx;
     };
 
-    StructuralBSPData structural = BuildStructuralBSP(unionPolys, GetTex);
+    int worldEntityId = -1;
+    for (size_t i = 0; i < map.entities.size(); ++i) {
+        if (EntityHasClass(map.entities[i], "worldspawn")) {
+            worldEntityId = (int)i;
+            break;
+        }
+    }
+    // Face textures are assigned once the outside fill has run, so a texture
+    // only culled faces use is never registered or packed.
+    StructuralBSPData structural = BuildStructuralBSP(unionPolys, worldEntityId,
+                                                      [](const std::string&) { return BSP_FACE_TEXTURE_NONE; });
+    std::vector<LeafPortal> leafPortals = BuildLeafPortals(structural);
+
+    // Flood from the player starts. On a sealed map the void is filled and
+    // every face only the void could see is left out of the bake; on a leak
+    // the path goes to a pointfile beside the .bsp and every face stays.
+    std::vector<Vector3> fillStarts;
+    for (const PlayerStart& start : GetPlayerStarts(map)) {
+        fillStarts.push_back(start.position);
+    }
+    const OutsideFillResult fill = FillOutside(structural, leafPortals, fillStarts);
+    const std::string pointFileName = outName.substr(0, outName.size() - 4) + ".pts";
+    std::vector<uint8_t> polyReachable(unionPolys.size(), 1);
+    if (fill.leaked) {
+        const bool wrote = WritePointFile(pointFileName, fill.leakPath);
+        printf("[compile_map] warning: map leaks (%zu point path%s%s); keeping every face\n",
+               fill.leakPath.size(), wrote ? ", see " : "", wrote ? pointFileName.c_str() : "");
+    } else if (!fill.filled) {
+        printf("[compile_map] no player start in empty space; skipping outside fill, keeping every face\n");
+    } else {
+        remove(pointFileName.c_str());
+        for (size_t i = 0; i < structural.faceSourcePolys.size(); ++i) {
+            if (!fill.faceReachable[i]) {
+                polyReachable[structural.faceSourcePolys[i]] = 0;
+            }
+        }
+    }
+
     // Geometry ownership stops at the parser CSG union. The BSP builder only
-    // indexes these polygons; it must not replace them with split fragments.
-    const std::vector<MapPolygon>& bspPolys = unionPolys;
+    // indexes these polygons; it must not replace them with split fragments,
+    // so the outside fill drops whole union polygons here.
+    std::vector<MapPolygon> bspPolys;
+    bspPolys.reserve(unionPolys.size());
+    size_t culledFaces = 0;
+    double culledLuxels = 0.0;
+    const float luxelArea = std::max(0.125f, lightSettings.luxelSize) * std::max(0.125f, lightSettings.luxelSize);
+    for (size_t i = 0; i < unionPolys.size(); ++i) {
+        if (polyReachable[i]) {
+            bspPolys.push_back(unionPolys[i]);
+            continue;
+        }
+        ++culledFaces;
+        culledLuxels += PolygonArea3D(unionPolys[i].verts) / luxelArea;
+    }
+    if (fill.filled) {
+        printf("[compile_map] outside fill: %zu leaves filled, %zu of %zu faces culled (~%.0f luxels)\n",
+               fill.filledLeaves, culledFaces, unionPolys.size(), culledLuxels);
+    }
+    // Register in BSP face order first so texture indices match a build
+    // that culls nothing, then pick up faces the BSP only lists by leaf.
+    for (uint32_t sourcePoly : structural.faceSourcePolys) {
+        if (polyReachable[sourcePoly]) {
+            GetTex(unionPolys[sourcePoly].texture);
+        }
+    }
+    for (const MapPolygon& poly : bspPolys) {
+        GetTex(poly.texture);
+    }
+    // A culled face keeps BSP_FACE_TEXTURE_NONE unless a surviving face
+    // shares its texture.
+    for (size_t i = 0; i < structural.faces.size(); ++i) {
+        const std::string& name = unionPolys[structural.faceSourcePolys[i]].texture;
+        auto it = texIdx.find(name.empty() ? std::string("default") : name);
+        if (it != texIdx.end()) {
+            structural.faces[i].textureIndex = it->second;
+        }
+    }
+
+    // Every texture the map uses is known now. Each PNG is decoded once on
+    // the worker pool for its size, its bounce colour and its packed mips;
+    // the pack streams out in texture order while the rest still decode.
+    // A failure here is reported after the .bsp is written, as before.
+    const auto ingestStart = std::chrono::steady_clock::now();
+    std::vector<Vector3> textureAverageColors(textures.size(), Vector3{0.5f, 0.5f, 0.5f});
+    std::vector<TextureIngestInfo> textureInfo;
+    std::string packError;
+    const bool packOk = IngestTextures(
+        textureSources, outPackName, packTextureFormat,
+        [&](size_t index, const TextureIngestInfo& info, const unsigned char* rgba) {
+            textureAverageColors[index] = TextureAverageColor(rgba, info);
+        },
+        &textureInfo, &packError);
+    for (size_t i = 0; i < textures.size(); ++i) {
+        const std::string& name = textureNames[i];
+        if (!textureInfo[i].loaded) {
+            printf("[compile_map] texture '%s' not found, assuming 64x64\n", name.c_str());
+            continue;
+        }
+        textures[i].width = textureInfo[i].width;
+        textures[i].height = textureInfo[i].height;
+        texCache[name] = TexInfo{ textureInfo[i].width, textureInfo[i].height };
+    }
+    printf("[compile_map] ingested %zu textures in %.1f ms\n", textures.size(),
+           std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - ingestStart).count());
+
     std::unordered_map<std::string, Vector3> textureBounceColors;
     for (const MapPolygon& poly : bspPolys) {
-        textureBounceColors[poly.texture] = ProbeTextureAverageColor(mapDir, poly.texture, textureColorCache);
+        const bool sampled = !poly.texture.empty() && IsPackableTextureName(poly.texture);
+        textureBounceColors[poly.texture] = sampled ? textureAverageColors[texIdx[poly.texture]]
+                                                    : Vector3{0.5f, 0.5f, 0.5f};
     }
     printf("[compile_map] structural bsp: %zu raw faces -> %zu union faces -> %zu bsp faces, %zu planes, %zu nodes, %zu leaves\n",
            rawPolys.size(), unionPolys.size(), bspPolys.size(), structural.planes.size(), structural.nodes.size(), structural.leaves.size());
 
+    const OccluderSelection occluders = SelectOccluders(bspPolys, worldEntityId);
+    printf("[compile_map] occluders: %zu polygons, %zu vertices, %.0f%% of the opaque world area\n",
+           occluders.occluders.size(), occluders.verts.size(),
+           occluders.candidateArea > 0.0 ? 100.0 * occluders.area / occluders.candidateArea : 0.0);
+
+    std::vector<uint8_t> visData;
+    if (visMode != 0) {
+        const auto visStart = std::chrono::steady_clock::now();
+        const LeafVisibility vis = ComputeLeafVisibility(structural, leafPortals, visMode);
+        visData = SerializeVisRows(vis.header, vis.rowOffsets, vis.rows);
+        printf("[compile_map] %s vis: %zu portals, %.1f of %zu leaves visible on average, %zu bytes, %.1f ms\n",
+               visMode == BSP_VIS_MODE_FULL ? "full" : "fast", vis.portalCount, vis.averageVisibleLeaves,
+               structural.leaves.size(), visData.size(),
+               std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - visStart).count());
+    }
+
+    // The lightmap lump streams into the file while the bake runs, so the
+    // output is opened first and the remaining lumps follow once it is done.
+    // It is written beside the target and only renamed over it once complete,
+    // so a failed or interrupted compile keeps the last good map.
+    const std::string tmpOutName = outName + ".tmp";
+    FILE* f = fopen(tmpOutName.c_str(),"wb");
+    if (!f) { fprintf(stderr,"Cannot open %s for write\n",tmpOutName.c_str()); return 1; }
+
+    LumpWriter lw{f};
+    lw.Begin();
+
+    std::vector<long> lmPageOffsets;
+    bool lmLumpReserved = false;
+    LightmapPageSink lmSink;
+    lmSink.begin = [&](const std::vector<LightmapPage>& pages) {
+        std::vector<BSPLightmapPageHeader> pageHeaders(pages.size());
+        size_t lmLumpSize = sizeof(BSPLightmapLumpHeader) + pages.size() * sizeof(BSPLightmapPageHeader);
+        for (size_t i = 0; i < pages.size(); ++i) {
+            const LightmapPage& page = pages[i];
+            pageHeaders[i] = BSPLightmapPageHeader{
+                (uint32_t)page.width,
+                (uint32_t)page.height,
+                (uint32_t)LightmapPageByteSize(page.encodedFormat, page.width, page.height),
+                page.encodedFormat
+            };
+            lmLumpSize += pageHeaders[i].byteLength;
+        }
+
+        const long lmLumpOffset = lw.Reserve(LUMP_LIGHTMAP, lmLumpSize);
+        lmLumpReserved = true;
+        const BSPLightmapLumpHeader lmHeader{ (uint32_t)pages.size() };
+        lw.WriteAt(lmLumpOffset, &lmHeader, sizeof(lmHeader));
+        lw.WriteAt(lmLumpOffset + (long)sizeof(lmHeader), pageHeaders.data(), pageHeaders.size() * sizeof(BSPLightmapPageHeader));
+
+        long pageOffset = lmLumpOffset + (long)(sizeof(lmHeader) + pageHeaders.size() * sizeof(BSPLightmapPageHeader));
+        lmPageOffsets.resize(pages.size());
+        for (size_t i = 0; i < pages.size(); ++i) {
+            lmPageOffsets[i] = pageOffset;
+            pageOffset += (long)pageHeaders[i].byteLength;
+        }
+    };
+    lmSink.write = [&](uint32_t pageIndex, const LightmapPage& page) {
+        if (pageIndex < lmPageOffsets.size()) {
+            lw.WriteAt(lmPageOffsets[pageIndex], page.encoded.data(), page.encoded.size());
+        }
+    };
+
     printf("[compile_map] baking lightmap...\n");
     // Leave occluderPolys empty so BakeLightmap builds the shadow scene from
     // the filtered bake-surface list and source-poly indices stay aligned.
@@ -311,14 +607,27 @@ int main(int argc, char** argv)
                                     surfaceLights,
                                     textureBounceColors,
                                     lightSettings,
-                                    backendMode);
+                                    backendMode,
+                                    &lmSink,
+                                    maxLightmapMemoryBytes);
+    if (!lmLumpReserved) {
+        // Nothing was packed, so the sink never reserved the lump.
+        const BSPLightmapLumpHeader lmHeader{ 0u };
+        lw.WriteRaw(LUMP_LIGHTMAP, &lmHeader, sizeof(lmHeader));
+    }
 
     // ----- triangulate into buckets ---------------------------------------
     std::vector<BSPVertex>  vertices;
     std::vector<uint32_t>   indices;
     std::vector<BSPMesh>    meshes;
 
-    struct Bucket { uint32_t firstIdx, firstVtx; uint32_t lightmapPage = 0; std::vector<BSPVertex> v; std::vector<uint32_t> i; };
+    std::vector<BSPMeshCluster> meshClusters;
+
+    struct Bucket {
+        uint32_t lightmapPage = 0;
+        std::vector<MeshClusterPolygon> polys;
+        std::vector<MeshCluster> clusters;
+    };
     std::unordered_map<uint64_t,Bucket> buckets;
 
     for (size_t pi=0; pi<lm.patches.size(); ++pi) {
@@ -340,28 +649,84 @@ int main(int argc, char** argv)
                              uv.x,uv.y, luv.x,luv.y};
         };
 
-        uint32_t base = (uint32_t)b.v.size();
-        for (size_t vi=0; vi<p.verts.size(); ++vi) b.v.push_back(MakeV(vi));
-        const std::vector<uint32_t> triIndices = TriangulatePolygonIndices(p.verts, p.normal);
-        for (uint32_t triIndex : triIndices) {
-            b.i.push_back(base + triIndex);
+        MeshClusterPolygon& poly = b.polys.emplace_back();
+        for (size_t vi=0; vi<p.verts.size(); ++vi) poly.vertices.push_back(MakeV(vi));
+        // Compact vertices store the diffuse uv as half floats, which lose
+        // precision far from zero, so each polygon's uvs move by whole
+        // repeats to near zero; sampling is unchanged. -vertex-format full
+        // keeps the uvs as computed.
+        if (vertexFormat != VERTEX_FORMAT_FULL) {
+            ShiftPolygonUVs(poly.vertices.data(), poly.vertices.size());
         }
+        poly.indices = TriangulatePolygonIndices(p.verts, p.normal);
     }
 
-    // flatten buckets → lumps
+    // split buckets into spatial clusters, then weld each and order it for
+    // the post-transform cache and vertex fetch
+    MeshOptimizeStats meshStats;
+    size_t clusterCount = 0;
+    for (auto& kv : buckets) {
+        kv.second.clusters = BuildMeshClusters(kv.second.polys);
+        kv.second.polys.clear();
+        for (MeshCluster& c : kv.second.clusters) {
+            OptimizeMesh(c.vertices, c.indices, &meshStats);
+        }
+        clusterCount += kv.second.clusters.size();
+    }
+    if (meshStats.triangleCount > 0) {
+        const double triangles = (double)meshStats.triangleCount;
+        printf("[compile_map] render clusters: %zu in %zu meshes, %.1f triangles each on average\n",
+               clusterCount, buckets.size(), triangles / (double)clusterCount);
+        printf("[compile_map] mesh optimise: %zu -> %zu vertices, ACMR %.3f -> %.3f (FIFO %d, %zu triangles)\n",
+               meshStats.vertexCountBefore, meshStats.vertexCountAfter,
+               meshStats.cacheMissesBefore / triangles, meshStats.cacheMissesAfter / triangles,
+               MESH_ACMR_CACHE_SIZE, meshStats.triangleCount);
+    }
+
+    // flatten buckets → lumps; a mesh's clusters tile its ranges in order
     for (auto& kv : buckets) {
         BSPMesh m{};
         m.textureIndex = (uint32_t)(kv.first & 0xFFFFFFFFu);
         m.lightmapPage = kv.second.lightmapPage;
         m.firstVertex  = (uint32_t)vertices.size();
-        m.vertexCount  = (uint32_t)kv.second.v.size();
         m.firstIndex   = (uint32_t)indices.size();
-        m.indexCount   = (uint32_t)kv.second.i.size();
-        for (auto& v : kv.second.v) vertices.push_back(v);
-        for (auto  i : kv.second.i) indices.push_back(i + m.firstVertex);
+        for (const MeshCluster& c : kv.second.clusters) {
+            BSPMeshCluster bc{};
+            bc.meshIndex   = (uint32_t)meshes.size();
+            bc.firstVertex = (uint32_t)vertices.size();
+            bc.vertexCount = (uint32_t)c.vertices.size();
+            bc.firstIndex  = (uint32_t)indices.size();
+            bc.indexCount  = (uint32_t)c.indices.size();
+            bc.minX = c.min.x; bc.minY = c.min.y; bc.minZ = c.min.z;
+            bc.maxX = c.max.x; bc.maxY = c.max.y; bc.maxZ = c.max.z;
+            for (auto& v : c.vertices) vertices.push_back(v);
+            for (auto  i : c.indices) indices.push_back(i + bc.firstVertex);
+            meshClusters.push_back(bc);
+        }
+        m.vertexCount  = (uint32_t)vertices.size() - m.firstVertex;
+        m.indexCount   = (uint32_t)indices.size() - m.firstIndex;
         meshes.push_back(m);
     }
 
+    // ----- compact vertices ------------------------------------------------
+    std::vector<BSPVertexCompact> compactVertices;
+    if (vertexFormat != VERTEX_FORMAT_FULL) {
+        CompactVertexError error;
+        compactVertices = EncodeCompactVertices(vertices, meshes, textures, lm.pages, &error);
+        const bool withinTolerance = error.texels <= COMPACT_VERTEX_MAX_TEXEL_ERROR &&
+                                     error.luxels <= COMPACT_VERTEX_MAX_LUXEL_ERROR;
+        printf("[compile_map] compact vertices: max error %.3f texels, %.4f luxels, %.2f deg normal%s\n",
+               error.texels, error.luxels, error.normalDegrees,
+               withinTolerance ? "" : " (over tolerance)");
+        if (!withinTolerance && vertexFormat == VERTEX_FORMAT_AUTO) {
+            printf("[compile_map] keeping full-precision vertices\n");
+            compactVertices.clear();
+        }
+    }
+    if (!compactVertices.empty()) {
+        vertices.clear();
+    }
+
     // ----- collision -------------------------------------------------------
     std::vector<MeshCollisionData> coll = ExtractCollisionData(map);
     std::vector<BSPHull> hulls;
@@ -376,7 +741,7 @@ int main(int argc, char** argv)
         hulls.push_back(h);
     }
 
-    // ----- entity text -----------------------------------------------------
+    // ----- entities ------------------------------------------------------
     std::string entText;
     for (auto& e : map.entities) {
         entText += "{\n";
@@ -386,54 +751,22 @@ int main(int argc, char** argv)
     }
     entText += '\0';
 
-    // ----- lightmap lump ---------------------------------------------------
-    std::vector<std::vector<uint8_t>> encodedLightmapPages;
-    encodedLightmapPages.reserve(lm.pages.size());
-    size_t lmLumpSize = sizeof(BSPLightmapLumpHeader) + lm.pages.size() * sizeof(BSPLightmapPageHeader);
-    for (const LightmapPage& page : lm.pages) {
-        encodedLightmapPages.push_back(EncodeLightmapPageRGBA16F(page));
-        lmLumpSize += encodedLightmapPages.back().size();
-    }
-    std::vector<uint8_t> lmLump(lmLumpSize);
-    uint8_t* lmWrite = lmLump.data();
-
-    BSPLightmapLumpHeader lmHeader{ (uint32_t)lm.pages.size() };
-    memcpy(lmWrite, &lmHeader, sizeof(lmHeader));
-    lmWrite += sizeof(lmHeader);
-
-    for (size_t pageIndex = 0; pageIndex < lm.pages.size(); ++pageIndex) {
-        const LightmapPage& page = lm.pages[pageIndex];
-        BSPLightmapPageHeader pageHeader{
-            (uint32_t)page.width,
-            (uint32_t)page.height,
-            (uint32_t)encodedLightmapPages[pageIndex].size(),
-            BSP_LIGHTMAP_FORMAT_RGBA16F
-        };
-        memcpy(lmWrite, &pageHeader, sizeof(pageHeader));
-        lmWrite += sizeof(pageHeader);
-    }
-
-    for (const std::vector<uint8_t>& encodedPage : encodedLightmapPages) {
-        if (!encodedPage.empty()) {
-            memcpy(lmWrite, encodedPage.data(), encodedPage.size());
-            lmWrite += encodedPage.size();
-        }
-    }
+    EntityTableStorage entityTable;
+    BuildEntityTable(map.entities, &entityTable);
+    const std::vector<uint8_t> entityData = SerializeEntityTable(entityTable);
 
-    // ----- write -----------------------------------------------------------
-    FILE* f = fopen(outName.c_str(),"wb");
-    if (!f) { fprintf(stderr,"Cannot open %s for write\n",outName.c_str()); return 1; }
-
-    LumpWriter lw{f};
-    lw.Begin();
+    // ----- write remaining lumps -------------------------------------------
+    // LUMP_LIGHTMAP is already in the file (see lmSink above).
     lw.Write   (LUMP_TEXTURES, textures);
     lw.Write   (LUMP_VERTICES, vertices);
+    lw.Write   (LUMP_VERTICES_COMPACT, compactVertices);
     lw.Write   (LUMP_INDICES,  indices);
     lw.Write   (LUMP_MESHES,   meshes);
+    lw.Write   (LUMP_MESH_CLUSTERS, meshClusters);
     lw.Write   (LUMP_HULLS,    hulls);
     lw.Write   (LUMP_HULL_PTS, hullPts);
     lw.WriteRaw(LUMP_ENTITIES, entText.data(), entText.size());
-    lw.WriteRaw(LUMP_LIGHTMAP, lmLump.data(),  lmLump.size());
+    lw.Write   (LUMP_ENTITY_DATA, entityData);
     lw.WriteRaw(LUMP_BSP_TREE, &structural.tree, sizeof(structural.tree));
     lw.Write   (LUMP_BSP_PLANES, structural.planes);
     lw.Write   (LUMP_BSP_FACES, structural.faces);
@@ -441,22 +774,45 @@ int main(int argc, char** argv)
     lw.Write   (LUMP_BSP_NODES, structural.nodes);
     lw.Write   (LUMP_BSP_LEAVES, structural.leaves);
     lw.Write   (LUMP_BSP_FACE_REFS, structural.faceRefs);
-    lw.End();
-    fclose(f);
+    lw.Write   (LUMP_VISIBILITY, visData);
+    lw.Write   (LUMP_OCCLUDERS, occluders.occluders);
+    lw.Write   (LUMP_OCCLUDER_VERTS, occluders.verts);
+    if (!lw.Finish()) {
+        fprintf(stderr, "[compile_map] failed to write %s: %s\n", tmpOutName.c_str(),
+                lw.error ? strerror(lw.error) : "a lump lies past the 4 GB the header can address");
+        remove(tmpOutName.c_str());
+        return 1;
+    }
 
-    std::string packError;
-    if (!WriteAssetPackRresWithMipmaps(outPackName, packagedAssets, &packError)) {
+    std::error_code renameError;
+    std::filesystem::rename(tmpOutName, outName, renameError);
+    if (renameError) {
+        fprintf(stderr, "[compile_map] failed to replace %s: %s\n", outName.c_str(), renameError.message().c_str());
+        remove(tmpOutName.c_str());
+        return 1;
+    }
+
+    if (!packOk) {
         fprintf(stderr, "[compile_map] failed to write %s: %s\n", outPackName.c_str(), packError.c_str());
         return 1;
     }
 
+    const std::string lightmapBudget =
+        maxLightmapMemoryBytes > 0 ? std::to_string(maxLightmapMemoryBytes / (1024 * 1024)) + " MB" : std::string("unlimited");
     printf("\n[compile_map] wrote %s\n", outName.c_str());
     printf("[compile_map] wrote %s\n", outPackName.c_str());
-    printf("  textures : %zu\n  vertices : %zu\n  indices  : %zu\n"
-           "  meshes   : %zu\n  hulls    : %zu\n  lightmap pages : %zu\n"
+    printf("  textures : %zu\n  vertices : %zu (%s, %zu bytes)\n  indices  : %zu\n"
+           "  meshes   : %zu (%zu clusters)\n  hulls    : %zu\n  lightmap pages : %zu (peak %.1f MB live, budget %s)\n"
+           "  entities : %zu (%zu properties, %zu keys, %zu string bytes)\n"
            "  bsp faces: %zu\n  bsp nodes: %zu\n  bsp leaves: %zu\n",
-           textures.size(), vertices.size(), indices.size(),
-           meshes.size(), hulls.size(), lm.pages.size(),
+           textures.size(),
+           compactVertices.empty() ? vertices.size() : compactVertices.size(),
+           compactVertices.empty() ? "full" : "compact",
+           compactVertices.empty() ? vertices.size() * sizeof(BSPVertex) : compactVertices.size() * sizeof(BSPVertexCompact),
+           indices.size(),
+           meshes.size(), meshClusters.size(), hulls.size(), lm.pages.size(),
+           (double)lm.peakResidentPageBytes / (1024.0 * 1024.0), lightmapBudget.c_str(),
+           entityTable.entities.size(), entityTable.properties.size(), entityTable.keys.size(), entityTable.strings.size(),
            structural.faces.size(), structural.nodes.size(), structural.leaves.size());
     return 0;
 }
@@ -0,0 +1,690 @@
+#include "leaf_vis.h"
+
+#include "../utils/bsp_vis.h"
+#include "../utils/parallel_for.h"
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <string>
+#include <unordered_map>
+
+namespace {
+
+// Same tolerances as the Quake tools, whose units these maps share.
+static constexpr double kOnEpsilon = 0.1;
+static constexpr double kTinyEdgeLength = 0.2;
+static constexpr double kBaseWindingSize = 1.0e6;
+static constexpr size_t kFlowWavePortals = 256;
+
+struct DVec3 {
+    double x, y, z;
+};
+
+static DVec3 Add(const DVec3& a, const DVec3& b) { return { a.x + b.x, a.y + b.y, a.z + b.z }; }
+static DVec3 Sub(const DVec3& a, const DVec3& b) { return { a.x - b.x, a.y - b.y, a.z - b.z }; }
+static DVec3 Scale(const DVec3& a, double s) { return { a.x * s, a.y * s, a.z * s }; }
+static double Dot(const DVec3& a, const DVec3& b) { return a.x * b.x + a.y * b.y + a.z * b.z; }
+static DVec3 Cross(const DVec3& a, const DVec3& b) {
+    return { a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x };
+}
+
+// normal . p - dist >= 0 is the front side.
+struct DPlane {
+    DVec3  normal;
+    double dist;
+};
+
+using Winding = std::vector<DVec3>;
+
+static DPlane ToDPlane(const BSPPlane& plane) {
+    return { { plane.nx, plane.ny, plane.nz }, -(double)plane.d };
+}
+
+static DPlane Flip(const DPlane& plane) {
+    return { Scale(plane.normal, -1.0), -plane.dist };
+}
+
+static Winding BaseWindingForPlane(const DPlane& plane) {
+    const DVec3& n = plane.normal;
+    const double ax = fabs(n.x);
+    const double ay = fabs(n.y);
+    const double az = fabs(n.z);
+    DVec3 up = (az >= ax && az >= ay) ? DVec3{ 1.0, 0.0, 0.0 } : DVec3{ 0.0, 0.0, 1.0 };
+    up = Sub(up, Scale(n, Dot(up, n)));
+    up = Scale(up, kBaseWindingSize / sqrt(Dot(up, up)));
+    const DVec3 right = Cross(up, n);
+    const DVec3 org = Scale(n, plane.dist);
+    return {
+        Add(Sub(org, right), up),
+        Add(Add(org, right), up),
+        Sub(Add(org, right), up),
+        Sub(Sub(org, right), up)
+    };
+}
+
+// Splits `in` by `plane`. Points within `epsilon` go to both sides; a
+// winding lying on the plane goes to the back.
+static void SplitWinding(const Winding& in, const DPlane& plane, double epsilon, Winding* front, Winding* back) {
+    front->clear();
+    back->clear();
+    const size_t n = in.size();
+    std::vector<double> dists(n + 1);
+    std::vector<int> sides(n + 1);
+    int counts[3] = { 0, 0, 0 };
+    for (size_t i = 0; i < n; ++i) {
+        const double d = Dot(in[i], plane.normal) - plane.dist;
+        dists[i] = d;
+        sides[i] = d > epsilon ? 0 : (d < -epsilon ? 1 : 2);
+        ++counts[sides[i]];
+    }
+    dists[n] = dists[0];
+    sides[n] = sides[0];
+    if (counts[0] == 0) {
+        *back = in;
+        return;
+    }
+    if (counts[1] == 0) {
+        *front = in;
+        return;
+    }
+
+    const double normal[3] = { plane.normal.x, plane.normal.y, plane.normal.z };
+    for (size_t i = 0; i < n; ++i) {
+        const DVec3& p1 = in[i];
+        if (sides[i] == 2) {
+            front->push_back(p1);
+            back->push_back(p1);
+            continue;
+        }
+        (sides[i] == 0 ? front : back)->push_back(p1);
+        if (sides[i + 1] == 2 || sides[i + 1] == sides[i]) {
+            continue;
+        }
+        const DVec3& p2 = in[(i + 1) % n];
+        const double t = dists[i] / (dists[i] - dists[i + 1]);
+        const double a[3] = { p1.x, p1.y, p1.z };
+        const double b[3] = { p2.x, p2.y, p2.z };
+        double mid[3];
+        for (int axis = 0; axis < 3; ++axis) {
+            // Exact on axial planes, so neighbouring portals share edges.
+            if (normal[axis] == 1.0) {
+                mid[axis] = plane.dist;
+            } else if (normal[axis] == -1.0) {
+                mid[axis] = -plane.dist;
+            } else {
+                mid[axis] = a[axis] + t * (b[axis] - a[axis]);
+            }
+        }
+        front->push_back({ mid[0], mid[1], mid[2] });
+        back->push_back({ mid[0], mid[1], mid[2] });
+    }
+    if (front->size() < 3) front->clear();
+    if (back->size() < 3) back->clear();
+}
+
+// Keeps the part of `w` in front of `plane`; returns false once nothing is left.
+static bool ChopWinding(Winding& w, const DPlane& plane) {
+    Winding front;
+    Winding back;
+    SplitWinding(w, plane, kOnEpsilon, &front, &back);
+    w.swap(front);
+    return !w.empty();
+}
+
+static bool WindingIsTiny(const Winding& w) {
+    int edges = 0;
+    for (size_t i = 0; i < w.size(); ++i) {
+        const DVec3 d = Sub(w[(i + 1) % w.size()], w[i]);
+        if (sqrt(Dot(d, d)) > kTinyEdgeLength && ++edges == 3) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// --------------------------------------------------------------------------
+// Portalization: every tree element (node, leaf or the outside) keeps the
+// portals on its boundary; each node's plane cuts a new portal between its
+// children and splits the portals it inherited between them.
+
+struct TreePortal {
+    Winding winding;
+    DPlane  plane;
+    int32_t elements[2];   // [0] on the front of `plane`
+};
+
+class Portalizer {
+public:
+    explicit Portalizer(const StructuralBSPData& bspIn)
+        : bsp(bspIn),
+          nodeCount((int32_t)bspIn.nodes.size()),
+          outsideElement((int32_t)(bspIn.nodes.size() + bspIn.leaves.size())),
+          elementPortals(bspIn.nodes.size() + bspIn.leaves.size() + 1) {
+    }
+
+    std::vector<LeafPortal> Build() {
+        MakeHeadPortals();
+        MakeTreePortals(bsp.tree.rootChild);
+        return CollectLeafPortals();
+    }
+
+private:
+    const StructuralBSPData& bsp;
+    int32_t nodeCount;
+    int32_t outsideElement;
+    std::vector<TreePortal> portals;
+    std::vector<std::vector<uint32_t>> elementPortals;
+
+    int32_t ElementForChild(int32_t child) const {
+        return child >= 0 ? child : nodeCount + (-1 - child);
+    }
+
+    void AddPortal(uint32_t portal, int32_t front, int32_t back) {
+        portals[portal].elements[0] = front;
+        portals[portal].elements[1] = back;
+        elementPortals[(size_t)front].push_back(portal);
+        elementPortals[(size_t)back].push_back(portal);
+    }
+
+    void RemovePortal(uint32_t portal, int32_t element) {
+        std::vector<uint32_t>& list = elementPortals[(size_t)element];
+        list.erase(std::find(list.begin(), list.end(), portal));
+    }
+
+    // The tree's bounding box, with planes facing in, separates the root
+    // from the outside.
+    void MakeHeadPortals() {
+        const float mins[3] = { bsp.boundsMin.x, bsp.boundsMin.y, bsp.boundsMin.z };
+        const float maxs[3] = { bsp.boundsMax.x, bsp.boundsMax.y, bsp.boundsMax.z };
+        DPlane boxPlanes[6];
+        for (int side = 0; side < 2; ++side) {
+            for (int axis = 0; axis < 3; ++axis) {
+                double normal[3] = { 0.0, 0.0, 0.0 };
+                normal[axis] = side ? -1.0 : 1.0;
+                boxPlanes[side * 3 + axis] = {
+                    { normal[0], normal[1], normal[2] },
+                    side ? -(double)maxs[axis] : (double)mins[axis]
+                };
+            }
+        }
+        const int32_t root = ElementForChild(bsp.tree.rootChild);
+        for (int i = 0; i < 6; ++i) {
+            TreePortal portal;
+            portal.plane = boxPlanes[i];
+            portal.winding = BaseWindingForPlane(boxPlanes[i]);
+            for (int k = 0; k < 6; ++k) {
+                if (k != i) {
+                    ChopWinding(portal.winding, boxPlanes[k]);
+                }
+            }
+            portals.push_back(std::move(portal));
+            AddPortal((uint32_t)portals.size() - 1, root, outsideElement);
+        }
+    }
+
+    void MakeTreePortals(int32_t child) {
+        if (child < 0) {
+            return;
+        }
+        MakeNodePortal(child);
+        SplitNodePortals(child);
+        const BSPNode& node = bsp.nodes[(size_t)child];
+        MakeTreePortals(node.frontChild);
+        MakeTreePortals(node.backChild);
+    }
+
+    void MakeNodePortal(int32_t nodeIndex) {
+        const BSPNode& node = bsp.nodes[(size_t)nodeIndex];
+        const DPlane plane = ToDPlane(bsp.planes[(size_t)node.planeIndex]);
+        Winding w = BaseWindingForPlane(plane);
+        for (uint32_t p : elementPortals[(size_t)nodeIndex]) {
+            const TreePortal& portal = portals[p];
+            const DPlane clip = portal.elements[0] == nodeIndex ? portal.plane : Flip(portal.plane);
+            if (!ChopWinding(w, clip)) {
+                return;
+            }
+        }
+        if (WindingIsTiny(w)) {
+            return;
+        }
+        portals.push_back({ std::move(w), plane, { 0, 0 } });
+        AddPortal((uint32_t)portals.size() - 1, ElementForChild(node.frontChild), ElementForChild(node.backChild));
+    }
+
+    void SplitNodePortals(int32_t nodeIndex) {
+        const BSPNode& node = bsp.nodes[(size_t)nodeIndex];
+        const DPlane plane = ToDPlane(bsp.planes[(size_t)node.planeIndex]);
+        const int32_t front = ElementForChild(node.frontChild);
+        const int32_t back = ElementForChild(node.backChild);
+
+        const std::vector<uint32_t> inherited = elementPortals[(size_t)nodeIndex];
+        for (uint32_t p : inherited) {
+            const int side = portals[p].elements[0] == nodeIndex ? 0 : 1;
+            const int32_t other = portals[p].elements[side ^ 1];
+            RemovePortal(p, portals[p].elements[0]);
+            RemovePortal(p, portals[p].elements[1]);
+
+            Winding frontWinding;
+            Winding backWinding;
+            SplitWinding(portals[p].winding, plane, kOnEpsilon, &frontWinding, &backWinding);
+            if (!frontWinding.empty() && WindingIsTiny(frontWinding)) frontWinding.clear();
+            if (!backWinding.empty() && WindingIsTiny(backWinding)) backWinding.clear();
+
+            if (frontWinding.empty() && backWinding.empty()) {
+                continue;
+            }
+            if (frontWinding.empty() || backWinding.empty()) {
+                const int32_t child = frontWinding.empty() ? back : front;
+                if (side == 0) AddPortal(p, child, other);
+                else AddPortal(p, other, child);
+                continue;
+            }
+
+            const DPlane portalPlane = portals[p].plane;
+            portals[p].winding.swap(frontWinding);
+            portals.push_back({ std::move(backWinding), portalPlane, { 0, 0 } });
+            const uint32_t backPortal = (uint32_t)portals.size() - 1;
+            if (side == 0) {
+                AddPortal(p, front, other);
+                AddPortal(backPortal, back, other);
+            } else {
+                AddPortal(p, other, front);
+                AddPortal(backPortal, other, back);
+            }
+        }
+    }
+
+    int32_t LeafForElement(int32_t element) const {
+        return element == outsideElement ? LEAF_PORTAL_OUTSIDE : element - nodeCount;
+    }
+
+    bool IsSolid(int32_t leaf) const {
+        return leaf != LEAF_PORTAL_OUTSIDE && bsp.leaves[(size_t)leaf].contents == BSP_CONTENTS_SOLID;
+    }
+
+    std::vector<LeafPortal> CollectLeafPortals() const {
+        std::vector<LeafPortal> out;
+        for (size_t leaf = 0; leaf < bsp.leaves.size(); ++leaf) {
+            const int32_t element = nodeCount + (int32_t)leaf;
+            for (uint32_t p : elementPortals[(size_t)element]) {
+                const TreePortal& portal = portals[p];
+                // Each portal once: from its front leaf, or from its only leaf.
+                if (portal.elements[0] != element && portal.elements[0] != outsideElement) {
+                    continue;
+                }
+                const int32_t frontLeaf = LeafForElement(portal.elements[0]);
+                const int32_t backLeaf = LeafForElement(portal.elements[1]);
+                if (IsSolid(frontLeaf) || IsSolid(backLeaf)) {
+                    continue;
+                }
+                LeafPortal& lp = out.emplace_back();
+                lp.points.reserve(portal.winding.size());
+                for (const DVec3& v : portal.winding) {
+                    lp.points.push_back({ (float)v.x, (float)v.y, (float)v.z });
+                }
+                lp.normal = { (float)portal.plane.normal.x, (float)portal.plane.normal.y, (float)portal.plane.normal.z };
+                lp.dist = (float)portal.plane.dist;
+                lp.frontLeaf = frontLeaf;
+                lp.backLeaf = backLeaf;
+            }
+        }
+        return out;
+    }
+};
+
+// --------------------------------------------------------------------------
+// Leaf flow. Every portal between two empty leaves becomes two one-way
+// portals, each listed by the leaf it leads out of and with its plane facing
+// the leaf it leads into.
+
+struct VisPortal {
+    Winding               winding;
+    DPlane                plane;
+    uint32_t              leaf = 0;     // leaf on the far side
+    std::vector<uint64_t> mightSee;     // leaf bits, from the portal flood
+    std::vector<uint64_t> visBits;      // leaf bits, after clipping
+    size_t                mightCount = 0;
+};
+
+static bool TestBit(const std::vector<uint64_t>& bits, uint32_t i) {
+    return (bits[i >> 6] >> (i & 63)) & 1u;
+}
+
+static void SetBit(std::vector<uint64_t>& bits, uint32_t i) {
+    bits[i >> 6] |= uint64_t(1) << (i & 63);
+}
+
+struct FlowFrame {
+    Winding               source;
+    Winding               pass;
+    bool                  hasPass = false;
+    DPlane                portalPlane{};
+    std::vector<uint64_t> mightSee;
+};
+
+class LeafFlow {
+public:
+    LeafFlow(const StructuralBSPData& bsp, const std::vector<LeafPortal>& leafPortals)
+        : words((bsp.leaves.size() + 63) / 64),
+          leafVisPortals(bsp.leaves.size()) {
+        for (const LeafPortal& lp : leafPortals) {
+            if (lp.frontLeaf == LEAF_PORTAL_OUTSIDE || lp.backLeaf == LEAF_PORTAL_OUTSIDE) {
+                continue;
+            }
+            Winding w;
+            for (const Vector3& v : lp.points) {
+                w.push_back({ v.x, v.y, v.z });
+            }
+            const DPlane plane{ { lp.normal.x, lp.normal.y, lp.normal.z }, lp.dist };
+
+            VisPortal& intoFront = portals.emplace_back();
+            intoFront.winding = w;
+            intoFront.plane = plane;
+            intoFront.leaf = (uint32_t)lp.frontLeaf;
+            leafVisPortals[(size_t)lp.backLeaf].push_back((uint32_t)portals.size() - 1);
+
+            VisPortal& intoBack = portals.emplace_back();
+            intoBack.winding.assign(w.rbegin(), w.rend());
+            intoBack.plane = Flip(plane);
+            intoBack.leaf = (uint32_t)lp.backLeaf;
+            leafVisPortals[(size_t)lp.frontLeaf].push_back((uint32_t)portals.size() - 1);
+        }
+    }
+
+    size_t PortalCount() const { return portals.size() / 2; }
+
+    // What each portal might see: leaves reached through chains of portals
+    // that are each at least partly in front of it and facing away from it.
+    void BaseVis() {
+        ParallelFor(portals.size(), [&](size_t i) {
+            VisPortal& p = portals[i];
+            std::vector<uint8_t> portalFront(portals.size(), 0);
+            for (size_t j = 0; j < portals.size(); ++j) {
+                if (j == i) {
+                    continue;
+                }
+                const VisPortal& tp = portals[j];
+                bool anyFront = false;
+                for (const DVec3& v : tp.winding) {
+                    if (Dot(v, p.plane.normal) - p.plane.dist > kOnEpsilon) {
+                        anyFront = true;
+                        break;
+                    }
+                }
+                bool anyBack = false;
+                for (const DVec3& v : p.winding) {
+                    if (Dot(v, tp.plane.normal) - tp.plane.dist < -kOnEpsilon) {
+                        anyBack = true;
+                        break;
+                    }
+                }
+                portalFront[j] = anyFront && anyBack;
+            }
+            p.mightSee.assign(words, 0);
+            std::vector<uint32_t> stack{ p.leaf };
+            SetBit(p.mightSee, p.leaf);
+            while (!stack.empty()) {
+                const uint32_t leaf = stack.back();
+                stack.pop_back();
+                for (uint32_t pn : leafVisPortals[leaf]) {
+                    const uint32_t next = portals[pn].leaf;
+                    if (portalFront[pn] && !TestBit(p.mightSee, next)) {
+                        SetBit(p.mightSee, next);
+                        stack.push_back(next);
+                    }
+                }
+            }
+            for (uint64_t w : p.mightSee) {
+                p.mightCount += (size_t)std::popcount(w);
+            }
+        });
+    }
+
+    // Portals with the smallest flood go first, so the larger ones can
+    // prune against their finished results. They run in fixed waves, and a
+    // portal only prunes against waves before its own, so the bits do not
+    // depend on thread timing or count.
+    void FullVis() {
+        std::vector<uint32_t> order(portals.size());
+        for (size_t i = 0; i < order.size(); ++i) {
+            order[i] = (uint32_t)i;
+        }
+        std::stable_sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) {
+            return portals[a].mightCount < portals[b].mightCount;
+        });
+        done.assign(portals.size(), 0);
+        for (size_t first = 0; first < order.size(); first += kFlowWavePortals) {
+            const size_t count = std::min(kFlowWavePortals, order.size() - first);
+            ParallelFor(count, [&](size_t i) {
+                PortalFlow(order[first + i]);
+            });
+            for (size_t i = 0; i < count; ++i) {
+                done[order[first + i]] = 1;
+            }
+        }
+    }
+
+    // A leaf sees itself and whatever its portals lead to.
+    std::vector<uint64_t> LeafRow(uint32_t leaf, bool full) const {
+        std::vector<uint64_t> row(words, 0);
+        SetBit(row, leaf);
+        for (uint32_t pn : leafVisPortals[leaf]) {
+            const std::vector<uint64_t>& bits = full ? portals[pn].visBits : portals[pn].mightSee;
+            for (size_t w = 0; w < words; ++w) {
+                row[w] |= bits[w];
+            }
+        }
+        return row;
+    }
+
+private:
+    size_t words;
+    std::vector<VisPortal> portals;
+    std::vector<std::vector<uint32_t>> leafVisPortals;
+    std::vector<uint8_t> done;   // per portal: visBits is from an earlier wave
+
+    struct Thread {
+        std::vector<uint64_t> leafVis;
+        DPlane                basePlane;
+    };
+
+    void PortalFlow(uint32_t portalIndex) {
+        VisPortal& p = portals[portalIndex];
+        Thread thread{ std::vector<uint64_t>(words, 0), p.plane };
+        FlowFrame head;
+        head.source = p.winding;
+        head.portalPlane = p.plane;
+        head.mightSee = p.mightSee;
+        RecursiveLeafFlow(p.leaf, thread, head);
+        p.visBits = std::move(thread.leafVis);
+    }
+
+    // Clips `target` to the planes through an edge of `source` and a point
+    // of `pass` that have all of `pass` on one side and `source` on the
+    // other: only that part of `target` can be seen from `source` through
+    // `pass`. With `flipClip` the planes keep the other side, for clipping
+    // with the roles of source and pass swapped.
+    static bool ClipToSeparators(const Winding& source, const Winding& pass, Winding& target, bool flipClip) {
+        for (size_t i = 0; i < source.size(); ++i) {
+            const size_t l = (i + 1) % source.size();
+            const DVec3 v1 = Sub(source[l], source[i]);
+            for (size_t j = 0; j < pass.size(); ++j) {
+                const DVec3 v2 = Sub(pass[j], source[i]);
+                DPlane plane;
+                plane.normal = Cross(v1, v2);
+                const double lengthSq = Dot(plane.normal, plane.normal);
+                if (lengthSq < kOnEpsilon) {
+                    continue;
+                }
+                plane.normal = Scale(plane.normal, 1.0 / sqrt(lengthSq));
+                plane.dist = Dot(pass[j], plane.normal);
+
+                // Orient the plane so the source is behind it.
+                int sourceSide = 0;
+                for (size_t k = 0; k < source.size(); ++k) {
+                    if (k == i || k == l) {
+                        continue;
+                    }
+                    const double d = Dot(source[k], plane.normal) - plane.dist;
+                    if (d < -kOnEpsilon) {
+                        sourceSide = -1;
+                        break;
+                    }
+                    if (d > kOnEpsilon) {
+                        sourceSide = 1;
+                        break;
+                    }
+                }
+                if (sourceSide == 0) {
+                    continue;
+                }
+                if (sourceSide > 0) {
+                    plane = Flip(plane);
+                }
+
+                // It separates only if all of pass is in front.
+                bool separates = true;
+                bool anyFront = false;
+                for (size_t k = 0; k < pass.size(); ++k) {
+                    if (k == j) {
+                        continue;
+                    }
+                    const double d = Dot(pass[k], plane.normal) - plane.dist;
+                    if (d < -kOnEpsilon) {
+                        separates = false;
+                        break;
+                    }
+                    anyFront |= d > kOnEpsilon;
+                }
+                if (!separates || !anyFront) {
+                    continue;
+                }
+                if (flipClip) {
+                    plane = Flip(plane);
+                }
+                if (!ChopWinding(target, plane)) {
+                    return false;
+                }
+            }
+        }
+        return true;
+    }
+
+    void RecursiveLeafFlow(uint32_t leaf, Thread& thread, const FlowFrame& prev) {
+        SetBit(thread.leafVis, leaf);
+
+        FlowFrame frame;
+        frame.mightSee.resize(words);
+        frame.hasPass = true;
+        for (uint32_t pn : leafVisPortals[leaf]) {
+            const VisPortal& p = portals[pn];
+            if (!TestBit(prev.mightSee, p.leaf)) {
+                continue;
+            }
+            // Nothing new can be seen through here.
+            const std::vector<uint64_t>& test = done[pn] ? p.visBits : p.mightSee;
+            uint64_t more = 0;
+            for (size_t w = 0; w < words; ++w) {
+                frame.mightSee[w] = prev.mightSee[w] & test[w];
+                more |= frame.mightSee[w] & ~thread.leafVis[w];
+            }
+            if (!more) {
+                continue;
+            }
+
+            frame.portalPlane = p.plane;
+            frame.pass = p.winding;
+            if (!ChopWinding(frame.pass, thread.basePlane)) {
+                continue;
+            }
+            frame.source = prev.source;
+            if (!ChopWinding(frame.source, Flip(p.plane))) {
+                continue;
+            }
+            if (!prev.hasPass) {
+                // The first leaf past the base portal sees all its portals.
+                RecursiveLeafFlow(p.leaf, thread, frame);
+                continue;
+            }
+            if (!ChopWinding(frame.pass, prev.portalPlane)) {
+                continue;
+            }
+            if (!ClipToSeparators(frame.source, prev.pass, frame.pass, false)) {
+                continue;
+            }
+            if (!ClipToSeparators(prev.pass, frame.source, frame.pass, true)) {
+                continue;
+            }
+            RecursiveLeafFlow(p.leaf, thread, frame);
+        }
+    }
+};
+
+} // namespace
+
+std::vector<LeafPortal> BuildLeafPortals(const StructuralBSPData& bsp)
+{
+    if (bsp.leaves.empty()) {
+        return {};
+    }
+    Portalizer portalizer(bsp);
+    return portalizer.Build();
+}
+
+LeafVisibility ComputeLeafVisibility(const StructuralBSPData& bsp,
+                                     const std::vector<LeafPortal>& portals,
+                                     uint32_t mode)
+{
+    LeafVisibility out;
+    const uint32_t leafCount = (uint32_t)bsp.leaves.size();
+    out.header.leafCount = leafCount;
+    out.header.rowBytes = (leafCount + 7) / 8;
+    out.header.mode = mode;
+    out.rowOffsets.assign(leafCount, BSP_VIS_NO_ROW);
+
+    LeafFlow flow(bsp, portals);
+    out.portalCount = flow.PortalCount();
+    flow.BaseVis();
+    const bool full = mode == BSP_VIS_MODE_FULL;
+    if (full) {
+        flow.FullVis();
+    }
+
+    // Identical rows are stored once.
+    std::unordered_map<std::string, uint32_t> rowByBytes;
+    std::vector<uint8_t> rowBytes(out.header.rowBytes);
+    std::vector<uint8_t> compressed;
+    size_t emptyLeaves = 0;
+    size_t visibleTotal = 0;
+    for (uint32_t leaf = 0; leaf < leafCount; ++leaf) {
+        if (bsp.leaves[leaf].contents == BSP_CONTENTS_SOLID) {
+            continue;
+        }
+        const std::vector<uint64_t> row = flow.LeafRow(leaf, full);
+        for (uint32_t i = 0; i < leafCount; ++i) {
+            // Solid leaves are never drawn from; keep their bits clear so
+            // rows compress better.
+            const bool visible = TestBit(row, i) && bsp.leaves[i].contents != BSP_CONTENTS_SOLID;
+            if (visible) {
+                rowBytes[i >> 3] |= (uint8_t)(1u << (i & 7));
+                ++visibleTotal;
+            } else {
+                rowBytes[i >> 3] &= (uint8_t)~(1u << (i & 7));
+            }
+        }
+        ++emptyLeaves;
+
+        compressed.clear();
+        CompressVisRow(rowBytes.data(), rowBytes.size(), &compressed);
+        auto [it, inserted] = rowByBytes.emplace(std::string(compressed.begin(), compressed.end()),
+                                                 (uint32_t)out.rows.size());
+        if (inserted) {
+            out.rows.insert(out.rows.end(), compressed.begin(), compressed.end());
+        }
+        out.rowOffsets[leaf] = it->second;
+    }
+    out.header.dataBytes = (uint32_t)out.rows.size();
+    out.averageVisibleLeaves = emptyLeaves ? (double)visibleTotal / (double)emptyLeaves : 0.0;
+    return out;
+}
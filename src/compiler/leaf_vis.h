@@ -0,0 +1,40 @@
+#pragma once
+
+#include "structural_bsp.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+inline constexpr int32_t LEAF_PORTAL_OUTSIDE = -1;
+
+// A convex opening between two non-solid cells of the structural tree.
+// `frontLeaf` lies on the side `normal` points to; either side may be
+// LEAF_PORTAL_OUTSIDE, the space beyond the tree's bounds.
+struct LeafPortal {
+    std::vector<Vector3> points;
+    Vector3              normal{};
+    float                dist = 0.0f;   // normal . p == dist on the portal
+    int32_t              frontLeaf = LEAF_PORTAL_OUTSIDE;
+    int32_t              backLeaf = LEAF_PORTAL_OUTSIDE;
+};
+
+// Cuts the tree's bounding box down every node plane and keeps the pieces
+// that separate two empty leaves, or an empty leaf and the outside.
+std::vector<LeafPortal> BuildLeafPortals(const StructuralBSPData& bsp);
+
+struct LeafVisibility {
+    BSPVisHeader          header{};
+    std::vector<uint32_t> rowOffsets;    // per leaf; BSP_VIS_NO_ROW for solid leaves
+    std::vector<uint8_t>  rows;          // compressed, see bsp_vis.h
+    size_t                portalCount = 0;        // between empty leaves
+    double                averageVisibleLeaves = 0.0;
+};
+
+// Potentially visible set of every empty leaf. BSP_VIS_MODE_FAST floods
+// through portals that face each other; BSP_VIS_MODE_FULL also clips each
+// chain of portals against the planes separating its first and last
+// opening, which culls around corners. Both are conservative.
+LeafVisibility ComputeLeafVisibility(const StructuralBSPData& bsp,
+                                     const std::vector<LeafPortal>& portals,
+                                     uint32_t mode);
@@ -8,13 +8,17 @@
 #include "lightmap_constants.h"
 #include "lightmap_compute.h"
 #include "lightmap_trace.h"
+#include "../utils/lightmap_codec.h"
+#include "../utils/parallel_for.h"
 
 #include <algorithm>
 #include <cctype>
+#include <chrono>
 #include <cfloat>
 #include <cmath>
 #include <cstdlib>
 #include <cstdio>
+#include <cstring>
 #include <string>
 #include <unordered_map>
 #include <unordered_set>
@@ -46,6 +50,8 @@ static constexpr float SURFACE_EMITTER_CULL_THRESHOLD = 1.0f / 255.0f;
 static constexpr float SURFACE_EMITTER_CULL_RADIUS_MIN = 32.0f;
 static constexpr float SURFACE_EMITTER_CULL_RADIUS_MAX = 8192.0f;
 static constexpr float LIGHT_ANGLE_EPSILON = 0.01f;
+static constexpr float CROSS_SEAM_NORMAL_EPSILON = 1e-3f;
+static constexpr float CROSS_SEAM_PLANE_EPSILON = 0.1f;
 // Runtime super-sampling grid size set at the top of BakeLightmap from
 // settings.extraSamples (which parses the worldspawn `_extra_samples` key).
 // Valid values: 1 = off (1 sample per luxel), 2 = 2x2, 4 = 4x4 (historical
@@ -514,23 +520,41 @@ static bool PointsEqualEps(const Vector3& a, const Vector3& b, float eps) {
            fabsf(a.z - b.z) <= eps;
 }
 
-static std::string MakeQuantizedPointKey(const Vector3& p, float eps) {
+// Quantized point packed as three signed 21-bit lattice coordinates. At the
+// 0.05 unit phong edge epsilon that covers +/-52k units on every axis.
+static uint64_t MakeQuantizedPointKey(const Vector3& p, float eps) {
+    constexpr int64_t kAxisLimit = (1 << 20) - 1;
     const float inv = 1.0f / std::max(1e-6f, eps);
-    const int x = (int)std::lround(p.x * inv);
-    const int y = (int)std::lround(p.y * inv);
-    const int z = (int)std::lround(p.z * inv);
-    char buffer[96];
-    snprintf(buffer, sizeof(buffer), "%d,%d,%d", x, y, z);
-    return std::string(buffer);
+    const int64_t x = std::clamp<int64_t>(std::llround(p.x * inv), -kAxisLimit, kAxisLimit);
+    const int64_t y = std::clamp<int64_t>(std::llround(p.y * inv), -kAxisLimit, kAxisLimit);
+    const int64_t z = std::clamp<int64_t>(std::llround(p.z * inv), -kAxisLimit, kAxisLimit);
+    constexpr uint64_t kAxisMask = (1ull << 21) - 1;
+    return (((uint64_t)x & kAxisMask) << 42) |
+           (((uint64_t)y & kAxisMask) << 21) |
+           ((uint64_t)z & kAxisMask);
 }
 
-static std::string MakeQuantizedEdgeKey(const Vector3& a, const Vector3& b, float eps) {
-    std::string ka = MakeQuantizedPointKey(a, eps);
-    std::string kb = MakeQuantizedPointKey(b, eps);
-    if (kb < ka) {
-        std::swap(ka, kb);
+struct QuantizedEdgeKey {
+    uint64_t a = 0;
+    uint64_t b = 0;
+
+    bool operator==(const QuantizedEdgeKey& other) const {
+        return a == other.a && b == other.b;
     }
-    return ka + "|" + kb;
+};
+
+struct QuantizedEdgeKeyHash {
+    size_t operator()(const QuantizedEdgeKey& key) const {
+        uint64_t h = key.a * 0x9E3779B97F4A7C15ull;
+        h ^= key.b + 0x9E3779B97F4A7C15ull + (h << 6) + (h >> 2);
+        return (size_t)h;
+    }
+};
+
+static QuantizedEdgeKey MakeQuantizedEdgeKey(const Vector3& a, const Vector3& b, float eps) {
+    const uint64_t ka = MakeQuantizedPointKey(a, eps);
+    const uint64_t kb = MakeQuantizedPointKey(b, eps);
+    return (kb < ka) ? QuantizedEdgeKey{ kb, ka } : QuantizedEdgeKey{ ka, kb };
 }
 
 struct EdgeRef {
@@ -581,7 +605,7 @@ static int FindMatchingPolyEdgeIndex(const MapPolygon& poly,
 static std::vector<PhongSourcePoly> BuildPhongSourcePolys(const std::vector<MapPolygon>& polys) {
     std::vector<PhongSourcePoly> sourcePolys(polys.size());
     constexpr float kEdgeKeyEpsilon = 0.05f;
-    std::unordered_map<std::string, std::vector<EdgeRef>> edgesByKey;
+    std::unordered_map<QuantizedEdgeKey, std::vector<EdgeRef>, QuantizedEdgeKeyHash> edgesByKey;
     edgesByKey.reserve(polys.size() * 4);
 
     for (size_t i = 0; i < polys.size(); ++i) {
@@ -1330,7 +1354,7 @@ static bool TextureNameLooksLikeNonShadowCaster(const std::string& texture) {
         || base == "areaportal";
 }
 
-static bool PolygonCastsShadowForLighting(const MapPolygon& poly) {
+bool PolygonCastsShadowForLighting(const MapPolygon& poly) {
     if (poly.occluderGroup >= 0) {
         return false;
     }
@@ -1705,8 +1729,53 @@ static Vector3 ClosestPointOnPolyBoundaryProjected(const std::vector<Vector2>& p
                                  Vector3Scale(axisV, bestPoint.y - currentV)));
 }
 
+// Placement and plane basis of a bake rect. This is all the CPU shading,
+// packing, seam and post passes read per luxel, so it stays small; the
+// fixed-size compute payload (polygon and phong tables) is only assembled from
+// the side tables when a page is actually dispatched to the GPU.
+// It stays one record per rect rather than a column per field: every pass
+// that maps a luxel to the world reads all of it for the same rect, and at
+// 76 bytes one rect's basis is about one cache line.
+struct FaceRectBasis {
+    int w = 0;
+    int h = 0;
+    int x = 0;
+    int y = 0;
+    float luxelSize = 1.0f;
+    float minU = 0.0f;
+    float minV = 0.0f;
+    Vector3 origin{};
+    Vector3 axisU{};
+    Vector3 axisV{};
+    Vector3 normal{};
+};
+
+enum class ComputeFallbackReason : uint8_t {
+    NONE = 0,
+    INVALID_REPAIR_SOURCE,
+    REPAIR_SOURCE_VERTEX_LIMIT,
+    PHONG_NEIGHBOR_LIMIT,
+    POLY_VERTEX_LIMIT,
+};
+
+static const char* ComputeFallbackReasonText(ComputeFallbackReason reason) {
+    switch (reason) {
+        case ComputeFallbackReason::INVALID_REPAIR_SOURCE:
+            return "page references an invalid repair source polygon";
+        case ComputeFallbackReason::REPAIR_SOURCE_VERTEX_LIMIT:
+            return "page contains source polygon(s) exceeding compute repair vertex limit";
+        case ComputeFallbackReason::PHONG_NEIGHBOR_LIMIT:
+            return "page uses phong smoothing with too many neighboring faces for the compute baker";
+        case ComputeFallbackReason::POLY_VERTEX_LIMIT:
+            return "page contains polygon(s) exceeding compute vertex limit";
+        case ComputeFallbackReason::NONE:
+        default:
+            return "";
+    }
+}
+
 struct FaceRect {
-    LightmapComputeFaceRect gpu;
+    FaceRectBasis basis;
     std::vector<Vector2> poly2d;
     std::vector<Vector2> polyGlobal2d;
     AABB bounds{};
@@ -1720,17 +1789,35 @@ struct FaceRect {
     float maxU = 0.0f;
     float maxV = 0.0f;
     bool computeCompatible = true;
-    std::string computeFallbackReason;
+    ComputeFallbackReason computeFallbackReason = ComputeFallbackReason::NONE;
 };
 
-static std::string FaceRectSourceSurfaceKey(const FaceRect& rect) {
+// Brush-face sources key on their full entity, brush and face ids; polygons
+// without a brush face fall back to their source polygon index, tagged in the
+// top bit so the two kinds never meet.
+struct SourceSurfaceKey {
+    uint64_t entityBrush = 0;
+    uint64_t faceOrPoly = 0;
+
+    bool operator==(const SourceSurfaceKey& other) const {
+        return entityBrush == other.entityBrush && faceOrPoly == other.faceOrPoly;
+    }
+};
+
+struct SourceSurfaceKeyHash {
+    size_t operator()(const SourceSurfaceKey& key) const {
+        uint64_t h = key.entityBrush * 0x9E3779B97F4A7C15ull;
+        h ^= key.faceOrPoly + 0x9E3779B97F4A7C15ull + (h << 6) + (h >> 2);
+        return (size_t)h;
+    }
+};
+
+static SourceSurfaceKey FaceRectSourceSurfaceKey(const FaceRect& rect) {
     if (rect.sourceEntityId >= 0 && rect.sourceBrushId >= 0 && rect.sourceFaceIndex >= 0) {
-        return std::string("face:") +
-               std::to_string(rect.sourceEntityId) + ":" +
-               std::to_string(rect.sourceBrushId) + ":" +
-               std::to_string(rect.sourceFaceIndex);
+        return { ((uint64_t)(uint32_t)rect.sourceEntityId << 32) | (uint32_t)rect.sourceBrushId,
+                 (uint64_t)(uint32_t)rect.sourceFaceIndex };
     }
-    return std::string("poly:") + std::to_string(rect.sourcePolyIndex);
+    return { 0, (1ull << 63) | rect.sourcePolyIndex };
 }
 
 static bool FaceRectsShareSourceSurface(const FaceRect& a, const FaceRect& b) {
@@ -1744,15 +1831,37 @@ static bool FaceRectsShareSourceSurface(const FaceRect& a, const FaceRect& b) {
     return a.sourcePolyIndex == b.sourcePolyIndex;
 }
 
-static std::unordered_map<std::string, std::vector<size_t>> GroupRectsBySourceSurface(const std::vector<FaceRect>& rects) {
-    std::unordered_map<std::string, std::vector<size_t>> rectsBySourceSurface;
-    rectsBySourceSurface.reserve(rects.size());
-    for (size_t i = 0; i < rects.size(); ++i) {
-        rectsBySourceSurface[FaceRectSourceSurfaceKey(rects[i])].push_back(i);
+// Groups come back in order of their first rect so every pass that walks them
+// visits source surfaces deterministically. `rectIndices` (ascending) limits
+// the grouping to part of the table, e.g. the rects of one page island.
+static std::vector<std::pair<SourceSurfaceKey, std::vector<size_t>>> GroupRectsBySourceSurface(const std::vector<FaceRect>& rects,
+                                                                                      const std::vector<size_t>& rectIndices) {
+    std::vector<std::pair<SourceSurfaceKey, std::vector<size_t>>> rectsBySourceSurface;
+    std::unordered_map<SourceSurfaceKey, size_t, SourceSurfaceKeyHash> groupIndexByKey;
+    groupIndexByKey.reserve(rectIndices.size());
+    for (size_t i : rectIndices) {
+        const SourceSurfaceKey key = FaceRectSourceSurfaceKey(rects[i]);
+        const auto [it, inserted] = groupIndexByKey.emplace(key, rectsBySourceSurface.size());
+        if (inserted) {
+            rectsBySourceSurface.push_back({ key, {} });
+        }
+        rectsBySourceSurface[it->second].second.push_back(i);
     }
     return rectsBySourceSurface;
 }
 
+static std::vector<size_t> AllRectIndices(const std::vector<FaceRect>& rects) {
+    std::vector<size_t> rectIndices(rects.size());
+    for (size_t i = 0; i < rectIndices.size(); ++i) {
+        rectIndices[i] = i;
+    }
+    return rectIndices;
+}
+
+static std::vector<std::pair<SourceSurfaceKey, std::vector<size_t>>> GroupRectsBySourceSurface(const std::vector<FaceRect>& rects) {
+    return GroupRectsBySourceSurface(rects, AllRectIndices(rects));
+}
+
 static void BuildComputeRectSurfaceEmitterDispatchData(
     const std::vector<FaceRect>& rects,
     const std::vector<size_t>& rectIndices,
@@ -1865,16 +1974,15 @@ static std::vector<FaceRect> BuildFaceRects(const std::vector<BakePatch>& patche
         const float alignedMaxV = ceilf(maxV / safeLuxelSize) * safeLuxelSize;
         const int interiorW = ComputeInteriorLuxelSpan(alignedMaxU - alignedMinU, safeLuxelSize);
         const int interiorH = ComputeInteriorLuxelSpan(alignedMaxV - alignedMinV, safeLuxelSize);
-        r.gpu.w = interiorW + LM_PAD * 2;
-        r.gpu.h = interiorH + LM_PAD * 2;
-        r.gpu.luxelSize = safeLuxelSize;
-        r.gpu.minU = alignedMinU;
-        r.gpu.minV = alignedMinV;
-        r.gpu.axisU = U;
-        r.gpu.axisV = V;
-        r.gpu.normal = p.normal;
+        r.basis.w = interiorW + LM_PAD * 2;
+        r.basis.h = interiorH + LM_PAD * 2;
+        r.basis.luxelSize = safeLuxelSize;
+        r.basis.minU = alignedMinU;
+        r.basis.minV = alignedMinV;
+        r.basis.axisU = U;
+        r.basis.axisV = V;
+        r.basis.normal = p.normal;
         r.sourcePolyIndex = patches[i].sourcePolyIndex;
-        r.gpu.sourcePolyIndex = (int)r.sourcePolyIndex;
         r.sourceEntityId = p.sourceEntityId;
         r.sourceBrushId = p.sourceBrushId;
         r.sourceFaceIndex = p.sourceFaceIndex;
@@ -1882,39 +1990,18 @@ static std::vector<FaceRect> BuildFaceRects(const std::vector<BakePatch>& patche
         r.maxV = alignedMaxV;
         if (r.sourcePolyIndex >= repairPolys.size()) {
             r.computeCompatible = false;
-            r.computeFallbackReason = "page references an invalid repair source polygon";
+            r.computeFallbackReason = ComputeFallbackReason::INVALID_REPAIR_SOURCE;
         } else if (repairPolys[r.sourcePolyIndex].poly2d.size() > LIGHTMAP_COMPUTE_MAX_POLY_VERTS) {
             r.computeCompatible = false;
-            r.computeFallbackReason = "page contains source polygon(s) exceeding compute repair vertex limit";
-        }
-        if (r.sourcePolyIndex < sourcePhongs.size()) {
-            const PhongSourcePoly& source = sourcePhongs[r.sourcePolyIndex];
-            r.gpu.phongBaseNormal = source.normal;
-            r.gpu.phongBaseAreaWeight = source.areaWeight;
-            if (source.neighbors.size() > LIGHTMAP_COMPUTE_MAX_PHONG_NEIGHBORS) {
-                r.computeCompatible = false;
-                r.computeFallbackReason = "page uses phong smoothing with too many neighboring faces for the compute baker";
-            } else {
-                r.gpu.phongNeighborCount = (int)source.neighbors.size();
-                for (int neighborIndex = 0; neighborIndex < r.gpu.phongNeighborCount; ++neighborIndex) {
-                    const PhongNeighbor& neighbor = source.neighbors[(size_t)neighborIndex];
-                    r.gpu.phongNeighborEdgeA[neighborIndex][0] = neighbor.edgeA.x;
-                    r.gpu.phongNeighborEdgeA[neighborIndex][1] = neighbor.edgeA.y;
-                    r.gpu.phongNeighborEdgeA[neighborIndex][2] = neighbor.edgeA.z;
-                    r.gpu.phongNeighborEdgeA[neighborIndex][3] = 0.0f;
-                    r.gpu.phongNeighborEdgeB[neighborIndex][0] = neighbor.edgeB.x;
-                    r.gpu.phongNeighborEdgeB[neighborIndex][1] = neighbor.edgeB.y;
-                    r.gpu.phongNeighborEdgeB[neighborIndex][2] = neighbor.edgeB.z;
-                    r.gpu.phongNeighborEdgeB[neighborIndex][3] = 0.0f;
-                    r.gpu.phongNeighborNormalWeight[neighborIndex][0] = neighbor.normal.x;
-                    r.gpu.phongNeighborNormalWeight[neighborIndex][1] = neighbor.normal.y;
-                    r.gpu.phongNeighborNormalWeight[neighborIndex][2] = neighbor.normal.z;
-                    r.gpu.phongNeighborNormalWeight[neighborIndex][3] = neighbor.areaWeight;
-                }
-            }
+            r.computeFallbackReason = ComputeFallbackReason::REPAIR_SOURCE_VERTEX_LIMIT;
+        }
+        if (r.sourcePolyIndex < sourcePhongs.size() &&
+            sourcePhongs[r.sourcePolyIndex].neighbors.size() > LIGHTMAP_COMPUTE_MAX_PHONG_NEIGHBORS) {
+            r.computeCompatible = false;
+            r.computeFallbackReason = ComputeFallbackReason::PHONG_NEIGHBOR_LIMIT;
         }
         const float d = Vector3DotProduct(p.verts[0], p.normal);
-        r.gpu.origin = Vector3Add(
+        r.basis.origin = Vector3Add(
             Vector3Scale(p.normal, d),
             Vector3Add(Vector3Scale(U, alignedMinU), Vector3Scale(V, alignedMinV)));
         r.poly2d.reserve(p.verts.size());
@@ -1931,17 +2018,9 @@ static std::vector<FaceRect> BuildFaceRects(const std::vector<BakePatch>& patche
         }
         if (r.poly2d.size() > LIGHTMAP_COMPUTE_MAX_POLY_VERTS) {
             r.computeCompatible = false;
-            r.computeFallbackReason = "page contains polygon(s) exceeding compute vertex limit";
+            r.computeFallbackReason = ComputeFallbackReason::POLY_VERTEX_LIMIT;
             printf("[Lightmap] compute polygon vertex limit exceeded (%zu > %d), page will use CPU fallback.\n",
                    r.poly2d.size(), LIGHTMAP_COMPUTE_MAX_POLY_VERTS);
-        } else {
-            r.gpu.polyCount = (int)r.poly2d.size();
-            for (int pi = 0; pi < r.gpu.polyCount; ++pi) {
-                r.gpu.polyVerts[pi][0] = r.poly2d[(size_t)pi].x;
-                r.gpu.polyVerts[pi][1] = r.poly2d[(size_t)pi].y;
-                r.gpu.polyVerts[pi][2] = 0.0f;
-                r.gpu.polyVerts[pi][3] = 0.0f;
-            }
         }
         r.lightIndices.reserve(lights.size());
         for (uint32_t lightIndex = 0; lightIndex < lights.size(); ++lightIndex) {
@@ -1964,6 +2043,55 @@ static std::vector<FaceRect> BuildFaceRects(const std::vector<BakePatch>& patche
     return rects;
 }
 
+// Expand a rect into the fixed-layout record the compute shader consumes. The
+// polygon and phong tables come from the rect's side tables and the shared
+// phong graph, so only rects on dispatched pages ever pay for them.
+static LightmapComputeFaceRect BuildComputeFaceRect(const FaceRect& r,
+                                                    const std::vector<PhongSourcePoly>& sourcePhongs) {
+    LightmapComputeFaceRect gpu;
+    gpu.w = r.basis.w;
+    gpu.h = r.basis.h;
+    gpu.x = r.basis.x;
+    gpu.y = r.basis.y;
+    gpu.luxelSize = r.basis.luxelSize;
+    gpu.minU = r.basis.minU;
+    gpu.minV = r.basis.minV;
+    gpu.origin = r.basis.origin;
+    gpu.axisU = r.basis.axisU;
+    gpu.axisV = r.basis.axisV;
+    gpu.normal = r.basis.normal;
+    gpu.sourcePolyIndex = (int)r.sourcePolyIndex;
+    if (r.sourcePolyIndex < sourcePhongs.size()) {
+        const PhongSourcePoly& source = sourcePhongs[r.sourcePolyIndex];
+        gpu.phongBaseNormal = source.normal;
+        gpu.phongBaseAreaWeight = source.areaWeight;
+        if (source.neighbors.size() <= LIGHTMAP_COMPUTE_MAX_PHONG_NEIGHBORS) {
+            gpu.phongNeighborCount = (int)source.neighbors.size();
+            for (int neighborIndex = 0; neighborIndex < gpu.phongNeighborCount; ++neighborIndex) {
+                const PhongNeighbor& neighbor = source.neighbors[(size_t)neighborIndex];
+                gpu.phongNeighborEdgeA[neighborIndex][0] = neighbor.edgeA.x;
+                gpu.phongNeighborEdgeA[neighborIndex][1] = neighbor.edgeA.y;
+                gpu.phongNeighborEdgeA[neighborIndex][2] = neighbor.edgeA.z;
+                gpu.phongNeighborEdgeB[neighborIndex][0] = neighbor.edgeB.x;
+                gpu.phongNeighborEdgeB[neighborIndex][1] = neighbor.edgeB.y;
+                gpu.phongNeighborEdgeB[neighborIndex][2] = neighbor.edgeB.z;
+                gpu.phongNeighborNormalWeight[neighborIndex][0] = neighbor.normal.x;
+                gpu.phongNeighborNormalWeight[neighborIndex][1] = neighbor.normal.y;
+                gpu.phongNeighborNormalWeight[neighborIndex][2] = neighbor.normal.z;
+                gpu.phongNeighborNormalWeight[neighborIndex][3] = neighbor.areaWeight;
+            }
+        }
+    }
+    if (r.poly2d.size() <= LIGHTMAP_COMPUTE_MAX_POLY_VERTS) {
+        gpu.polyCount = (int)r.poly2d.size();
+        for (int pi = 0; pi < gpu.polyCount; ++pi) {
+            gpu.polyVerts[pi][0] = r.poly2d[(size_t)pi].x;
+            gpu.polyVerts[pi][1] = r.poly2d[(size_t)pi].y;
+        }
+    }
+    return gpu;
+}
+
 static bool CoverageContains(const std::vector<uint8_t>& coverage,
                              const LightmapPage& page,
                              int x, int y)
@@ -1976,11 +2104,11 @@ static bool CoverageContains(const std::vector<uint8_t>& coverage,
 }
 
 static int InteriorSpanX(const FaceRect& rect) {
-    return std::max(0, rect.gpu.w - LM_PAD * 2);
+    return std::max(0, rect.basis.w - LM_PAD * 2);
 }
 
 static int InteriorSpanY(const FaceRect& rect) {
-    return std::max(0, rect.gpu.h - LM_PAD * 2);
+    return std::max(0, rect.basis.h - LM_PAD * 2);
 }
 
 static bool LocalInteriorIndexFromGlobalCenter(float rectMinCoord,
@@ -2046,19 +2174,19 @@ static size_t WeldVerticalSiblingSeam(const FaceRect& left,
     LightmapPage& rightPage = pages[right.page];
     const std::vector<uint8_t>& leftCoverage = coverageMasks[left.page];
     const std::vector<uint8_t>& rightCoverage = coverageMasks[right.page];
-    const int leftX = left.gpu.x + LM_PAD + leftInteriorW - 1;
-    const int rightX = right.gpu.x + LM_PAD;
+    const int leftX = left.basis.x + LM_PAD + leftInteriorW - 1;
+    const int rightX = right.basis.x + LM_PAD;
 
     size_t welded = 0;
     for (int leftRow = 0; leftRow < leftInteriorH; ++leftRow) {
-        const float globalVCenter = left.gpu.minV + (float)leftRow * left.gpu.luxelSize;
+        const float globalVCenter = left.basis.minV + (float)leftRow * left.basis.luxelSize;
         int rightRow = 0;
-        if (!LocalInteriorIndexFromGlobalCenter(right.gpu.minV, right.gpu.luxelSize, rightInteriorH, globalVCenter, &rightRow)) {
+        if (!LocalInteriorIndexFromGlobalCenter(right.basis.minV, right.basis.luxelSize, rightInteriorH, globalVCenter, &rightRow)) {
             continue;
         }
 
-        const int leftY = left.gpu.y + LM_PAD + leftRow;
-        const int rightY = right.gpu.y + LM_PAD + rightRow;
+        const int leftY = left.basis.y + LM_PAD + leftRow;
+        const int rightY = right.basis.y + LM_PAD + rightRow;
         if (!CoverageContains(leftCoverage, leftPage, leftX, leftY) ||
             !CoverageContains(rightCoverage, rightPage, rightX, rightY)) {
             continue;
@@ -2092,19 +2220,19 @@ static size_t WeldHorizontalSiblingSeam(const FaceRect& bottom,
     LightmapPage& topPage = pages[top.page];
     const std::vector<uint8_t>& bottomCoverage = coverageMasks[bottom.page];
     const std::vector<uint8_t>& topCoverage = coverageMasks[top.page];
-    const int bottomY = bottom.gpu.y + LM_PAD + bottomInteriorH - 1;
-    const int topY = top.gpu.y + LM_PAD;
+    const int bottomY = bottom.basis.y + LM_PAD + bottomInteriorH - 1;
+    const int topY = top.basis.y + LM_PAD;
 
     size_t welded = 0;
     for (int bottomCol = 0; bottomCol < bottomInteriorW; ++bottomCol) {
-        const float globalUCenter = bottom.gpu.minU + (float)bottomCol * bottom.gpu.luxelSize;
+        const float globalUCenter = bottom.basis.minU + (float)bottomCol * bottom.basis.luxelSize;
         int topCol = 0;
-        if (!LocalInteriorIndexFromGlobalCenter(top.gpu.minU, top.gpu.luxelSize, topInteriorW, globalUCenter, &topCol)) {
+        if (!LocalInteriorIndexFromGlobalCenter(top.basis.minU, top.basis.luxelSize, topInteriorW, globalUCenter, &topCol)) {
             continue;
         }
 
-        const int bottomX = bottom.gpu.x + LM_PAD + bottomCol;
-        const int topX = top.gpu.x + LM_PAD + topCol;
+        const int bottomX = bottom.basis.x + LM_PAD + bottomCol;
+        const int topX = top.basis.x + LM_PAD + topCol;
         if (!CoverageContains(bottomCoverage, bottomPage, bottomX, bottomY) ||
             !CoverageContains(topCoverage, topPage, topX, topY)) {
             continue;
@@ -2118,13 +2246,14 @@ static size_t WeldHorizontalSiblingSeam(const FaceRect& bottom,
 }
 
 static size_t WeldSiblingPatchSeams(const std::vector<FaceRect>& rects,
+                                    const std::vector<size_t>& rectIndices,
                                     std::vector<LightmapPage>& pages,
                                     const std::vector<std::vector<uint8_t>>& coverageMasks,
                                     float luxelSize)
 {
     const float kSeamCoordEpsilon = std::max(0.125f, luxelSize) * 0.05f;
 
-    const auto rectsBySourceSurface = GroupRectsBySourceSurface(rects);
+    const auto rectsBySourceSurface = GroupRectsBySourceSurface(rects, rectIndices);
     size_t weldedSamples = 0;
     for (const auto& [sourceSurfaceKey, group] : rectsBySourceSurface) {
         (void)sourceSurfaceKey;
@@ -2137,15 +2266,15 @@ static size_t WeldSiblingPatchSeams(const std::vector<FaceRect>& rects,
             for (size_t j = i + 1; j < group.size(); ++j) {
                 const FaceRect& b = rects[group[j]];
 
-                if (fabsf(a.maxU - b.gpu.minU) <= kSeamCoordEpsilon) {
+                if (fabsf(a.maxU - b.basis.minU) <= kSeamCoordEpsilon) {
                     weldedSamples += WeldVerticalSiblingSeam(a, b, pages, coverageMasks);
-                } else if (fabsf(b.maxU - a.gpu.minU) <= kSeamCoordEpsilon) {
+                } else if (fabsf(b.maxU - a.basis.minU) <= kSeamCoordEpsilon) {
                     weldedSamples += WeldVerticalSiblingSeam(b, a, pages, coverageMasks);
                 }
 
-                if (fabsf(a.maxV - b.gpu.minV) <= kSeamCoordEpsilon) {
+                if (fabsf(a.maxV - b.basis.minV) <= kSeamCoordEpsilon) {
                     weldedSamples += WeldHorizontalSiblingSeam(a, b, pages, coverageMasks);
-                } else if (fabsf(b.maxV - a.gpu.minV) <= kSeamCoordEpsilon) {
+                } else if (fabsf(b.maxV - a.basis.minV) <= kSeamCoordEpsilon) {
                     weldedSamples += WeldHorizontalSiblingSeam(b, a, pages, coverageMasks);
                 }
             }
@@ -2246,7 +2375,7 @@ static bool FaceRectPagePixelFromGlobalUV(const FaceRect& rect,
                                           int* outPageX,
                                           int* outPageY)
 {
-    if (!outPageX || !outPageY || rect.gpu.luxelSize <= 0.0f) {
+    if (!outPageX || !outPageY || rect.basis.luxelSize <= 0.0f) {
         return false;
     }
 
@@ -2256,130 +2385,266 @@ static bool FaceRectPagePixelFromGlobalUV(const FaceRect& rect,
         return false;
     }
 
-    const float localU = (globalUv.x - rect.gpu.minU) / rect.gpu.luxelSize;
-    const float localV = (globalUv.y - rect.gpu.minV) / rect.gpu.luxelSize;
+    const float localU = (globalUv.x - rect.basis.minU) / rect.basis.luxelSize;
+    const float localV = (globalUv.y - rect.basis.minV) / rect.basis.luxelSize;
     const int col = (int)floorf(localU);
     const int row = (int)floorf(localV);
     if (col < 0 || col >= interiorW || row < 0 || row >= interiorH) {
         return false;
     }
 
-    *outPageX = rect.gpu.x + LM_PAD + col;
-    *outPageY = rect.gpu.y + LM_PAD + row;
+    *outPageX = rect.basis.x + LM_PAD + col;
+    *outPageY = rect.basis.y + LM_PAD + row;
     return true;
 }
 
+// ---------------------------------------------------------------------------
+//  Candidate pairs for cross-polygon seam welding.
+//
+//  Every rect edge is registered in a hash keyed by the rect's quantized plane
+//  (normal + distance) and the plane-space grid cells its segment crosses. A
+//  value within tolerance of a cell border is registered on both sides, so any
+//  two rects whose planes match within the weld tolerances and whose edges
+//  touch are guaranteed to share at least one key. Only those pairs are handed
+//  to the exact overlap tests, returned as sorted (i << 32 | j) ids so pairs are
+//  welded in the same order as an exhaustive i < j sweep.
+// ---------------------------------------------------------------------------
+static uint64_t MixSeamHashKey(uint64_t h, int64_t value) {
+    h ^= (uint64_t)value + 0x9E3779B97F4A7C15ull + (h << 6) + (h >> 2);
+    return h;
+}
+
+static void AppendToleranceCells(float value, float tolerance, float cellSize, std::vector<int64_t>* outCells) {
+    const int64_t lo = (int64_t)floorf((value - tolerance) / cellSize);
+    const int64_t hi = (int64_t)floorf((value + tolerance) / cellSize);
+    for (int64_t cell = lo; cell <= hi; ++cell) {
+        outCells->push_back(cell);
+    }
+}
+
+static std::vector<uint64_t> BuildCrossPolygonSeamCandidates(const std::vector<FaceRect>& rects,
+                                                             const std::vector<size_t>& rectIndices,
+                                                             float normalEpsilon,
+                                                             float planeEpsilon,
+                                                             float edgeEpsilon,
+                                                             float gridCellSize)
+{
+    constexpr float kNormalCellSize = 0.05f;
+    constexpr float kPlaneCellSize = 4.0f;
+
+    std::unordered_map<uint64_t, std::vector<uint32_t>> rectsByKey;
+    rectsByKey.reserve(rectIndices.size() * 8);
+    std::vector<uint64_t> planeKeys;
+    std::vector<uint64_t> rectKeys;
+    std::vector<int64_t> cellsX, cellsY, cellsZ, cellsD;
+    for (size_t rectIndex : rectIndices) {
+        const FaceRect& rect = rects[rectIndex];
+        if (rect.polyGlobal2d.size() < 2) {
+            continue;
+        }
+
+        const Vector3& n = rect.basis.normal;
+        cellsX.clear();
+        cellsY.clear();
+        cellsZ.clear();
+        cellsD.clear();
+        AppendToleranceCells(n.x, normalEpsilon, kNormalCellSize, &cellsX);
+        AppendToleranceCells(n.y, normalEpsilon, kNormalCellSize, &cellsY);
+        AppendToleranceCells(n.z, normalEpsilon, kNormalCellSize, &cellsZ);
+        AppendToleranceCells(Vector3DotProduct(n, rect.basis.origin), planeEpsilon, kPlaneCellSize, &cellsD);
+        planeKeys.clear();
+        for (int64_t cx : cellsX) {
+            for (int64_t cy : cellsY) {
+                for (int64_t cz : cellsZ) {
+                    for (int64_t cd : cellsD) {
+                        planeKeys.push_back(MixSeamHashKey(MixSeamHashKey(MixSeamHashKey(MixSeamHashKey(0, cx), cy), cz), cd));
+                    }
+                }
+            }
+        }
+
+        // Walk each edge in pieces no longer than a grid cell and register the
+        // tolerance-expanded bounds of every piece.
+        rectKeys.clear();
+        for (size_t edgeIndex = 0; edgeIndex < rect.polyGlobal2d.size(); ++edgeIndex) {
+            const Vector2& e0 = rect.polyGlobal2d[edgeIndex];
+            const Vector2& e1 = rect.polyGlobal2d[(edgeIndex + 1) % rect.polyGlobal2d.size()];
+            const float dx = e1.x - e0.x;
+            const float dy = e1.y - e0.y;
+            const int pieceCount = std::max(1, (int)ceilf(sqrtf(dx * dx + dy * dy) / gridCellSize));
+            for (int piece = 0; piece < pieceCount; ++piece) {
+                const float t0 = (float)piece / (float)pieceCount;
+                const float t1 = (float)(piece + 1) / (float)pieceCount;
+                const float ax = e0.x + dx * t0;
+                const float ay = e0.y + dy * t0;
+                const float bx = e0.x + dx * t1;
+                const float by = e0.y + dy * t1;
+                const int64_t minCellX = (int64_t)floorf((std::min(ax, bx) - edgeEpsilon) / gridCellSize);
+                const int64_t maxCellX = (int64_t)floorf((std::max(ax, bx) + edgeEpsilon) / gridCellSize);
+                const int64_t minCellY = (int64_t)floorf((std::min(ay, by) - edgeEpsilon) / gridCellSize);
+                const int64_t maxCellY = (int64_t)floorf((std::max(ay, by) + edgeEpsilon) / gridCellSize);
+                for (uint64_t planeKey : planeKeys) {
+                    for (int64_t gy = minCellY; gy <= maxCellY; ++gy) {
+                        for (int64_t gx = minCellX; gx <= maxCellX; ++gx) {
+                            rectKeys.push_back(MixSeamHashKey(MixSeamHashKey(planeKey, gx), gy));
+                        }
+                    }
+                }
+            }
+        }
+        std::sort(rectKeys.begin(), rectKeys.end());
+        rectKeys.erase(std::unique(rectKeys.begin(), rectKeys.end()), rectKeys.end());
+        for (uint64_t key : rectKeys) {
+            rectsByKey[key].push_back((uint32_t)rectIndex);
+        }
+    }
+
+    std::vector<uint64_t> candidates;
+    for (const auto& [key, bucket] : rectsByKey) {
+        (void)key;
+        for (size_t i = 0; i < bucket.size(); ++i) {
+            for (size_t j = i + 1; j < bucket.size(); ++j) {
+                const uint32_t lo = std::min(bucket[i], bucket[j]);
+                const uint32_t hi = std::max(bucket[i], bucket[j]);
+                candidates.push_back(((uint64_t)lo << 32) | (uint64_t)hi);
+            }
+        }
+    }
+    std::sort(candidates.begin(), candidates.end());
+    candidates.erase(std::unique(candidates.begin(), candidates.end()), candidates.end());
+    return candidates;
+}
+
+static float CrossSeamEdgeOverlapEpsilon(float luxelSize) {
+    return std::max(0.05f, luxelSize * 0.1f);
+}
+
+// The pairs WeldCrossPolygonEdgeSeams tests; page island planning links pages
+// through the same list so a weld can never reach outside its island.
+static std::vector<uint64_t> BuildCrossPolygonWeldCandidates(const std::vector<FaceRect>& rects,
+                                                             const std::vector<size_t>& rectIndices,
+                                                             float luxelSize)
+{
+    return BuildCrossPolygonSeamCandidates(rects,
+                                           rectIndices,
+                                           CROSS_SEAM_NORMAL_EPSILON,
+                                           CROSS_SEAM_PLANE_EPSILON,
+                                           CrossSeamEdgeOverlapEpsilon(luxelSize),
+                                           std::max(32.0f, luxelSize * 8.0f));
+}
+
 static size_t WeldCrossPolygonEdgeSeams(const std::vector<FaceRect>& rects,
+                                        const std::vector<size_t>& rectIndices,
                                         std::vector<LightmapPage>& pages,
                                         const std::vector<std::vector<uint8_t>>& coverageMasks,
                                         float luxelSize)
 {
-    const float kNormalEpsilon = 1e-3f;
-    const float kPlaneEpsilon = 0.1f;
-    const float kEdgeOverlapEpsilon = std::max(0.05f, luxelSize * 0.1f);
+    const float kNormalEpsilon = CROSS_SEAM_NORMAL_EPSILON;
+    const float kPlaneEpsilon = CROSS_SEAM_PLANE_EPSILON;
+    const float kEdgeOverlapEpsilon = CrossSeamEdgeOverlapEpsilon(luxelSize);
     const float kBoundsEpsilon = std::max(0.125f, luxelSize);
     const float kInsetDistance = std::max(0.125f, luxelSize * 0.5f);
 
+    const std::vector<uint64_t> candidatePairs = BuildCrossPolygonWeldCandidates(rects, rectIndices, luxelSize);
+
     size_t weldedSamples = 0;
     std::unordered_set<uint64_t> weldedPairs;
-    for (size_t i = 0; i < rects.size(); ++i) {
-        const FaceRect& a = rects[i];
-        for (size_t j = i + 1; j < rects.size(); ++j) {
-            const FaceRect& b = rects[j];
+    for (uint64_t candidatePair : candidatePairs) {
+        const FaceRect& a = rects[(size_t)(candidatePair >> 32)];
+        const FaceRect& b = rects[(size_t)(candidatePair & 0xFFFFFFFFull)];
 
-            if (FaceRectsShareSourceSurface(a, b)) {
-                continue;
-            }
+        if (FaceRectsShareSourceSurface(a, b)) {
+            continue;
+        }
 
-            const Vector3 normalDiff = Vector3Subtract(a.gpu.normal, b.gpu.normal);
-            if (Vector3DotProduct(normalDiff, normalDiff) > kNormalEpsilon * kNormalEpsilon) {
-                continue;
-            }
+        const Vector3 normalDiff = Vector3Subtract(a.basis.normal, b.basis.normal);
+        if (Vector3DotProduct(normalDiff, normalDiff) > kNormalEpsilon * kNormalEpsilon) {
+            continue;
+        }
 
-            const float planeA = Vector3DotProduct(a.gpu.normal, a.gpu.origin);
-            const float planeB = Vector3DotProduct(b.gpu.normal, b.gpu.origin);
-            if (fabsf(planeA - planeB) > kPlaneEpsilon) {
-                continue;
-            }
+        const float planeA = Vector3DotProduct(a.basis.normal, a.basis.origin);
+        const float planeB = Vector3DotProduct(b.basis.normal, b.basis.origin);
+        if (fabsf(planeA - planeB) > kPlaneEpsilon) {
+            continue;
+        }
 
-            if (a.maxU + kBoundsEpsilon < b.gpu.minU || b.maxU + kBoundsEpsilon < a.gpu.minU ||
-                a.maxV + kBoundsEpsilon < b.gpu.minV || b.maxV + kBoundsEpsilon < a.gpu.minV) {
-                continue;
-            }
+        if (a.maxU + kBoundsEpsilon < b.basis.minU || b.maxU + kBoundsEpsilon < a.basis.minU ||
+            a.maxV + kBoundsEpsilon < b.basis.minV || b.maxV + kBoundsEpsilon < a.basis.minV) {
+            continue;
+        }
 
-            if (a.page >= pages.size() || b.page >= pages.size() ||
-                a.page >= coverageMasks.size() || b.page >= coverageMasks.size()) {
-                continue;
-            }
+        if (a.page >= pages.size() || b.page >= pages.size() ||
+            a.page >= coverageMasks.size() || b.page >= coverageMasks.size()) {
+            continue;
+        }
+
+        const LightmapPage& aPage = pages[a.page];
+        const LightmapPage& bPage = pages[b.page];
+        const std::vector<uint8_t>& aCoverage = coverageMasks[a.page];
+        const std::vector<uint8_t>& bCoverage = coverageMasks[b.page];
+
+        for (size_t aEdge = 0; aEdge < a.polyGlobal2d.size(); ++aEdge) {
+            const Vector2& a0 = a.polyGlobal2d[aEdge];
+            const Vector2& a1 = a.polyGlobal2d[(aEdge + 1) % a.polyGlobal2d.size()];
+            for (size_t bEdge = 0; bEdge < b.polyGlobal2d.size(); ++bEdge) {
+                const Vector2& b0 = b.polyGlobal2d[bEdge];
+                const Vector2& b1 = b.polyGlobal2d[(bEdge + 1) % b.polyGlobal2d.size()];
+
+                Vector2 overlapStart{};
+                Vector2 overlapEnd{};
+                if (!ComputeCollinearSegmentOverlap2D(a0, a1, b0, b1, kEdgeOverlapEpsilon, &overlapStart, &overlapEnd)) {
+                    continue;
+                }
+
+                Vector2 aOffset{};
+                Vector2 bOffset{};
+                if (!ComputePolygonEdgeInteriorOffset(a.polyGlobal2d, overlapStart, overlapEnd, kInsetDistance, &aOffset) ||
+                    !ComputePolygonEdgeInteriorOffset(b.polyGlobal2d, overlapStart, overlapEnd, kInsetDistance, &bOffset)) {
+                    continue;
+                }
 
-            const LightmapPage& aPage = pages[a.page];
-            const LightmapPage& bPage = pages[b.page];
-            const std::vector<uint8_t>& aCoverage = coverageMasks[a.page];
-            const std::vector<uint8_t>& bCoverage = coverageMasks[b.page];
-
-            for (size_t aEdge = 0; aEdge < a.polyGlobal2d.size(); ++aEdge) {
-                const Vector2& a0 = a.polyGlobal2d[aEdge];
-                const Vector2& a1 = a.polyGlobal2d[(aEdge + 1) % a.polyGlobal2d.size()];
-                for (size_t bEdge = 0; bEdge < b.polyGlobal2d.size(); ++bEdge) {
-                    const Vector2& b0 = b.polyGlobal2d[bEdge];
-                    const Vector2& b1 = b.polyGlobal2d[(bEdge + 1) % b.polyGlobal2d.size()];
-
-                    Vector2 overlapStart{};
-                    Vector2 overlapEnd{};
-                    if (!ComputeCollinearSegmentOverlap2D(a0, a1, b0, b1, kEdgeOverlapEpsilon, &overlapStart, &overlapEnd)) {
+                const float overlapDx = overlapEnd.x - overlapStart.x;
+                const float overlapDy = overlapEnd.y - overlapStart.y;
+                const float overlapLength = sqrtf(overlapDx * overlapDx + overlapDy * overlapDy);
+                const int sampleCount = std::max(1, (int)ceilf(overlapLength / std::max(0.25f, luxelSize * 0.5f)));
+                for (int sampleIndex = 0; sampleIndex < sampleCount; ++sampleIndex) {
+                    const float t = ((float)sampleIndex + 0.5f) / (float)sampleCount;
+                    const Vector2 seamPoint = {
+                        overlapStart.x + overlapDx * t,
+                        overlapStart.y + overlapDy * t
+                    };
+                    const Vector2 aSampleUv = { seamPoint.x + aOffset.x, seamPoint.y + aOffset.y };
+                    const Vector2 bSampleUv = { seamPoint.x + bOffset.x, seamPoint.y + bOffset.y };
+
+                    int aPageX = 0;
+                    int aPageY = 0;
+                    int bPageX = 0;
+                    int bPageY = 0;
+                    if (!FaceRectPagePixelFromGlobalUV(a, aSampleUv, &aPageX, &aPageY) ||
+                        !FaceRectPagePixelFromGlobalUV(b, bSampleUv, &bPageX, &bPageY)) {
                         continue;
                     }
 
-                    Vector2 aOffset{};
-                    Vector2 bOffset{};
-                    if (!ComputePolygonEdgeInteriorOffset(a.polyGlobal2d, overlapStart, overlapEnd, kInsetDistance, &aOffset) ||
-                        !ComputePolygonEdgeInteriorOffset(b.polyGlobal2d, overlapStart, overlapEnd, kInsetDistance, &bOffset)) {
+                    if (!CoverageContains(aCoverage, aPage, aPageX, aPageY) ||
+                        !CoverageContains(bCoverage, bPage, bPageX, bPageY)) {
                         continue;
                     }
 
-                    const float overlapDx = overlapEnd.x - overlapStart.x;
-                    const float overlapDy = overlapEnd.y - overlapStart.y;
-                    const float overlapLength = sqrtf(overlapDx * overlapDx + overlapDy * overlapDy);
-                    const int sampleCount = std::max(1, (int)ceilf(overlapLength / std::max(0.25f, luxelSize * 0.5f)));
-                    for (int sampleIndex = 0; sampleIndex < sampleCount; ++sampleIndex) {
-                        const float t = ((float)sampleIndex + 0.5f) / (float)sampleCount;
-                        const Vector2 seamPoint = {
-                            overlapStart.x + overlapDx * t,
-                            overlapStart.y + overlapDy * t
-                        };
-                        const Vector2 aSampleUv = { seamPoint.x + aOffset.x, seamPoint.y + aOffset.y };
-                        const Vector2 bSampleUv = { seamPoint.x + bOffset.x, seamPoint.y + bOffset.y };
-
-                        int aPageX = 0;
-                        int aPageY = 0;
-                        int bPageX = 0;
-                        int bPageY = 0;
-                        if (!FaceRectPagePixelFromGlobalUV(a, aSampleUv, &aPageX, &aPageY) ||
-                            !FaceRectPagePixelFromGlobalUV(b, bSampleUv, &bPageX, &bPageY)) {
-                            continue;
-                        }
-
-                        if (!CoverageContains(aCoverage, aPage, aPageX, aPageY) ||
-                            !CoverageContains(bCoverage, bPage, bPageX, bPageY)) {
-                            continue;
-                        }
-
-                        const uint64_t aPixelId = ((uint64_t)a.page << 20) |
-                                                  ((uint64_t)aPageY << 10) |
-                                                  (uint64_t)aPageX;
-                        const uint64_t bPixelId = ((uint64_t)b.page << 20) |
-                                                  ((uint64_t)bPageY << 10) |
-                                                  (uint64_t)bPageX;
-                        const uint64_t lowId = std::min(aPixelId, bPixelId);
-                        const uint64_t highId = std::max(aPixelId, bPixelId);
-                        const uint64_t pairKey = (lowId << 32) | highId;
-                        if (!weldedPairs.insert(pairKey).second) {
-                            continue;
-                        }
-
-                        AverageLuxelPair(pages[a.page], aPageX, aPageY, pages[b.page], bPageX, bPageY);
-                        ++weldedSamples;
+                    const uint64_t aPixelId = ((uint64_t)a.page << 20) |
+                                              ((uint64_t)aPageY << 10) |
+                                              (uint64_t)aPageX;
+                    const uint64_t bPixelId = ((uint64_t)b.page << 20) |
+                                              ((uint64_t)bPageY << 10) |
+                                              (uint64_t)bPageX;
+                    const uint64_t lowId = std::min(aPixelId, bPixelId);
+                    const uint64_t highId = std::max(aPixelId, bPixelId);
+                    const uint64_t pairKey = (lowId << 32) | highId;
+                    if (!weldedPairs.insert(pairKey).second) {
+                        continue;
                     }
+
+                    AverageLuxelPair(pages[a.page], aPageX, aPageY, pages[b.page], bPageX, bPageY);
+                    ++weldedSamples;
                 }
             }
         }
@@ -2389,7 +2654,7 @@ static size_t WeldCrossPolygonEdgeSeams(const std::vector<FaceRect>& rects,
 }
 
 static bool PlaceRectOnPage(FaceRect& rect, LightmapPageLayout& page) {
-    if (rect.gpu.w > LIGHTMAP_PAGE_SIZE || rect.gpu.h > LIGHTMAP_PAGE_SIZE) {
+    if (rect.basis.w > LIGHTMAP_PAGE_SIZE || rect.basis.h > LIGHTMAP_PAGE_SIZE) {
         return false;
     }
 
@@ -2397,22 +2662,22 @@ static bool PlaceRectOnPage(FaceRect& rect, LightmapPageLayout& page) {
     int y = page.cursorY;
     int rowH = page.rowH;
 
-    if (x + rect.gpu.w > LIGHTMAP_PAGE_SIZE) {
+    if (x + rect.basis.w > LIGHTMAP_PAGE_SIZE) {
         y += rowH;
         x = 0;
         rowH = 0;
     }
 
-    if (y + rect.gpu.h > LIGHTMAP_PAGE_SIZE) {
+    if (y + rect.basis.h > LIGHTMAP_PAGE_SIZE) {
         return false;
     }
 
-    rect.gpu.x = x;
-    rect.gpu.y = y;
+    rect.basis.x = x;
+    rect.basis.y = y;
 
-    page.cursorX = x + rect.gpu.w;
+    page.cursorX = x + rect.basis.w;
     page.cursorY = y;
-    page.rowH = std::max(rowH, rect.gpu.h);
+    page.rowH = std::max(rowH, rect.basis.h);
     page.usedHeight = std::max(page.usedHeight, page.cursorY + page.rowH);
     return true;
 }
@@ -2423,7 +2688,7 @@ static std::vector<LightmapPageLayout> PackLightmapPages(std::vector<FaceRect>&
         order[i] = i;
     }
     std::sort(order.begin(), order.end(), [&](size_t a, size_t b) {
-        return rects[a].gpu.h > rects[b].gpu.h;
+        return rects[a].basis.h > rects[b].basis.h;
     });
 
     std::vector<LightmapPageLayout> pages;
@@ -2446,7 +2711,7 @@ static std::vector<LightmapPageLayout> PackLightmapPages(std::vector<FaceRect>&
             LightmapPageLayout page;
             if (!PlaceRectOnPage(rects[idx], page)) {
                 printf("[Lightmap] face rect %zux%zu exceeds page size %d.\n",
-                       (size_t)rects[idx].gpu.w, (size_t)rects[idx].gpu.h, LIGHTMAP_PAGE_SIZE);
+                       (size_t)rects[idx].basis.w, (size_t)rects[idx].basis.h, LIGHTMAP_PAGE_SIZE);
                 return {};
             }
             rects[idx].page = (uint32_t)pages.size();
@@ -2475,11 +2740,11 @@ static void FillPatchUVs(const std::vector<BakePatch>& patches,
         atlas.patches[i].sourcePolyIndex = patches[i].sourcePolyIndex;
         atlas.patches[i].uv.reserve(p.verts.size());
         for (const Vector3& vv : p.verts) {
-            const float u = (Vector3DotProduct(vv, r.gpu.axisU) - r.gpu.minU) / r.gpu.luxelSize;
-            const float v = (Vector3DotProduct(vv, r.gpu.axisV) - r.gpu.minV) / r.gpu.luxelSize;
+            const float u = (Vector3DotProduct(vv, r.basis.axisU) - r.basis.minU) / r.basis.luxelSize;
+            const float v = (Vector3DotProduct(vv, r.basis.axisV) - r.basis.minV) / r.basis.luxelSize;
             atlas.patches[i].uv.push_back({
-                (r.gpu.x + LM_PAD + u + 0.5f) / page.width,
-                (r.gpu.y + LM_PAD + v + 0.5f) / page.height
+                (r.basis.x + LM_PAD + u + 0.5f) / page.width,
+                (r.basis.y + LM_PAD + v + 0.5f) / page.height
             });
         }
     }
@@ -2495,8 +2760,8 @@ static std::vector<uint8_t> BuildCoverageMask(const std::vector<FaceRect>& rects
         if (r.page != pageIndex) {
             continue;
         }
-        for (int ly = 0; ly < r.gpu.h; ++ly) {
-            for (int lx = 0; lx < r.gpu.w; ++lx) {
+        for (int ly = 0; ly < r.basis.h; ++ly) {
+            for (int lx = 0; lx < r.basis.w; ++lx) {
                 uint8_t coveredSamples = 0;
                 for (int sy = 0; sy < g_aaGrid; ++sy) {
                     for (int sx = 0; sx < g_aaGrid; ++sx) {
@@ -2507,7 +2772,7 @@ static std::vector<uint8_t> BuildCoverageMask(const std::vector<FaceRect>& rects
                         }
                     }
                 }
-                coverage[(size_t)(r.gpu.y + ly) * W + (r.gpu.x + lx)] = coveredSamples;
+                coverage[(size_t)(r.basis.y + ly) * W + (r.basis.x + lx)] = coveredSamples;
             }
         }
     }
@@ -2532,8 +2797,8 @@ static std::vector<uint8_t> BuildStrictInteriorMask(const std::vector<FaceRect>&
         if (rect.page != pageIndex) {
             continue;
         }
-        for (int ly = 0; ly < rect.gpu.h; ++ly) {
-            for (int lx = 0; lx < rect.gpu.w; ++lx) {
+        for (int ly = 0; ly < rect.basis.h; ++ly) {
+            for (int lx = 0; lx < rect.basis.w; ++lx) {
                 const float cu = (float)(lx - LM_PAD);
                 const float cv = (float)(ly - LM_PAD);
                 if (!InsidePoly2D(rect.poly2d, cu, cv)) {
@@ -2543,8 +2808,8 @@ static std::vector<uint8_t> BuildStrictInteriorMask(const std::vector<FaceRect>&
                     continue;
                 }
 
-                const int pageX = rect.gpu.x + lx;
-                const int pageY = rect.gpu.y + ly;
+                const int pageX = rect.basis.x + lx;
+                const int pageY = rect.basis.y + ly;
                 if (pageX < 0 || pageY < 0 || pageX >= W || pageY >= H) {
                     continue;
                 }
@@ -2555,37 +2820,94 @@ static std::vector<uint8_t> BuildStrictInteriorMask(const std::vector<FaceRect>&
     return strictInterior;
 }
 
-static void StabilizeEdgeTexels(LightmapPage& page,
-                                const std::vector<uint8_t>& coverage)
+// ---------------------------------------------------------------------------
+//  Rect tiles for the post-bake passes.
+//
+//  Edge stabilization and border dilation only ever propagate between luxels
+//  of the same rect (covered luxels sit at least LM_PAD texels inside their
+//  rect, and dilation is restricted to same-owner neighbours), so each rect
+//  footprint is an independent, cache-sized tile. Tiles are copied into a
+//  compact local buffer, run through every pass there and written back, and
+//  different tiles never touch the same texels, so they run in parallel.
+// ---------------------------------------------------------------------------
+struct LightmapRectTile {
+    int x0 = 0;
+    int y0 = 0;
+    int w = 0;
+    int h = 0;
+};
+
+static bool ClipRectTile(const FaceRect& rect, int pageWidth, int pageHeight, LightmapRectTile* outTile) {
+    const int x0 = std::max(0, rect.basis.x);
+    const int y0 = std::max(0, rect.basis.y);
+    const int x1 = std::min(pageWidth, rect.basis.x + rect.basis.w);
+    const int y1 = std::min(pageHeight, rect.basis.y + rect.basis.h);
+    if (x1 <= x0 || y1 <= y0) {
+        return false;
+    }
+    *outTile = { x0, y0, x1 - x0, y1 - y0 };
+    return true;
+}
+
+static void LoadTilePixels(const LightmapPage& page, const LightmapRectTile& tile, std::vector<float>* outPixels) {
+    outPixels->resize((size_t)tile.w * (size_t)tile.h * 4);
+    for (int y = 0; y < tile.h; ++y) {
+        const float* src = page.pixels.data() + ((size_t)(tile.y0 + y) * (size_t)page.width + (size_t)tile.x0) * 4;
+        std::copy(src, src + (size_t)tile.w * 4, outPixels->data() + (size_t)y * (size_t)tile.w * 4);
+    }
+}
+
+static void StoreTilePixels(LightmapPage& page, const LightmapRectTile& tile, const std::vector<float>& pixels) {
+    for (int y = 0; y < tile.h; ++y) {
+        const float* src = pixels.data() + (size_t)y * (size_t)tile.w * 4;
+        std::copy(src, src + (size_t)tile.w * 4,
+                  page.pixels.data() + ((size_t)(tile.y0 + y) * (size_t)page.width + (size_t)tile.x0) * 4);
+    }
+}
+
+static void LoadTileMask(const std::vector<uint8_t>& mask, int pageWidth, const LightmapRectTile& tile, std::vector<uint8_t>* outMask) {
+    outMask->resize((size_t)tile.w * (size_t)tile.h);
+    for (int y = 0; y < tile.h; ++y) {
+        const uint8_t* src = mask.data() + (size_t)(tile.y0 + y) * (size_t)pageWidth + (size_t)tile.x0;
+        std::copy(src, src + tile.w, outMask->data() + (size_t)y * (size_t)tile.w);
+    }
+}
+
+static std::vector<std::vector<size_t>> BuildPageRectIndices(const std::vector<FaceRect>& rects, size_t pageCount) {
+    std::vector<std::vector<size_t>> rectIndicesByPage(pageCount);
+    for (size_t rectIndex = 0; rectIndex < rects.size(); ++rectIndex) {
+        if (rects[rectIndex].page < pageCount) {
+            rectIndicesByPage[rects[rectIndex].page].push_back(rectIndex);
+        }
+    }
+    return rectIndicesByPage;
+}
+
+// Partial-coverage texels take the average of their fully covered 8-neighbours,
+// growing inward from the stable interior for up to STABILIZE_EDGE_PASSES.
+static void StabilizeEdgeTexelsTile(std::vector<float>& pixels,
+                                    const std::vector<uint8_t>& coverage,
+                                    int W,
+                                    int H)
 {
-    const int W = page.width;
-    const int H = page.height;
     const uint8_t kFullCoverage = (uint8_t)(g_aaGrid * g_aaGrid);
     const size_t pixelCount = (size_t)W * (size_t)H;
-    if (coverage.size() < pixelCount) {
-        return;
-    }
-
     std::vector<uint8_t> stable(pixelCount, 0);
+    bool anyInterior = false;
     for (size_t i = 0; i < pixelCount; ++i) {
         stable[i] = (coverage[i] == kFullCoverage) ? 1 : 0;
-    }
-
-    bool anyInterior = false;
-    for (uint8_t v : stable) {
-        if (v) {
-            anyInterior = true;
-            break;
-        }
+        anyInterior = anyInterior || stable[i];
     }
     if (!anyInterior) {
         return;
     }
 
+    std::vector<uint8_t> nextStable;
+    std::vector<float> nextPixels;
     for (int pass = 0; pass < STABILIZE_EDGE_PASSES; ++pass) {
         bool changed = false;
-        std::vector<uint8_t> nextStable = stable;
-        std::vector<float> nextPixels = page.pixels;
+        nextStable = stable;
+        nextPixels = pixels;
 
         for (int y = 0; y < H; ++y) {
             for (int x = 0; x < W; ++x) {
@@ -2610,9 +2932,9 @@ static void StabilizeEdgeTexels(LightmapPage& page,
                         if (!stable[ni]) {
                             continue;
                         }
-                        sr += page.pixels[ni * 4 + 0];
-                        sg += page.pixels[ni * 4 + 1];
-                        sb += page.pixels[ni * 4 + 2];
+                        sr += pixels[ni * 4 + 0];
+                        sg += pixels[ni * 4 + 1];
+                        sb += pixels[ni * 4 + 2];
                         ++n;
                     }
                 }
@@ -2628,7 +2950,7 @@ static void StabilizeEdgeTexels(LightmapPage& page,
             }
         }
 
-        page.pixels.swap(nextPixels);
+        pixels.swap(nextPixels);
         stable.swap(nextStable);
         if (!changed) {
             break;
@@ -2636,6 +2958,247 @@ static void StabilizeEdgeTexels(LightmapPage& page,
     }
 }
 
+// Invalid texels inside a rect take the average of their valid 4-neighbours,
+// DILATE_PASSES rings deep. `valid` is the tile's working copy.
+static void DilateTile(std::vector<float>& pixels, std::vector<uint8_t>& valid, int W, int H) {
+    std::vector<uint8_t> nextValid;
+    for (int pass = 0; pass < DILATE_PASSES; ++pass) {
+        nextValid = valid;
+        for (int y = 0; y < H; ++y) {
+            for (int x = 0; x < W; ++x) {
+                const size_t idx = (size_t)y * W + x;
+                if (valid[idx]) continue;
+                float sr = 0.0f, sg = 0.0f, sb = 0.0f;
+                int n = 0;
+                const int dx[4] = {-1, 1, 0, 0};
+                const int dy[4] = {0, 0, -1, 1};
+                for (int k = 0; k < 4; ++k) {
+                    const int nx = x + dx[k];
+                    const int ny = y + dy[k];
+                    if (nx < 0 || ny < 0 || nx >= W || ny >= H) continue;
+                    const size_t ni = (size_t)ny * W + nx;
+                    if (!valid[ni]) continue;
+                    sr += pixels[ni * 4 + 0];
+                    sg += pixels[ni * 4 + 1];
+                    sb += pixels[ni * 4 + 2];
+                    ++n;
+                }
+                if (n) {
+                    pixels[idx * 4 + 0] = sr / (float)n;
+                    pixels[idx * 4 + 1] = sg / (float)n;
+                    pixels[idx * 4 + 2] = sb / (float)n;
+                    pixels[idx * 4 + 3] = 1.0f;
+                    nextValid[idx] = 1;
+                }
+            }
+        }
+        valid.swap(nextValid);
+    }
+}
+
+static void StabilizeEdgeTexels(LightmapPage& page,
+                                const std::vector<uint8_t>& coverage,
+                                const std::vector<FaceRect>& rects,
+                                const std::vector<size_t>& pageRectIndices)
+{
+    const size_t pixelCount = (size_t)page.width * (size_t)page.height;
+    if (coverage.size() < pixelCount || page.pixels.size() < pixelCount * 4) {
+        return;
+    }
+
+    ParallelFor(pageRectIndices.size(), [&](size_t i) {
+        LightmapRectTile tile;
+        if (!ClipRectTile(rects[pageRectIndices[i]], page.width, page.height, &tile)) {
+            return;
+        }
+        std::vector<float> tilePixels;
+        std::vector<uint8_t> tileCoverage;
+        LoadTilePixels(page, tile, &tilePixels);
+        LoadTileMask(coverage, page.width, tile, &tileCoverage);
+        StabilizeEdgeTexelsTile(tilePixels, tileCoverage, tile.w, tile.h);
+        StoreTilePixels(page, tile, tilePixels);
+    });
+}
+
+static void DilatePage(LightmapPage& page,
+                       const std::vector<uint8_t>& valid,
+                       const std::vector<FaceRect>& rects,
+                       const std::vector<size_t>& pageRectIndices)
+{
+    const size_t pixelCount = (size_t)page.width * (size_t)page.height;
+    if (valid.size() < pixelCount || page.pixels.size() < pixelCount * 4) {
+        return;
+    }
+
+    ParallelFor(pageRectIndices.size(), [&](size_t i) {
+        LightmapRectTile tile;
+        if (!ClipRectTile(rects[pageRectIndices[i]], page.width, page.height, &tile)) {
+            return;
+        }
+        std::vector<float> tilePixels;
+        std::vector<uint8_t> tileValid;
+        LoadTilePixels(page, tile, &tilePixels);
+        LoadTileMask(valid, page.width, tile, &tileValid);
+        DilateTile(tilePixels, tileValid, tile.w, tile.h);
+        StoreTilePixels(page, tile, tilePixels);
+    });
+}
+
+// Round-trip error of the final encode, relative per RGB channel. Sources
+// below 1/256 are measured against that floor so black texels do not blow
+// the ratio up.
+struct LightmapEncodeStats {
+    double sum = 0.0;
+    float  max = 0.0f;
+    size_t count = 0;
+};
+
+static void MergeEncodeStats(LightmapEncodeStats* dst, const LightmapEncodeStats& src) {
+    dst->sum += src.sum;
+    dst->max = std::max(dst->max, src.max);
+    dst->count += src.count;
+}
+
+static void AccumulateEncodeError(const float* src, const float decoded[3], LightmapEncodeStats* stats) {
+    for (int c = 0; c < 3; ++c) {
+        const float reference = std::max(0.0f, src[c]);
+        const float rel = fabsf(decoded[c] - reference) / std::max(reference, 1.0f / 256.0f);
+        stats->sum += rel;
+        stats->max = std::max(stats->max, rel);
+        ++stats->count;
+    }
+}
+
+static void EncodeTileTexels(const std::vector<float>& pixels,
+                             const LightmapRectTile& tile,
+                             LightmapPage& page,
+                             LightmapEncodeStats* stats) {
+    const size_t texelBytes = LightmapPageByteSize(page.encodedFormat, 1, 1);
+    for (int y = 0; y < tile.h; ++y) {
+        const float* src = pixels.data() + (size_t)y * (size_t)tile.w * 4;
+        uint8_t* dst = page.encoded.data() + ((size_t)(tile.y0 + y) * (size_t)page.width + (size_t)tile.x0) * texelBytes;
+        for (int x = 0; x < tile.w; ++x, src += 4, dst += texelBytes) {
+            EncodeLightmapTexel(page.encodedFormat, src, dst);
+            float decoded[3];
+            DecodeLightmapTexel(page.encodedFormat, dst, decoded);
+            AccumulateEncodeError(src, decoded, stats);
+        }
+    }
+}
+
+// BC6H blocks straddle rect borders, so the dilated tiles go back into the
+// float page first, then every 4x4 block is encoded from it and the rect
+// footprints are decoded again for the error report.
+static void EncodeBlockCompressedPage(LightmapPage& page,
+                                      const std::vector<FaceRect>& rects,
+                                      const std::vector<size_t>& pageRectIndices,
+                                      LightmapEncodeStats* stats) {
+    const int blocksX = (page.width + 3) / 4;
+    const int blocksY = (page.height + 3) / 4;
+    ParallelFor((size_t)blocksY, [&](size_t by) {
+        float rgb[16 * 3];
+        for (int bx = 0; bx < blocksX; ++bx) {
+            for (int t = 0; t < 16; ++t) {
+                const int x = std::min(page.width - 1, bx * 4 + (t & 3));
+                const int y = std::min(page.height - 1, (int)by * 4 + (t >> 2));
+                const float* src = page.pixels.data() + ((size_t)y * (size_t)page.width + (size_t)x) * 4;
+                rgb[t * 3 + 0] = src[0];
+                rgb[t * 3 + 1] = src[1];
+                rgb[t * 3 + 2] = src[2];
+            }
+            EncodeBC6HBlock(rgb, page.encoded.data() + (by * (size_t)blocksX + (size_t)bx) * BC6H_BLOCK_BYTES);
+        }
+    });
+
+    std::vector<LightmapEncodeStats> tileStats(pageRectIndices.size());
+    ParallelFor(pageRectIndices.size(), [&](size_t i) {
+        LightmapRectTile tile;
+        if (!ClipRectTile(rects[pageRectIndices[i]], page.width, page.height, &tile)) {
+            return;
+        }
+        float decoded[16 * 3];
+        for (int by = tile.y0 / 4; by <= (tile.y0 + tile.h - 1) / 4; ++by) {
+            for (int bx = tile.x0 / 4; bx <= (tile.x0 + tile.w - 1) / 4; ++bx) {
+                if (!DecodeBC6HBlock(page.encoded.data() + ((size_t)by * (size_t)blocksX + (size_t)bx) * BC6H_BLOCK_BYTES, decoded)) {
+                    continue;
+                }
+                for (int t = 0; t < 16; ++t) {
+                    const int x = bx * 4 + (t & 3);
+                    const int y = by * 4 + (t >> 2);
+                    if (x < tile.x0 || y < tile.y0 || x >= tile.x0 + tile.w || y >= tile.y0 + tile.h) {
+                        continue;
+                    }
+                    AccumulateEncodeError(page.pixels.data() + ((size_t)y * (size_t)page.width + (size_t)x) * 4,
+                                          decoded + t * 3, &tileStats[i]);
+                }
+            }
+        }
+    });
+    for (const LightmapEncodeStats& tileStat : tileStats) {
+        MergeEncodeStats(stats, tileStat);
+    }
+}
+
+// Final tile stage: border dilation and the encode into page.encodedFormat.
+// For per-texel formats both run back to back on each rect tile, writing
+// straight into page.encoded: the gutter between rects is encoded first in a
+// row pass (bounce accumulation marks it opaque), then the tiles overwrite
+// their own footprints. Block formats go through EncodeBlockCompressedPage.
+// The float page is released once the page is encoded.
+static void FinalizeLightmapPage(LightmapPage& page,
+                                 const std::vector<FaceRect>& rects,
+                                 const std::vector<size_t>& pageRectIndices,
+                                 const std::vector<uint8_t>& valid,
+                                 LightmapEncodeStats* stats)
+{
+    const size_t pixelCount = (size_t)page.width * (size_t)page.height;
+    page.encoded.assign(LightmapPageByteSize(page.encodedFormat, page.width, page.height), 0);
+    if (page.pixels.size() < pixelCount * 4) {
+        std::vector<float>().swap(page.pixels);
+        return;
+    }
+
+    if (LightmapFormatIsBlockCompressed(page.encodedFormat)) {
+        if (valid.size() >= pixelCount) {
+            DilatePage(page, valid, rects, pageRectIndices);
+        }
+        EncodeBlockCompressedPage(page, rects, pageRectIndices, stats);
+        std::vector<float>().swap(page.pixels);
+        return;
+    }
+
+    const size_t texelBytes = LightmapPageByteSize(page.encodedFormat, 1, 1);
+    ParallelFor((size_t)page.height, [&](size_t row) {
+        const float* src = page.pixels.data() + row * (size_t)page.width * 4;
+        uint8_t* dst = page.encoded.data() + row * (size_t)page.width * texelBytes;
+        for (int x = 0; x < page.width; ++x) {
+            EncodeLightmapTexel(page.encodedFormat, src + (size_t)x * 4, dst + (size_t)x * texelBytes);
+        }
+    });
+
+    if (valid.size() >= pixelCount) {
+        std::vector<LightmapEncodeStats> tileStats(pageRectIndices.size());
+        ParallelFor(pageRectIndices.size(), [&](size_t i) {
+            LightmapRectTile tile;
+            if (!ClipRectTile(rects[pageRectIndices[i]], page.width, page.height, &tile)) {
+                return;
+            }
+
+            std::vector<float> tilePixels;
+            std::vector<uint8_t> tileValid;
+            LoadTilePixels(page, tile, &tilePixels);
+            LoadTileMask(valid, page.width, tile, &tileValid);
+            DilateTile(tilePixels, tileValid, tile.w, tile.h);
+            EncodeTileTexels(tilePixels, tile, page, &tileStats[i]);
+        });
+        for (const LightmapEncodeStats& tileStat : tileStats) {
+            MergeEncodeStats(stats, tileStat);
+        }
+    }
+
+    std::vector<float>().swap(page.pixels);
+}
+
 struct StitchedSourceFaceCanvas {
     float minU = 0.0f;
     float minV = 0.0f;
@@ -2693,15 +3256,15 @@ static bool InitializeStitchedSourceFaceCanvas(const std::vector<FaceRect>& rect
     }
 
     const FaceRect& firstRect = rects[rectGroup.front()];
-    float minU = firstRect.gpu.minU;
-    float minV = firstRect.gpu.minV;
+    float minU = firstRect.basis.minU;
+    float minV = firstRect.basis.minV;
     float maxU = firstRect.maxU;
     float maxV = firstRect.maxV;
-    const float baseLuxelSize = std::max(0.125f, firstRect.gpu.luxelSize);
+    const float baseLuxelSize = std::max(0.125f, firstRect.basis.luxelSize);
     for (size_t rectIndex : rectGroup) {
         const FaceRect& rect = rects[rectIndex];
-        minU = std::min(minU, rect.gpu.minU);
-        minV = std::min(minV, rect.gpu.minV);
+        minU = std::min(minU, rect.basis.minU);
+        minV = std::min(minV, rect.basis.minV);
         maxU = std::max(maxU, rect.maxU);
         maxV = std::max(maxV, rect.maxV);
     }
@@ -2742,8 +3305,8 @@ static bool RectLocalPixelToStitchedIndex(const FaceRect& rect,
         return false;
     }
 
-    const float globalUCenter = rect.gpu.minU + (float)(localX - LM_PAD) * rect.gpu.luxelSize;
-    const float globalVCenter = rect.gpu.minV + (float)(localY - LM_PAD) * rect.gpu.luxelSize;
+    const float globalUCenter = rect.basis.minU + (float)(localX - LM_PAD) * rect.basis.luxelSize;
+    const float globalVCenter = rect.basis.minV + (float)(localY - LM_PAD) * rect.basis.luxelSize;
     return GlobalCenterToStitchedIndex(stitchedMinU,
                                        stitchedMinV,
                                        stitchedLuxelSize,
@@ -2774,8 +3337,8 @@ static bool RectLocalSubsampleToStitchedIndex(const FaceRect& rect,
     }
 
     const float invScale = 1.0f / (float)sampleScale;
-    const float globalUCenter = rect.gpu.minU + ((float)(localX - LM_PAD) - 0.5f + ((float)subX + 0.5f) * invScale) * rect.gpu.luxelSize;
-    const float globalVCenter = rect.gpu.minV + ((float)(localY - LM_PAD) - 0.5f + ((float)subY + 0.5f) * invScale) * rect.gpu.luxelSize;
+    const float globalUCenter = rect.basis.minU + ((float)(localX - LM_PAD) - 0.5f + ((float)subX + 0.5f) * invScale) * rect.basis.luxelSize;
+    const float globalVCenter = rect.basis.minV + ((float)(localY - LM_PAD) - 0.5f + ((float)subY + 0.5f) * invScale) * rect.basis.luxelSize;
     return GlobalCenterToStitchedIndex(stitchedMinU,
                                        stitchedMinV,
                                        stitchedLuxelSize,
@@ -2821,10 +3384,10 @@ static bool BuildStitchedSourceFaceCanvas(const std::vector<FaceRect>& rects,
             continue;
         }
 
-        for (int ly = 0; ly < rect.gpu.h; ++ly) {
-            for (int lx = 0; lx < rect.gpu.w; ++lx) {
-                const int pageX = rect.gpu.x + lx;
-                const int pageY = rect.gpu.y + ly;
+        for (int ly = 0; ly < rect.basis.h; ++ly) {
+            for (int lx = 0; lx < rect.basis.w; ++lx) {
+                const int pageX = rect.basis.x + lx;
+                const int pageY = rect.basis.y + ly;
                 if (pageX < 0 || pageY < 0 || pageX >= page.width || pageY >= page.height) {
                     continue;
                 }
@@ -2897,10 +3460,10 @@ static void WriteStitchedSourceFaceCanvas(const StitchedSourceFaceCanvas& canvas
             continue;
         }
 
-        for (int ly = 0; ly < rect.gpu.h; ++ly) {
-            for (int lx = 0; lx < rect.gpu.w; ++lx) {
-                const int pageX = rect.gpu.x + lx;
-                const int pageY = rect.gpu.y + ly;
+        for (int ly = 0; ly < rect.basis.h; ++ly) {
+            for (int lx = 0; lx < rect.basis.w; ++lx) {
+                const int pageX = rect.basis.x + lx;
+                const int pageY = rect.basis.y + ly;
                 if (pageX < 0 || pageY < 0 || pageX >= page.width || pageY >= page.height) {
                     continue;
                 }
@@ -3017,6 +3580,7 @@ static void FloodFillTransparentCanvas(int width,
 
 static void ApplyLightmapAA(std::vector<LightmapPage>& pages,
                             const std::vector<FaceRect>& rects,
+                            const std::vector<size_t>& rectIndices,
                             const std::vector<std::vector<uint8_t>>& validMasks,
                             int lmAAScale) {
     if (lmAAScale <= 0) return;
@@ -3035,12 +3599,13 @@ static void ApplyLightmapAA(std::vector<LightmapPage>& pages,
         for (int i = 0; i <= radius; ++i) kernel[i] /= sum;
     }
 
-    const auto rectsBySourceSurface = GroupRectsBySourceSurface(rects);
-    for (const auto& [sourceSurfaceKey, rectGroup] : rectsBySourceSurface) {
-        (void)sourceSurfaceKey;
+    // Source surfaces own disjoint rects, so their canvases are filtered in parallel.
+    const auto rectsBySourceSurface = GroupRectsBySourceSurface(rects, rectIndices);
+    ParallelFor(rectsBySourceSurface.size(), [&](size_t groupIndex) {
+        const std::vector<size_t>& rectGroup = rectsBySourceSurface[groupIndex].second;
         StitchedSourceFaceCanvas canvas;
         if (!BuildStitchedSourceFaceCanvas(rects, pages, validMasks, rectGroup, &canvas)) {
-            continue;
+            return;
         }
 
         const int W = canvas.width;
@@ -3105,99 +3670,29 @@ static void ApplyLightmapAA(std::vector<LightmapPage>& pages,
                 float wTotal = 0.0f;
                 for (int k = -radius; k <= radius; ++k) {
                     const int ny = y + k;
-                    if (ny < 0 || ny >= H) {
-                        continue;
-                    }
-                    const size_t ni = (size_t)ny * (size_t)W + (size_t)x;
-                    if (!paddedValid[ni]) {
-                        continue;
-                    }
-                    const float w = kernel[abs(k)];
-                    sumR += w * tempR[ni];
-                    sumG += w * tempG[ni];
-                    sumB += w * tempB[ni];
-                    wTotal += w;
-                }
-                if (wTotal > 0.0f) {
-                    canvas.pixelsR[idx] = sumR / wTotal;
-                    canvas.pixelsG[idx] = sumG / wTotal;
-                    canvas.pixelsB[idx] = sumB / wTotal;
-                }
-            }
-        }
-
-        WriteStitchedSourceFaceCanvas(canvas, rects, validMasks, rectGroup, pages);
-    }
-}
-
-static std::vector<int32_t> BuildDilateOwnerMap(const std::vector<FaceRect>& rects,
-                                                uint32_t pageIndex,
-                                                int width,
-                                                int height)
-{
-    std::vector<int32_t> ownerMap((size_t)width * (size_t)height, -1);
-    for (size_t rectIndex = 0; rectIndex < rects.size(); ++rectIndex) {
-        const FaceRect& rect = rects[rectIndex];
-        if (rect.page != pageIndex) {
-            continue;
-        }
-
-        const int minX = std::max(0, rect.gpu.x);
-        const int minY = std::max(0, rect.gpu.y);
-        const int maxX = std::min(width, rect.gpu.x + rect.gpu.w);
-        const int maxY = std::min(height, rect.gpu.y + rect.gpu.h);
-        for (int y = minY; y < maxY; ++y) {
-            for (int x = minX; x < maxX; ++x) {
-                ownerMap[(size_t)y * (size_t)width + (size_t)x] = (int32_t)rectIndex;
-            }
-        }
-    }
-    return ownerMap;
-}
-
-static void DilatePage(LightmapPage& page,
-                       std::vector<uint8_t>& valid,
-                       const std::vector<int32_t>& ownerMap) {
-    const int W = page.width;
-    const int H = page.height;
-    if (ownerMap.size() < (size_t)W * (size_t)H) {
-        return;
-    }
-    for (int pass = 0; pass < DILATE_PASSES; ++pass) {
-        std::vector<uint8_t> nextValid = valid;
-        for (int y = 0; y < H; ++y) {
-            for (int x = 0; x < W; ++x) {
-                const size_t idx = (size_t)y * W + x;
-                const int32_t owner = ownerMap[idx];
-                if (owner < 0) continue;
-                if (valid[idx]) continue;
-                float sr = 0.0f, sg = 0.0f, sb = 0.0f;
-                int n = 0;
-                const int dx[4] = {-1, 1, 0, 0};
-                const int dy[4] = {0, 0, -1, 1};
-                for (int k = 0; k < 4; ++k) {
-                    const int nx = x + dx[k];
-                    const int ny = y + dy[k];
-                    if (nx < 0 || ny < 0 || nx >= W || ny >= H) continue;
-                    const size_t ni = (size_t)ny * W + nx;
-                    if (ownerMap[ni] != owner) continue;
-                    if (!valid[ni]) continue;
-                    sr += page.pixels[ni * 4 + 0];
-                    sg += page.pixels[ni * 4 + 1];
-                    sb += page.pixels[ni * 4 + 2];
-                    ++n;
+                    if (ny < 0 || ny >= H) {
+                        continue;
+                    }
+                    const size_t ni = (size_t)ny * (size_t)W + (size_t)x;
+                    if (!paddedValid[ni]) {
+                        continue;
+                    }
+                    const float w = kernel[abs(k)];
+                    sumR += w * tempR[ni];
+                    sumG += w * tempG[ni];
+                    sumB += w * tempB[ni];
+                    wTotal += w;
                 }
-                if (n) {
-                    page.pixels[idx * 4 + 0] = sr / (float)n;
-                    page.pixels[idx * 4 + 1] = sg / (float)n;
-                    page.pixels[idx * 4 + 2] = sb / (float)n;
-                    page.pixels[idx * 4 + 3] = 1.0f;
-                    nextValid[idx] = 1;
+                if (wTotal > 0.0f) {
+                    canvas.pixelsR[idx] = sumR / wTotal;
+                    canvas.pixelsG[idx] = sumG / wTotal;
+                    canvas.pixelsB[idx] = sumB / wTotal;
                 }
             }
         }
-        valid.swap(nextValid);
-    }
+
+        WriteStitchedSourceFaceCanvas(canvas, rects, validMasks, rectGroup, pages);
+    });
 }
 
 struct DarkLuxelStats {
@@ -3710,9 +4205,9 @@ static Vector3 AverageRectLighting(const LightmapPage& page,
     size_t fullCount = 0;
     Vector3 validAccum = Vector3Zero();
     size_t validCount = 0;
-    for (int ly = 0; ly < rect.gpu.h; ++ly) {
-        for (int lx = 0; lx < rect.gpu.w; ++lx) {
-            const size_t pixelIndex = (size_t)(rect.gpu.y + ly) * (size_t)page.width + (size_t)(rect.gpu.x + lx);
+    for (int ly = 0; ly < rect.basis.h; ++ly) {
+        for (int lx = 0; lx < rect.basis.w; ++lx) {
+            const size_t pixelIndex = (size_t)(rect.basis.y + ly) * (size_t)page.width + (size_t)(rect.basis.x + lx);
             if (pixelIndex >= pixelCount || coverage[pixelIndex] == 0) {
                 continue;
             }
@@ -3911,6 +4406,7 @@ static float EffectiveOutputGamma(const LightBakeSettings& settings)
 }
 
 static void ApplyLightmapOutputConditioning(std::vector<LightmapPage>& pages,
+                                            const std::vector<uint32_t>& pageIndices,
                                             const std::vector<std::vector<uint8_t>>& validMasks,
                                             const LightBakeSettings& settings)
 {
@@ -3924,7 +4420,10 @@ static void ApplyLightmapOutputConditioning(std::vector<LightmapPage>& pages,
         return;
     }
 
-    for (size_t pageIndex = 0; pageIndex < pages.size() && pageIndex < validMasks.size(); ++pageIndex) {
+    for (uint32_t pageIndex : pageIndices) {
+        if (pageIndex >= pages.size() || pageIndex >= validMasks.size()) {
+            continue;
+        }
         LightmapPage& page = pages[pageIndex];
         const std::vector<uint8_t>& valid = validMasks[pageIndex];
         const size_t pixelCount = (size_t)page.width * (size_t)page.height;
@@ -3932,50 +4431,53 @@ static void ApplyLightmapOutputConditioning(std::vector<LightmapPage>& pages,
             continue;
         }
 
-        for (size_t pixelIndex = 0; pixelIndex < pixelCount; ++pixelIndex) {
-            if (!valid[pixelIndex]) {
-                continue;
-            }
+        ParallelFor((size_t)page.height, [&](size_t row) {
+            const size_t rowEnd = (row + 1) * (size_t)page.width;
+            for (size_t pixelIndex = row * (size_t)page.width; pixelIndex < rowEnd; ++pixelIndex) {
+                if (!valid[pixelIndex]) {
+                    continue;
+                }
 
-            float r = std::max(0.0f, page.pixels[pixelIndex * 4 + 0]);
-            float g = std::max(0.0f, page.pixels[pixelIndex * 4 + 1]);
-            float b = std::max(0.0f, page.pixels[pixelIndex * 4 + 2]);
-
-            if (clampMaxLight) {
-                const float peak = std::max(r, std::max(g, b));
-                if (peak > maxLight && peak > 1e-6f) {
-                    const float scale = maxLight / peak;
-                    r *= scale;
-                    g *= scale;
-                    b *= scale;
+                float r = std::max(0.0f, page.pixels[pixelIndex * 4 + 0]);
+                float g = std::max(0.0f, page.pixels[pixelIndex * 4 + 1]);
+                float b = std::max(0.0f, page.pixels[pixelIndex * 4 + 2]);
+
+                if (clampMaxLight) {
+                    const float peak = std::max(r, std::max(g, b));
+                    if (peak > maxLight && peak > 1e-6f) {
+                        const float scale = maxLight / peak;
+                        r *= scale;
+                        g *= scale;
+                        b *= scale;
+                    }
                 }
-            }
 
-            if (scaleRange) {
-                r *= rangeScale;
-                g *= rangeScale;
-                b *= rangeScale;
-            }
+                if (scaleRange) {
+                    r *= rangeScale;
+                    g *= rangeScale;
+                    b *= rangeScale;
+                }
 
-            if (applyGamma) {
-                r = powf(std::max(0.0f, r), 1.0f / lightmapGamma);
-                g = powf(std::max(0.0f, g), 1.0f / lightmapGamma);
-                b = powf(std::max(0.0f, b), 1.0f / lightmapGamma);
-            }
+                if (applyGamma) {
+                    r = powf(std::max(0.0f, r), 1.0f / lightmapGamma);
+                    g = powf(std::max(0.0f, g), 1.0f / lightmapGamma);
+                    b = powf(std::max(0.0f, b), 1.0f / lightmapGamma);
+                }
 
-            page.pixels[pixelIndex * 4 + 0] = std::max(0.0f, r);
-            page.pixels[pixelIndex * 4 + 1] = std::max(0.0f, g);
-            page.pixels[pixelIndex * 4 + 2] = std::max(0.0f, b);
-            page.pixels[pixelIndex * 4 + 3] = 1.0f;
-        }
+                page.pixels[pixelIndex * 4 + 0] = std::max(0.0f, r);
+                page.pixels[pixelIndex * 4 + 1] = std::max(0.0f, g);
+                page.pixels[pixelIndex * 4 + 2] = std::max(0.0f, b);
+                page.pixels[pixelIndex * 4 + 3] = 1.0f;
+            }
+        });
     }
 }
 
 static Vector3 ComputeLuxelPlanePoint(const FaceRect& rect, float ju, float jv) {
     return Vector3Add(
-        rect.gpu.origin,
-        Vector3Add(Vector3Scale(rect.gpu.axisU, ju * rect.gpu.luxelSize),
-                   Vector3Scale(rect.gpu.axisV, jv * rect.gpu.luxelSize)));
+        rect.basis.origin,
+        Vector3Add(Vector3Scale(rect.basis.axisU, ju * rect.basis.luxelSize),
+                   Vector3Scale(rect.basis.axisV, jv * rect.basis.luxelSize)));
 }
 
 static Vector3 OffsetPointAlongSurfaceNormal(const Vector3& planePoint,
@@ -4295,7 +4797,7 @@ static RepairedSamplePoint RepairSamplePoint(const FaceRect& rect,
     const Vector3 baseNormal = (rect.sourcePolyIndex < repairPolys.size() &&
                                 Vector3LengthSq(repairPolys[rect.sourcePolyIndex].normal) > 1e-8f)
         ? repairPolys[rect.sourcePolyIndex].normal
-        : rect.gpu.normal;
+        : rect.basis.normal;
     InitializeRepairOwnerFromSourcePoly(repairPolys,
                                         rect.sourcePolyIndex,
                                         planePoint,
@@ -4675,8 +5177,8 @@ static void ShadeRectOversampled(const FaceRect& rect,
 
     const int aaGrid = g_aaGrid;
     const float invG = 1.0f / (float)aaGrid;
-    const int hiW = rect.gpu.w * aaGrid;
-    const int hiH = rect.gpu.h * aaGrid;
+    const int hiW = rect.basis.w * aaGrid;
+    const int hiH = rect.basis.h * aaGrid;
     const size_t hiPixelCount = (size_t)hiW * (size_t)hiH;
     outBuffer->width = hiW;
     outBuffer->height = hiH;
@@ -4708,8 +5210,8 @@ static void ShadeRectOversampled(const FaceRect& rect,
     }
     usesDirt = usesDirt || SkyDomeUsesDirt(settings);
 
-    for (int ly = 0; ly < rect.gpu.h; ++ly) {
-        for (int lx = 0; lx < rect.gpu.w; ++lx) {
+    for (int ly = 0; ly < rect.basis.h; ++ly) {
+        for (int lx = 0; lx < rect.basis.w; ++lx) {
             for (int sy = 0; sy < aaGrid; ++sy) {
                 for (int sx = 0; sx < aaGrid; ++sx) {
                     const float ju = (lx - LM_PAD - 0.5f) + (sx + 0.5f) * invG;
@@ -4720,9 +5222,9 @@ static void ShadeRectOversampled(const FaceRect& rect,
 
                     const Vector3 planePoint = ComputeLuxelPlanePoint(rect, ju, jv);
                     const RepairedSamplePoint repairedSample = RepairSamplePoint(
-                        rect, repairPolys, repairSolids, planePoint, rect.gpu.luxelSize, settings.surfaceSampleOffset);
+                        rect, repairPolys, repairSolids, planePoint, rect.basis.luxelSize, settings.surfaceSampleOffset);
                     const Vector3 faceSamplePoint = OffsetSamplePointOffSurface(
-                        planePoint, rect.gpu.normal, settings.surfaceSampleOffset);
+                        planePoint, rect.basis.normal, settings.surfaceSampleOffset);
                     const bool faceSampleInsideSolid = PointInsideAnySolid(repairSolids, faceSamplePoint, SOLID_REPAIR_EPSILON);
                     if (faceSampleInsideSolid && !repairedSample.valid) {
                         const int hiX = lx * aaGrid + sx;
@@ -4738,9 +5240,9 @@ static void ShadeRectOversampled(const FaceRect& rect,
                     const Vector3 ownerPlanePoint = faceSampleInsideSolid ? repairedSample.planePoint : planePoint;
                     const Vector3 ownerNormal = (faceSampleInsideSolid && Vector3LengthSq(repairedSample.ownerNormal) > 1e-8f)
                         ? repairedSample.ownerNormal
-                        : rect.gpu.normal;
+                        : rect.basis.normal;
                     const Vector3 samplePoint = faceSampleInsideSolid ? repairedSample.samplePoint : faceSamplePoint;
-                    Vector3 sampleNormal = EvaluatePhongNormal(sourcePhongs, ownerSourcePolyIndex, ownerPlanePoint, rect.gpu.luxelSize);
+                    Vector3 sampleNormal = EvaluatePhongNormal(sourcePhongs, ownerSourcePolyIndex, ownerPlanePoint, rect.basis.luxelSize);
                     if (Vector3LengthSq(sampleNormal) <= 1e-8f) {
                         sampleNormal = ownerNormal;
                     }
@@ -4825,8 +5327,8 @@ static void ResolveOversampledBufferToPage(const FaceRect& rect,
 {
     const int W = page.width;
     const int aaGrid = g_aaGrid;
-    for (int ly = 0; ly < rect.gpu.h; ++ly) {
-        for (int lx = 0; lx < rect.gpu.w; ++lx) {
+    for (int ly = 0; ly < rect.basis.h; ++ly) {
+        for (int lx = 0; lx < rect.basis.w; ++lx) {
             float sumR = 0.0f;
             float sumG = 0.0f;
             float sumB = 0.0f;
@@ -4876,7 +5378,7 @@ static void ResolveOversampledBufferToPage(const FaceRect& rect,
                 outB = sumBIgnoringCoverage * invCount;
             }
 
-            const size_t off = ((size_t)(rect.gpu.y + ly) * (size_t)W + (size_t)(rect.gpu.x + lx)) * 4;
+            const size_t off = ((size_t)(rect.basis.y + ly) * (size_t)W + (size_t)(rect.basis.x + lx)) * 4;
             if (off + 3 >= page.pixels.size()) {
                 continue;
             }
@@ -4973,7 +5475,89 @@ static bool ResolveStitchedOversampledCanvas(const StitchedSourceFaceCanvas& hiC
     return anyResolved;
 }
 
+// ---------------------------------------------------------------------------
+//  Scene-wide compute payloads (occluder tris, BVH, solids, repair/phong graphs
+//  and surface emitters). Only the compute baker reads these, so they are built
+//  the first time a page is actually dispatched to it; `-cpu` bakes and pages
+//  that fall back up front never pay for them.
+// ---------------------------------------------------------------------------
+struct LightmapComputeScenePayload {
+    bool built = false;
+    std::vector<LightmapComputeOccluderTri> occluders;
+    LightmapComputeBvh bvh;
+    std::vector<LightmapComputeBrushSolid> brushSolids;
+    std::vector<LightmapComputeSolidPlane> solidPlanes;
+    std::vector<LightmapComputeRepairSourcePoly> repairSourcePolys;
+    std::vector<LightmapComputeRepairSourceNeighbor> repairSourceNeighbors;
+    std::vector<LightmapComputePhongSourcePoly> phongSourcePolys;
+    std::vector<LightmapComputePhongNeighbor> phongNeighbors;
+    std::vector<LightmapComputeSurfaceEmitter> surfaceEmitters;
+    std::vector<LightmapComputeSurfaceEmitterSample> surfaceEmitterSamples;
+};
+
+static double ElapsedMs(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+static const LightmapComputeScenePayload& EnsureComputeScenePayload(LightmapComputeScenePayload* payload,
+                                                                     const OccluderSet& occ,
+                                                                     const std::vector<BrushSolid>& repairSolids,
+                                                                     const std::vector<RepairSourcePoly>& repairPolys,
+                                                                     const std::vector<PhongSourcePoly>& sourcePhongs,
+                                                                     const std::vector<SurfaceLightEmitter>& surfaceEmitters)
+{
+    if (payload->built) {
+        return *payload;
+    }
+    payload->built = true;
+
+    using clock = std::chrono::steady_clock;
+    const auto totalStart = clock::now();
+
+    auto stepStart = clock::now();
+    payload->occluders = BuildLightmapComputeOccluders(occ);
+    const double occluderMs = ElapsedMs(stepStart);
+
+    stepStart = clock::now();
+    std::string computeBvhError;
+    if (BuildLightmapComputeBvh(payload->occluders, &payload->bvh, &computeBvhError)) {
+        if (!payload->bvh.nodes.empty()) {
+            printf("[Lightmap] Embree-built GPU BVH ready (%zu nodes, %zu tri refs).\n",
+                   payload->bvh.nodes.size(),
+                   payload->bvh.triIndices.size());
+            fflush(stdout);
+        }
+    } else if (!computeBvhError.empty()) {
+        printf("[Lightmap] GPU BVH unavailable; compute tracing will scan triangles: %s\n",
+               computeBvhError.c_str());
+        fflush(stdout);
+    }
+    const double bvhMs = ElapsedMs(stepStart);
+
+    stepStart = clock::now();
+    BuildComputeBrushSolids(repairSolids, &payload->brushSolids, &payload->solidPlanes);
+    const double solidMs = ElapsedMs(stepStart);
+
+    stepStart = clock::now();
+    BuildComputeRepairSourceGraph(repairPolys, &payload->repairSourcePolys, &payload->repairSourceNeighbors);
+    const double repairMs = ElapsedMs(stepStart);
+
+    stepStart = clock::now();
+    BuildComputePhongGraph(sourcePhongs, &payload->phongSourcePolys, &payload->phongNeighbors);
+    const double phongMs = ElapsedMs(stepStart);
+
+    stepStart = clock::now();
+    BuildComputeSurfaceEmitterPayload(surfaceEmitters, &payload->surfaceEmitters, &payload->surfaceEmitterSamples);
+    const double emitterMs = ElapsedMs(stepStart);
+
+    printf("[Lightmap] compute payload built in %.1f ms (occluders %.1f, bvh %.1f, solids %.1f, repair graph %.1f, phong graph %.1f, surface emitters %.1f)\n",
+           ElapsedMs(totalStart), occluderMs, bvhMs, solidMs, repairMs, phongMs, emitterMs);
+    fflush(stdout);
+    return *payload;
+}
+
 static bool BuildComputeOversampledGroupRects(const std::vector<FaceRect>& rects,
+                                              const std::vector<PhongSourcePoly>& sourcePhongs,
                                               const std::vector<size_t>& rectGroup,
                                               const StitchedSourceFaceCanvas& hiCanvas,
                                               std::vector<LightmapComputeFaceRect>* outRects,
@@ -5008,14 +5592,14 @@ static bool BuildComputeOversampledGroupRects(const std::vector<FaceRect>& rects
                                          hiCanvas.luxelSize,
                                          hiCanvas.width,
                                          hiCanvas.height,
-                                         rect.gpu.minU - 0.5f * rect.gpu.luxelSize + 0.5f * hiCanvas.luxelSize,
-                                         rect.gpu.minV - 0.5f * rect.gpu.luxelSize + 0.5f * hiCanvas.luxelSize,
+                                         rect.basis.minU - 0.5f * rect.basis.luxelSize + 0.5f * hiCanvas.luxelSize,
+                                         rect.basis.minV - 0.5f * rect.basis.luxelSize + 0.5f * hiCanvas.luxelSize,
                                          &hiX,
                                          &hiY)) {
             return false;
         }
 
-        LightmapComputeFaceRect gpuRect = rect.gpu;
+        LightmapComputeFaceRect gpuRect = BuildComputeFaceRect(rect, sourcePhongs);
         gpuRect.x = hiX;
         gpuRect.y = hiY;
         gpuRect.w = interiorW * g_aaGrid;
@@ -5030,18 +5614,10 @@ static bool BuildComputeOversampledGroupRects(const std::vector<FaceRect>& rects
 }
 
 static bool BakeLightmapComputeStitchedExtra(const std::vector<FaceRect>& rects,
+                                             const std::vector<PhongSourcePoly>& sourcePhongs,
                                              const std::vector<std::vector<uint8_t>>& validMasks,
-                                             const std::vector<LightmapComputeOccluderTri>& computeOccluders,
-                                             const LightmapComputeBvh& computeBvh,
-                                             const std::vector<LightmapComputeBrushSolid>& computeBrushSolids,
-                                             const std::vector<LightmapComputeSolidPlane>& computeSolidPlanes,
-                                             const std::vector<LightmapComputeRepairSourcePoly>& computeRepairSourcePolys,
-                                             const std::vector<LightmapComputeRepairSourceNeighbor>& computeRepairSourceNeighbors,
-                                             const std::vector<LightmapComputePhongSourcePoly>& computePhongSourcePolys,
-                                             const std::vector<LightmapComputePhongNeighbor>& computePhongNeighbors,
+                                             const LightmapComputeScenePayload& computePayload,
                                              const std::vector<PointLight>& lights,
-                                             const std::vector<LightmapComputeSurfaceEmitter>& surfaceEmitters,
-                                             const std::vector<LightmapComputeSurfaceEmitterSample>& surfaceEmitterSamples,
                                              const LightBakeSettings& settings,
                                              float skyTraceDistance,
                                              std::vector<LightmapPage>& pages,
@@ -5061,7 +5637,7 @@ static bool BakeLightmapComputeStitchedExtra(const std::vector<FaceRect>& rects,
 
         std::vector<LightmapComputeFaceRect> hiRects;
         std::vector<size_t> hiRectIndices;
-        if (!BuildComputeOversampledGroupRects(rects, rectGroup, hiCanvas, &hiRects, &hiRectIndices)) {
+        if (!BuildComputeOversampledGroupRects(rects, sourcePhongs, rectGroup, hiCanvas, &hiRects, &hiRectIndices)) {
             if (error) {
                 *error = "failed to build oversampled compute rects for a stitched source face";
             }
@@ -5077,17 +5653,17 @@ static bool BakeLightmapComputeStitchedExtra(const std::vector<FaceRect>& rects,
 
         std::vector<float> hiPixels;
         if (!BakeLightmapCompute(hiRects,
-                                 computeOccluders,
-                                 computeBvh,
-                                 computeBrushSolids,
-                                 computeSolidPlanes,
-                                 computeRepairSourcePolys,
-                                 computeRepairSourceNeighbors,
-                                 computePhongSourcePolys,
-                                 computePhongNeighbors,
+                                 computePayload.occluders,
+                                 computePayload.bvh,
+                                 computePayload.brushSolids,
+                                 computePayload.solidPlanes,
+                                 computePayload.repairSourcePolys,
+                                 computePayload.repairSourceNeighbors,
+                                 computePayload.phongSourcePolys,
+                                 computePayload.phongNeighbors,
                                  lights,
-                                 surfaceEmitters,
-                                 surfaceEmitterSamples,
+                                 computePayload.surfaceEmitters,
+                                 computePayload.surfaceEmitterSamples,
                                  hiRectSurfaceEmitterRanges,
                                  hiRectSurfaceEmitterIndices,
                                  settings,
@@ -5181,8 +5757,8 @@ static void BakeLightmapCPUStitchedExtra(const std::vector<PhongSourcePoly>& sou
                                  skyTraceDistance,
                                  &rectBuffer);
 
-            for (int ly = 0; ly < rect.gpu.h; ++ly) {
-                for (int lx = 0; lx < rect.gpu.w; ++lx) {
+            for (int ly = 0; ly < rect.basis.h; ++ly) {
+                for (int lx = 0; lx < rect.basis.w; ++lx) {
                     for (int sy = 0; sy < g_aaGrid; ++sy) {
                         for (int sx = 0; sx < g_aaGrid; ++sx) {
                             const int hiX = lx * g_aaGrid + sx;
@@ -5312,17 +5888,19 @@ static void BakeLightmapCPUPage(const std::vector<BakePatch>& patches,
 // ---------------------------------------------------------------------------
 static void ApplyLightmapSoften(std::vector<LightmapPage>& pages,
                                 const std::vector<FaceRect>& rects,
+                                const std::vector<size_t>& rectIndices,
                                 const std::vector<std::vector<uint8_t>>& validMasks,
                                 int soften) {
     if (soften <= 0) return;
     const int n = std::min(4, soften);  // kernel radius, 1..4
 
-    const auto rectsBySourceSurface = GroupRectsBySourceSurface(rects);
-    for (const auto& [sourceSurfaceKey, rectGroup] : rectsBySourceSurface) {
-        (void)sourceSurfaceKey;
+    // Source surfaces own disjoint rects, so their canvases are filtered in parallel.
+    const auto rectsBySourceSurface = GroupRectsBySourceSurface(rects, rectIndices);
+    ParallelFor(rectsBySourceSurface.size(), [&](size_t groupIndex) {
+        const std::vector<size_t>& rectGroup = rectsBySourceSurface[groupIndex].second;
         StitchedSourceFaceCanvas canvas;
         if (!BuildStitchedSourceFaceCanvas(rects, pages, validMasks, rectGroup, &canvas)) {
-            continue;
+            return;
         }
 
         const int W = canvas.width;
@@ -5381,10 +5959,166 @@ static void ApplyLightmapSoften(std::vector<LightmapPage>& pages,
         }
 
         WriteStitchedSourceFaceCanvas(canvas, rects, validMasks, rectGroup, pages);
-    }
+    });
 }
 
 // --------------------------------------------------------------------------
+// ---------------------------------------------------------------------------
+//  Page islands
+//
+//  After lighting, every pass either stays inside one rect or links rects
+//  that share a source surface (sibling welds, AA, soften) or a cross-polygon
+//  seam. Pages joined by any such link form an island; once all of an
+//  island's pages are lit it can finish on its own and be written out.
+// ---------------------------------------------------------------------------
+struct LightmapPageIsland {
+    std::vector<uint32_t> pages;       // ascending
+    std::vector<size_t>   rectIndices; // ascending
+};
+
+static uint32_t FindPageIslandRoot(std::vector<uint32_t>& parent, uint32_t page) {
+    while (parent[page] != page) {
+        parent[page] = parent[parent[page]];
+        page = parent[page];
+    }
+    return page;
+}
+
+static void JoinPageIslands(std::vector<uint32_t>& parent, uint32_t a, uint32_t b) {
+    if (a >= parent.size() || b >= parent.size()) {
+        return;
+    }
+    a = FindPageIslandRoot(parent, a);
+    b = FindPageIslandRoot(parent, b);
+    if (a != b) {
+        parent[std::max(a, b)] = std::min(a, b);
+    }
+}
+
+static std::vector<LightmapPageIsland> BuildLightmapPageIslands(const std::vector<FaceRect>& rects,
+                                                                size_t pageCount,
+                                                                float luxelSize)
+{
+    std::vector<uint32_t> parent(pageCount);
+    for (size_t i = 0; i < parent.size(); ++i) {
+        parent[i] = (uint32_t)i;
+    }
+    for (const auto& [sourceSurfaceKey, group] : GroupRectsBySourceSurface(rects)) {
+        (void)sourceSurfaceKey;
+        for (size_t i = 1; i < group.size(); ++i) {
+            JoinPageIslands(parent, rects[group[0]].page, rects[group[i]].page);
+        }
+    }
+    for (uint64_t candidatePair : BuildCrossPolygonWeldCandidates(rects, AllRectIndices(rects), luxelSize)) {
+        JoinPageIslands(parent,
+                        rects[(size_t)(candidatePair >> 32)].page,
+                        rects[(size_t)(candidatePair & 0xFFFFFFFFull)].page);
+    }
+
+    std::vector<LightmapPageIsland> islands;
+    std::vector<size_t> islandIndexByRoot(pageCount, SIZE_MAX);
+    for (uint32_t pageIndex = 0; pageIndex < pageCount; ++pageIndex) {
+        const uint32_t root = FindPageIslandRoot(parent, pageIndex);
+        if (islandIndexByRoot[root] == SIZE_MAX) {
+            islandIndexByRoot[root] = islands.size();
+            islands.emplace_back();
+        }
+        islands[islandIndexByRoot[root]].pages.push_back(pageIndex);
+    }
+    for (size_t rectIndex = 0; rectIndex < rects.size(); ++rectIndex) {
+        if (rects[rectIndex].page < pageCount) {
+            islands[islandIndexByRoot[FindPageIslandRoot(parent, rects[rectIndex].page)]].rectIndices.push_back(rectIndex);
+        }
+    }
+    return islands;
+}
+
+static size_t LightmapPageFloatBytes(const LightmapPage& page) {
+    return (size_t)page.width * (size_t)page.height * 4 * sizeof(float);
+}
+
+// Runs everything after lighting on a closed set of pages (whole islands,
+// `pageIndices` and `rectIndices` ascending), then encodes each page and
+// passes it to the sink. `directSeamsPending` is set when the sibling welds
+// and direct dilation have not run yet (no bounce pass did them). Encode
+// error accumulates into `atlasStats`.
+static void FinishLightmapPages(const std::vector<uint32_t>& pageIndices,
+                                const std::vector<size_t>& rectIndices,
+                                bool directSeamsPending,
+                                const std::vector<FaceRect>& rects,
+                                const std::vector<std::vector<size_t>>& rectIndicesByPage,
+                                const std::vector<std::vector<uint8_t>>& coverageMasks,
+                                const std::vector<std::vector<uint8_t>>& validMasks,
+                                const LightBakeSettings& settings,
+                                float luxelSize,
+                                const LightmapPageSink* sink,
+                                std::vector<LightmapPage>& pages,
+                                LightmapEncodeStats* atlasStats)
+{
+    if (directSeamsPending) {
+        const size_t directSeamWelded = WeldSiblingPatchSeams(rects, rectIndices, pages, coverageMasks, luxelSize);
+        if (directSeamWelded > 0) {
+            printf("[Lightmap] welded %zu direct seam-adjacent luxel pairs across split patches.\n", directSeamWelded);
+            fflush(stdout);
+        }
+        for (uint32_t pageIndex : pageIndices) {
+            printf("[Lightmap] page %u dilating direct borders\n", pageIndex);
+            fflush(stdout);
+            DilatePage(pages[pageIndex], validMasks[pageIndex], rects, rectIndicesByPage[pageIndex]);
+        }
+    }
+
+    const float outputRangeScale = EffectiveOutputRangeScale(settings);
+    const float outputGamma = EffectiveOutputGamma(settings);
+    if (settings.maxLight > 0.0f ||
+        fabsf(outputRangeScale - 1.0f) > 1e-6f ||
+        fabsf(outputGamma - 1.0f) > 1e-6f) {
+        printf("[Lightmap] applying output conditioning (_maxlight=%.3f, _range=%.2f -> scale=%.3f, _gamma=%.2f)\n",
+               settings.maxLight, settings.rangeScale, outputRangeScale, settings.lightmapGamma);
+        fflush(stdout);
+        ApplyLightmapOutputConditioning(pages, pageIndices, validMasks, settings);
+    }
+
+    const size_t crossPolySeamWelded = WeldCrossPolygonEdgeSeams(rects, rectIndices, pages, coverageMasks, luxelSize);
+    if (crossPolySeamWelded > 0) {
+        printf("[Lightmap] welded %zu cross-polygon boundary luxel pairs.\n", crossPolySeamWelded);
+        fflush(stdout);
+    }
+
+    if (settings.lmAAScale > 0) {
+        printf("[Lightmap] applying post-bake AA (scale=%d, sigma=%.1f)\n", settings.lmAAScale, settings.lmAAScale / 2.0f);
+        fflush(stdout);
+        ApplyLightmapAA(pages, rects, rectIndices, validMasks, settings.lmAAScale);
+    }
+
+    // Post-process box-filter softening from the worldspawn `_soften` key. Runs
+    // after AA so the gaussian and the box filter compose cleanly before the
+    // final border dilation pass.
+    if (settings.soften > 0) {
+        printf("[Lightmap] applying _soften post-process (n=%d, %dx%d window)\n",
+               settings.soften, settings.soften * 2 + 1, settings.soften * 2 + 1);
+        fflush(stdout);
+        ApplyLightmapSoften(pages, rects, rectIndices, validMasks, settings.soften);
+    }
+
+    printf("[Lightmap] dilating final borders and encoding %zu pages (%s)\n",
+           pageIndices.size(), LightmapFormatName(settings.lightmapFormat));
+    fflush(stdout);
+    for (uint32_t pageIndex : pageIndices) {
+        LightmapPage& page = pages[pageIndex];
+        LightmapEncodeStats pageStats;
+        FinalizeLightmapPage(page, rects, rectIndicesByPage[pageIndex], validMasks[pageIndex], &pageStats);
+        MergeEncodeStats(atlasStats, pageStats);
+        if (sink && sink->write) {
+            sink->write(pageIndex, page);
+            std::vector<uint8_t>().swap(page.encoded);
+        }
+        printf("[Lightmap] page %u complete (round-trip error: max %.4f, mean %.5f relative)\n",
+               pageIndex, pageStats.max, pageStats.count ? pageStats.sum / (double)pageStats.count : 0.0);
+    }
+    fflush(stdout);
+}
+
 LightmapAtlas BakeLightmap(const std::vector<MapPolygon>& polys,
                            const std::vector<MapPolygon>& occluderPolys,
                            const std::vector<MapPolygon>& solidPolys,
@@ -5392,7 +6126,9 @@ LightmapAtlas BakeLightmap(const std::vector<MapPolygon>& polys,
                            const std::vector<SurfaceLightTemplate>& surfaceLights,
                            const std::unordered_map<std::string, Vector3>& textureBounceColors,
                            const LightBakeSettings& settings,
-                           LightmapBakeBackendMode backendMode)
+                           LightmapBakeBackendMode backendMode,
+                           const LightmapPageSink* sink,
+                           size_t maxResidentPageBytes)
 {
     LightmapAtlas atlas;
     const float luxelSize = std::max(0.125f, settings.luxelSize);
@@ -5401,9 +6137,18 @@ LightmapAtlas BakeLightmap(const std::vector<MapPolygon>& polys,
     const char* forceCpuReason = (backendMode == LIGHTMAP_BAKE_BACKEND_FORCE_CPU)
         ? "forced CPU reference bake via -cpu"
         : "forced CPU reference bake via WARPED_LIGHTMAP_FORCE_CPU";
+    // Without a compute device every page would build its payload only for
+    // BakeLightmapCompute to fail, so settle that once for the whole bake.
+    std::string computeUnavailableReason;
+    const bool computeUnavailable = !forceCpuBake && !LightmapComputeAvailable(&computeUnavailableReason);
+    const bool bakeAllOnCpu = forceCpuBake || computeUnavailable;
     if (forceCpuBake) {
         printf("[Lightmap] %s.\n", forceCpuReason);
         fflush(stdout);
+    } else if (computeUnavailable) {
+        computeUnavailableReason = "no compute device: " + computeUnavailableReason;
+        printf("[Lightmap] %s; baking every page on the CPU.\n", computeUnavailableReason.c_str());
+        fflush(stdout);
     } else if (backendMode == LIGHTMAP_BAKE_BACKEND_PREFER_GPU) {
         printf("[Lightmap] preferring GPU compute bake via -gpu; unsupported pages can still fall back to CPU.\n");
         fflush(stdout);
@@ -5437,50 +6182,38 @@ LightmapAtlas BakeLightmap(const std::vector<MapPolygon>& polys,
         return atlas;
     }
 
+    // Float pixels are allocated when a page starts baking, not here. Block
+    // formats get whole 4x4 blocks: the height rounds up before FillPatchUVs
+    // so the UVs are normalized against the stored page.
+    const bool blockCompressed = LightmapFormatIsBlockCompressed(settings.lightmapFormat);
     atlas.pages.resize(layouts.size());
     for (size_t i = 0; i < layouts.size(); ++i) {
         atlas.pages[i].width = LIGHTMAP_PAGE_SIZE;
-        atlas.pages[i].height = layouts[i].usedHeight;
-        atlas.pages[i].pixels.assign((size_t)atlas.pages[i].width * (size_t)atlas.pages[i].height * 4, 0.0f);
+        atlas.pages[i].height = blockCompressed ? (layouts[i].usedHeight + 3) & ~3 : layouts[i].usedHeight;
+        atlas.pages[i].encodedFormat = settings.lightmapFormat;
     }
 
     FillPatchUVs(patches, rects, atlas.pages, atlas);
+    if (sink && sink->begin) {
+        sink->begin(atlas.pages);
+    }
 
     size_t totalLuxels = 0;
+    size_t rectSideTableBytes = 0;
     for (const FaceRect& r : rects) {
-        totalLuxels += (size_t)r.gpu.w * (size_t)r.gpu.h;
-    }
+        totalLuxels += (size_t)r.basis.w * (size_t)r.basis.h;
+        rectSideTableBytes += (r.poly2d.capacity() + r.polyGlobal2d.capacity()) * sizeof(Vector2) +
+                              (r.lightIndices.capacity() + r.surfaceEmitterIndices.capacity()) * sizeof(uint32_t);
+    }
+    printf("[Lightmap] rect table: %zu rects, %.1f KB records + %.1f KB side tables (compute payload is %zu B/rect, built per dispatched page)\n",
+           rects.size(),
+           (double)(rects.size() * sizeof(FaceRect)) / 1024.0,
+           (double)rectSideTableBytes / 1024.0,
+           sizeof(LightmapComputeFaceRect));
+    fflush(stdout);
 
     OccluderSet occ = BuildOccluders(occluderPolys.empty() ? visiblePolys : occluderPolys);
-    const std::vector<LightmapComputeOccluderTri> computeOccluders = BuildLightmapComputeOccluders(occ);
-    LightmapComputeBvh computeBvh;
-    if (!forceCpuBake) {
-        std::string computeBvhError;
-        if (BuildLightmapComputeBvh(computeOccluders, &computeBvh, &computeBvhError)) {
-            if (!computeBvh.nodes.empty()) {
-                printf("[Lightmap] Embree-built GPU BVH ready (%zu nodes, %zu tri refs).\n",
-                       computeBvh.nodes.size(),
-                       computeBvh.triIndices.size());
-                fflush(stdout);
-            }
-        } else if (!computeBvhError.empty()) {
-            printf("[Lightmap] GPU BVH unavailable; compute tracing will scan triangles: %s\n",
-                   computeBvhError.c_str());
-            fflush(stdout);
-        }
-    }
-    std::vector<LightmapComputeBrushSolid> computeBrushSolids;
-    std::vector<LightmapComputeSolidPlane> computeSolidPlanes;
-    std::vector<LightmapComputeRepairSourcePoly> computeRepairSourcePolys;
-    std::vector<LightmapComputeRepairSourceNeighbor> computeRepairSourceNeighbors;
-    std::vector<LightmapComputePhongSourcePoly> computePhongSourcePolys;
-    std::vector<LightmapComputePhongNeighbor> computePhongNeighbors;
-    std::vector<LightmapComputeSurfaceEmitter> computeSurfaceEmitters;
-    std::vector<LightmapComputeSurfaceEmitterSample> computeSurfaceEmitterSamples;
-    BuildComputeBrushSolids(repairSolids, &computeBrushSolids, &computeSolidPlanes);
-    BuildComputeRepairSourceGraph(repairPolys, &computeRepairSourcePolys, &computeRepairSourceNeighbors);
-    BuildComputePhongGraph(sourcePhongs, &computePhongSourcePolys, &computePhongNeighbors);
-    BuildComputeSurfaceEmitterPayload(surfaceEmitters, &computeSurfaceEmitters, &computeSurfaceEmitterSamples);
+    LightmapComputeScenePayload computePayload;
     const bool repairGraphExceedsComputeVerts = std::any_of(
         repairPolys.begin(),
         repairPolys.end(),
@@ -5490,8 +6223,8 @@ LightmapAtlas BakeLightmap(const std::vector<MapPolygon>& polys,
     if (repairGraphExceedsComputeVerts) {
         for (FaceRect& rect : rects) {
             rect.computeCompatible = false;
-            if (rect.computeFallbackReason.empty()) {
-                rect.computeFallbackReason = "page contains source polygon(s) exceeding compute repair vertex limit";
+            if (rect.computeFallbackReason == ComputeFallbackReason::NONE) {
+                rect.computeFallbackReason = ComputeFallbackReason::REPAIR_SOURCE_VERTEX_LIMIT;
             }
         }
     }
@@ -5504,6 +6237,7 @@ LightmapAtlas BakeLightmap(const std::vector<MapPolygon>& polys,
            settings.bounceCount, settings.bounceScale);
     fflush(stdout);
 
+    const std::vector<std::vector<size_t>> rectIndicesByPage = BuildPageRectIndices(rects, atlas.pages.size());
     std::vector<std::vector<uint8_t>> coverageMasks(atlas.pages.size());
     std::vector<std::vector<uint8_t>> baseValidMasks(atlas.pages.size());
     std::vector<std::vector<uint8_t>> strictInteriorMasks(atlas.pages.size());
@@ -5515,9 +6249,87 @@ LightmapAtlas BakeLightmap(const std::vector<MapPolygon>& polys,
     }
 
     const bool useStitchedExtraResolve = (g_aaGrid > 1);
+
+    // The stitched resolve lights the whole atlas in one go and bounce gathers
+    // from every page, so both keep all pages live until lighting is done.
+    // Otherwise pages are baked island by island and each island finishes and
+    // is written out as soon as its last page is lit, or is held back to
+    // batch with later islands while the float pages still fit the budget.
+    const bool retireIslandsEarly = !useStitchedExtraResolve && settings.bounceCount <= 0;
+    const std::vector<LightmapPageIsland> islands = BuildLightmapPageIslands(rects, atlas.pages.size(), luxelSize);
+    std::vector<uint32_t> islandByPage(atlas.pages.size(), 0);
+    std::vector<size_t> islandPagesRemaining(islands.size(), 0);
+    std::vector<uint32_t> bakeOrder;
+    bakeOrder.reserve(atlas.pages.size());
+    size_t largestIslandBytes = 0;
+    size_t atlasFloatBytes = 0;
+    for (size_t islandIndex = 0; islandIndex < islands.size(); ++islandIndex) {
+        size_t islandBytes = 0;
+        for (uint32_t pageIndex : islands[islandIndex].pages) {
+            islandByPage[pageIndex] = (uint32_t)islandIndex;
+            islandBytes += LightmapPageFloatBytes(atlas.pages[pageIndex]);
+            bakeOrder.push_back(pageIndex);
+        }
+        islandPagesRemaining[islandIndex] = islands[islandIndex].pages.size();
+        largestIslandBytes = std::max(largestIslandBytes, islandBytes);
+        atlasFloatBytes += islandBytes;
+    }
+    if (!retireIslandsEarly) {
+        std::sort(bakeOrder.begin(), bakeOrder.end());
+    }
+    const size_t requiredResidentBytes = retireIslandsEarly ? largestIslandBytes : atlasFloatBytes;
+    printf("[Lightmap] %zu pages in %zu islands, %s; float pages need %.1f MB live at once (atlas %.1f MB, budget %s)\n",
+           atlas.pages.size(),
+           islands.size(),
+           retireIslandsEarly ? "finishing each island once its pages are lit"
+                              : (useStitchedExtraResolve ? "stitched resolve keeps every page live"
+                                                         : "bounce keeps every page live"),
+           (double)requiredResidentBytes / (1024.0 * 1024.0),
+           (double)atlasFloatBytes / (1024.0 * 1024.0),
+           maxResidentPageBytes > 0 ? (std::to_string(maxResidentPageBytes / (1024 * 1024)) + " MB").c_str() : "unlimited");
+    if (maxResidentPageBytes > 0 && requiredResidentBytes > maxResidentPageBytes) {
+        printf("[Lightmap] warning: pages linked by seams%s cannot be split; still streaming, but the -max-memory budget will be exceeded.\n",
+               retireIslandsEarly ? "" : ", bounce or the stitched resolve");
+    }
+    fflush(stdout);
+
+    size_t residentPageBytes = 0;
+    size_t peakResidentPageBytes = 0;
+    LightmapEncodeStats encodeStats;
+    auto allocatePage = [&](LightmapPage& page) {
+        page.pixels.assign((size_t)page.width * (size_t)page.height * 4, 0.0f);
+        residentPageBytes += page.pixels.size() * sizeof(float);
+        peakResidentPageBytes = std::max(peakResidentPageBytes, residentPageBytes);
+    };
+    std::vector<size_t> readyIslands;
+    auto retireReadyIslands = [&](bool directSeamsPending) {
+        if (readyIslands.empty()) {
+            return;
+        }
+        std::vector<uint32_t> batchPages;
+        std::vector<size_t> batchRects;
+        for (size_t islandIndex : readyIslands) {
+            batchPages.insert(batchPages.end(), islands[islandIndex].pages.begin(), islands[islandIndex].pages.end());
+            batchRects.insert(batchRects.end(), islands[islandIndex].rectIndices.begin(), islands[islandIndex].rectIndices.end());
+        }
+        readyIslands.clear();
+        std::sort(batchPages.begin(), batchPages.end());
+        std::sort(batchRects.begin(), batchRects.end());
+        FinishLightmapPages(batchPages, batchRects, directSeamsPending, rects, rectIndicesByPage,
+                            coverageMasks, baseValidMasks, settings, luxelSize, sink, atlas.pages, &encodeStats);
+        for (uint32_t pageIndex : batchPages) {
+            residentPageBytes -= std::min(residentPageBytes, LightmapPageFloatBytes(atlas.pages[pageIndex]));
+        }
+    };
+    if (!retireIslandsEarly) {
+        for (LightmapPage& page : atlas.pages) {
+            allocatePage(page);
+        }
+    }
+
     bool directUseComputeStitchedResolve = false;
     std::string directComputeStitchedError;
-    if (useStitchedExtraResolve && !forceCpuBake) {
+    if (useStitchedExtraResolve && !bakeAllOnCpu) {
         directUseComputeStitchedResolve = true;
         for (uint32_t pageIndex = 0; pageIndex < atlas.pages.size(); ++pageIndex) {
             std::vector<PointLight> pageLights = GatherPageLights(rects, pageIndex, directPointLights);
@@ -5526,9 +6338,9 @@ LightmapAtlas BakeLightmap(const std::vector<MapPolygon>& polys,
                     continue;
                 }
                 directUseComputeStitchedResolve = false;
-                directComputeStitchedError = rect.computeFallbackReason.empty()
+                directComputeStitchedError = rect.computeFallbackReason == ComputeFallbackReason::NONE
                     ? "page contains rects that the compute baker does not support"
-                    : rect.computeFallbackReason;
+                    : ComputeFallbackReasonText(rect.computeFallbackReason);
                 break;
             }
             if (!directUseComputeStitchedResolve) {
@@ -5542,18 +6354,10 @@ LightmapAtlas BakeLightmap(const std::vector<MapPolygon>& polys,
 
         if (directUseComputeStitchedResolve &&
             !BakeLightmapComputeStitchedExtra(rects,
+                                              sourcePhongs,
                                               baseValidMasks,
-                                              computeOccluders,
-                                              computeBvh,
-                                              computeBrushSolids,
-                                              computeSolidPlanes,
-                                              computeRepairSourcePolys,
-                                              computeRepairSourceNeighbors,
-                                              computePhongSourcePolys,
-                                              computePhongNeighbors,
+                                              EnsureComputeScenePayload(&computePayload, occ, repairSolids, repairPolys, sourcePhongs, surfaceEmitters),
                                               directPointLights,
-                                              computeSurfaceEmitters,
-                                              computeSurfaceEmitterSamples,
                                               settings,
                                               skyTraceDistance,
                                               atlas.pages,
@@ -5563,7 +6367,14 @@ LightmapAtlas BakeLightmap(const std::vector<MapPolygon>& polys,
     }
 
     bool directStitchedCpuBaked = false;
-    for (uint32_t pageIndex = 0; pageIndex < atlas.pages.size(); ++pageIndex) {
+    for (uint32_t pageIndex : bakeOrder) {
+        if (retireIslandsEarly) {
+            if (maxResidentPageBytes > 0 && !readyIslands.empty() &&
+                residentPageBytes + LightmapPageFloatBytes(atlas.pages[pageIndex]) > maxResidentPageBytes) {
+                retireReadyIslands(true);
+            }
+            allocatePage(atlas.pages[pageIndex]);
+        }
         LightmapPage& page = atlas.pages[pageIndex];
         printf("[Lightmap] page %u/%zu begin (%dx%d)\n",
                pageIndex + 1, atlas.pages.size(), page.width, page.height);
@@ -5576,32 +6387,30 @@ LightmapAtlas BakeLightmap(const std::vector<MapPolygon>& polys,
 
         std::vector<LightmapComputeFaceRect> pageRects;
         std::vector<size_t> pageRectIndices;
-        pageRects.reserve(rects.size());
         pageRectIndices.reserve(rects.size());
-        bool pageRequiresCPU = forceCpuBake ||
+        bool pageRequiresCPU = bakeAllOnCpu ||
             (useStitchedExtraResolve && (!directUseComputeStitchedResolve || directStitchedCpuBaked));
-        std::string computeError = forceCpuBake
-            ? forceCpuReason
+        std::string computeError = bakeAllOnCpu
+            ? (forceCpuBake ? std::string(forceCpuReason) : computeUnavailableReason)
             : ((useStitchedExtraResolve && directStitchedCpuBaked)
                 ? "stitched direct bake already fell back to CPU earlier in this atlas"
                 : ((useStitchedExtraResolve && !directUseComputeStitchedResolve) ? directComputeStitchedError : std::string()));
         for (size_t rectIndex = 0; rectIndex < rects.size(); ++rectIndex) {
             const FaceRect& r = rects[rectIndex];
             if (r.page == pageIndex) {
-                pageRects.push_back(r.gpu);
                 pageRectIndices.push_back(rectIndex);
-                pageLuxels += (size_t)r.gpu.w * (size_t)r.gpu.h;
+                pageLuxels += (size_t)r.basis.w * (size_t)r.basis.h;
                 if (!useStitchedExtraResolve && !r.computeCompatible) {
                     pageRequiresCPU = true;
                     if (computeError.empty()) {
-                        computeError = r.computeFallbackReason;
+                        computeError = ComputeFallbackReasonText(r.computeFallbackReason);
                     }
                 }
             }
         }
         printf("[Lightmap] page %u stats: %zu rects, %zu direct point lights, %zu grouped surface emitters%s%s, %zu luxels\n",
                pageIndex,
-               pageRects.size(),
+               pageRectIndices.size(),
                pageLights.size(),
                pageSurfaceEmitterCount,
                (settings.sunlight2Intensity > 0.0f) ? ", + upper skylight" : "",
@@ -5615,26 +6424,38 @@ LightmapAtlas BakeLightmap(const std::vector<MapPolygon>& polys,
             PageUsesCPUOnlyLightingFeatures(pageIndex, rects, sourcePhongs, pageLights, !surfaceEmitters.empty(), true, settings, &computeError)) {
             pageRequiresCPU = true;
         }
+        const bool usedPrecomputedComputeResult = directUseComputeStitchedResolve && !directStitchedCpuBaked;
+        const bool dispatchCompute = !usedPrecomputedComputeResult && !pageRequiresCPU;
         std::vector<LightmapComputeRectSurfaceEmitterRange> pageRectSurfaceEmitterRanges;
         std::vector<uint32_t> pageRectSurfaceEmitterIndices;
-        BuildComputeRectSurfaceEmitterDispatchData(rects,
-                                                  pageRectIndices,
-                                                  &pageRectSurfaceEmitterRanges,
-                                                  &pageRectSurfaceEmitterIndices);
-        const bool usedPrecomputedComputeResult = directUseComputeStitchedResolve && !directStitchedCpuBaked;
+        if (dispatchCompute) {
+            EnsureComputeScenePayload(&computePayload, occ, repairSolids, repairPolys, sourcePhongs, surfaceEmitters);
+            const auto pagePayloadStart = std::chrono::steady_clock::now();
+            pageRects.reserve(pageRectIndices.size());
+            for (size_t rectIndex : pageRectIndices) {
+                pageRects.push_back(BuildComputeFaceRect(rects[rectIndex], sourcePhongs));
+            }
+            BuildComputeRectSurfaceEmitterDispatchData(rects,
+                                                      pageRectIndices,
+                                                      &pageRectSurfaceEmitterRanges,
+                                                      &pageRectSurfaceEmitterIndices);
+            printf("[Lightmap] page %u compute payload built in %.1f ms (%zu rects, %zu emitter refs)\n",
+                   pageIndex, ElapsedMs(pagePayloadStart), pageRects.size(), pageRectSurfaceEmitterIndices.size());
+            fflush(stdout);
+        }
         if (!usedPrecomputedComputeResult &&
             (pageRequiresCPU || !BakeLightmapCompute(pageRects,
-                                                     computeOccluders,
-                                                     computeBvh,
-                                                     computeBrushSolids,
-                                                     computeSolidPlanes,
-                                                     computeRepairSourcePolys,
-                                                     computeRepairSourceNeighbors,
-                                                     computePhongSourcePolys,
-                                                     computePhongNeighbors,
+                                                     computePayload.occluders,
+                                                     computePayload.bvh,
+                                                     computePayload.brushSolids,
+                                                     computePayload.solidPlanes,
+                                                     computePayload.repairSourcePolys,
+                                                     computePayload.repairSourceNeighbors,
+                                                     computePayload.phongSourcePolys,
+                                                     computePayload.phongNeighbors,
                                                      pageLights,
-                                                     computeSurfaceEmitters,
-                                                     computeSurfaceEmitterSamples,
+                                                     computePayload.surfaceEmitters,
+                                                     computePayload.surfaceEmitterSamples,
                                                      pageRectSurfaceEmitterRanges,
                                                      pageRectSurfaceEmitterIndices,
                                                      settings,
@@ -5675,7 +6496,7 @@ LightmapAtlas BakeLightmap(const std::vector<MapPolygon>& polys,
             // hard compute failure.
             printf("[Lightmap] page %u stabilizing edge texels\n", pageIndex);
             fflush(stdout);
-            StabilizeEdgeTexels(page, coverage);
+            StabilizeEdgeTexels(page, coverage, rects, rectIndicesByPage[pageIndex]);
             edgeTexelsStabilized = true;
 
             const DarkLuxelStats darkStats = GatherDarkLuxelStats(page, valid, coverage, strictInteriorMasks[pageIndex]);
@@ -5705,160 +6526,140 @@ LightmapAtlas BakeLightmap(const std::vector<MapPolygon>& polys,
         if (!edgeTexelsStabilized) {
             printf("[Lightmap] page %u stabilizing edge texels\n", pageIndex);
             fflush(stdout);
-            StabilizeEdgeTexels(page, coverage);
+            StabilizeEdgeTexels(page, coverage, rects, rectIndicesByPage[pageIndex]);
         }
         printf("[Lightmap] page %u direct complete\n", pageIndex);
         fflush(stdout);
-    }
-
-    const size_t directSeamWelded = WeldSiblingPatchSeams(rects, atlas.pages, coverageMasks, luxelSize);
-    if (directSeamWelded > 0) {
-        printf("[Lightmap] welded %zu direct seam-adjacent luxel pairs across split patches.\n", directSeamWelded);
-        fflush(stdout);
-    }
-    for (uint32_t pageIndex = 0; pageIndex < atlas.pages.size(); ++pageIndex) {
-        LightmapPage& page = atlas.pages[pageIndex];
-        std::vector<uint8_t> valid = baseValidMasks[pageIndex];
-        const std::vector<int32_t> ownerMap = BuildDilateOwnerMap(rects, pageIndex, page.width, page.height);
-        printf("[Lightmap] page %u dilating direct borders\n", pageIndex);
-        fflush(stdout);
-        DilatePage(page, valid, ownerMap);
-    }
-
-    std::vector<LightmapPage> bounceSourcePages = atlas.pages;
-    Vector3 bounceAmbient = settings.ambientColor;
-    for (int bouncePass = 0; bouncePass < settings.bounceCount; ++bouncePass) {
-        const std::vector<SurfaceLightEmitter> indirectEmitters = BuildIndirectBounceEmitters(
-            visiblePolys, rects, bounceSourcePages, coverageMasks, surfaceLights, textureBounceColors, bounceAmbient, repairSolids, settings, bouncePass + 1);
-        if (indirectEmitters.empty()) {
-            if (bouncePass == 0) {
-                printf("[Lightmap] indirect bounce emitters: 0\n");
-                fflush(stdout);
-            }
-            break;
+        if (retireIslandsEarly && --islandPagesRemaining[islandByPage[pageIndex]] == 0) {
+            readyIslands.push_back(islandByPage[pageIndex]);
         }
+    }
 
-        printf("[Lightmap] bounce pass %d/%d emitters: %zu\n",
-               bouncePass + 1, settings.bounceCount, indirectEmitters.size());
-        fflush(stdout);
-        const std::vector<std::vector<uint32_t>> indirectEmitterIndices = BuildSurfaceEmitterIndicesByRect(rects, indirectEmitters);
-        std::vector<LightmapPage> bouncedPages = atlas.pages;
-        for (LightmapPage& bouncedPage : bouncedPages) {
-            bouncedPage = MakeBlankPageLike(bouncedPage);
+    // Without bounce the direct sibling welds and dilation run per island in
+    // FinishLightmapPages; bounce needs them done across the whole atlas first.
+    const bool directSeamsPending = settings.bounceCount <= 0;
+    if (!directSeamsPending) {
+        const std::vector<size_t> allRectIndices = AllRectIndices(rects);
+        const size_t directSeamWelded = WeldSiblingPatchSeams(rects, allRectIndices, atlas.pages, coverageMasks, luxelSize);
+        if (directSeamWelded > 0) {
+            printf("[Lightmap] welded %zu direct seam-adjacent luxel pairs across split patches.\n", directSeamWelded);
+            fflush(stdout);
         }
-        const std::vector<PointLight> noIndirectPointLights;
-        bool bounceStitchedCpuBaked = false;
-
         for (uint32_t pageIndex = 0; pageIndex < atlas.pages.size(); ++pageIndex) {
             LightmapPage& page = atlas.pages[pageIndex];
-            LightmapPage& bouncedPage = bouncedPages[pageIndex];
-            const size_t pageIndirectEmitterCount = CountPageSurfaceEmitters(rects, pageIndex, indirectEmitters.size(), &indirectEmitterIndices);
-            if (pageIndirectEmitterCount == 0) {
-                continue;
+            printf("[Lightmap] page %u dilating direct borders\n", pageIndex);
+            fflush(stdout);
+            DilatePage(page, baseValidMasks[pageIndex], rects, rectIndicesByPage[pageIndex]);
+        }
+
+        // Each pass gathers its emitters from the light the previous pass added
+        // (the direct atlas for the first), so only the current pass's pages are
+        // ever held next to the atlas.
+        Vector3 bounceAmbient = settings.ambientColor;
+        std::vector<SurfaceLightEmitter> indirectEmitters = BuildIndirectBounceEmitters(
+            visiblePolys, rects, atlas.pages, coverageMasks, surfaceLights, textureBounceColors, bounceAmbient, repairSolids, settings, 1);
+        for (int bouncePass = 0; bouncePass < settings.bounceCount; ++bouncePass) {
+            if (indirectEmitters.empty()) {
+                if (bouncePass == 0) {
+                    printf("[Lightmap] indirect bounce emitters: 0\n");
+                    fflush(stdout);
+                }
+                break;
             }
 
-            printf("[Lightmap] page %u bounce %d begin (%zu bounce emitters)\n",
-                   pageIndex, bouncePass + 1, pageIndirectEmitterCount);
+            printf("[Lightmap] bounce pass %d/%d emitters: %zu\n",
+                   bouncePass + 1, settings.bounceCount, indirectEmitters.size());
             fflush(stdout);
-            LightBakeSettings bounceSettings = settings;
-            bounceSettings.ambientColor = Vector3Zero();
-            bounceSettings.sunlight2Intensity = 0.0f;
-            bounceSettings.sunlight3Intensity = 0.0f;
-            if (useStitchedExtraResolve) {
-                if (!bounceStitchedCpuBaked) {
-                    BakeLightmapCPUStitchedExtra(sourcePhongs, repairPolys, noIndirectPointLights, &indirectEmitters, rects, nullptr, &indirectEmitterIndices, baseValidMasks, occ, repairSolids, bounceSettings, skyTraceDistance, bouncedPages);
-                    bounceStitchedCpuBaked = true;
+            const std::vector<std::vector<uint32_t>> indirectEmitterIndices = BuildSurfaceEmitterIndicesByRect(rects, indirectEmitters);
+            std::vector<LightmapPage> bouncedPages;
+            bouncedPages.reserve(atlas.pages.size());
+            size_t bouncedPageBytes = 0;
+            for (const LightmapPage& page : atlas.pages) {
+                bouncedPages.push_back(MakeBlankPageLike(page));
+                bouncedPageBytes += bouncedPages.back().pixels.size() * sizeof(float);
+            }
+            peakResidentPageBytes = std::max(peakResidentPageBytes, residentPageBytes + bouncedPageBytes);
+            const std::vector<PointLight> noIndirectPointLights;
+            bool bounceStitchedCpuBaked = false;
+
+            for (uint32_t pageIndex = 0; pageIndex < atlas.pages.size(); ++pageIndex) {
+                LightmapPage& page = atlas.pages[pageIndex];
+                LightmapPage& bouncedPage = bouncedPages[pageIndex];
+                const size_t pageIndirectEmitterCount = CountPageSurfaceEmitters(rects, pageIndex, indirectEmitters.size(), &indirectEmitterIndices);
+                if (pageIndirectEmitterCount == 0) {
+                    continue;
                 }
-            } else {
-                BakeLightmapCPUPage(patches, sourcePhongs, repairPolys, noIndirectPointLights, &indirectEmitters, rects, nullptr, &indirectEmitterIndices, pageIndex, occ, repairSolids, bounceSettings, skyTraceDistance, bouncedPage);
+
+                printf("[Lightmap] page %u bounce %d begin (%zu bounce emitters)\n",
+                       pageIndex, bouncePass + 1, pageIndirectEmitterCount);
+                fflush(stdout);
+                LightBakeSettings bounceSettings = settings;
+                bounceSettings.ambientColor = Vector3Zero();
+                bounceSettings.sunlight2Intensity = 0.0f;
+                bounceSettings.sunlight3Intensity = 0.0f;
+                if (useStitchedExtraResolve) {
+                    if (!bounceStitchedCpuBaked) {
+                        BakeLightmapCPUStitchedExtra(sourcePhongs, repairPolys, noIndirectPointLights, &indirectEmitters, rects, nullptr, &indirectEmitterIndices, baseValidMasks, occ, repairSolids, bounceSettings, skyTraceDistance, bouncedPages);
+                        bounceStitchedCpuBaked = true;
+                    }
+                } else {
+                    BakeLightmapCPUPage(patches, sourcePhongs, repairPolys, noIndirectPointLights, &indirectEmitters, rects, nullptr, &indirectEmitterIndices, pageIndex, occ, repairSolids, bounceSettings, skyTraceDistance, bouncedPage);
+                }
+
+                StabilizeEdgeTexels(bouncedPage, coverageMasks[pageIndex], rects, rectIndicesByPage[pageIndex]);
+                AddPagePixels(page, bouncedPage);
+                printf("[Lightmap] page %u bounce %d complete\n", pageIndex, bouncePass + 1);
+                fflush(stdout);
             }
 
-            StabilizeEdgeTexels(bouncedPage, coverageMasks[pageIndex]);
-            AddPagePixels(page, bouncedPage);
-            printf("[Lightmap] page %u bounce %d complete\n", pageIndex, bouncePass + 1);
-            fflush(stdout);
-        }
+            const size_t indirectSeamWelded = WeldSiblingPatchSeams(rects, allRectIndices, atlas.pages, coverageMasks, luxelSize);
+            if (indirectSeamWelded > 0) {
+                printf("[Lightmap] welded %zu bounce %d seam-adjacent luxel pairs across split patches.\n",
+                       indirectSeamWelded, bouncePass + 1);
+                fflush(stdout);
+            }
+            const size_t bounceSourceSeamWelded = WeldSiblingPatchSeams(rects, allRectIndices, bouncedPages, coverageMasks, luxelSize);
+            if (bounceSourceSeamWelded > 0) {
+                printf("[Lightmap] welded %zu bounce %d source seam-adjacent luxel pairs across split patches.\n",
+                       bounceSourceSeamWelded, bouncePass + 1);
+                fflush(stdout);
+            }
+            for (uint32_t pageIndex = 0; pageIndex < bouncedPages.size(); ++pageIndex) {
+                LightmapPage& bouncedPage = bouncedPages[pageIndex];
+                printf("[Lightmap] page %u bounce %d dilating source borders\n",
+                       pageIndex, bouncePass + 1);
+                fflush(stdout);
+                DilatePage(bouncedPage, baseValidMasks[pageIndex], rects, rectIndicesByPage[pageIndex]);
+            }
 
-        const size_t indirectSeamWelded = WeldSiblingPatchSeams(rects, atlas.pages, coverageMasks, luxelSize);
-        if (indirectSeamWelded > 0) {
-            printf("[Lightmap] welded %zu bounce %d seam-adjacent luxel pairs across split patches.\n",
-                   indirectSeamWelded, bouncePass + 1);
-            fflush(stdout);
-        }
-        const size_t bounceSourceSeamWelded = WeldSiblingPatchSeams(rects, bouncedPages, coverageMasks, luxelSize);
-        if (bounceSourceSeamWelded > 0) {
-            printf("[Lightmap] welded %zu bounce %d source seam-adjacent luxel pairs across split patches.\n",
-                   bounceSourceSeamWelded, bouncePass + 1);
-            fflush(stdout);
-        }
-        for (uint32_t pageIndex = 0; pageIndex < bouncedPages.size(); ++pageIndex) {
-            LightmapPage& bouncedPage = bouncedPages[pageIndex];
-            std::vector<uint8_t> valid = baseValidMasks[pageIndex];
-            const std::vector<int32_t> ownerMap = BuildDilateOwnerMap(rects, pageIndex, bouncedPage.width, bouncedPage.height);
-            printf("[Lightmap] page %u bounce %d dilating source borders\n",
-                   pageIndex, bouncePass + 1);
-            fflush(stdout);
-            DilatePage(bouncedPage, valid, ownerMap);
+            bounceAmbient = Vector3Zero();
+            if (bouncePass + 1 < settings.bounceCount) {
+                indirectEmitters = BuildIndirectBounceEmitters(
+                    visiblePolys, rects, bouncedPages, coverageMasks, surfaceLights, textureBounceColors, bounceAmbient, repairSolids, settings, bouncePass + 2);
+            }
         }
 
-        bounceSourcePages = std::move(bouncedPages);
-        bounceAmbient = Vector3Zero();
-    }
-
-    if (settings.bounceCount > 0) {
         for (uint32_t pageIndex = 0; pageIndex < atlas.pages.size(); ++pageIndex) {
             LightmapPage& page = atlas.pages[pageIndex];
-            std::vector<uint8_t> valid = baseValidMasks[pageIndex];
-            const std::vector<int32_t> ownerMap = BuildDilateOwnerMap(rects, pageIndex, page.width, page.height);
             printf("[Lightmap] page %u dilating post-indirect borders\n", pageIndex);
             fflush(stdout);
-            DilatePage(page, valid, ownerMap);
+            DilatePage(page, baseValidMasks[pageIndex], rects, rectIndicesByPage[pageIndex]);
         }
     }
 
-    const float outputRangeScale = EffectiveOutputRangeScale(settings);
-    const float outputGamma = EffectiveOutputGamma(settings);
-    if (settings.maxLight > 0.0f ||
-        fabsf(outputRangeScale - 1.0f) > 1e-6f ||
-        fabsf(outputGamma - 1.0f) > 1e-6f) {
-        printf("[Lightmap] applying output conditioning (_maxlight=%.3f, _range=%.2f -> scale=%.3f, _gamma=%.2f)\n",
-               settings.maxLight, settings.rangeScale, outputRangeScale, settings.lightmapGamma);
-        fflush(stdout);
-        ApplyLightmapOutputConditioning(atlas.pages, baseValidMasks, settings);
-    }
-
-    const size_t crossPolySeamWelded = WeldCrossPolygonEdgeSeams(rects, atlas.pages, coverageMasks, luxelSize);
-    if (crossPolySeamWelded > 0) {
-        printf("[Lightmap] welded %zu cross-polygon boundary luxel pairs.\n", crossPolySeamWelded);
-        fflush(stdout);
-    }
-
-    if (settings.lmAAScale > 0) {
-        printf("[Lightmap] applying post-bake AA (scale=%d, sigma=%.1f)\n", settings.lmAAScale, settings.lmAAScale / 2.0f);
-        fflush(stdout);
-        ApplyLightmapAA(atlas.pages, rects, baseValidMasks, settings.lmAAScale);
-    }
-
-    // Post-process box-filter softening from the worldspawn `_soften` key. Runs
-    // after AA so the gaussian and the box filter compose cleanly before the
-    // final border dilation pass.
-    if (settings.soften > 0) {
-        printf("[Lightmap] applying _soften post-process (n=%d, %dx%d window)\n",
-               settings.soften, settings.soften * 2 + 1, settings.soften * 2 + 1);
-        fflush(stdout);
-        ApplyLightmapSoften(atlas.pages, rects, baseValidMasks, settings.soften);
-    }
-
-    for (uint32_t pageIndex = 0; pageIndex < atlas.pages.size(); ++pageIndex) {
-        LightmapPage& page = atlas.pages[pageIndex];
-        std::vector<uint8_t> valid = baseValidMasks[pageIndex];
-        const std::vector<int32_t> ownerMap = BuildDilateOwnerMap(rects, pageIndex, page.width, page.height);
-        printf("[Lightmap] page %u dilating final borders\n", pageIndex);
-        fflush(stdout);
-        DilatePage(page, valid, ownerMap);
-        printf("[Lightmap] page %u complete\n", pageIndex);
-        fflush(stdout);
+    if (!retireIslandsEarly) {
+        for (size_t islandIndex = 0; islandIndex < islands.size(); ++islandIndex) {
+            readyIslands.push_back(islandIndex);
+        }
     }
+    retireReadyIslands(directSeamsPending);
+    atlas.peakResidentPageBytes = peakResidentPageBytes;
+    printf("[Lightmap] peak live float pages: %.1f MB\n", (double)peakResidentPageBytes / (1024.0 * 1024.0));
+    printf("[Lightmap] %s round-trip error over rect texels: max %.4f, mean %.5f relative\n",
+           LightmapFormatName(settings.lightmapFormat),
+           encodeStats.max,
+           encodeStats.count ? encodeStats.sum / (double)encodeStats.count : 0.0);
+    fflush(stdout);
 
     return atlas;
 }
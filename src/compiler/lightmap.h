@@ -1,13 +1,21 @@
 // lightmap.h  —  offline lightmap baker for compile_map.
 #pragma once
 #include "map_parser.h"
+#include "../utils/bsp_format.h"
+#include <functional>
 #include <vector>
 #include <cstdint>
 
+// While baking a page lives in `pixels`. The final post-process stage encodes
+// each tile straight into `encoded` (BSPLightmapPageFormat `encodedFormat`) and
+// releases the float page, so BakeLightmap returns pages ready for the lump
+// (or hands each one to a LightmapPageSink as soon as it is final).
 struct LightmapPage {
     int                  width  = 0;
     int                  height = 0;
     std::vector<float>   pixels; // linear RGBA, width*height*4
+    std::vector<uint8_t> encoded;
+    uint32_t             encodedFormat = BSP_LIGHTMAP_FORMAT_RGBA16F;
 };
 
 // Renderable surface patch used for lightmapped geometry emission. A single
@@ -20,11 +28,25 @@ struct LightmapPatch {
     uint32_t              sourcePolyIndex = 0;
 };
 
+// Lets the caller write pages out while the bake is still running. `begin`
+// runs once after packing with every page's size and format (no pixels yet);
+// `write` runs once per page as soon as its encoding is final, in island
+// order rather than page order. The baker drops the encoded bytes afterwards.
+struct LightmapPageSink {
+    std::function<void(const std::vector<LightmapPage>& pages)> begin;
+    std::function<void(uint32_t pageIndex, const LightmapPage& page)> write;
+};
+
 struct LightmapAtlas {
     std::vector<LightmapPage> pages;
     std::vector<LightmapPatch> patches;
+    size_t peakResidentPageBytes = 0;   // most float page bytes live at once during the bake
 };
 
+// False for sky, liquids, utility textures (clip, trigger, nodraw, ...) and
+// light brush faces: the surfaces light passes through.
+bool PolygonCastsShadowForLighting(const MapPolygon& poly);
+
 enum LightmapBakeBackendMode : uint8_t {
     LIGHTMAP_BAKE_BACKEND_AUTO = 0,
     LIGHTMAP_BAKE_BACKEND_FORCE_CPU,
@@ -36,6 +58,9 @@ enum LightmapBakeBackendMode : uint8_t {
 // from the supplied point lights. `polys` remains the authoritative source
 // polygon list for world geometry/collision; any patch subdivision returned in
 // LightmapAtlas::patches is only for lightmapped render emission.
+// With a `sink` the returned pages carry only their size and format.
+// `maxResidentPageBytes` (0 = unlimited) caps the float pages kept live when
+// islands of seam-linked pages can finish independently; see lightmap.cpp.
 LightmapAtlas BakeLightmap(const std::vector<MapPolygon>& polys,
                            const std::vector<MapPolygon>& occluderPolys,
                            const std::vector<MapPolygon>& solidPolys,
@@ -43,4 +68,6 @@ LightmapAtlas BakeLightmap(const std::vector<MapPolygon>& polys,
                            const std::vector<SurfaceLightTemplate>& surfaceLights,
                            const std::unordered_map<std::string, Vector3>& textureBounceColors,
                            const LightBakeSettings& settings,
-                           LightmapBakeBackendMode backendMode = LIGHTMAP_BAKE_BACKEND_AUTO);
+                           LightmapBakeBackendMode backendMode = LIGHTMAP_BAKE_BACKEND_AUTO,
+                           const LightmapPageSink* sink = nullptr,
+                           size_t maxResidentPageBytes = 0);
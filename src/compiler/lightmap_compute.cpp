@@ -639,6 +639,41 @@ bool BuildLightmapComputeBvh(const std::vector<LightmapComputeOccluderTri>& occl
 #endif
 }
 
+bool LightmapComputeAvailable(std::string* error) {
+    static bool probed = false;
+    static bool available = false;
+    static std::string probeError;
+    if (!probed) {
+        probed = true;
+        sg_environment environment{};
+        if (LightmapComputePlatform_Init(&environment, &probeError)) {
+            sg_desc setupDesc{};
+            setupDesc.logger.func = slog_func;
+            setupDesc.environment = environment;
+            sg_setup(&setupDesc);
+            if (!sg_isvalid()) {
+                SetError(&probeError, "sg_setup failed for the lightmap compute baker.");
+            } else if (!BackendMatchesBuild(sg_query_backend())) {
+                SetError(&probeError,
+                         "Lightmap compute backend mismatch: build expects this platform backend, runtime resolved %s.",
+                         BackendName(sg_query_backend()));
+            } else if (!sg_query_features().compute) {
+                SetError(&probeError, "Sokol compute is unavailable on backend %s.", BackendName(sg_query_backend()));
+            } else {
+                available = true;
+            }
+            if (sg_isvalid()) {
+                sg_shutdown();
+            }
+            LightmapComputePlatform_Shutdown();
+        }
+    }
+    if (!available && error) {
+        *error = probeError;
+    }
+    return available;
+}
+
 bool BakeLightmapCompute(const std::vector<LightmapComputeFaceRect>& rects,
                          const std::vector<LightmapComputeOccluderTri>& occluders,
                          const LightmapComputeBvh& bvh,
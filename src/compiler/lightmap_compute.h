@@ -137,6 +137,12 @@ bool BuildLightmapComputeBvh(const std::vector<LightmapComputeOccluderTri>& occl
                              LightmapComputeBvh* outBvh,
                              std::string* error = nullptr);
 
+// Whether a compute-capable device for this build's backend can be set up.
+// Probed on the first call only; later calls return the same answer (and
+// error), so bakes can route every page to the CPU up front instead of
+// building a payload per page for BakeLightmapCompute to reject.
+bool LightmapComputeAvailable(std::string* error = nullptr);
+
 bool BakeLightmapCompute(const std::vector<LightmapComputeFaceRect>& rects,
                          const std::vector<LightmapComputeOccluderTri>& occluders,
                          const LightmapComputeBvh& bvh,
@@ -189,6 +189,18 @@ Vector3 PointEntityAnglesToTBDirection(const Vector3& angles) {
     });
 }
 
+static bool PointEntityAnglesToFacing(const Vector3& angles, float& outYaw, float& outPitch) {
+    const Vector3 directionWorld = ConvertTBPointEntityToWorld(PointEntityAnglesToTBDirection(angles));
+    if (Vector3LengthSq(directionWorld) <= 1.0e-6f) {
+        return false;
+    }
+
+    const Vector3 normalized = Vector3Normalize(directionWorld);
+    outYaw = atan2f(normalized.z, normalized.x) * RAD2DEG;
+    outPitch = asinf(std::clamp(normalized.y, -1.0f, 1.0f)) * RAD2DEG;
+    return true;
+}
+
 bool ParsePointEntityFacing(const Entity& entity, float& outYaw, float& outPitch) {
     outYaw = 0.0f;
     outPitch = 0.0f;
@@ -198,15 +210,23 @@ bool ParsePointEntityFacing(const Entity& entity, float& outYaw, float& outPitch
         return false;
     }
 
-    const Vector3 directionWorld = ConvertTBPointEntityToWorld(PointEntityAnglesToTBDirection(angles));
-    if (Vector3LengthSq(directionWorld) <= 1.0e-6f) {
-        return false;
+    return PointEntityAnglesToFacing(angles, outYaw, outPitch);
+}
+
+bool ParsePointEntityFacing(const EntityTable& table, size_t entityIndex, float& outYaw, float& outPitch) {
+    outYaw = 0.0f;
+    outPitch = 0.0f;
+
+    Vector3 angles{};
+    const BSPEntityProperty* property = FindEntityProperty(table, entityIndex, "angles");
+    if (!property || !EntityPropertyVec3(*property, angles)) {
+        property = FindEntityProperty(table, entityIndex, "mangle");
+        if (!property || !EntityPropertyVec3(*property, angles)) {
+            return false;
+        }
     }
 
-    const Vector3 normalized = Vector3Normalize(directionWorld);
-    outYaw = atan2f(normalized.z, normalized.x) * RAD2DEG;
-    outPitch = asinf(std::clamp(normalized.y, -1.0f, 1.0f)) * RAD2DEG;
-    return true;
+    return PointEntityAnglesToFacing(angles, outYaw, outPitch);
 }
 
 bool FindEntityOriginByTargetname(const Map& map, const std::string& targetname, Vector3& outWorldOrigin) {
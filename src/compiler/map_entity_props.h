@@ -1,5 +1,6 @@
 #pragma once
 
+#include "../utils/entity_table.h"
 #include "../utils/map_types.h"
 
 #include <string>
@@ -23,6 +24,7 @@ Vector3 MangleToTBDirection(const Vector3& mangle);
 Vector3 MangleToWorldLightDirection(const Vector3& mangle);
 Vector3 PointEntityAnglesToTBDirection(const Vector3& angles);
 bool ParsePointEntityFacing(const Entity& entity, float& outYaw, float& outPitch);
+bool ParsePointEntityFacing(const EntityTable& table, size_t entityIndex, float& outYaw, float& outPitch);
 bool FindEntityOriginByTargetname(const Map& map, const std::string& targetname, Vector3& outWorldOrigin);
 bool ParseLightDirection(const Map& map, const Entity& e, const Vector3& lightOrigin, Vector3& outDirection);
 float ParseAngleScaleProp(const Entity& e, float defaultValue);
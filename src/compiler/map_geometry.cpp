@@ -461,6 +461,16 @@ Vector3 ConvertTBPointEntityToWorld(const Vector3& in) {
     return ConvertTBtoWorld(in);
 }
 
+// Inverse of ConvertTBtoWorld, for files the editor reads back.
+Vector3 ConvertWorldToTB(const Vector3& in) {
+    Vector3 out = {
+         in.x,
+        -in.z,
+         in.y
+    };
+    return out;
+}
+
 Vector3 PolygonCentroid(const std::vector<Vector3>& verts) {
     Vector3 centroid{0, 0, 0};
     if (verts.empty()) {
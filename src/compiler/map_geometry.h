@@ -23,6 +23,7 @@ bool GetIntersection(const Plane& p1, const Plane& p2, const Plane& p3, Vector3&
 Vector3 ConvertTBtoWorld(const Vector3& in);
 Vector3 ConvertTBTextureAxisToWorld(const Vector3& in);
 Vector3 ConvertTBPointEntityToWorld(const Vector3& in);
+Vector3 ConvertWorldToTB(const Vector3& in);
 void ConvertMapPolygonTBToWorld(MapPolygon& poly);
 void ConvertMapPolygonsTBToWorld(std::vector<MapPolygon>& polys);
 void CleanupClippedPolygon(std::vector<Vector3>& poly, const Vector3& expectedNormal);
@@ -1,6 +1,7 @@
 #include "map_lights.h"
 #include "map_entity_props.h"
 #include "map_geometry.h"
+#include "../utils/lightmap_codec.h"
 
 #include <algorithm>
 #include <cmath>
@@ -254,6 +255,15 @@ LightBakeSettings GetLightBakeSettings(const Map &map) {
             settings.soften = soften;
         }
 
+        // _lightmap_format: encoding of the lightmap lump pages (rgba16f,
+        // rgb9e5, bc6h or rgba8). compile_map's -lightmap-format overrides it.
+        auto formatIt = entity.properties.find("_lightmap_format");
+        if (formatIt != entity.properties.end() &&
+            !LightmapFormatFromName(formatIt->second.c_str(), &settings.lightmapFormat)) {
+            printf("[LightSettings] unknown _lightmap_format '%s', keeping %s\n",
+                   formatIt->second.c_str(), LightmapFormatName(settings.lightmapFormat));
+        }
+
         Vector3 parsedColor{};
         if (ParseUnitOr255ColorProp(entity, "_sunlight_color", parsedColor) ||
             ParseUnitOr255ColorProp(entity, "_sun_color", parsedColor)) {
@@ -278,7 +288,7 @@ LightBakeSettings GetLightBakeSettings(const Map &map) {
         break;
     }
 
-    printf("[LightSettings] ambient=(%.2f,%.2f,%.2f) luxel=%.3f bounces=%d bounceScale=%.2f bounceColorScale=%.2f bounceSubdiv=%.1f range=%.2f maxLight=%.3f gamma=%.2f surfScale=%.2f surfAtten=%.2f surfSubdiv=%.1f sampleOffset=%.3f sun=%.1f sun2=%.1f sun3=%.1f sunNoSky=%d dirt=%d lmAA=%d extraSamples=%d soften=%d\n",
+    printf("[LightSettings] ambient=(%.2f,%.2f,%.2f) luxel=%.3f bounces=%d bounceScale=%.2f bounceColorScale=%.2f bounceSubdiv=%.1f range=%.2f maxLight=%.3f gamma=%.2f surfScale=%.2f surfAtten=%.2f surfSubdiv=%.1f sampleOffset=%.3f sun=%.1f sun2=%.1f sun3=%.1f sunNoSky=%d dirt=%d lmAA=%d extraSamples=%d soften=%d lmFormat=%s\n",
            settings.ambientColor.x, settings.ambientColor.y, settings.ambientColor.z,
            settings.luxelSize, settings.bounceCount, settings.bounceScale, settings.bounceColorScale,
            settings.bounceLightSubdivision, settings.rangeScale, settings.maxLight, settings.lightmapGamma,
@@ -286,7 +296,8 @@ LightBakeSettings GetLightBakeSettings(const Map &map) {
            settings.surfaceSampleOffset,
            settings.sunlightIntensity, settings.sunlight2Intensity, settings.sunlight3Intensity,
            settings.sunlightNoSky,
-           settings.dirt, settings.lmAAScale, settings.extraSamples, settings.soften);
+           settings.dirt, settings.lmAAScale, settings.extraSamples, settings.soften,
+           LightmapFormatName(settings.lightmapFormat));
     return settings;
 }
 
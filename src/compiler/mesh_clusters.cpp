@@ -0,0 +1,138 @@
+#include "mesh_clusters.h"
+
+#include <algorithm>
+#include <array>
+#include <limits>
+
+namespace {
+
+struct ClusterBounds {
+    float min[3] = {
+        std::numeric_limits<float>::max(),
+        std::numeric_limits<float>::max(),
+        std::numeric_limits<float>::max()
+    };
+    float max[3] = {
+        -std::numeric_limits<float>::max(),
+        -std::numeric_limits<float>::max(),
+        -std::numeric_limits<float>::max()
+    };
+
+    void Extend(const BSPVertex& v) {
+        const float p[3] = { v.x, v.y, v.z };
+        Extend(p);
+    }
+    void Extend(const float p[3]) {
+        for (int axis = 0; axis < 3; ++axis) {
+            min[axis] = std::min(min[axis], p[axis]);
+            max[axis] = std::max(max[axis], p[axis]);
+        }
+    }
+    int LongestAxis() const {
+        const float extent[3] = { max[0] - min[0], max[1] - min[1], max[2] - min[2] };
+        if (extent[0] >= extent[1] && extent[0] >= extent[2]) return 0;
+        return extent[1] >= extent[2] ? 1 : 2;
+    }
+    float LongestExtent() const {
+        const int axis = LongestAxis();
+        return max[axis] - min[axis];
+    }
+};
+
+struct ClusterBuilder {
+    const std::vector<MeshClusterPolygon>& polygons;
+    std::vector<std::array<float, 3>>      centroids;
+    std::vector<uint32_t>                  order;
+    uint32_t                               maxTriangles;
+    float                                  maxExtent;
+    std::vector<MeshCluster>               clusters;
+
+    void Emit(size_t begin, size_t end) {
+        MeshCluster& cluster = clusters.emplace_back();
+        for (size_t i = begin; i < end; ++i) {
+            const MeshClusterPolygon& poly = polygons[order[i]];
+            const uint32_t base = (uint32_t)cluster.vertices.size();
+            cluster.vertices.insert(cluster.vertices.end(), poly.vertices.begin(), poly.vertices.end());
+            for (uint32_t index : poly.indices) {
+                cluster.indices.push_back(base + index);
+            }
+        }
+        UpdateMeshClusterBounds(cluster);
+    }
+
+    void Split(size_t begin, size_t end) {
+        ClusterBounds bounds;
+        ClusterBounds centroidBounds;
+        size_t triangles = 0;
+        for (size_t i = begin; i < end; ++i) {
+            const MeshClusterPolygon& poly = polygons[order[i]];
+            for (const BSPVertex& v : poly.vertices) {
+                bounds.Extend(v);
+            }
+            centroidBounds.Extend(centroids[order[i]].data());
+            triangles += poly.indices.size() / 3;
+        }
+
+        if (end - begin <= 1 ||
+            (triangles <= maxTriangles && bounds.LongestExtent() <= maxExtent) ||
+            centroidBounds.LongestExtent() <= 0.0f) {
+            Emit(begin, end);
+            return;
+        }
+
+        const int axis = centroidBounds.LongestAxis();
+        const size_t mid = begin + (end - begin) / 2;
+        std::nth_element(order.begin() + begin, order.begin() + mid, order.begin() + end,
+                         [&](uint32_t a, uint32_t b) {
+                             if (centroids[a][axis] != centroids[b][axis]) {
+                                 return centroids[a][axis] < centroids[b][axis];
+                             }
+                             return a < b;
+                         });
+        Split(begin, mid);
+        Split(mid, end);
+    }
+};
+
+} // namespace
+
+std::vector<MeshCluster> BuildMeshClusters(const std::vector<MeshClusterPolygon>& polygons,
+                                           uint32_t maxTriangles,
+                                           float maxExtent)
+{
+    ClusterBuilder builder{ polygons, {}, {}, maxTriangles, maxExtent, {} };
+    builder.centroids.resize(polygons.size());
+    builder.order.reserve(polygons.size());
+    for (size_t i = 0; i < polygons.size(); ++i) {
+        const MeshClusterPolygon& poly = polygons[i];
+        std::array<float, 3> sum{ 0.0f, 0.0f, 0.0f };
+        for (const BSPVertex& v : poly.vertices) {
+            sum[0] += v.x;
+            sum[1] += v.y;
+            sum[2] += v.z;
+        }
+        const float scale = poly.vertices.empty() ? 0.0f : 1.0f / (float)poly.vertices.size();
+        builder.centroids[i] = { sum[0] * scale, sum[1] * scale, sum[2] * scale };
+        if (!poly.indices.empty()) {
+            builder.order.push_back((uint32_t)i);
+        }
+    }
+    if (!builder.order.empty()) {
+        builder.Split(0, builder.order.size());
+    }
+    return std::move(builder.clusters);
+}
+
+void UpdateMeshClusterBounds(MeshCluster& cluster)
+{
+    ClusterBounds bounds;
+    for (const BSPVertex& v : cluster.vertices) {
+        bounds.Extend(v);
+    }
+    if (cluster.vertices.empty()) {
+        cluster.min = cluster.max = BSPVec3{ 0.0f, 0.0f, 0.0f };
+        return;
+    }
+    cluster.min = BSPVec3{ bounds.min[0], bounds.min[1], bounds.min[2] };
+    cluster.max = BSPVec3{ bounds.max[0], bounds.max[1], bounds.max[2] };
+}
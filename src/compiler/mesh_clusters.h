@@ -0,0 +1,35 @@
+#pragma once
+
+#include "../utils/bsp_format.h"
+
+#include <cstdint>
+#include <vector>
+
+// A cluster stops splitting once it is within both limits. The extent is
+// the longest side of its bounds, in world units.
+inline constexpr uint32_t MESH_CLUSTER_MAX_TRIANGLES = 256;
+inline constexpr float MESH_CLUSTER_MAX_EXTENT = 512.0f;
+
+// One triangulated polygon of a render bucket.
+struct MeshClusterPolygon {
+    std::vector<BSPVertex> vertices;
+    std::vector<uint32_t>  indices;   // relative to `vertices`
+};
+
+struct MeshCluster {
+    std::vector<BSPVertex> vertices;
+    std::vector<uint32_t>  indices;   // relative to `vertices`
+    BSPVec3                min{};
+    BSPVec3                max{};
+};
+
+// Groups a bucket's polygons into spatially compact clusters by splitting
+// at the median polygon centroid along the longest axis until each cluster
+// is within the limits above. Polygons are never split; a single polygon
+// over the limits becomes its own cluster.
+std::vector<MeshCluster> BuildMeshClusters(const std::vector<MeshClusterPolygon>& polygons,
+                                           uint32_t maxTriangles = MESH_CLUSTER_MAX_TRIANGLES,
+                                           float maxExtent = MESH_CLUSTER_MAX_EXTENT);
+
+// Recomputes `cluster.min`/`max` from its vertices.
+void UpdateMeshClusterBounds(MeshCluster& cluster);
@@ -0,0 +1,217 @@
+#include "mesh_optimize.h"
+
+#include <cmath>
+#include <string_view>
+#include <unordered_map>
+
+namespace {
+
+// Tom Forsyth, "Linear-Speed Vertex Cache Optimisation" (2006).
+static constexpr float kCacheDecayPower = 1.5f;
+static constexpr float kLastTriangleScore = 0.75f;
+static constexpr float kValenceBoostScale = 2.0f;
+static constexpr float kValenceBoostPower = 0.5f;
+
+static float VertexScore(int cachePosition, uint32_t liveTriangles)
+{
+    if (liveTriangles == 0) {
+        return -1.0f;
+    }
+    float score = 0.0f;
+    if (cachePosition >= 0) {
+        if (cachePosition < 3) {
+            // The triangle just emitted; deliberately below the next slots so
+            // the strip-like walk does not keep reusing the same edge.
+            score = kLastTriangleScore;
+        } else {
+            const float scale = 1.0f / (float)(MESH_OPTIMIZE_CACHE_SIZE - 3);
+            score = powf(1.0f - (float)(cachePosition - 3) * scale, kCacheDecayPower);
+        }
+    }
+    // Favour vertices with few triangles left so they are finished off.
+    score += kValenceBoostScale * powf((float)liveTriangles, -kValenceBoostPower);
+    return score;
+}
+
+static void WeldVertices(std::vector<BSPVertex>& vertices, std::vector<uint32_t>& indices)
+{
+    std::unordered_map<std::string_view, uint32_t> firstByBytes;
+    firstByBytes.reserve(vertices.size());
+    std::vector<uint32_t> remap(vertices.size());
+    std::vector<BSPVertex> welded;
+    welded.reserve(vertices.size());
+    for (size_t i = 0; i < vertices.size(); ++i) {
+        const std::string_view bytes((const char*)&vertices[i], sizeof(BSPVertex));
+        auto [it, inserted] = firstByBytes.emplace(bytes, (uint32_t)welded.size());
+        if (inserted) {
+            welded.push_back(vertices[i]);
+        }
+        remap[i] = it->second;
+    }
+    for (uint32_t& index : indices) {
+        index = remap[index];
+    }
+    vertices.swap(welded);
+}
+
+static void OptimizeTriangleOrder(std::vector<uint32_t>& indices, size_t vertexCount)
+{
+    const size_t triangleCount = indices.size() / 3;
+    if (triangleCount < 2) {
+        return;
+    }
+
+    // Per-vertex lists of triangles not yet emitted: adjacency[start[v] ..
+    // start[v] + live[v]).
+    std::vector<uint32_t> live(vertexCount, 0);
+    for (uint32_t index : indices) {
+        ++live[index];
+    }
+    std::vector<uint32_t> start(vertexCount + 1, 0);
+    for (size_t v = 0; v < vertexCount; ++v) {
+        start[v + 1] = start[v] + live[v];
+    }
+    std::vector<uint32_t> adjacency(indices.size());
+    {
+        std::vector<uint32_t> fill(start.begin(), start.end() - 1);
+        for (size_t i = 0; i < indices.size(); ++i) {
+            adjacency[fill[indices[i]]++] = (uint32_t)(i / 3);
+        }
+    }
+
+    std::vector<int> cachePosition(vertexCount, -1);
+    std::vector<float> vertexScore(vertexCount);
+    for (size_t v = 0; v < vertexCount; ++v) {
+        vertexScore[v] = VertexScore(-1, live[v]);
+    }
+    std::vector<float> triangleScore(triangleCount);
+    for (size_t t = 0; t < triangleCount; ++t) {
+        triangleScore[t] = vertexScore[indices[t * 3]] + vertexScore[indices[t * 3 + 1]] +
+                           vertexScore[indices[t * 3 + 2]];
+    }
+    std::vector<uint8_t> emitted(triangleCount, 0);
+
+    std::vector<uint32_t> cache;
+    std::vector<uint32_t> nextCache;
+    cache.reserve(MESH_OPTIMIZE_CACHE_SIZE + 3);
+    nextCache.reserve(MESH_OPTIMIZE_CACHE_SIZE + 3);
+    std::vector<uint32_t> ordered;
+    ordered.reserve(indices.size());
+
+    int64_t best = -1;
+    for (size_t emittedCount = 0; emittedCount < triangleCount; ++emittedCount) {
+        if (best < 0) {
+            // Nothing in the cache touches a live triangle: start a new
+            // island from the best-scoring triangle left.
+            float bestScore = -1.0f;
+            for (size_t t = 0; t < triangleCount; ++t) {
+                if (!emitted[t] && triangleScore[t] > bestScore) {
+                    bestScore = triangleScore[t];
+                    best = (int64_t)t;
+                }
+            }
+        }
+
+        const uint32_t t = (uint32_t)best;
+        const uint32_t* tri = &indices[(size_t)t * 3];
+        ordered.insert(ordered.end(), tri, tri + 3);
+        emitted[t] = 1;
+        for (int k = 0; k < 3; ++k) {
+            const uint32_t v = tri[k];
+            uint32_t* list = &adjacency[start[v]];
+            for (uint32_t j = 0; j < live[v]; ++j) {
+                if (list[j] == t) {
+                    list[j] = list[--live[v]];
+                    break;
+                }
+            }
+        }
+
+        nextCache.clear();
+        for (int k = 0; k < 3; ++k) {
+            if (k == 0 || (tri[k] != tri[0] && (k == 1 || tri[k] != tri[1]))) {
+                nextCache.push_back(tri[k]);
+            }
+        }
+        for (uint32_t v : cache) {
+            if (v != tri[0] && v != tri[1] && v != tri[2]) {
+                nextCache.push_back(v);
+            }
+        }
+        for (size_t k = 0; k < nextCache.size(); ++k) {
+            const uint32_t v = nextCache[k];
+            cachePosition[v] = k < (size_t)MESH_OPTIMIZE_CACHE_SIZE ? (int)k : -1;
+            vertexScore[v] = VertexScore(cachePosition[v], live[v]);
+        }
+
+        // Only triangles touching a vertex whose score moved can change.
+        best = -1;
+        float bestScore = -1.0f;
+        for (uint32_t v : nextCache) {
+            for (uint32_t j = 0; j < live[v]; ++j) {
+                const uint32_t other = adjacency[start[v] + j];
+                const float score = vertexScore[indices[(size_t)other * 3]] +
+                                    vertexScore[indices[(size_t)other * 3 + 1]] +
+                                    vertexScore[indices[(size_t)other * 3 + 2]];
+                triangleScore[other] = score;
+                if (score > bestScore) {
+                    bestScore = score;
+                    best = other;
+                }
+            }
+        }
+
+        if (nextCache.size() > (size_t)MESH_OPTIMIZE_CACHE_SIZE) {
+            nextCache.resize(MESH_OPTIMIZE_CACHE_SIZE);
+        }
+        cache.swap(nextCache);
+    }
+    indices.swap(ordered);
+}
+
+static void OptimizeVertexFetch(std::vector<BSPVertex>& vertices, std::vector<uint32_t>& indices)
+{
+    std::vector<uint32_t> remap(vertices.size(), UINT32_MAX);
+    std::vector<BSPVertex> ordered;
+    ordered.reserve(vertices.size());
+    for (uint32_t& index : indices) {
+        if (remap[index] == UINT32_MAX) {
+            remap[index] = (uint32_t)ordered.size();
+            ordered.push_back(vertices[index]);
+        }
+        index = remap[index];
+    }
+    vertices.swap(ordered);
+}
+
+} // namespace
+
+size_t CountCacheMisses(const std::vector<uint32_t>& indices, size_t vertexCount, int cacheSize)
+{
+    // insertedAt[v] is the miss that loaded v (1-based); it has been pushed
+    // out once `cacheSize` further misses have happened.
+    std::vector<size_t> insertedAt(vertexCount, 0);
+    size_t misses = 0;
+    for (uint32_t index : indices) {
+        if (insertedAt[index] == 0 || misses - insertedAt[index] >= (size_t)cacheSize) {
+            insertedAt[index] = ++misses;
+        }
+    }
+    return misses;
+}
+
+void OptimizeMesh(std::vector<BSPVertex>& vertices,
+                  std::vector<uint32_t>& indices,
+                  MeshOptimizeStats* stats)
+{
+    stats->vertexCountBefore += vertices.size();
+    stats->triangleCount += indices.size() / 3;
+    stats->cacheMissesBefore += CountCacheMisses(indices, vertices.size(), MESH_ACMR_CACHE_SIZE);
+
+    WeldVertices(vertices, indices);
+    OptimizeTriangleOrder(indices, vertices.size());
+    OptimizeVertexFetch(vertices, indices);
+
+    stats->vertexCountAfter += vertices.size();
+    stats->cacheMissesAfter += CountCacheMisses(indices, vertices.size(), MESH_ACMR_CACHE_SIZE);
+}
@@ -0,0 +1,33 @@
+#pragma once
+
+#include "../utils/bsp_format.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Post-transform cache size the triangle order is tuned for, and the FIFO
+// size ACMR (cache misses per triangle) is measured with.
+inline constexpr int MESH_OPTIMIZE_CACHE_SIZE = 32;
+inline constexpr int MESH_ACMR_CACHE_SIZE = 16;
+
+struct MeshOptimizeStats {
+    size_t vertexCountBefore = 0;
+    size_t vertexCountAfter = 0;
+    size_t triangleCount = 0;
+    size_t cacheMissesBefore = 0;
+    size_t cacheMissesAfter = 0;
+};
+
+// Optimises one mesh in place; `indices` are relative to `vertices`.
+//   1. welds bitwise-identical vertices,
+//   2. reorders triangles for the post-transform cache (Forsyth),
+//   3. renumbers vertices in first-use order for fetch locality, dropping
+//      any no triangle references.
+// Triangles keep their winding. Adds this mesh's counts to `stats`.
+void OptimizeMesh(std::vector<BSPVertex>& vertices,
+                  std::vector<uint32_t>& indices,
+                  MeshOptimizeStats* stats);
+
+// Vertices a FIFO cache of `cacheSize` entries would transform for `indices`.
+size_t CountCacheMisses(const std::vector<uint32_t>& indices, size_t vertexCount, int cacheSize);
@@ -0,0 +1,45 @@
+#include "occluders.h"
+
+#include "lightmap.h"
+#include "map_geometry.h"
+
+#include <algorithm>
+
+OccluderSelection SelectOccluders(const std::vector<MapPolygon>& polys, int worldEntityId, size_t maxCount)
+{
+    struct Candidate {
+        size_t poly;
+        float  area;
+    };
+    OccluderSelection out;
+    std::vector<Candidate> candidates;
+    for (size_t i = 0; i < polys.size(); ++i) {
+        const MapPolygon& poly = polys[i];
+        if (poly.sourceEntityId != worldEntityId || poly.verts.size() < 3 ||
+            (!poly.texture.empty() && poly.texture[0] == '{') ||
+            !PolygonCastsShadowForLighting(poly)) {
+            continue;
+        }
+        const float area = PolygonArea3D(poly.verts);
+        out.candidateArea += area;
+        if (area >= OCCLUDER_MIN_AREA && poly.verts.size() <= OCCLUDER_MAX_VERTICES) {
+            candidates.push_back({ i, area });
+        }
+    }
+    std::sort(candidates.begin(), candidates.end(), [](const Candidate& a, const Candidate& b) {
+        return a.area != b.area ? a.area > b.area : a.poly < b.poly;
+    });
+    if (candidates.size() > maxCount) {
+        candidates.resize(maxCount);
+    }
+
+    for (const Candidate& c : candidates) {
+        const MapPolygon& poly = polys[c.poly];
+        out.occluders.push_back({ (uint32_t)out.verts.size(), (uint32_t)poly.verts.size() });
+        for (const Vector3& v : poly.verts) {
+            out.verts.push_back({ v.x, v.y, v.z });
+        }
+        out.area += c.area;
+    }
+    return out;
+}
@@ -0,0 +1,27 @@
+#pragma once
+
+#include "../utils/bsp_format.h"
+#include "../utils/map_types.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Occluders are whole polygons, never split, so a face with more vertices
+// than this is left out rather than clipped.
+inline constexpr size_t OCCLUDER_MAX_COUNT = 512;
+inline constexpr uint32_t OCCLUDER_MAX_VERTICES = 16;
+inline constexpr float OCCLUDER_MIN_AREA = 64.0f * 64.0f;   // square world units
+
+struct OccluderSelection {
+    std::vector<BSPOccluder> occluders;   // largest first
+    std::vector<BSPVec3>     verts;
+    double                   area = 0.0;           // of the chosen polygons
+    double                   candidateArea = 0.0;  // of every opaque world polygon
+};
+
+// Picks the largest opaque polygons of the world entity as the occluders the
+// engine rasterizes for occlusion culling. Cut-out ('{') textures and
+// anything light passes through are skipped.
+OccluderSelection SelectOccluders(const std::vector<MapPolygon>& polys, int worldEntityId,
+                                  size_t maxCount = OCCLUDER_MAX_COUNT);
@@ -0,0 +1,148 @@
+#include "outside_fill.h"
+
+#include "map_geometry.h"
+#include "../utils/bsp_vis.h"
+
+#include <algorithm>
+#include <cstdio>
+
+namespace {
+
+static constexpr uint32_t kNoParent = 0xFFFFFFFFu;
+// How far past the leaking portal the pointfile path ends.
+static constexpr float kLeakPathOvershoot = 32.0f;
+
+static Vector3 PortalCenter(const LeafPortal& portal) {
+    return PolygonCentroid(portal.points);
+}
+
+} // namespace
+
+OutsideFillResult FillOutside(StructuralBSPData& bsp,
+                              std::vector<LeafPortal>& portals,
+                              const std::vector<Vector3>& starts)
+{
+    OutsideFillResult result;
+    result.faceReachable.assign(bsp.faces.size(), 1);
+    const size_t leafCount = bsp.leaves.size();
+    if (leafCount == 0) {
+        return result;
+    }
+
+    std::vector<std::vector<uint32_t>> leafPortals(leafCount);
+    for (size_t i = 0; i < portals.size(); ++i) {
+        if (portals[i].frontLeaf != LEAF_PORTAL_OUTSIDE) leafPortals[(size_t)portals[i].frontLeaf].push_back((uint32_t)i);
+        if (portals[i].backLeaf != LEAF_PORTAL_OUTSIDE) leafPortals[(size_t)portals[i].backLeaf].push_back((uint32_t)i);
+    }
+
+    // Breadth first, so a leak is reported along the shortest portal chain.
+    std::vector<uint8_t> reached(leafCount, 0);
+    std::vector<uint32_t> parentPortal(leafCount, kNoParent);
+    std::vector<uint32_t> rootStart(leafCount, 0);
+    std::vector<uint32_t> queue;
+    for (size_t i = 0; i < starts.size(); ++i) {
+        const float point[3] = { starts[i].x, starts[i].y, starts[i].z };
+        const int32_t leaf = FindBSPLeaf(bsp.nodes, bsp.planes, bsp.tree.rootChild, point);
+        if (leaf < 0 || bsp.leaves[(size_t)leaf].contents == BSP_CONTENTS_SOLID) {
+            printf("[outside_fill] warning: player start at (%.1f %.1f %.1f) is inside solid; not flooding from it\n",
+                   starts[i].x, starts[i].y, starts[i].z);
+            continue;
+        }
+        if (!reached[(size_t)leaf]) {
+            reached[(size_t)leaf] = 1;
+            rootStart[(size_t)leaf] = (uint32_t)i;
+            queue.push_back((uint32_t)leaf);
+        }
+    }
+    if (queue.empty()) {
+        return result;
+    }
+
+    for (size_t head = 0; head < queue.size(); ++head) {
+        const uint32_t leaf = queue[head];
+        for (uint32_t p : leafPortals[leaf]) {
+            const LeafPortal& portal = portals[p];
+            const int32_t other = portal.frontLeaf == (int32_t)leaf ? portal.backLeaf : portal.frontLeaf;
+            if (other == LEAF_PORTAL_OUTSIDE) {
+                result.leaked = true;
+                // Walk back to the start, then flip into start-to-outside order.
+                std::vector<Vector3> path;
+                const Vector3 outward = Vector3Scale(portal.normal, portal.frontLeaf == LEAF_PORTAL_OUTSIDE ? 1.0f : -1.0f);
+                path.push_back(Vector3Add(PortalCenter(portal), Vector3Scale(outward, kLeakPathOvershoot)));
+                path.push_back(PortalCenter(portal));
+                uint32_t at = leaf;
+                while (parentPortal[at] != kNoParent) {
+                    const LeafPortal& back = portals[parentPortal[at]];
+                    path.push_back(PortalCenter(back));
+                    at = (uint32_t)(back.frontLeaf == (int32_t)at ? back.backLeaf : back.frontLeaf);
+                }
+                path.push_back(starts[rootStart[at]]);
+                result.leakPath.assign(path.rbegin(), path.rend());
+                return result;
+            }
+            if (!reached[(size_t)other] && bsp.leaves[(size_t)other].contents != BSP_CONTENTS_SOLID) {
+                reached[(size_t)other] = 1;
+                parentPortal[(size_t)other] = p;
+                queue.push_back((uint32_t)other);
+            }
+        }
+    }
+
+    // Sealed: the void around the map becomes solid.
+    for (size_t leaf = 0; leaf < leafCount; ++leaf) {
+        BSPLeaf& l = bsp.leaves[leaf];
+        if (l.contents == BSP_CONTENTS_SOLID || reached[leaf]) {
+            continue;
+        }
+        l.contents = BSP_CONTENTS_SOLID;
+        l.faceRefCount = 0;
+        ++result.filledLeaves;
+    }
+    std::vector<LeafPortal> inside;
+    inside.reserve(portals.size());
+    for (LeafPortal& portal : portals) {
+        if (portal.frontLeaf != LEAF_PORTAL_OUTSIDE && portal.backLeaf != LEAF_PORTAL_OUTSIDE &&
+            reached[(size_t)portal.frontLeaf] && reached[(size_t)portal.backLeaf]) {
+            inside.push_back(std::move(portal));
+        }
+    }
+    portals.swap(inside);
+
+    BSPLeaf outside{};
+    outside.contents = BSP_CONTENTS_SOLID;
+    outside.minX = bsp.boundsMin.x;
+    outside.minY = bsp.boundsMin.y;
+    outside.minZ = bsp.boundsMin.z;
+    outside.maxX = bsp.boundsMax.x;
+    outside.maxY = bsp.boundsMax.y;
+    outside.maxZ = bsp.boundsMax.z;
+    outside.firstFaceRef = (uint32_t)bsp.faceRefs.size();
+    bsp.leaves.push_back(outside);
+    bsp.tree.outsideLeaf = (int32_t)bsp.leaves.size() - 1;
+
+    std::fill(result.faceReachable.begin(), result.faceReachable.end(), 0);
+    for (size_t leaf = 0; leaf < leafCount; ++leaf) {
+        const BSPLeaf& l = bsp.leaves[leaf];
+        if (!reached[leaf]) {
+            continue;
+        }
+        for (uint32_t i = 0; i < l.faceRefCount; ++i) {
+            result.faceReachable[bsp.faceRefs[l.firstFaceRef + i]] = 1;
+        }
+    }
+    result.filled = true;
+    return result;
+}
+
+bool WritePointFile(const std::string& filePath, const std::vector<Vector3>& path)
+{
+    FILE* f = fopen(filePath.c_str(), "w");
+    if (!f) {
+        return false;
+    }
+    for (const Vector3& p : path) {
+        const Vector3 tb = ConvertWorldToTB(p);
+        fprintf(f, "%f %f %f\n", tb.x, tb.y, tb.z);
+    }
+    return fclose(f) == 0;
+}
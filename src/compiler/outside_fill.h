@@ -0,0 +1,29 @@
+#pragma once
+
+#include "leaf_vis.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+struct OutsideFillResult {
+    bool                 filled = false;   // unreachable leaves were made solid
+    bool                 leaked = false;   // the flood reached the outside
+    size_t               filledLeaves = 0;
+    std::vector<Vector3> leakPath;         // world space, from a start out through the leak
+    std::vector<uint8_t> faceReachable;    // per bsp face: a reachable leaf lists it
+};
+
+// Floods the empty leaves reachable from `starts` through `portals`. When
+// the flood stays inside, every empty leaf it missed becomes solid, portals
+// touching those leaves are dropped, and a solid leaf for the void is
+// appended and named by tree.outsideLeaf. When it leaks, or no start is in
+// empty space, nothing changes and every face counts as reachable.
+OutsideFillResult FillOutside(StructuralBSPData& bsp,
+                              std::vector<LeafPortal>& portals,
+                              const std::vector<Vector3>& starts);
+
+// Writes `path` as a pointfile (one "x y z" per line, editor coordinates)
+// for the editor to draw the leak.
+bool WritePointFile(const std::string& filePath, const std::vector<Vector3>& path);
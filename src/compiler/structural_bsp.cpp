@@ -3,17 +3,37 @@
 #include <algorithm>
 #include <cmath>
 #include <cfloat>
+#include <cstdio>
 #include <limits>
 #include <unordered_map>
 
 namespace {
 
 static constexpr float kPlaneEpsilon = 0.05f;
-static constexpr int kMaxDepth = 64;
+static constexpr int kMaxDepth = 256;
+// Space kept around the geometry, so the outermost faces still have empty
+// cells in front of them.
+static constexpr float kWorldMargin = 64.0f;
 
 struct BuildFace {
     MapPolygon poly;
     int planeIndex = -1;
+    bool structural = false;
+    uint32_t sourcePoly = 0;
+};
+
+// A piece of a structural face left after splitting; the tree is built from
+// these, while face refs always name the whole source face.
+struct Fragment {
+    std::vector<Vector3> verts;
+    uint32_t face = 0;
+};
+
+// A fragment consumed on a node's plane, waiting to be filtered into the
+// leaves on its empty side.
+struct NodeFragment {
+    int32_t child = 0;
+    Fragment fragment;
 };
 
 struct BuildBounds {
@@ -52,30 +72,14 @@ static void ExtendBounds(BuildBounds* bounds, const Vector3& p) {
     bounds->max.z = std::max(bounds->max.z, p.z);
 }
 
-static BuildBounds ComputeFaceBounds(const std::vector<BuildFace>& faces, const std::vector<uint32_t>& faceIds) {
-    BuildBounds bounds;
-    if (faceIds.empty()) {
-        bounds.min = Vector3Zero();
-        bounds.max = Vector3Zero();
-        return bounds;
-    }
-    for (uint32_t faceId : faceIds) {
-        const BuildFace& face = faces[faceId];
-        for (const Vector3& v : face.poly.verts) {
-            ExtendBounds(&bounds, v);
-        }
-    }
-    return bounds;
-}
-
 static float PlaneDistance(const BSPPlane& plane, const Vector3& p) {
     return plane.nx * p.x + plane.ny * p.y + plane.nz * p.z + plane.d;
 }
 
-static FaceSide ClassifyFaceAgainstPlane(const BuildFace& face, const BSPPlane& plane) {
+static FaceSide ClassifyPointsAgainstPlane(const std::vector<Vector3>& verts, const BSPPlane& plane) {
     bool hasFront = false;
     bool hasBack = false;
-    for (const Vector3& v : face.poly.verts) {
+    for (const Vector3& v : verts) {
         const float dist = PlaneDistance(plane, v);
         if (dist > kPlaneEpsilon) {
             hasFront = true;
@@ -95,23 +99,88 @@ static FaceSide ClassifyFaceAgainstPlane(const BuildFace& face, const BSPPlane&
     return FACE_COPLANAR;
 }
 
+// Splits a spanning polygon; points within kPlaneEpsilon go to both sides.
+static void SplitPoints(const std::vector<Vector3>& verts, const BSPPlane& plane,
+                        std::vector<Vector3>* front, std::vector<Vector3>* back) {
+    for (size_t i = 0; i < verts.size(); ++i) {
+        const Vector3& a = verts[i];
+        const Vector3& b = verts[(i + 1) % verts.size()];
+        const float da = PlaneDistance(plane, a);
+        const float db = PlaneDistance(plane, b);
+        if (da >= -kPlaneEpsilon) front->push_back(a);
+        if (da <= kPlaneEpsilon) back->push_back(a);
+        if ((da > kPlaneEpsilon && db < -kPlaneEpsilon) || (da < -kPlaneEpsilon && db > kPlaneEpsilon)) {
+            const float t = da / (da - db);
+            const Vector3 hit = Vector3Add(a, Vector3Scale(Vector3Subtract(b, a), t));
+            front->push_back(hit);
+            back->push_back(hit);
+        }
+    }
+}
+
+static bool IsAxialPlane(const BSPPlane& plane) {
+    return fabsf(plane.nx) >= 1.0f - 1e-5f || fabsf(plane.ny) >= 1.0f - 1e-5f || fabsf(plane.nz) >= 1.0f - 1e-5f;
+}
+
+// The part of `bounds` on one side of `plane`. Only axial planes tighten it;
+// anything else keeps the parent box, which still contains the cell.
+static BuildBounds SplitCellBounds(const BuildBounds& bounds, const BSPPlane& plane, bool front) {
+    BuildBounds out = bounds;
+    const float n[3] = { plane.nx, plane.ny, plane.nz };
+    float* mins[3] = { &out.min.x, &out.min.y, &out.min.z };
+    float* maxs[3] = { &out.max.x, &out.max.y, &out.max.z };
+    for (int axis = 0; axis < 3; ++axis) {
+        if (fabsf(n[axis]) < 1.0f - 1e-5f) {
+            continue;
+        }
+        // n[axis] * x + d >= 0 is the front side.
+        const float cut = -plane.d / n[axis];
+        const bool keepAbove = (n[axis] > 0.0f) == front;
+        if (keepAbove) {
+            *mins[axis] = std::max(*mins[axis], cut);
+        } else {
+            *maxs[axis] = std::min(*maxs[axis], cut);
+        }
+    }
+    return out;
+}
+
 class Builder {
 public:
     explicit Builder(const std::function<uint32_t(const std::string&)>& resolveTextureIndexIn)
         : resolveTextureIndex(resolveTextureIndexIn) {
     }
 
-    StructuralBSPData Build(const std::vector<MapPolygon>& polys) {
-        InitializeFaces(polys);
-        std::vector<uint32_t> faceIds(facePool.size());
-        for (size_t i = 0; i < faceIds.size(); ++i) {
-            faceIds[i] = (uint32_t)i;
+    StructuralBSPData Build(const std::vector<MapPolygon>& polys, int worldEntityId) {
+        InitializeFaces(polys, worldEntityId);
+
+        BuildBounds world;
+        std::vector<Fragment> fragments;
+        for (size_t i = 0; i < facePool.size(); ++i) {
+            for (const Vector3& v : facePool[i].poly.verts) {
+                ExtendBounds(&world, v);
+            }
+            if (facePool[i].structural) {
+                fragments.push_back({ facePool[i].poly.verts, (uint32_t)i });
+            }
         }
+        if (facePool.empty()) {
+            world.min = world.max = Vector3Zero();
+        }
+        world.min = Vector3Subtract(world.min, { kWorldMargin, kWorldMargin, kWorldMargin });
+        world.max = Vector3Add(world.max, { kWorldMargin, kWorldMargin, kWorldMargin });
+        out.boundsMin = world.min;
+        out.boundsMax = world.max;
 
-        out.tree.rootChild = BuildNode(faceIds, 0);
+        out.tree.rootChild = BuildNode(std::move(fragments), world, BSP_CONTENTS_EMPTY, 0);
         out.tree.outsideLeaf = -1;
         out.tree.reserved0 = 0;
         out.tree.reserved1 = 0;
+        if (depthLimitHit) {
+            printf("[structural_bsp] warning: depth limit %d reached; some cells stay unsplit and count as empty\n", kMaxDepth);
+        }
+
+        FillLeafFaceRefs();
         SerializeFaces();
         return out;
     }
@@ -120,16 +189,22 @@ private:
     const std::function<uint32_t(const std::string&)>& resolveTextureIndex;
     StructuralBSPData out;
     std::vector<BuildFace> facePool;
+    std::vector<NodeFragment> nodeFragments;
+    std::vector<std::vector<uint32_t>> leafFaces;
+    bool depthLimitHit = false;
 
-    void InitializeFaces(const std::vector<MapPolygon>& polys) {
+    void InitializeFaces(const std::vector<MapPolygon>& polys, int worldEntityId) {
         facePool.reserve(polys.size());
-        for (const MapPolygon& poly : polys) {
+        for (size_t i = 0; i < polys.size(); ++i) {
+            const MapPolygon& poly = polys[i];
             if (poly.verts.size() < 3 || Vector3LengthSq(poly.normal) <= 1e-8f) {
                 continue;
             }
             BuildFace face;
             face.poly = poly;
+            face.sourcePoly = (uint32_t)i;
             face.planeIndex = FindOrAddPlane(poly.normal, -Vector3DotProduct(poly.normal, poly.verts[0]));
+            face.structural = poly.sourceEntityId == worldEntityId;
             facePool.push_back(std::move(face));
         }
     }
@@ -164,96 +239,101 @@ private:
         return first;
     }
 
-    uint32_t BuildLeaf(const std::vector<uint32_t>& faceIds) {
-        const BuildBounds bounds = ComputeFaceBounds(facePool, faceIds);
+    uint32_t BuildLeaf(int32_t contents, const BuildBounds& bounds) {
         BSPLeaf leaf{};
-        leaf.contents = 0;
+        leaf.contents = contents;
         leaf.minX = bounds.min.x;
         leaf.minY = bounds.min.y;
         leaf.minZ = bounds.min.z;
         leaf.maxX = bounds.max.x;
         leaf.maxY = bounds.max.y;
         leaf.maxZ = bounds.max.z;
-        leaf.firstFaceRef = AppendFaceRefs(faceIds);
-        leaf.faceRefCount = (uint32_t)faceIds.size();
         out.leaves.push_back(leaf);
+        leafFaces.emplace_back();
         return (uint32_t)out.leaves.size() - 1;
     }
 
-    bool ChooseSplitPlane(const std::vector<uint32_t>& faceIds, int* outPlaneIndex) const {
+    // Any structural plane will do, since every one must be consumed before
+    // a cell can be called solid or empty; prefer planes that split few
+    // fragments, balance the rest and are axial (cleaner portals).
+    int ChooseSplitPlane(const std::vector<Fragment>& fragments) const {
         float bestScore = FLT_MAX;
         int bestPlane = -1;
-        for (uint32_t faceId : faceIds) {
-            const BuildFace& candidateFace = facePool[faceId];
-            const BSPPlane& plane = out.planes[(size_t)candidateFace.planeIndex];
+        std::vector<uint8_t> tried(out.planes.size(), 0);
+        for (const Fragment& candidate : fragments) {
+            const int planeIndex = facePool[candidate.face].planeIndex;
+            if (tried[(size_t)planeIndex]) {
+                continue;
+            }
+            tried[(size_t)planeIndex] = 1;
+            const BSPPlane& plane = out.planes[(size_t)planeIndex];
             PlaneClassification stats;
-            for (uint32_t otherId : faceIds) {
-                switch (ClassifyFaceAgainstPlane(facePool[otherId], plane)) {
+            for (const Fragment& other : fragments) {
+                switch (ClassifyPointsAgainstPlane(other.verts, plane)) {
                     case FACE_FRONT: ++stats.frontCount; break;
                     case FACE_BACK: ++stats.backCount; break;
                     case FACE_COPLANAR: ++stats.coplanarCount; break;
                     case FACE_SPANNING: ++stats.spanningCount; break;
                 }
             }
-            if (stats.frontCount == 0 || stats.backCount == 0) {
-                continue;
-            }
             const float score = (float)stats.spanningCount * 8.0f +
-                                (float)abs(stats.frontCount - stats.backCount) +
-                                (float)stats.coplanarCount * 0.25f;
+                                (float)abs(stats.frontCount - stats.backCount) -
+                                (float)stats.coplanarCount * 0.5f +
+                                (IsAxialPlane(plane) ? 0.0f : 4.0f);
             if (score < bestScore) {
                 bestScore = score;
-                bestPlane = candidateFace.planeIndex;
+                bestPlane = planeIndex;
             }
         }
-        if (bestPlane < 0) {
-            return false;
-        }
-        *outPlaneIndex = bestPlane;
-        return true;
+        return bestPlane;
     }
 
-    int32_t BuildNode(const std::vector<uint32_t>& faceIds, int depth) {
-        if (faceIds.empty() || depth >= kMaxDepth || faceIds.size() <= 2) {
-            return EncodeLeafIndex(BuildLeaf(faceIds));
+    // Structural faces point out of solid space, so a cell that runs out of
+    // fragments behind a face plane is solid and one in front of it empty.
+    int32_t BuildNode(std::vector<Fragment> fragments, const BuildBounds& bounds, int32_t contents, int depth) {
+        if (fragments.empty()) {
+            return EncodeLeafIndex(BuildLeaf(contents, bounds));
         }
-
-        int splitPlaneIndex = -1;
-        if (!ChooseSplitPlane(faceIds, &splitPlaneIndex)) {
-            return EncodeLeafIndex(BuildLeaf(faceIds));
+        if (depth >= kMaxDepth) {
+            depthLimitHit = true;
+            return EncodeLeafIndex(BuildLeaf(BSP_CONTENTS_EMPTY, bounds));
         }
 
-        const BSPPlane& plane = out.planes[(size_t)splitPlaneIndex];
+        const int splitPlaneIndex = ChooseSplitPlane(fragments);
+        const BSPPlane plane = out.planes[(size_t)splitPlaneIndex];
+        const Vector3 planeNormal = { plane.nx, plane.ny, plane.nz };
         std::vector<uint32_t> nodeFaces;
-        std::vector<uint32_t> frontFaces;
-        std::vector<uint32_t> backFaces;
+        std::vector<Fragment> coplanar;
+        std::vector<Fragment> frontFragments;
+        std::vector<Fragment> backFragments;
 
-        for (uint32_t faceId : faceIds) {
-            const BuildFace& face = facePool[faceId];
-            switch (ClassifyFaceAgainstPlane(face, plane)) {
+        for (Fragment& fragment : fragments) {
+            switch (ClassifyPointsAgainstPlane(fragment.verts, plane)) {
                 case FACE_COPLANAR:
-                    nodeFaces.push_back(faceId);
+                    if (std::find(nodeFaces.begin(), nodeFaces.end(), fragment.face) == nodeFaces.end()) {
+                        nodeFaces.push_back(fragment.face);
+                    }
+                    coplanar.push_back(std::move(fragment));
                     break;
                 case FACE_FRONT:
-                    frontFaces.push_back(faceId);
+                    frontFragments.push_back(std::move(fragment));
                     break;
                 case FACE_BACK:
-                    backFaces.push_back(faceId);
+                    backFragments.push_back(std::move(fragment));
                     break;
-                case FACE_SPANNING:
-                    // The map parser owns CSG and polygon clipping. The BSP
-                    // tree is only a spatial index, so spanning polygons stay
-                    // intact and are referenced from this node.
-                    nodeFaces.push_back(faceId);
+                case FACE_SPANNING: {
+                    Fragment front{ {}, fragment.face };
+                    Fragment back{ {}, fragment.face };
+                    SplitPoints(fragment.verts, plane, &front.verts, &back.verts);
+                    if (front.verts.size() >= 3) frontFragments.push_back(std::move(front));
+                    if (back.verts.size() >= 3) backFragments.push_back(std::move(back));
                     break;
+                }
             }
         }
+        fragments.clear();
+        fragments.shrink_to_fit();
 
-        if (frontFaces.empty() || backFaces.empty()) {
-            return EncodeLeafIndex(BuildLeaf(faceIds));
-        }
-
-        const BuildBounds bounds = ComputeFaceBounds(facePool, faceIds);
         BSPNode node{};
         node.planeIndex = splitPlaneIndex;
         node.minX = bounds.min.x;
@@ -267,11 +347,78 @@ private:
         out.nodes.push_back(node);
         const uint32_t nodeIndex = (uint32_t)out.nodes.size() - 1;
 
-        out.nodes[nodeIndex].frontChild = BuildNode(frontFaces, depth + 1);
-        out.nodes[nodeIndex].backChild = BuildNode(backFaces, depth + 1);
+        const int32_t frontChild = BuildNode(std::move(frontFragments), SplitCellBounds(bounds, plane, true),
+                                             BSP_CONTENTS_EMPTY, depth + 1);
+        const int32_t backChild = BuildNode(std::move(backFragments), SplitCellBounds(bounds, plane, false),
+                                            BSP_CONTENTS_SOLID, depth + 1);
+        out.nodes[nodeIndex].frontChild = frontChild;
+        out.nodes[nodeIndex].backChild = backChild;
+
+        // Each consumed fragment borders the side its face looks into.
+        for (Fragment& fragment : coplanar) {
+            const bool facesFront = Vector3DotProduct(facePool[fragment.face].poly.normal, planeNormal) > 0.0f;
+            nodeFragments.push_back({ facesFront ? frontChild : backChild, std::move(fragment) });
+        }
         return (int32_t)nodeIndex;
     }
 
+    // Sends a polygon down from `child` into every leaf it touches; coplanar
+    // pieces go to the side `normal` faces.
+    void FilterIntoLeaves(int32_t child, const std::vector<Vector3>& verts, const Vector3& normal, uint32_t face) {
+        while (child >= 0) {
+            const BSPNode& node = out.nodes[(size_t)child];
+            const BSPPlane& plane = out.planes[(size_t)node.planeIndex];
+            switch (ClassifyPointsAgainstPlane(verts, plane)) {
+                case FACE_FRONT:
+                    child = node.frontChild;
+                    continue;
+                case FACE_BACK:
+                    child = node.backChild;
+                    continue;
+                case FACE_COPLANAR: {
+                    const float facing = plane.nx * normal.x + plane.ny * normal.y + plane.nz * normal.z;
+                    child = facing >= 0.0f ? node.frontChild : node.backChild;
+                    continue;
+                }
+                case FACE_SPANNING: {
+                    std::vector<Vector3> front;
+                    std::vector<Vector3> back;
+                    SplitPoints(verts, plane, &front, &back);
+                    const int32_t frontChild = node.frontChild;
+                    const int32_t backChild = node.backChild;
+                    if (front.size() >= 3) FilterIntoLeaves(frontChild, front, normal, face);
+                    if (back.size() >= 3) FilterIntoLeaves(backChild, back, normal, face);
+                    return;
+                }
+            }
+        }
+        std::vector<uint32_t>& faces = leafFaces[(size_t)(-1 - child)];
+        if (faces.empty() || faces.back() != face) {
+            if (std::find(faces.begin(), faces.end(), face) == faces.end()) {
+                faces.push_back(face);
+            }
+        }
+    }
+
+    // Leaves reference the structural faces on their boundary and the detail
+    // faces inside them.
+    void FillLeafFaceRefs() {
+        for (const NodeFragment& nf : nodeFragments) {
+            FilterIntoLeaves(nf.child, nf.fragment.verts, facePool[nf.fragment.face].poly.normal, nf.fragment.face);
+        }
+        nodeFragments.clear();
+        for (size_t i = 0; i < facePool.size(); ++i) {
+            if (!facePool[i].structural) {
+                FilterIntoLeaves(out.tree.rootChild, facePool[i].poly.verts, facePool[i].poly.normal, (uint32_t)i);
+            }
+        }
+        for (size_t i = 0; i < out.leaves.size(); ++i) {
+            out.leaves[i].firstFaceRef = AppendFaceRefs(leafFaces[i]);
+            out.leaves[i].faceRefCount = (uint32_t)leafFaces[i].size();
+        }
+        leafFaces.clear();
+    }
+
     void SerializeFaces() {
         std::vector<int32_t> remap(facePool.size(), -1);
         out.faces.reserve(out.faceRefs.size());
@@ -296,8 +443,9 @@ private:
                 outFace.sourceEntityId = sourcePoly.sourceEntityId;
                 outFace.sourceBrushId = sourcePoly.sourceBrushId;
                 outFace.sourceFaceIndex = sourcePoly.sourceFaceIndex;
-                outFace.flags = 0;
+                outFace.flags = face.structural ? 0u : BSP_FACE_DETAIL;
                 out.faces.push_back(outFace);
+                out.faceSourcePolys.push_back(face.sourcePoly);
                 for (const Vector3& v : sourcePoly.verts) {
                     out.faceVerts.push_back({ v.x, v.y, v.z });
                 }
@@ -310,8 +458,9 @@ private:
 } // namespace
 
 StructuralBSPData BuildStructuralBSP(const std::vector<MapPolygon>& polys,
+                                     int worldEntityId,
                                      const std::function<uint32_t(const std::string&)>& resolveTextureIndex)
 {
     Builder builder(resolveTextureIndex);
-    return builder.Build(polys);
+    return builder.Build(polys, worldEntityId);
 }
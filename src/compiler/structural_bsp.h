@@ -11,11 +11,19 @@ struct StructuralBSPData {
     BSPTreeHeader         tree{};
     std::vector<BSPPlane> planes;
     std::vector<BSPFace>  faces;
+    std::vector<uint32_t> faceSourcePolys;   // per face, its index in the input polygons
     std::vector<BSPVec3>  faceVerts;
     std::vector<BSPNode>  nodes;
     std::vector<BSPLeaf>  leaves;
     std::vector<uint32_t> faceRefs;
+    Vector3               boundsMin{};   // geometry bounds plus a margin; the
+    Vector3               boundsMax{};   // tree's cells all lie inside
 };
 
+// Builds a solid-leaf tree: faces of `worldEntityId` (worldspawn) are
+// structural and split space until every leaf is BSP_CONTENTS_SOLID or
+// BSP_CONTENTS_EMPTY; faces of other entities are detail and only listed by
+// the leaves they touch. Leaves list the structural faces on their boundary.
 StructuralBSPData BuildStructuralBSP(const std::vector<MapPolygon>& polys,
+                                     int worldEntityId,
                                      const std::function<uint32_t(const std::string&)>& resolveTextureIndex);
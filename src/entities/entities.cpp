@@ -1,7 +1,7 @@
 #include "entities.h"
 
+#include "../compiler/map_entity_props.h"
 #include "../compiler/map_geometry.h"
-#include "../compiler/map_parser.h"
 #include "../physx/physics.h"
 
 #include "Jolt/Jolt.h"
@@ -16,6 +16,7 @@
 #include <algorithm>
 #include <cmath>
 #include <cstdio>
+#include <cstring>
 #include <string>
 #include <unordered_map>
 #include <unordered_set>
@@ -102,90 +103,71 @@ static inline JPH::RVec3 ToJoltRVec3(Vector3 v)
     return JPH::RVec3(v.x, v.y, v.z);
 }
 
-static bool ParseVec3Property(const Entity& entity, const char* key, Vector3& out)
+static bool ParseVec3Property(const EntityTable& entities, size_t entityIndex, const char* key, Vector3& out)
 {
-    auto it = entity.properties.find(key);
-    if (it == entity.properties.end()) {
-        return false;
-    }
-
-    float x = 0.0f;
-    float y = 0.0f;
-    float z = 0.0f;
-    if (std::sscanf(it->second.c_str(), "%f %f %f", &x, &y, &z) != 3) {
-        return false;
-    }
-
-    out = { x, y, z };
-    return true;
+    const BSPEntityProperty* property = FindEntityProperty(entities, entityIndex, key);
+    return property != nullptr && EntityPropertyVec3(*property, out);
 }
 
-static bool ParseStringProperty(const Entity& entity, const char* key, std::string& out)
+static bool ParseStringProperty(const EntityTable& entities, size_t entityIndex, const char* key, std::string& out)
 {
-    auto it = entity.properties.find(key);
-    if (it == entity.properties.end()) {
+    const BSPEntityProperty* property = FindEntityProperty(entities, entityIndex, key);
+    if (property == nullptr) {
         return false;
     }
-    out = it->second;
+    out = EntityPropertyText(entities, *property);
     return true;
 }
 
-static int ParseClampedIntProperty(const Entity& entity, const char* key, int defaultValue, int minValue, int maxValue)
+static int ParseClampedIntProperty(const EntityTable& entities, size_t entityIndex, const char* key, int defaultValue, int minValue, int maxValue)
 {
-    auto it = entity.properties.find(key);
-    if (it == entity.properties.end()) {
+    const BSPEntityProperty* property = FindEntityProperty(entities, entityIndex, key);
+    if (property == nullptr) {
         return defaultValue;
     }
 
-    try {
-        const int parsed = (int)std::lround(std::stof(it->second));
-        return std::clamp(parsed, minValue, maxValue);
-    } catch (...) {
-        auto classnameIt = entity.properties.find("classname");
-        const char* classname = classnameIt != entity.properties.end() ? classnameIt->second.c_str() : "?";
+    int parsed = 0;
+    if (!EntityPropertyInt(*property, parsed)) {
         printf("[entities] %s has invalid %s='%s', using default %d\n",
-               classname,
+               EntityClassname(entities, entityIndex),
                key,
-               it->second.c_str(),
+               EntityPropertyText(entities, *property),
                defaultValue);
         return defaultValue;
     }
+    return std::clamp(parsed, minValue, maxValue);
 }
 
-static float ParseFloatProperty(const Entity& entity, const char* key, float defaultValue, float minValue)
+static float ParseFloatProperty(const EntityTable& entities, size_t entityIndex, const char* key, float defaultValue, float minValue)
 {
-    auto it = entity.properties.find(key);
-    if (it == entity.properties.end()) {
+    const BSPEntityProperty* property = FindEntityProperty(entities, entityIndex, key);
+    if (property == nullptr) {
         return defaultValue;
     }
 
-    try {
-        return std::max(minValue, std::stof(it->second));
-    } catch (...) {
-        auto classnameIt = entity.properties.find("classname");
-        const char* classname = classnameIt != entity.properties.end() ? classnameIt->second.c_str() : "?";
+    float parsed = 0.0f;
+    if (!EntityPropertyFloat(*property, parsed)) {
         printf("[entities] %s has invalid %s='%s', using default %.2f\n",
-               classname,
+               EntityClassname(entities, entityIndex),
                key,
-               it->second.c_str(),
+               EntityPropertyText(entities, *property),
                defaultValue);
         return defaultValue;
     }
+    return std::max(minValue, parsed);
 }
 
-static Vector3 ParseBoostDirection(const Entity& entity)
+static Vector3 ParseBoostDirection(const EntityTable& entities, size_t entityIndex)
 {
     Vector3 directionTB = kDefaultDirectionTB;
     Vector3 parsedTB{};
-    if (ParseVec3Property(entity, "direction", parsedTB)) {
+    if (ParseVec3Property(entities, entityIndex, "direction", parsedTB)) {
         directionTB = parsedTB;
     }
 
     Vector3 directionWorld = ConvertTBPointEntityToWorld(directionTB);
     if (Vector3LengthSq(directionWorld) <= 1.0e-6f) {
-        auto classnameIt = entity.properties.find("classname");
-        const char* classname = classnameIt != entity.properties.end() ? classnameIt->second.c_str() : "?";
-        printf("[entities] %s has zero direction, using default 0 0 1\n", classname);
+        printf("[entities] %s has zero direction, using default 0 0 1\n", EntityClassname(entities, entityIndex));
         directionWorld = ConvertTBPointEntityToWorld(kDefaultDirectionTB);
     }
 
@@ -223,24 +205,23 @@ void Reset()
     sGameplayTime = 0.0;
 }
 
-void RegisterPointEntities(const std::vector<Entity>& entities)
+void RegisterPointEntities(const EntityTable& entities)
 {
-    for (size_t entityIndex = 0; entityIndex < entities.size(); ++entityIndex) {
-        const Entity& entity = entities[entityIndex];
-
-        auto classnameIt = entity.properties.find("classname");
-        if (classnameIt == entity.properties.end() || classnameIt->second != "check_point") {
+    const uint32_t classnameKey = FindEntityKey(entities, "classname");
+    for (size_t entityIndex = 0; entityIndex < entities.entities.size(); ++entityIndex) {
+        const BSPEntityProperty* classname = FindEntityProperty(entities, entityIndex, classnameKey);
+        if (classname == nullptr || strcmp(EntityPropertyText(entities, *classname), "check_point") != 0) {
             continue;
         }
 
         std::string targetname;
-        if (!ParseStringProperty(entity, "targetname", targetname) || targetname.empty()) {
+        if (!ParseStringProperty(entities, entityIndex, "targetname", targetname) || targetname.empty()) {
             printf("[entities] check_point entity=%zu is missing targetname and cannot be targeted\n", entityIndex);
             continue;
         }
 
         Vector3 originTB{};
-        if (!ParseVec3Property(entity, "origin", originTB)) {
+        if (!ParseVec3Property(entities, entityIndex, "origin", originTB)) {
             printf("[entities] check_point '%s' is missing origin\n", targetname.c_str());
             continue;
         }
@@ -249,7 +230,7 @@ void RegisterPointEntities(const std::vector<Entity>& entities)
         checkPoint.entityIndex = (int)entityIndex;
         checkPoint.targetname = targetname;
         checkPoint.position = ConvertTBPointEntityToWorld(originTB);
-        ParsePointEntityFacing(entity, checkPoint.yaw, checkPoint.pitch);
+        ParsePointEntityFacing(entities, entityIndex, checkPoint.yaw, checkPoint.pitch);
 
         sCheckPointsByTargetname[targetname] = sCheckPoints.size();
         sCheckPoints.push_back(checkPoint);
@@ -265,22 +246,22 @@ void RegisterPointEntities(const std::vector<Entity>& entities)
     }
 }
 
-void RegisterBrushEntity(const Entity& entity, int entityIndex, JPH::BodyID bodyID)
+void RegisterBrushEntity(const EntityTable& entities, int entityIndex, JPH::BodyID bodyID)
 {
-    auto classnameIt = entity.properties.find("classname");
-    if (classnameIt == entity.properties.end()) {
+    const BSPEntityProperty* classnameProperty = FindEntityProperty(entities, (size_t)entityIndex, "classname");
+    if (classnameProperty == nullptr) {
         return;
     }
 
-    const std::string& classname = classnameIt->second;
+    const char* classname = EntityPropertyText(entities, *classnameProperty);
 
-    if (classname == "func_boost") {
+    if (strcmp(classname, "func_boost") == 0) {
         BoostVolume boostVolume;
         boostVolume.entityIndex = entityIndex;
         boostVolume.bodyID = bodyID;
-        boostVolume.direction = ParseBoostDirection(entity);
-        boostVolume.boostAmount = (float)ParseClampedIntProperty(entity, "boost", kDefaultBoostAmount, kBoostAmountMin, kBoostAmountMax);
-        boostVolume.acceleration = (float)ParseClampedIntProperty(entity, "acceleration", kDefaultAcceleration, kAccelerationMin, kAccelerationMax);
+        boostVolume.direction = ParseBoostDirection(entities, (size_t)entityIndex);
+        boostVolume.boostAmount = (float)ParseClampedIntProperty(entities, (size_t)entityIndex, "boost", kDefaultBoostAmount, kBoostAmountMin, kBoostAmountMax);
+        boostVolume.acceleration = (float)ParseClampedIntProperty(entities, (size_t)entityIndex, "acceleration", kDefaultAcceleration, kAccelerationMin, kAccelerationMax);
 
         sBoostVolumesByBody[bodyID] = sBoostVolumes.size();
         sBoostVolumes.push_back(boostVolume);
@@ -296,30 +277,31 @@ void RegisterBrushEntity(const Entity& entity, int entityIndex, JPH::BodyID body
         return;
     }
 
-    if (classname == "trigger_once" || classname == "trigger_multiple") {
+    const bool triggerOnce = strcmp(classname, "trigger_once") == 0;
+    if (triggerOnce || strcmp(classname, "trigger_multiple") == 0) {
         std::string target;
-        if (!ParseStringProperty(entity, "target", target) || target.empty()) {
+        if (!ParseStringProperty(entities, (size_t)entityIndex, "target", target) || target.empty()) {
             printf("[entities] %s entity=%d is missing target and will not teleport the player\n",
-                   classname.c_str(),
+                   classname,
                    entityIndex);
             return;
         }
 
-        const int spawnflags = ParseClampedIntProperty(entity, "spawnflags", 0, 0, 0x7fffffff);
+        const int spawnflags = ParseClampedIntProperty(entities, (size_t)entityIndex, "spawnflags", 0, 0, 0x7fffffff);
 
         TeleportTrigger trigger;
         trigger.entityIndex = entityIndex;
         trigger.bodyID = bodyID;
         trigger.target = target;
-        trigger.triggerOnce = classname == "trigger_once";
+        trigger.triggerOnce = triggerOnce;
         trigger.enabled = (spawnflags & 1) == 0;
-        trigger.wait = trigger.triggerOnce ? 0.0f : ParseFloatProperty(entity, "wait", 1.0f, 0.0f);
+        trigger.wait = trigger.triggerOnce ? 0.0f : ParseFloatProperty(entities, (size_t)entityIndex, "wait", 1.0f, 0.0f);
 
         sTeleportTriggersByBody[bodyID] = sTeleportTriggers.size();
         sTeleportTriggers.push_back(trigger);
 
         printf("[entities] registered %s entity=%d body=%u target='%s' enabled=%d wait=%.2f\n",
-               classname.c_str(),
+               classname,
                entityIndex,
                bodyID.GetIndexAndSequenceNumber(),
                target.c_str(),
@@ -1,7 +1,7 @@
 #pragma once
 
 #include "../math/wmath.h"
-#include "../utils/map_types.h"
+#include "../utils/entity_table.h"
 #include "Jolt/Jolt.h"
 #include "Jolt/Physics/Body/BodyID.h"
 
@@ -26,9 +26,9 @@ struct TriggerTeleportResult {
 
 void Reset();
 
-void RegisterPointEntities(const std::vector<Entity>& entities);
+void RegisterPointEntities(const EntityTable& entities);
 
-void RegisterBrushEntity(const Entity& entity, int entityIndex, JPH::BodyID bodyID);
+void RegisterBrushEntity(const EntityTable& entities, int entityIndex, JPH::BodyID bodyID);
 
 PlayerEffectResult ApplyPlayerEffects(JPH::PhysicsSystem* physicsSystem,
                                       const JPH::Shape* playerShape,
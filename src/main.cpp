@@ -15,6 +15,7 @@
 #include "sokol_log.h"
 #include "sokol_debugtext.h"
 
+#include <atomic>
 #include <cstdio>
 #include <cstdlib>
 #include <chrono>
@@ -28,6 +29,7 @@
 #include "render/renderer.h"
 #include "render/debug_draw.h"
 #include "utils/bsp_loader.h"
+#include "utils/parallel_for.h"
 #include "utils/parameters.h"
 #include "physx/collision_data.h"
 #include "physx/physics.h"
@@ -37,6 +39,85 @@
 #include "Jolt/Jolt.h"
 #include "Jolt/Physics/Body/BodyInterface.h"
 
+// ---------------------------------------------------------------------------
+//  Map loading
+// ---------------------------------------------------------------------------
+// The menu keeps drawing while a map loads. A loader thread reads the .bsp,
+// then builds the physics hulls and bodies alongside the renderer's
+// preparation (texture and lightmap decodes, vis, cull tree). The frame
+// thread then makes the GPU resources MAP_LOAD_BUDGET_MS at a time and
+// finishes with the player.
+//
+// Switching maps tears down only the map: its model, its bodies and the
+// textures the next one does not share. Jolt, the texture manager and the
+// renderer stay up, and the menu reads ahead the .bsp under the pointer.
+enum class MapLoadStage : int {
+    Idle,
+    Reading,     // loader thread: LoadBSP
+    Preparing,   // loader thread: physics and renderer preparation
+    Uploading,   // frame thread: Renderer_StepBSPUpload
+    Failed,
+};
+
+struct MapLoad {
+    MapEntry                  map;
+    std::thread               worker;
+    std::atomic<MapLoadStage> stage{ MapLoadStage::Idle };
+    MapUpload                 upload;
+    std::chrono::steady_clock::time_point started;
+};
+
+// A .bsp read on its own thread ahead of the load that wants it. The loader
+// takes it over when it is the picked map; otherwise it reads its own.
+struct MapRead {
+    std::string       bspPath;
+    std::thread       worker;
+    std::atomic<bool> done{ false };
+    bool              loaded = false;   // valid once done
+    BSPData           bsp;
+};
+
+static void ReadMap(MapRead* read) {
+    read->loaded = LoadBSP(read->bspPath.c_str(), read->bsp);
+    if (read->loaded) {
+        // LoadBSP only touches the lumps it parses; fault in the rest of the
+        // mapping too so the loader never waits on the disk.
+        static volatile unsigned char sink;
+        unsigned char sum = 0;
+        for (size_t i = 0; i < read->bsp.file.size; i += 4096) {
+            sum ^= read->bsp.file.data[i];
+        }
+        sink = sum;
+    }
+    read->done = true;
+}
+
+static void MapLoadWorker(MapLoad* load, MapRead* read, TextureManager* texMgr, JPH::BodyInterface* bodyInterface) {
+    if (read->worker.joinable()) {
+        read->worker.join();
+    }
+    if (read->bspPath != load->map.bspPath || !read->loaded) {
+        read->bspPath = load->map.bspPath;
+        ReadMap(read);
+    }
+    if (!read->loaded) {
+        load->stage = MapLoadStage::Failed;
+        return;
+    }
+    load->stage = MapLoadStage::Preparing;
+    const BSPData& bsp = read->bsp;
+    // The two halves share nothing but the read-only .bsp.
+    ParallelFor(2, [&](size_t half) {
+        if (half == 0) {
+            const std::vector<JPH::RefConst<JPH::Shape>> shapes = BuildMapHullShapes(bsp.hulls, bsp.hullPoints);
+            AddMapBodies(bsp.hulls, shapes, bsp.entities, bodyInterface);
+        } else {
+            Renderer_PrepareBSPUpload(load->upload, bsp, *texMgr);
+        }
+    });
+    load->stage = MapLoadStage::Uploading;
+}
+
 // ---------------------------------------------------------------------------
 //  State
 // ---------------------------------------------------------------------------
@@ -55,7 +136,11 @@ static struct {
 
     std::vector<MapEntry> availableMaps;
     std::string           menuStatus;
-    std::string           currentMapName;
+    MapEntry              currentMap;
+    MapLoad               load;
+    MapRead               read;
+
+    FILE*                 cameraPath = nullptr;   // WARPED_RECORD_CAMERA, for occlusion_bench -path
 } G;
 
 static const char* GfxBackendName(sg_backend backend) {
@@ -73,17 +158,82 @@ static const char* GfxBackendName(sg_backend backend) {
     }
 }
 
-static bool LoadSelectedMap(const MapEntry& map) {
-    if (G.gameplayLoaded) {
-        G.menuStatus = "Map switching from the menu is not implemented yet.";
-        return false;
+// Appends the camera to the file named by WARPED_RECORD_CAMERA, one
+// "position target" line per frame, so occlusion_bench can replay the path.
+static void RecordCameraPath(const Camera& camera) {
+    static bool opened = false;
+    if (!opened) {
+        opened = true;
+        const char* path = getenv("WARPED_RECORD_CAMERA");
+        if (path && path[0] != '\0') {
+            G.cameraPath = fopen(path, "w");
+            printf("[main] %s camera path to %s\n", G.cameraPath ? "Recording" : "Cannot record", path);
+        }
+    }
+    if (G.cameraPath) {
+        fprintf(G.cameraPath, "%.3f %.3f %.3f %.3f %.3f %.3f\n",
+                camera.position.x, camera.position.y, camera.position.z,
+                camera.target.x, camera.target.y, camera.target.z);
     }
+}
+
+// Joins a read-ahead and drops its .bsp.
+static void DropMapRead(MapRead& read) {
+    if (read.worker.joinable()) {
+        read.worker.join();
+    }
+    UnloadBSP(read.bsp);
+    read.bspPath.clear();
+    read.loaded = false;
+    read.done = false;
+}
+
+// Reads `map` ahead while the menu has no load running. One read at a time:
+// while the last one is still going, the pointer has to stay put.
+static void PrefetchMap(const MapEntry& map) {
+    MapRead& read = G.read;
+    if (G.load.stage != MapLoadStage::Idle) return;
+    if (G.gameplayLoaded && map.bspPath == G.currentMap.bspPath) return;
+    if (map.bspPath == read.bspPath) return;
+    if (read.worker.joinable() && !read.done) return;
+
+    DropMapRead(read);
+    read.bspPath = map.bspPath;
+    read.worker = std::thread(ReadMap, &read);
+}
+
+// Escape while playing: back to the menu with the map kept as it is.
+static void ReturnToMenu(void) {
+    G.mode = AppMode::MainMenu;
+    Input_LockMouse(false);
+    G.menuStatus = "Playing " + G.currentMap.displayName + ": pick it to resume or another map to switch.";
+    Input_EndFrame();
+}
+
+// Drops the map being played ahead of the next one. Textures stay with the
+// manager until the next upload knows which of them it shares.
+static void UnloadCurrentMap(void) {
+    Renderer_DestroyMap(G.mapModel);
+    G.mapModel = MapModel{};
+    RemoveMapBodies(G.bodyInterface);
+    G.gameplayLoaded = false;
+}
 
-    BSPData bsp;
-    if (!LoadBSP(map.bspPath.c_str(), bsp)) {
-        G.menuStatus = "Failed to load " + map.name + ".";
+// Starts loading `map` in the background; UpdateMapLoad carries it on.
+// Picking the map already being played resumes it.
+static bool LoadSelectedMap(const MapEntry& map) {
+    if (G.load.stage != MapLoadStage::Idle) {
         return false;
     }
+    if (G.gameplayLoaded && map.bspPath == G.currentMap.bspPath) {
+        G.menuStatus.clear();
+        G.mode = AppMode::Playing;
+        Input_LockMouse(true);
+        return true;
+    }
+    if (G.gameplayLoaded) {
+        UnloadCurrentMap();
+    }
 
     if (!G.physicsReady) {
         InitPhysicsSystem();
@@ -91,27 +241,90 @@ static bool LoadSelectedMap(const MapEntry& map) {
         G.physicsReady = true;
     }
 
-    std::vector<PlayerStart> starts = GetPlayerStarts(bsp);
+    MapLoad& load = G.load;
+    load.map = map;
+    load.started = std::chrono::steady_clock::now();
+    load.stage = MapLoadStage::Reading;
+    Renderer_BeginBSPUpload(load.upload, G.texMgr);
+    load.worker = std::thread(MapLoadWorker, &load, &G.read, &G.texMgr, G.bodyInterface);
+    printf("[menu] loading map '%s'\n", map.bspPath.c_str());
+    return true;
+}
+
+// Drives the load started by LoadSelectedMap from the menu's frame: shows
+// its progress, uploads within the frame's budget once the loader thread is
+// done, and enters the map when everything is in place. Returns the
+// progress in [0, 1], or -1 with no load running.
+static float UpdateMapLoad(void) {
+    MapLoad& load = G.load;
+    const MapLoadStage stage = load.stage;
+    switch (stage) {
+        case MapLoadStage::Idle:
+            return -1.0f;
+        case MapLoadStage::Reading:
+            G.menuStatus = "Loading " + load.map.displayName + ": reading map...";
+            return 0.05f;
+        case MapLoadStage::Preparing:
+            G.menuStatus = "Loading " + load.map.displayName + ": building collision and decoding textures...";
+            return 0.15f;
+        case MapLoadStage::Failed:
+            load.worker.join();
+            load.stage = MapLoadStage::Idle;
+            DropMapRead(G.read);
+            G.menuStatus = "Failed to load " + load.map.name + ".";
+            return -1.0f;
+        case MapLoadStage::Uploading:
+            break;
+    }
+
+    if (load.worker.joinable()) {
+        load.worker.join();
+    }
+    G.menuStatus = "Loading " + load.map.displayName + ": uploading textures...";
+    if (!Renderer_StepBSPUpload(load.upload, G.texMgr, MAP_LOAD_BUDGET_MS)) {
+        return 0.3f + 0.7f * Renderer_BSPUploadProgress(load.upload);
+    }
+
+    std::vector<PlayerStart> starts = GetPlayerStarts(G.read.bsp);
     const PlayerStart start = starts.empty() ? PlayerStart{ (Vector3){0, 0, 0}, 0.0f, 0.0f } : starts[0];
     Vector3 spawn = start.position;
 
     InitPlayer(&G.player, spawn, (Vector3){0, 0, 0}, (Vector3){0, 1, 0}, 90.0f);
-    G.mapModel = Renderer_UploadBSP(bsp, G.texMgr);
+    G.mapModel = std::move(load.upload.model);
+    load.upload = MapUpload{};
 
-    BuildMapPhysics(bsp.hulls, bsp.entities, G.bodyInterface);
     SpawnDebugPhysObj(G.bodyInterface);
     InitJoltCharacter(&G.player, s_physics_system);
     RespawnPlayer(&G.player, s_physics_system, start.position, start.yaw, start.pitch);
+    // Renderer and physics own copies of everything they use from here on.
+    DropMapRead(G.read);
+    load.stage = MapLoadStage::Idle;
 
-    G.currentMapName = map.name;
+    G.currentMap = load.map;
     G.menuStatus.clear();
     G.gameplayLoaded = true;
     G.mode = AppMode::Playing;
     Input_LockMouse(true);
     Input_EndFrame();
 
-    printf("[menu] loaded map '%s'\n", map.bspPath.c_str());
-    return true;
+    const double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - load.started).count();
+    printf("[menu] loaded map '%s' in %.0f ms\n", load.map.bspPath.c_str(), ms);
+    return 1.0f;
+}
+
+// Waits out a load (or a read-ahead) the app is quitting during and drops
+// what it made.
+static void CancelMapLoad(void) {
+    MapLoad& load = G.load;
+    if (load.worker.joinable()) {
+        load.worker.join();
+    }
+    if (load.stage == MapLoadStage::Uploading) {
+        Renderer_DestroyMap(load.upload.model);
+        load.upload = MapUpload{};
+    }
+    DropMapRead(G.read);
+    load.stage = MapLoadStage::Idle;
 }
 
 // ---------------------------------------------------------------------------
@@ -171,6 +384,11 @@ static void init(void) {
     Debug_Init();
     UI_Init(sapp_width(), sapp_height());
 
+    // Read before Renderer_Init, which only makes the array pipelines when
+    // they are wanted.
+    if (getenv("WARPED_TEXTURE_ARRAYS")) {
+        TEXTURE_ARRAYS = true;
+    }
     Renderer_Init();
     InitTextureManager(G.texMgr);
     Input_Init();
@@ -204,6 +422,10 @@ static void frame(void) {
     postTime += frameDt;
     static double accumulator = 0.0;
 
+    if (G.mode == AppMode::Playing && Input_KeyPressed(WKEY_ESCAPE)) {
+        ReturnToMenu();
+    }
+
     if (G.mode == AppMode::MainMenu) {
         if (Input_KeyPressed(WKEY_TAB)) {
             sapp_toggle_fullscreen();
@@ -212,15 +434,21 @@ static void frame(void) {
             sapp_request_quit();
         }
 
+        const float loadProgress = UpdateMapLoad();
+        if (G.mode == AppMode::Playing) {
+            accumulator = 0.0;
+            return;
+        }
+
         UI_NewFrame();
-        int requestedMapIndex = UI_UpdateMenu(G.availableMaps, G.menuStatus);
+        int requestedMapIndex = UI_UpdateMenu(G.availableMaps, G.menuStatus, loadProgress);
 
         if (requestedMapIndex >= 0 && requestedMapIndex < (int)G.availableMaps.size()) {
             LoadSelectedMap(G.availableMaps[requestedMapIndex]);
-            accumulator = 0.0;
-            if (G.mode == AppMode::Playing) {
-                return;
-            }
+        }
+        const int hoveredMapIndex = UI_HoveredMapIndex();
+        if (hoveredMapIndex >= 0 && hoveredMapIndex < (int)G.availableMaps.size()) {
+            PrefetchMap(G.availableMaps[hoveredMapIndex]);
         }
 
         sg_pass pass = {};
@@ -248,7 +476,6 @@ static void frame(void) {
 
     while (accumulator >= simTickInterval) {
         if (Input_KeyPressed(WKEY_TAB))    sapp_toggle_fullscreen();
-        if (Input_KeyPressed(WKEY_ESCAPE)) sapp_request_quit();
 
         UpdatePhysicsSystem(deltaTime, G.bodyInterface);
 
@@ -263,6 +490,7 @@ static void frame(void) {
     }
 
     UpdateCameraTarget(&G.player);
+    RecordCameraPath(G.player.camera);
 
     float aspect = (float)sapp_width() / (float)sapp_height();
     Matrix proj  = MatrixPerspective(G.player.camera.fovy * DEG2RAD, aspect, 0.1f, RENDER_DISTANCE);
@@ -275,6 +503,12 @@ static void frame(void) {
     Matrix normalModel = MatrixMultiply(view, model);
     Frustum frustum = FrustumFromVP(vp);
 
+    const float pixelsPerUnit = (float)sapp_height() * 0.5f / tanf(G.player.camera.fovy * DEG2RAD * 0.5f);
+    const DrawStats lastFrameDraws = Renderer_GetDrawStats();   // reset by Renderer_CullMap
+    Renderer_UpdateMapVisibility(G.mapModel, G.player.camera.position);
+    Renderer_CullMap(G.mapModel, vp, frustum);
+    Renderer_UpdateTextureStreaming(G.texMgr, G.mapModel, G.player.camera.position, pixelsPerUnit);
+
     Debug_NewFrame();
     Debug_SetCamera(proj, view);
 
@@ -295,22 +529,33 @@ static void frame(void) {
     sdtx_pos(0, 0);
     sdtx_printf("FPS %5.1f", (frameDt > 0.0f) ? 1.0f / frameDt : 0.0f);
     sdtx_pos(0, 1);
-    sdtx_printf("MAP %s", G.currentMapName.c_str());
+    sdtx_printf("MAP %s", G.currentMap.name.c_str());
+    sdtx_pos(0, 2);
+    sdtx_printf("TEX %.1f/%d MB", (double)G.texMgr.streamer.stats.residentBytes / (1024.0 * 1024.0), TEXTURE_BUDGET_MB);
+
+    sdtx_pos(0, 3);
+    sdtx_printf("DRAW %u cmds %u binds %u draws", lastFrameDraws.commands, lastFrameDraws.bindings,
+                lastFrameDraws.draws);
 
-    DebugDrawPlayerPos(&G.player, 0, 3);
-    DebugDrawPlayerVel(0, 5);
+    DebugDrawPlayerPos(&G.player, 0, 4);
+    DebugDrawPlayerVel(0, 6);
 
     bool usePost = Renderer_BeginScenePostPass(G.gamePassAction,
                                                sapp_width(),
                                                sapp_height(),
                                                sapp_sample_count());
     if (usePost) {
-        Renderer_DrawMap(G.mapModel, mvp, model, frustum);
+        const bool sceneWritesNormals = Renderer_ScenePostPassWritesNormals();
+        if (sceneWritesNormals) {
+            Renderer_DrawMapWithNormals(G.mapModel, mvp, normalModel);
+        } else {
+            Renderer_DrawMap(G.mapModel, mvp, model);
+        }
         Renderer_EndScenePostPass();
-        if (usePost) {
+        if (!sceneWritesNormals) {
             usePost = Renderer_BeginNormalPostPass(sapp_width(), sapp_height());
             if (usePost) {
-                Renderer_DrawMapNormals(G.mapModel, mvp, normalModel, frustum);
+                Renderer_DrawMapNormals(G.mapModel, mvp, normalModel);
                 Renderer_EndNormalPostPass();
             }
         }
@@ -335,7 +580,7 @@ static void frame(void) {
         pass.action = G.gamePassAction;
         pass.swapchain = sglue_swapchain();
         sg_begin_pass(&pass);
-            Renderer_DrawMap(G.mapModel, mvp, model, frustum);
+            Renderer_DrawMap(G.mapModel, mvp, model);
             Debug_Flush();
             sdtx_draw();
         sg_end_pass();
@@ -355,6 +600,11 @@ static void event(const sapp_event* ev) {
 //  CLEANUP
 // ---------------------------------------------------------------------------
 static void cleanup(void) {
+    if (G.cameraPath) {
+        fclose(G.cameraPath);
+        G.cameraPath = nullptr;
+    }
+    CancelMapLoad();
     if (G.gameplayLoaded) {
         Renderer_DestroyMap(G.mapModel);
     }
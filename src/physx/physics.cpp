@@ -11,6 +11,7 @@
 #include "Jolt/Physics/Collision/ObjectLayer.h"
 #include "collision_data.h"
 #include "../entities/entities.h"
+#include "../utils/parallel_for.h"
 
 #include "Jolt/Jolt.h"
 
@@ -239,6 +240,9 @@ static MyContactListener                    s_contact_listener;
 
 JPH::BodyID                          debugSphereID;
 
+// Every body a map added, so the next map can take them out again.
+static std::vector<JPH::BodyID>             s_map_bodies;
+
 //--------------------------------------//
 // Implementation
 //--------------------------------------//
@@ -355,55 +359,65 @@ void SpawnDebugPhysObj(JPH::BodyInterface *bodyInterface) {
         JPH::EMotionType::Dynamic,
         Layers::MOVING);
     debugSphereID = bodyInterface->CreateAndAddBody(sphere_settings, JPH::EActivation::Activate);
+    if (!debugSphereID.IsInvalid()) {
+        s_map_bodies.push_back(debugSphereID);
+    }
  
     printf("\n --TEST OBJECT SPAWNED-- \n");
 }
 
-void BuildMapPhysics(const std::vector<MeshCollisionData> &meshCollisionData,
-                     const std::vector<Entity> &entities,
-                     JPH::BodyInterface *bodyInterface)
+std::vector<JPH::RefConst<JPH::Shape>> BuildMapHullShapes(std::span<const BSPHull> hulls,
+                                                          std::span<const BSPVec3> hullPoints)
 {
-    int count = 0;
-    GameplayEntities::Reset();
-    GameplayEntities::RegisterPointEntities(entities);
-
-    for (auto &mcd : meshCollisionData) {
+    std::vector<JPH::RefConst<JPH::Shape>> shapes(hulls.size());
+    ParallelFor(hulls.size(), [&](size_t h) {
+        const BSPHull &hull = hulls[h];
         // If NO_COLLIDE or something similar, we skip
-        if (mcd.collisionType == CollisionType::NO_COLLIDE) {
-            continue; 
+        if ((CollisionType)hull.collisionType == CollisionType::NO_COLLIDE) {
+            return;
         }
 
-        // Convert Raylib vectors to Jolt float3
-        std::vector<JPH::Float3> jolt_points;
-        jolt_points.reserve(mcd.vertices.size());
-        for (auto &v : mcd.vertices) {
-            jolt_points.push_back(JPH::Float3(v.x, v.y, v.z));
-        }
-
-        // Build a convex hull from these points
+        // Build a convex hull straight from the hull's points
         JPH::ConvexHullShapeSettings hull_settings;
-        hull_settings.mPoints.resize(jolt_points.size());
-        for (size_t i = 0; i < jolt_points.size(); ++i) {
-            hull_settings.mPoints[i] = JPH::Vec3(
-                jolt_points[i].x,
-                jolt_points[i].y,
-                jolt_points[i].z
-            );
+        hull_settings.mPoints.resize(hull.pointCount);
+        for (uint32_t i = 0; i < hull.pointCount; ++i) {
+            const BSPVec3 &p = hullPoints[hull.firstPoint + i];
+            hull_settings.mPoints[i] = JPH::Vec3(p.x, p.y, p.z);
         }
 
         auto shape_result = hull_settings.Create();
         if (shape_result.HasError()) {
             printf("Error building hull shape: %s\n", shape_result.GetError().c_str());
+            return;
+        }
+        shapes[h] = shape_result.Get();
+    });
+    return shapes;
+}
+
+void AddMapBodies(std::span<const BSPHull> hulls,
+                  std::span<const JPH::RefConst<JPH::Shape>> shapes,
+                  const EntityTable &entities,
+                  JPH::BodyInterface *bodyInterface)
+{
+    int count = 0;
+    GameplayEntities::Reset();
+    GameplayEntities::RegisterPointEntities(entities);
+
+    for (size_t h = 0; h < hulls.size() && h < shapes.size(); ++h) {
+        const BSPHull &hull = hulls[h];
+        const CollisionType collisionType = (CollisionType)hull.collisionType;
+        if (!shapes[h]) {
             continue;
         }
 
-        JPH::RefConst<JPH::Shape> hull_shape = shape_result.Get();
+        const JPH::RefConst<JPH::Shape> &hull_shape = shapes[h];
 
         // Decide motion type and layer from collisionType
         JPH::EMotionType motionType     = JPH::EMotionType::Static;
         JPH::ObjectLayer objectLayer    = Layers::NON_MOVING; // default
 
-        switch (mcd.collisionType) {
+        switch (collisionType) {
             case CollisionType::STATIC: {
                 motionType = JPH::EMotionType::Static;
                 objectLayer = Layers::NON_MOVING;
@@ -436,15 +450,16 @@ void BuildMapPhysics(const std::vector<MeshCollisionData> &meshCollisionData,
             objectLayer
         );
 
-        if (mcd.collisionType == CollisionType::TRIGGER) {
+        if (collisionType == CollisionType::TRIGGER) {
             bcs.mIsSensor = true;
             printf("\n SETTING IS SENSOR TO TRUE \n");
         }
 
         if (JPH::Body *body = bodyInterface->CreateBody(bcs)) {
             bodyInterface->AddBody(body->GetID(), JPH::EActivation::Activate);
-            if (mcd.entityIndex >= 0 && (size_t)mcd.entityIndex < entities.size()) {
-                GameplayEntities::RegisterBrushEntity(entities[(size_t)mcd.entityIndex], mcd.entityIndex, body->GetID());
+            s_map_bodies.push_back(body->GetID());
+            if (hull.entityIndex >= 0 && (size_t)hull.entityIndex < entities.entities.size()) {
+                GameplayEntities::RegisterBrushEntity(entities, hull.entityIndex, body->GetID());
             }
             ++count;
         }
@@ -455,3 +470,24 @@ void BuildMapPhysics(const std::vector<MeshCollisionData> &meshCollisionData,
 
     printf("\n\n %d MAP COLLISIONS SUCCESSFULLY CREATED \n\n", count);
 }
+
+void RemoveMapBodies(JPH::BodyInterface *bodyInterface)
+{
+    if (!s_map_bodies.empty()) {
+        bodyInterface->RemoveBodies(s_map_bodies.data(), (int)s_map_bodies.size());
+        bodyInterface->DestroyBodies(s_map_bodies.data(), (int)s_map_bodies.size());
+    }
+    printf("[RemoveMapBodies] Removed %zu bodies.\n", s_map_bodies.size());
+    s_map_bodies.clear();
+    debugSphereID = JPH::BodyID();
+    GameplayEntities::Reset();
+}
+
+void BuildMapPhysics(std::span<const BSPHull> hulls,
+                     std::span<const BSPVec3> hullPoints,
+                     const EntityTable &entities,
+                     JPH::BodyInterface *bodyInterface)
+{
+    const std::vector<JPH::RefConst<JPH::Shape>> shapes = BuildMapHullShapes(hulls, hullPoints);
+    AddMapBodies(hulls, shapes, entities, bodyInterface);
+}
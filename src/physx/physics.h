@@ -2,6 +2,8 @@
 
 #include "Jolt/Core/Core.h"
 #include "collision_data.h"
+#include "../utils/bsp_format.h"
+#include "../utils/entity_table.h"
 #include "Jolt/Jolt.h"
 #include "Jolt/Physics/PhysicsSystem.h"
 #include "Jolt/Physics/Collision/ObjectLayer.h"
@@ -12,6 +14,7 @@
 #include "Jolt/Geometry/ConvexSupport.h"
 #include "Jolt/Geometry/GJKClosestPoint.h"
 #include "Jolt/Physics/Body/BodyInterface.h"
+#include <span>
 #include <vector>
 
 extern JPH::PhysicsSystem     *s_physics_system;
@@ -49,8 +52,30 @@ void UpdatePhysicsSystem(float delta_time, JPH::BodyInterface *bodyInterface);
 
 void SpawnDebugPhysObj(JPH::BodyInterface *bodyInterface);
 
-void BuildMapPhysics(const std::vector<MeshCollisionData> &meshCollisionData,
-                     const std::vector<Entity> &entities,
+// `hulls` are ranges of `hullPoints`, as loaded from the BSP.
+// BuildMapHullShapes then AddMapBodies.
+void BuildMapPhysics(std::span<const BSPHull> hulls,
+                     std::span<const BSPVec3> hullPoints,
+                     const EntityTable &entities,
                      JPH::BodyInterface *bodyInterface);
 
+// A convex shape per hull, built on every worker; null where the hull does
+// not collide or its points make no hull. Touches nothing but the Jolt
+// allocator, so it can run on a loader thread.
+std::vector<JPH::RefConst<JPH::Shape>> BuildMapHullShapes(std::span<const BSPHull> hulls,
+                                                          std::span<const BSPVec3> hullPoints);
+
+// Registers the map's gameplay entities and adds a body per shape. The
+// body interface locks, so this can run on a loader thread as long as the
+// physics system is not being stepped meanwhile.
+void AddMapBodies(std::span<const BSPHull> hulls,
+                  std::span<const JPH::RefConst<JPH::Shape>> shapes,
+                  const EntityTable &entities,
+                  JPH::BodyInterface *bodyInterface);
+
+// Removes and destroys every body AddMapBodies and SpawnDebugPhysObj added
+// and forgets the map's gameplay entities. The physics system, its job pool
+// and allocators stay for the next map.
+void RemoveMapBodies(JPH::BodyInterface *bodyInterface);
+
 void SpawnMinimalTest(JPH::BodyInterface &bodyInterface);
@@ -0,0 +1,54 @@
+#include "draw_list.h"
+
+#include <utility>
+
+void DrawList_Sort(std::vector<DrawCommand>& commands, std::vector<DrawCommand>& scratch)
+{
+    const size_t count = commands.size();
+    if (count < 2) {
+        return;
+    }
+    // One pass over the keys builds every byte's histogram.
+    uint32_t histograms[8][256] = {};
+    for (const DrawCommand& c : commands) {
+        for (int pass = 0; pass < 8; ++pass) {
+            ++histograms[pass][(c.key >> (pass * 8)) & 0xFF];
+        }
+    }
+
+    scratch.resize(count);
+    DrawCommand* src = commands.data();
+    DrawCommand* dst = scratch.data();
+    for (int pass = 0; pass < 8; ++pass) {
+        uint32_t* histogram = histograms[pass];
+        const int shift = pass * 8;
+        // A byte every key shares leaves the order as it is.
+        if (histogram[(src[0].key >> shift) & 0xFF] == count) {
+            continue;
+        }
+        uint32_t offset = 0;
+        for (int b = 0; b < 256; ++b) {
+            const uint32_t n = histogram[b];
+            histogram[b] = offset;
+            offset += n;
+        }
+        for (size_t i = 0; i < count; ++i) {
+            dst[histogram[(src[i].key >> shift) & 0xFF]++] = src[i];
+        }
+        std::swap(src, dst);
+    }
+    if (src != commands.data()) {
+        commands.swap(scratch);
+    }
+}
+
+uint32_t DrawList_CountDraws(const std::vector<DrawCommand>& commands)
+{
+    uint32_t draws = 0;
+    for (size_t i = 0; i < commands.size(); ++i) {
+        const bool joins = i > 0 && DrawKey_State(commands[i].key) == DrawKey_State(commands[i - 1].key) &&
+                           commands[i - 1].first_index + commands[i - 1].index_count == commands[i].first_index;
+        draws += joins ? 0 : 1;
+    }
+    return draws;
+}
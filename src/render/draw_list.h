@@ -0,0 +1,77 @@
+// draw_list.h  —  sortable draw commands for the map passes.
+//
+// Every visible run of a submesh becomes one command with a 64-bit key:
+// pipeline, lightmap binding and texture binding from the top down, then
+// view depth, so sorting the keys groups draws by state and orders each
+// group front to back, or by index buffer offset where merging neighbouring
+// ranges into one draw matters more than depth order. Keys are sorted with
+// an LSD radix sort that skips the bytes every key shares, which in practice
+// leaves the depth bytes and a few binding bytes. Draw loops compare
+// DrawKey_State of neighbouring commands and only rebind when it changes.
+//
+// Nothing here touches sokol, so lists build and sort headless.
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+inline constexpr int DRAW_KEY_PIPELINE_BITS = 4;
+inline constexpr int DRAW_KEY_LIGHTMAP_BITS = 12;
+inline constexpr int DRAW_KEY_TEXTURE_BITS = 16;
+inline constexpr int DRAW_KEY_DEPTH_BITS = 32;   // the bits of a non-negative float
+
+struct DrawCommand {
+    uint64_t key = 0;
+    uint32_t mesh = 0;          // submesh the range belongs to, for its bindings
+    int      first_index = 0;
+    int      index_count = 0;
+};
+
+// Draws and state changes issued by the map passes, for the overlay and
+// benchmarks. Reset by the caller once per frame.
+struct DrawStats {
+    uint32_t commands = 0;   // sorted commands built for the frame
+    uint32_t pipelines = 0;  // sg_apply_pipeline calls
+    uint32_t bindings = 0;   // sg_apply_bindings calls
+    uint32_t uniforms = 0;   // sg_apply_uniforms calls
+    uint32_t draws = 0;      // sg_draw calls
+};
+
+// Packs the fields into a key; each is truncated to its width. `order`
+// fills the depth field as-is, for lists that want some other order than
+// front to back within a group.
+inline uint64_t DrawKeyInOrder(uint32_t pipeline, uint32_t lightmap, uint32_t texture, uint32_t order)
+{
+    constexpr int textureShift = DRAW_KEY_DEPTH_BITS;
+    constexpr int lightmapShift = textureShift + DRAW_KEY_TEXTURE_BITS;
+    constexpr int pipelineShift = lightmapShift + DRAW_KEY_LIGHTMAP_BITS;
+    return ((uint64_t)(pipeline & ((1u << DRAW_KEY_PIPELINE_BITS) - 1u)) << pipelineShift) |
+           ((uint64_t)(lightmap & ((1u << DRAW_KEY_LIGHTMAP_BITS) - 1u)) << lightmapShift) |
+           ((uint64_t)(texture & ((1u << DRAW_KEY_TEXTURE_BITS) - 1u)) << textureShift) |
+           (uint64_t)order;
+}
+
+// DrawKeyInOrder with the view distance `depth` as the order, with anything
+// negative counting as 0.
+inline uint64_t DrawKey(uint32_t pipeline, uint32_t lightmap, uint32_t texture, float depth)
+{
+    uint32_t depthBits = 0;
+    if (depth > 0.0f) {
+        static_assert(sizeof(float) == sizeof(uint32_t));
+        memcpy(&depthBits, &depth, sizeof(depthBits));
+    }
+    return DrawKeyInOrder(pipeline, lightmap, texture, depthBits);
+}
+
+// Everything in the key but depth: commands with equal state share bindings.
+inline uint32_t DrawKey_State(uint64_t key) { return (uint32_t)(key >> DRAW_KEY_DEPTH_BITS); }
+
+// Sorts `commands` by key, stably; `scratch` is resized and reused between
+// calls.
+void DrawList_Sort(std::vector<DrawCommand>& commands, std::vector<DrawCommand>& scratch);
+
+// The sg_draw calls a sorted list costs: neighbouring commands share one
+// when their state matches and their index ranges meet.
+uint32_t DrawList_CountDraws(const std::vector<DrawCommand>& commands);
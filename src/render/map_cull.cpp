@@ -0,0 +1,304 @@
+#include "map_cull.h"
+
+#include <algorithm>
+#include <cstring>
+
+#if defined(__AVX__)
+    #include <immintrin.h>
+    #define MAP_CULL_AVX 1
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+    #include <emmintrin.h>
+    #define MAP_CULL_SSE 1
+#elif defined(__ARM_NEON) || defined(_M_ARM64)
+    #include <arm_neon.h>
+    #define MAP_CULL_NEON 1
+#endif
+
+namespace {
+
+#if defined(MAP_CULL_AVX)
+constexpr size_t kBatch = 8;
+#else
+constexpr size_t kBatch = 4;
+#endif
+// Nodes with this many clusters or fewer test them directly instead of
+// splitting further; a few batches cost less than more levels of boxes
+// (map_cull_bench, synthetic grid and small maps alike).
+constexpr uint32_t kLeafItems = 32;
+constexpr int      kMaxDepth = 256;
+constexpr float    kEmptyBound = 1e30f;
+
+struct Builder {
+    MapCullTree&              tree;
+    std::span<const AABB>     bounds;
+    std::span<const BSPNode>  nodes;
+    std::span<const BSPPlane> planes;
+    std::vector<uint32_t>     order;   // cluster indices, partitioned in place
+};
+
+Vector3 BoxCenter(const AABB& b)
+{
+    return Vector3{ (b.min.x + b.max.x) * 0.5f, (b.min.y + b.max.y) * 0.5f, (b.min.z + b.max.z) * 0.5f };
+}
+
+AABB BoxUnion(const AABB& a, const AABB& b)
+{
+    return AABB{ { std::min(a.min.x, b.min.x), std::min(a.min.y, b.min.y), std::min(a.min.z, b.min.z) },
+                 { std::max(a.max.x, b.max.x), std::max(a.max.y, b.max.y), std::max(a.max.z, b.max.z) } };
+}
+
+int32_t AddLeaf(Builder& b, uint32_t begin, uint32_t end)
+{
+    MapCullNode node;
+    node.bounds = b.bounds[b.order[begin]];
+    for (uint32_t i = begin + 1; i < end; ++i) {
+        node.bounds = BoxUnion(node.bounds, b.bounds[b.order[i]]);
+    }
+    node.firstItem = begin;
+    node.itemCount = end - begin;
+    b.tree.nodes.push_back(node);
+    return (int32_t)b.tree.nodes.size() - 1;
+}
+
+// Builds the cull node for the clusters order[begin, end) below BSP child
+// `bspChild`. Sides that get no clusters are skipped, so a BSP node with
+// only one populated side adds nothing.
+int32_t BuildNode(Builder& b, int32_t bspChild, uint32_t begin, uint32_t end, int depth)
+{
+    if (begin == end) {
+        return -1;
+    }
+    if (end - begin <= kLeafItems || bspChild < 0 || depth >= kMaxDepth ||
+        (size_t)bspChild >= b.nodes.size() ||
+        (size_t)b.nodes[(size_t)bspChild].planeIndex >= b.planes.size()) {
+        return AddLeaf(b, begin, end);
+    }
+    const BSPNode& bspNode = b.nodes[(size_t)bspChild];
+    const BSPPlane& plane = b.planes[(size_t)bspNode.planeIndex];
+    uint32_t* first = b.order.data() + begin;
+    uint32_t* mid = std::partition(first, b.order.data() + end, [&](uint32_t cluster) {
+        const Vector3 c = BoxCenter(b.bounds[cluster]);
+        return plane.nx * c.x + plane.ny * c.y + plane.nz * c.z + plane.d >= 0.0f;
+    });
+    const uint32_t split = begin + (uint32_t)(mid - first);
+    if (split == begin) {
+        return BuildNode(b, bspNode.backChild, begin, end, depth + 1);
+    }
+    if (split == end) {
+        return BuildNode(b, bspNode.frontChild, begin, end, depth + 1);
+    }
+
+    const int32_t index = (int32_t)b.tree.nodes.size();
+    b.tree.nodes.emplace_back();
+    const int32_t front = BuildNode(b, bspNode.frontChild, begin, split, depth + 1);
+    const int32_t back = BuildNode(b, bspNode.backChild, split, end, depth + 1);
+    MapCullNode& node = b.tree.nodes[(size_t)index];
+    node.children[0] = front;
+    node.children[1] = back;
+    node.bounds = BoxUnion(b.tree.nodes[(size_t)front].bounds, b.tree.nodes[(size_t)back].bounds);
+    node.firstItem = begin;
+    node.itemCount = end - begin;
+    return index;
+}
+
+// One frustum plane with the bound arrays its positive vertex reads.
+struct BatchPlane {
+    const float* xs;
+    const float* ys;
+    const float* zs;
+    float nx, ny, nz, w;
+};
+
+// Bit i set when cluster slot `slot + i` is inside every plane.
+uint32_t TestBatch(const BatchPlane* planes, int planeCount, size_t slot)
+{
+#if defined(MAP_CULL_AVX)
+    __m256 inside = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+    for (int p = 0; p < planeCount; ++p) {
+        const BatchPlane& pl = planes[p];
+        __m256 d = _mm256_mul_ps(_mm256_set1_ps(pl.nx), _mm256_loadu_ps(pl.xs + slot));
+        d = _mm256_add_ps(d, _mm256_mul_ps(_mm256_set1_ps(pl.ny), _mm256_loadu_ps(pl.ys + slot)));
+        d = _mm256_add_ps(d, _mm256_mul_ps(_mm256_set1_ps(pl.nz), _mm256_loadu_ps(pl.zs + slot)));
+        d = _mm256_add_ps(d, _mm256_set1_ps(pl.w));
+        inside = _mm256_and_ps(inside, _mm256_cmp_ps(d, _mm256_setzero_ps(), _CMP_GE_OQ));
+    }
+    return (uint32_t)_mm256_movemask_ps(inside);
+#elif defined(MAP_CULL_SSE)
+    __m128 inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+    for (int p = 0; p < planeCount; ++p) {
+        const BatchPlane& pl = planes[p];
+        __m128 d = _mm_mul_ps(_mm_set1_ps(pl.nx), _mm_loadu_ps(pl.xs + slot));
+        d = _mm_add_ps(d, _mm_mul_ps(_mm_set1_ps(pl.ny), _mm_loadu_ps(pl.ys + slot)));
+        d = _mm_add_ps(d, _mm_mul_ps(_mm_set1_ps(pl.nz), _mm_loadu_ps(pl.zs + slot)));
+        d = _mm_add_ps(d, _mm_set1_ps(pl.w));
+        inside = _mm_and_ps(inside, _mm_cmpge_ps(d, _mm_setzero_ps()));
+    }
+    return (uint32_t)_mm_movemask_ps(inside);
+#elif defined(MAP_CULL_NEON)
+    uint32x4_t inside = vdupq_n_u32(0xFFFFFFFFu);
+    for (int p = 0; p < planeCount; ++p) {
+        const BatchPlane& pl = planes[p];
+        float32x4_t d = vmulq_n_f32(vld1q_f32(pl.xs + slot), pl.nx);
+        d = vmlaq_n_f32(d, vld1q_f32(pl.ys + slot), pl.ny);
+        d = vmlaq_n_f32(d, vld1q_f32(pl.zs + slot), pl.nz);
+        d = vaddq_f32(d, vdupq_n_f32(pl.w));
+        inside = vandq_u32(inside, vcgeq_f32(d, vdupq_n_f32(0.0f)));
+    }
+    return (vgetq_lane_u32(inside, 0) & 1u) | (vgetq_lane_u32(inside, 1) & 2u) |
+           (vgetq_lane_u32(inside, 2) & 4u) | (vgetq_lane_u32(inside, 3) & 8u);
+#else
+    uint32_t bits = 0;
+    for (size_t lane = 0; lane < kBatch; ++lane) {
+        bool inside = true;
+        for (int p = 0; p < planeCount && inside; ++p) {
+            const BatchPlane& pl = planes[p];
+            inside = pl.nx * pl.xs[slot + lane] + pl.ny * pl.ys[slot + lane] + pl.nz * pl.zs[slot + lane] + pl.w >= 0.0f;
+        }
+        bits |= inside ? 1u << lane : 0u;
+    }
+    return bits;
+#endif
+}
+
+} // namespace
+
+void MapCull_Build(MapCullTree& tree,
+                   std::span<const AABB> clusterBounds,
+                   std::span<const BSPNode> nodes,
+                   std::span<const BSPPlane> planes,
+                   int32_t rootChild)
+{
+    tree = MapCullTree{};
+    tree.clusterCount = clusterBounds.size();
+    if (clusterBounds.empty()) {
+        return;
+    }
+
+    Builder b{ tree, clusterBounds, nodes, planes, {} };
+    b.order.resize(clusterBounds.size());
+    for (size_t i = 0; i < b.order.size(); ++i) {
+        b.order[i] = (uint32_t)i;
+    }
+    // The first node added is the root; without a BSP tree it is the only one.
+    BuildNode(b, nodes.empty() ? -1 : rootChild, 0, (uint32_t)b.order.size(), 0);
+
+    const size_t padded = (b.order.size() + kBatch - 1) / kBatch * kBatch + kBatch;
+    tree.minX.assign(padded, kEmptyBound);
+    tree.minY.assign(padded, kEmptyBound);
+    tree.minZ.assign(padded, kEmptyBound);
+    tree.maxX.assign(padded, -kEmptyBound);
+    tree.maxY.assign(padded, -kEmptyBound);
+    tree.maxZ.assign(padded, -kEmptyBound);
+    for (size_t slot = 0; slot < b.order.size(); ++slot) {
+        const AABB& box = clusterBounds[b.order[slot]];
+        tree.minX[slot] = box.min.x;
+        tree.minY[slot] = box.min.y;
+        tree.minZ[slot] = box.min.z;
+        tree.maxX[slot] = box.max.x;
+        tree.maxY[slot] = box.max.y;
+        tree.maxZ[slot] = box.max.z;
+    }
+    tree.items = std::move(b.order);
+}
+
+void MapCull_Frustum(const MapCullTree& tree, const Frustum& frustum, uint8_t* inFrustum)
+{
+    if (tree.clusterCount == 0) {
+        return;
+    }
+    memset(inFrustum, 0, tree.clusterCount);
+    if (tree.nodes.empty()) {
+        return;
+    }
+
+    // Each plane's positive vertex reads the max bound where its normal is
+    // non-negative, as in FrustumAABB.
+    BatchPlane all[6];
+    for (int p = 0; p < 6; ++p) {
+        const Vector4& pl = frustum.p[p];
+        all[p] = BatchPlane{ pl.x >= 0.0f ? tree.maxX.data() : tree.minX.data(),
+                             pl.y >= 0.0f ? tree.maxY.data() : tree.minY.data(),
+                             pl.z >= 0.0f ? tree.maxZ.data() : tree.minZ.data(),
+                             pl.x, pl.y, pl.z, pl.w };
+    }
+
+    // A node's mask holds the planes its box straddles; planes it is wholly
+    // inside of are dropped for the whole subtree.
+    struct Entry { int32_t node; uint32_t planeMask; };
+    Entry stack[kMaxDepth + 2];
+    int top = 0;
+    stack[top++] = Entry{ 0, 0x3Fu };
+    while (top > 0) {
+        const Entry entry = stack[--top];
+        const MapCullNode& node = tree.nodes[(size_t)entry.node];
+        const AABB& b = node.bounds;
+        uint32_t mask = entry.planeMask;
+        bool outside = false;
+        for (int p = 0; p < 6 && !outside; ++p) {
+            if (!(mask & (1u << p))) continue;
+            const Vector4& pl = frustum.p[p];
+            const float px = pl.x >= 0.0f ? b.max.x : b.min.x;
+            const float py = pl.y >= 0.0f ? b.max.y : b.min.y;
+            const float pz = pl.z >= 0.0f ? b.max.z : b.min.z;
+            if (pl.x * px + pl.y * py + pl.z * pz + pl.w < 0.0f) {
+                outside = true;
+                break;
+            }
+            const float nx = pl.x >= 0.0f ? b.min.x : b.max.x;
+            const float ny = pl.y >= 0.0f ? b.min.y : b.max.y;
+            const float nz = pl.z >= 0.0f ? b.min.z : b.max.z;
+            if (pl.x * nx + pl.y * ny + pl.z * nz + pl.w >= 0.0f) {
+                mask &= ~(1u << p);
+            }
+        }
+        if (outside) {
+            continue;
+        }
+
+        const uint32_t end = node.firstItem + node.itemCount;
+        if (mask == 0) {
+            for (uint32_t slot = node.firstItem; slot < end; ++slot) {
+                inFrustum[tree.items[slot]] = 1;
+            }
+            continue;
+        }
+        if (node.children[0] >= 0 || node.children[1] >= 0) {
+            for (int32_t child : node.children) {
+                if (child >= 0) {
+                    stack[top++] = Entry{ child, mask };
+                }
+            }
+            continue;
+        }
+
+        BatchPlane active[6];
+        int activeCount = 0;
+        for (int p = 0; p < 6; ++p) {
+            if (mask & (1u << p)) {
+                active[activeCount++] = all[p];
+            }
+        }
+        for (uint32_t slot = node.firstItem; slot < end; slot += kBatch) {
+            const uint32_t bits = TestBatch(active, activeCount, slot);
+            const uint32_t lanes = std::min<uint32_t>(kBatch, end - slot);
+            for (uint32_t lane = 0; lane < lanes; ++lane) {
+                if (bits & (1u << lane)) {
+                    inFrustum[tree.items[slot + lane]] = 1;
+                }
+            }
+        }
+    }
+}
+
+const char* MapCull_SimdName(void)
+{
+#if defined(MAP_CULL_AVX)
+    return "AVX";
+#elif defined(MAP_CULL_SSE)
+    return "SSE2";
+#elif defined(MAP_CULL_NEON)
+    return "NEON";
+#else
+    return "scalar";
+#endif
+}
@@ -0,0 +1,53 @@
+// map_cull.h  —  hierarchical frustum culling of map clusters.
+//
+// The cull tree follows the map's BSP nodes: every cluster is hung on the
+// leaf holding its centre, each node's box is tightened to the clusters
+// below it, and subtrees without clusters are dropped. Clusters are stored
+// in subtree order as struct-of-arrays bounds, so a node entirely inside
+// the frustum accepts its whole range at once and a small node tests its
+// clusters 4 or 8 at a time with SSE/AVX (NEON on ARM). Maps without a BSP
+// tree get a single node over all clusters.
+//
+// Nothing here touches sokol, so the tree builds and culls headless.
+#pragma once
+
+#include "../math/wmath.h"
+#include "../utils/bsp_format.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+struct MapCullNode {
+    AABB     bounds{};          // of every cluster in the subtree
+    int32_t  children[2] = { -1, -1 }; // into MapCullTree::nodes; -1 = none
+    uint32_t firstItem = 0;     // subtree's clusters, into MapCullTree items
+    uint32_t itemCount = 0;
+};
+
+struct MapCullTree {
+    std::vector<MapCullNode> nodes;   // nodes[0] is the root, if any
+    // Cluster bounds in subtree order, padded so a batch may read past the
+    // last item; padding boxes are inverted and fail every plane.
+    std::vector<float>    minX, minY, minZ;
+    std::vector<float>    maxX, maxY, maxZ;
+    std::vector<uint32_t> items;      // cluster index per slot
+    size_t                clusterCount = 0;
+};
+
+// Builds the tree over `clusterBounds`. `nodes`, `planes` and `rootChild`
+// are the map's BSP tree as in bsp_vis.h; empty spans build one flat node.
+void MapCull_Build(MapCullTree& tree,
+                   std::span<const AABB> clusterBounds,
+                   std::span<const BSPNode> nodes,
+                   std::span<const BSPPlane> planes,
+                   int32_t rootChild);
+
+// Sets inFrustum[c] to 1 for every cluster whose box is not fully outside
+// one of the frustum's planes, the same test as FrustumAABB, and to 0 for
+// the rest. `inFrustum` holds tree.clusterCount entries.
+void MapCull_Frustum(const MapCullTree& tree, const Frustum& frustum, uint8_t* inFrustum);
+
+// "AVX", "SSE2", "NEON" or "scalar": the batch test this build uses.
+const char* MapCull_SimdName(void);
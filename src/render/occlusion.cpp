@@ -0,0 +1,477 @@
+#include "occlusion.h"
+#include "../utils/worker_pool.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+    #include <emmintrin.h>
+    #define OCCLUSION_SSE 1
+#elif defined(__ARM_NEON) || defined(_M_ARM64)
+    #include <arm_neon.h>
+    #define OCCLUSION_NEON 1
+#endif
+
+namespace {
+
+// Four pixels of a row at a time.
+#if defined(OCCLUSION_SSE)
+using F4 = __m128;
+inline F4   F4Set1(float v)                { return _mm_set1_ps(v); }
+inline F4   F4Set(float a, float b, float c, float d) { return _mm_setr_ps(a, b, c, d); }
+inline F4   F4Load(const float* p)         { return _mm_loadu_ps(p); }
+inline void F4Store(float* p, F4 v)        { _mm_storeu_ps(p, v); }
+inline F4   F4Add(F4 a, F4 b)              { return _mm_add_ps(a, b); }
+inline F4   F4Mul(F4 a, F4 b)              { return _mm_mul_ps(a, b); }
+inline F4   F4Max(F4 a, F4 b)              { return _mm_max_ps(a, b); }
+inline F4   F4Min(F4 a, F4 b)              { return _mm_min_ps(a, b); }
+inline F4   F4Greater(F4 a, F4 b)          { return _mm_cmpgt_ps(a, b); }
+inline int  F4MaskBits(F4 mask)            { return _mm_movemask_ps(mask); }
+inline float F4HorizontalMin(F4 v)
+{
+    v = _mm_min_ps(v, _mm_shuffle_ps(v, v, _MM_SHUFFLE(2, 3, 0, 1)));
+    v = _mm_min_ps(v, _mm_shuffle_ps(v, v, _MM_SHUFFLE(1, 0, 3, 2)));
+    return _mm_cvtss_f32(v);
+}
+#elif defined(OCCLUSION_NEON)
+using F4 = float32x4_t;
+inline F4   F4Set1(float v)                { return vdupq_n_f32(v); }
+inline F4   F4Set(float a, float b, float c, float d) { const float v[4] = { a, b, c, d }; return vld1q_f32(v); }
+inline F4   F4Load(const float* p)         { return vld1q_f32(p); }
+inline void F4Store(float* p, F4 v)        { vst1q_f32(p, v); }
+inline F4   F4Add(F4 a, F4 b)              { return vaddq_f32(a, b); }
+inline F4   F4Mul(F4 a, F4 b)              { return vmulq_f32(a, b); }
+inline F4   F4Max(F4 a, F4 b)              { return vmaxq_f32(a, b); }
+inline F4   F4Min(F4 a, F4 b)              { return vminq_f32(a, b); }
+inline F4   F4Greater(F4 a, F4 b)          { return vreinterpretq_f32_u32(vcgtq_f32(a, b)); }
+inline int  F4MaskBits(F4 mask)
+{
+    const uint32x4_t m = vreinterpretq_u32_f32(mask);
+    return (int)((vgetq_lane_u32(m, 0) & 1u) | (vgetq_lane_u32(m, 1) & 2u) |
+                 (vgetq_lane_u32(m, 2) & 4u) | (vgetq_lane_u32(m, 3) & 8u));
+}
+inline float F4HorizontalMin(F4 v)         { return vminvq_f32(v); }
+#else
+struct F4 { float v[4]; };
+inline F4   F4Set1(float v)                { return F4{ { v, v, v, v } }; }
+inline F4   F4Set(float a, float b, float c, float d) { return F4{ { a, b, c, d } }; }
+inline F4   F4Load(const float* p)         { return F4{ { p[0], p[1], p[2], p[3] } }; }
+inline void F4Store(float* p, F4 v)        { memcpy(p, v.v, sizeof(v.v)); }
+template <typename Op>
+inline F4   F4Map(F4 a, F4 b, Op op)       { F4 r; for (int i = 0; i < 4; ++i) r.v[i] = op(a.v[i], b.v[i]); return r; }
+inline float F4Bool(bool b)                { uint32_t bits = b ? 0xFFFFFFFFu : 0u; float f; memcpy(&f, &bits, sizeof(f)); return f; }
+inline bool F4IsSet(float f)               { uint32_t bits; memcpy(&bits, &f, sizeof(bits)); return bits != 0; }
+inline F4   F4Add(F4 a, F4 b)              { return F4Map(a, b, [](float x, float y) { return x + y; }); }
+inline F4   F4Mul(F4 a, F4 b)              { return F4Map(a, b, [](float x, float y) { return x * y; }); }
+inline F4   F4Max(F4 a, F4 b)              { return F4Map(a, b, [](float x, float y) { return std::max(x, y); }); }
+inline F4   F4Min(F4 a, F4 b)              { return F4Map(a, b, [](float x, float y) { return std::min(x, y); }); }
+inline F4   F4Greater(F4 a, F4 b)          { return F4Map(a, b, [](float x, float y) { return F4Bool(x > y); }); }
+inline int  F4MaskBits(F4 mask)            { int bits = 0; for (int i = 0; i < 4; ++i) bits |= F4IsSet(mask.v[i]) ? 1 << i : 0; return bits; }
+inline float F4HorizontalMin(F4 v)         { return std::min(std::min(v.v[0], v.v[1]), std::min(v.v[2], v.v[3])); }
+#endif
+
+// Below this many on-screen occluders one thread rasterizes everything;
+// waking the pool would cost more than the bands save.
+constexpr size_t kThreadedPolygonCount = 64;
+
+struct ClipVertex {
+    float x, y, z, w;
+};
+
+ClipVertex Transform(const Matrix& m, float x, float y, float z)
+{
+    return ClipVertex{
+        m.m0 * x + m.m4 * y + m.m8 * z + m.m12,
+        m.m1 * x + m.m5 * y + m.m9 * z + m.m13,
+        m.m2 * x + m.m6 * y + m.m10 * z + m.m14,
+        m.m3 * x + m.m7 * y + m.m11 * z + m.m15,
+    };
+}
+
+// Signed distance of `v` to clip plane `plane`: -x, +x, -y, +y, then near.
+float ClipDistance(const ClipVertex& v, int plane)
+{
+    switch (plane) {
+        case 0:  return v.w + v.x;
+        case 1:  return v.w - v.x;
+        case 2:  return v.w + v.y;
+        case 3:  return v.w - v.y;
+        default: return v.w + v.z;
+    }
+}
+
+// Bit per clip plane the vertex is outside of.
+uint32_t Outcode(const ClipVertex& v)
+{
+    uint32_t code = 0;
+    for (int plane = 0; plane < 5; ++plane) {
+        code |= (ClipDistance(v, plane) < 0.0f ? 1u : 0u) << plane;
+    }
+    return code;
+}
+
+// Clips the polygon in `in` against the clip planes set in `planes`;
+// returns the vertex count left in `out` (0 when nothing is).
+int ClipPolygon(ClipVertex* in, int count, uint32_t planes, ClipVertex* out)
+{
+    ClipVertex* src = in;
+    ClipVertex* dst = out;
+    for (int plane = 0; plane < 5 && count >= 3; ++plane) {
+        if (!(planes & (1u << plane))) {
+            continue;
+        }
+        int written = 0;
+        for (int i = 0; i < count; ++i) {
+            const ClipVertex& a = src[i];
+            const ClipVertex& b = src[(i + 1) % count];
+            const float da = ClipDistance(a, plane);
+            const float db = ClipDistance(b, plane);
+            if (da >= 0.0f) {
+                dst[written++] = a;
+            }
+            if ((da >= 0.0f) != (db >= 0.0f) && written < OCCLUSION_MAX_EDGES) {
+                const float t = da / (da - db);
+                dst[written++] = ClipVertex{ a.x + (b.x - a.x) * t, a.y + (b.y - a.y) * t,
+                                             a.z + (b.z - a.z) * t, a.w + (b.w - a.w) * t };
+            }
+            if (written >= OCCLUSION_MAX_EDGES) {
+                break;
+            }
+        }
+        count = written;
+        std::swap(src, dst);
+    }
+    if (count >= 3 && src != out) {
+        memcpy(out, src, (size_t)count * sizeof(ClipVertex));
+    }
+    return count >= 3 ? count : 0;
+}
+
+// Sets up edge and depth functions for a clipped polygon. Each is lowered
+// by its largest change across half a pixel, so a pixel passes every edge
+// only when the polygon covers all of it and gets the depth of its farthest
+// corner. False for polygons with no area on screen.
+bool SetupPolygon(const ClipVertex* v, int count, int width, int height, OcclusionPolygon& out)
+{
+    float sx[OCCLUSION_MAX_EDGES], sy[OCCLUSION_MAX_EDGES], iw[OCCLUSION_MAX_EDGES];
+    float minX = (float)width, maxX = 0.0f, minY = (float)height, maxY = 0.0f;
+    out.nearest = 0.0f;
+    for (int i = 0; i < count; ++i) {
+        iw[i] = 1.0f / v[i].w;
+        out.nearest = std::max(out.nearest, iw[i]);
+        sx[i] = (v[i].x * iw[i] * 0.5f + 0.5f) * (float)width;
+        sy[i] = (v[i].y * iw[i] * 0.5f + 0.5f) * (float)height;
+        minX = std::min(minX, sx[i]);
+        maxX = std::max(maxX, sx[i]);
+        minY = std::min(minY, sy[i]);
+        maxY = std::max(maxY, sy[i]);
+    }
+    // Fan triangle with the largest area: the best conditioned for the
+    // depth plane, and its sign gives the winding.
+    float area = 0.0f;
+    int best = 1;
+    for (int i = 1; i + 1 < count; ++i) {
+        const float a = (sx[i] - sx[0]) * (sy[i + 1] - sy[0]) - (sx[i + 1] - sx[0]) * (sy[i] - sy[0]);
+        if (fabsf(a) > fabsf(area)) {
+            area = a;
+            best = i;
+        }
+    }
+    if (fabsf(area) < 1e-3f) {
+        return false;
+    }
+    const float sign = area > 0.0f ? 1.0f : -1.0f;
+
+    // Edges split by which side of a row's span they bound, each scaled so
+    // its crossing needs no divide. Horizontal ones bound the rows instead.
+    float rowLow = minY, rowHigh = maxY;   // pixel centres allowed, in y
+    float rightB[OCCLUSION_MAX_EDGES], rightC[OCCLUSION_MAX_EDGES];
+    int rightCount = 0;
+    out.edgeCount = 0;
+    out.leftEdgeCount = 0;
+    for (int i = 0; i < count; ++i) {
+        const int j = (i + 1) % count;
+        const float dx = sx[j] - sx[i];
+        const float dy = sy[j] - sy[i];
+        if (dx == 0.0f && dy == 0.0f) {
+            continue;
+        }
+        const float a = -dy * sign;
+        const float b = dx * sign;
+        const float c = (dy * sx[i] - dx * sy[i]) * sign - 0.5f * (fabsf(a) + fabsf(b));
+        if (a > 0.0f) {
+            const int e = out.leftEdgeCount++;
+            out.edgeB[e] = -b / a;
+            out.edgeC[e] = -c / a;
+        } else if (a < 0.0f) {
+            rightB[rightCount] = -b / a;
+            rightC[rightCount] = -c / a;
+            ++rightCount;
+        } else if (b > 0.0f) {
+            rowLow = std::max(rowLow, -c / b);
+        } else {
+            rowHigh = std::min(rowHigh, -c / b);
+        }
+    }
+    for (int e = 0; e < rightCount; ++e) {
+        out.edgeB[out.leftEdgeCount + e] = rightB[e];
+        out.edgeC[out.leftEdgeCount + e] = rightC[e];
+    }
+    out.edgeCount = out.leftEdgeCount + rightCount;
+
+    const int i1 = best, i2 = best + 1;
+    const float x1 = sx[i1] - sx[0], y1 = sy[i1] - sy[0], z1 = iw[i1] - iw[0];
+    const float x2 = sx[i2] - sx[0], y2 = sy[i2] - sy[0], z2 = iw[i2] - iw[0];
+    out.depthA = (z1 * y2 - z2 * y1) / area;
+    out.depthB = (x1 * z2 - x2 * z1) / area;
+    out.depthC = iw[0] - out.depthA * sx[0] - out.depthB * sy[0] - 0.5f * (fabsf(out.depthA) + fabsf(out.depthB));
+
+    out.minX = std::max(0, (int)floorf(minX));
+    out.maxX = std::min(width - 1, (int)floorf(maxX));
+    out.minY = std::max(0, (int)ceilf(rowLow - 0.5f));
+    out.maxY = std::min(height - 1, (int)floorf(rowHigh - 0.5f));
+    return out.minX <= out.maxX && out.minY <= out.maxY;
+}
+
+// The pixels of row `y` the polygon covers, [x0, x1]. The polygon is
+// convex, so that is one span between its left and right edges. False
+// when the row misses it.
+bool RowSpan(const OcclusionPolygon& poly, int y, int* x0, int* x1)
+{
+    const float cy = (float)y + 0.5f;
+    float left = (float)poly.minX + 0.5f;
+    float right = (float)poly.maxX + 0.5f;
+    for (int e = 0; e < poly.leftEdgeCount; ++e) {
+        left = std::max(left, poly.edgeB[e] * cy + poly.edgeC[e]);
+    }
+    for (int e = poly.leftEdgeCount; e < poly.edgeCount; ++e) {
+        right = std::min(right, poly.edgeB[e] * cy + poly.edgeC[e]);
+    }
+    *x0 = std::max(poly.minX, (int)ceilf(left - 0.5f));
+    *x1 = std::min(poly.maxX, (int)floorf(right - 0.5f));
+    return *x0 <= *x1;
+}
+
+// Clears and fills rows [y0, y1), then their tile minima. y0 and y1 are on
+// tile boundaries. While filling, tileMin holds a lower bound for each
+// tile, raised whenever a polygon covers a whole tile; drawn in `order`,
+// front to back, that skips strips of later polygons already hidden.
+void RasterizeBand(OcclusionBuffer& buf, int y0, int y1)
+{
+    const int width = buf.width;
+    const int tilesX = width / OCCLUSION_TILE_SIZE;
+    std::fill(buf.depth.begin() + (size_t)y0 * width, buf.depth.begin() + (size_t)y1 * width, 0.0f);
+    std::fill(buf.tileMin.begin() + (size_t)(y0 / OCCLUSION_TILE_SIZE) * tilesX,
+              buf.tileMin.begin() + (size_t)(y1 / OCCLUSION_TILE_SIZE) * tilesX, 0.0f);
+    const F4 laneOffsets = F4Set(0.5f, 1.5f, 2.5f, 3.5f);
+    for (uint32_t polyIndex : buf.order) {
+        const OcclusionPolygon& poly = buf.polygons[polyIndex];
+        const int rowStart = std::max(y0, poly.minY);
+        const int rowEnd = std::min(y1 - 1, poly.maxY);
+        const int tx0 = poly.minX / OCCLUSION_TILE_SIZE;
+        const int tx1 = poly.maxX / OCCLUSION_TILE_SIZE;
+        const F4 depthStep = F4Set1(poly.depthA * 4.0f);
+        for (int ty = rowStart / OCCLUSION_TILE_SIZE; ty <= rowEnd / OCCLUSION_TILE_SIZE; ++ty) {
+            float* tileRow = buf.tileMin.data() + (size_t)ty * tilesX;
+            bool hidden = true;
+            for (int tx = tx0; tx <= tx1 && hidden; ++tx) {
+                hidden = tileRow[tx] > poly.nearest;
+            }
+            if (hidden) {
+                continue;
+            }
+            const int stripStart = ty * OCCLUSION_TILE_SIZE;
+            const int stripEnd = stripStart + OCCLUSION_TILE_SIZE - 1;
+            bool wholeStrip = rowStart <= stripStart && rowEnd >= stripEnd;
+            int coverLeft = 0, coverRight = width - 1;
+            for (int y = std::max(rowStart, stripStart); y <= std::min(rowEnd, stripEnd); ++y) {
+                int x0, x1;
+                if (!RowSpan(poly, y, &x0, &x1)) {
+                    wholeStrip = false;
+                    continue;
+                }
+                coverLeft = std::max(coverLeft, x0);
+                coverRight = std::min(coverRight, x1);
+                float* row = buf.depth.data() + (size_t)y * width;
+                const float rowDepth = poly.depthB * ((float)y + 0.5f) + poly.depthC;
+                int x = x0;
+                F4 depth = F4Add(F4Mul(F4Set1(poly.depthA), F4Add(F4Set1((float)x0), laneOffsets)), F4Set1(rowDepth));
+                for (; x + 3 <= x1; x += 4) {
+                    F4Store(row + x, F4Max(F4Load(row + x), depth));
+                    depth = F4Add(depth, depthStep);
+                }
+                for (; x <= x1; ++x) {
+                    row[x] = std::max(row[x], poly.depthA * ((float)x + 0.5f) + rowDepth);
+                }
+            }
+            if (!wholeStrip) {
+                continue;
+            }
+            // Tiles inside every row's span are covered; the plane is
+            // lowest at one of their corner pixels.
+            const float cornerY = (float)stripStart + (poly.depthB >= 0.0f ? 0.5f : OCCLUSION_TILE_SIZE - 0.5f);
+            const float cornerX = poly.depthA >= 0.0f ? 0.5f : OCCLUSION_TILE_SIZE - 0.5f;
+            for (int tx = (coverLeft + OCCLUSION_TILE_SIZE - 1) / OCCLUSION_TILE_SIZE;
+                 (tx + 1) * OCCLUSION_TILE_SIZE - 1 <= coverRight; ++tx) {
+                const float lowest = poly.depthA * ((float)(tx * OCCLUSION_TILE_SIZE) + cornerX) +
+                                     poly.depthB * cornerY + poly.depthC;
+                tileRow[tx] = std::max(tileRow[tx], lowest);
+            }
+        }
+    }
+
+    for (int ty = y0 / OCCLUSION_TILE_SIZE; ty < y1 / OCCLUSION_TILE_SIZE; ++ty) {
+        for (int tx = 0; tx < tilesX; ++tx) {
+            F4 tileMin = F4Set1(INFINITY);
+            for (int y = ty * OCCLUSION_TILE_SIZE; y < (ty + 1) * OCCLUSION_TILE_SIZE; ++y) {
+                const float* row = buf.depth.data() + (size_t)y * width + tx * OCCLUSION_TILE_SIZE;
+                for (int x = 0; x < OCCLUSION_TILE_SIZE; x += 4) {
+                    tileMin = F4Min(tileMin, F4Load(row + x));
+                }
+            }
+            buf.tileMin[(size_t)ty * tilesX + tx] = F4HorizontalMin(tileMin);
+        }
+    }
+}
+
+} // namespace
+
+void Occlusion_Init(OcclusionBuffer& buf,
+                    std::span<const BSPOccluder> occluders,
+                    std::span<const BSPVec3> verts,
+                    int width,
+                    int height)
+{
+    buf = OcclusionBuffer{};
+    buf.width = (std::max(width, 1) + OCCLUSION_TILE_SIZE - 1) / OCCLUSION_TILE_SIZE * OCCLUSION_TILE_SIZE;
+    buf.height = (std::max(height, 1) + OCCLUSION_TILE_SIZE - 1) / OCCLUSION_TILE_SIZE * OCCLUSION_TILE_SIZE;
+    buf.occluders.assign(occluders.begin(), occluders.end());
+    buf.occluderVerts.reserve(verts.size());
+    for (const BSPVec3& v : verts) {
+        buf.occluderVerts.push_back(Vector3{ v.x, v.y, v.z });
+    }
+    buf.depth.assign((size_t)buf.width * buf.height, 0.0f);
+    buf.tileMin.assign((size_t)(buf.width / OCCLUSION_TILE_SIZE) * (buf.height / OCCLUSION_TILE_SIZE), 0.0f);
+}
+
+void Occlusion_Render(OcclusionBuffer& buf, const Matrix& viewProj)
+{
+    buf.viewProj = viewProj;
+    buf.polygons.clear();
+    ClipVertex in[OCCLUSION_MAX_EDGES];
+    ClipVertex clipped[OCCLUSION_MAX_EDGES];
+    for (const BSPOccluder& occluder : buf.occluders) {
+        const int count = (int)std::min<uint32_t>(occluder.vertexCount, OCCLUSION_MAX_EDGES - 5);
+        uint32_t anyOutside = 0, allOutside = ~0u;
+        for (int i = 0; i < count; ++i) {
+            const Vector3& p = buf.occluderVerts[occluder.firstVertex + i];
+            in[i] = Transform(viewProj, p.x, p.y, p.z);
+            const uint32_t code = Outcode(in[i]);
+            anyOutside |= code;
+            allOutside &= code;
+        }
+        if (allOutside) {
+            continue;
+        }
+        ClipVertex* verts = in;
+        int vertCount = count;
+        if (anyOutside) {
+            vertCount = ClipPolygon(in, count, anyOutside, clipped);
+            verts = clipped;
+        }
+        OcclusionPolygon poly;
+        if (vertCount >= 3 && SetupPolygon(verts, vertCount, buf.width, buf.height, poly)) {
+            buf.polygons.push_back(poly);
+        }
+    }
+
+    // Front to back, so the near occluders' tile bounds let far ones skip
+    // strips. Polygons are large; sort their indices.
+    buf.order.resize(buf.polygons.size());
+    for (size_t i = 0; i < buf.order.size(); ++i) {
+        buf.order[i] = (uint32_t)i;
+    }
+    std::sort(buf.order.begin(), buf.order.end(), [&](uint32_t a, uint32_t b) {
+        return buf.polygons[a].nearest != buf.polygons[b].nearest ? buf.polygons[a].nearest > buf.polygons[b].nearest
+                                                                   : a < b;
+    });
+
+    // Bands of whole tile rows, so no tile is shared between workers. The
+    // pool's threads stay parked between frames.
+    WorkerPool& pool = FrameWorkerPool();
+    const int tileRows = buf.height / OCCLUSION_TILE_SIZE;
+    const size_t bands = buf.polygons.size() >= kThreadedPolygonCount
+                             ? std::min<size_t>(pool.WorkerCount(), (size_t)tileRows) : 1;
+    pool.Run(bands, [&](size_t band) {
+        const int firstRow = (int)(band * tileRows / bands);
+        const int endRow = (int)((band + 1) * tileRows / bands);
+        RasterizeBand(buf, firstRow * OCCLUSION_TILE_SIZE, endRow * OCCLUSION_TILE_SIZE);
+    });
+}
+
+bool Occlusion_TestAABB(const OcclusionBuffer& buf, const AABB& box)
+{
+    if (buf.polygons.empty()) {
+        return true;
+    }
+    float minX = INFINITY, maxX = -INFINITY, minY = INFINITY, maxY = -INFINITY;
+    float nearest = 0.0f;
+    for (int corner = 0; corner < 8; ++corner) {
+        const ClipVertex v = Transform(buf.viewProj,
+                                       (corner & 1) ? box.max.x : box.min.x,
+                                       (corner & 2) ? box.max.y : box.min.y,
+                                       (corner & 4) ? box.max.z : box.min.z);
+        if (v.w + v.z <= 0.0f || v.w <= 0.0f) {
+            return true;
+        }
+        const float iw = 1.0f / v.w;
+        const float sx = (v.x * iw * 0.5f + 0.5f) * (float)buf.width;
+        const float sy = (v.y * iw * 0.5f + 0.5f) * (float)buf.height;
+        minX = std::min(minX, sx);
+        maxX = std::max(maxX, sx);
+        minY = std::min(minY, sy);
+        maxY = std::max(maxY, sy);
+        nearest = std::max(nearest, iw);
+    }
+    const int x0 = std::max(0, (int)floorf(minX));
+    const int x1 = std::min(buf.width - 1, (int)floorf(maxX));
+    const int y0 = std::max(0, (int)floorf(minY));
+    const int y1 = std::min(buf.height - 1, (int)floorf(maxY));
+    if (x0 > x1 || y0 > y1) {
+        return true;
+    }
+
+    // Tiles first: a tile whose farthest occluder is in front of the box
+    // hides every pixel of it.
+    const int tilesX = buf.width / OCCLUSION_TILE_SIZE;
+    bool tilesHide = true;
+    for (int ty = y0 / OCCLUSION_TILE_SIZE; ty <= y1 / OCCLUSION_TILE_SIZE && tilesHide; ++ty) {
+        for (int tx = x0 / OCCLUSION_TILE_SIZE; tx <= x1 / OCCLUSION_TILE_SIZE; ++tx) {
+            if (!(buf.tileMin[(size_t)ty * tilesX + tx] > nearest)) {
+                tilesHide = false;
+                break;
+            }
+        }
+    }
+    if (tilesHide) {
+        return false;
+    }
+
+    const F4 boxDepth = F4Set1(nearest);
+    for (int y = y0; y <= y1; ++y) {
+        const float* row = buf.depth.data() + (size_t)y * buf.width;
+        int x = x0;
+        for (; x + 3 <= x1; x += 4) {
+            if (F4MaskBits(F4Greater(F4Load(row + x), boxDepth)) != 0xF) {
+                return true;
+            }
+        }
+        for (; x <= x1; ++x) {
+            if (!(row[x] > nearest)) {
+                return true;
+            }
+        }
+    }
+    return false;
+}
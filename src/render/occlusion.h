@@ -0,0 +1,72 @@
+// occlusion.h  —  CPU software occlusion culling against the map's occluders.
+//
+// compile_map stores the largest opaque world polygons in the .bsp. Every
+// frame they are rasterized into a small depth buffer (256x128 by default)
+// holding 1/w, nearest wins, in horizontal bands spread over worker threads
+// and four pixels at a time with SSE2/NEON. Rasterization is conservative
+// the safe way round: a pixel is written only when an occluder covers all
+// of it, with the occluder's farthest depth over the pixel, so the buffer
+// never hides more than the real polygons would. A box is hidden when its
+// nearest point is behind the buffer over every pixel its screen rectangle
+// touches; per-tile minima settle most tests without reading pixels.
+//
+// Nothing here touches sokol, so it runs and is measured headless.
+#pragma once
+
+#include "../math/wmath.h"
+#include "../utils/bsp_format.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+inline constexpr int OCCLUSION_DEFAULT_WIDTH = 256;
+inline constexpr int OCCLUSION_DEFAULT_HEIGHT = 128;
+inline constexpr int OCCLUSION_TILE_SIZE = 8;
+inline constexpr int OCCLUSION_MAX_EDGES = 24;   // occluder vertices plus five clip planes
+
+// One occluder clipped to the view and set up for rasterizing, in pixels.
+// Edges give the span of each row: pixel centres x with x >= B*y + C for
+// the first leftEdgeCount of them and x <= B*y + C for the rest, y at the
+// row's centre. Edge and depth functions already carry the half-pixel
+// offsets that make them conservative.
+struct OcclusionPolygon {
+    int   minX = 0, maxX = 0, minY = 0, maxY = 0;   // inclusive pixel bounds
+    int   edgeCount = 0;
+    int   leftEdgeCount = 0;
+    float edgeB[OCCLUSION_MAX_EDGES];
+    float edgeC[OCCLUSION_MAX_EDGES];
+    float depthA = 0.0f, depthB = 0.0f, depthC = 0.0f;   // 1/w = A*x + B*y + C
+    float nearest = 0.0f;                                  // largest 1/w of its vertices
+};
+
+struct OcclusionBuffer {
+    int                      width = 0;    // a multiple of OCCLUSION_TILE_SIZE
+    int                      height = 0;
+    std::vector<BSPOccluder> occluders;    // copied out of the .bsp
+    std::vector<Vector3>     occluderVerts;
+
+    // Rebuilt by Occlusion_Render.
+    Matrix                        viewProj{};
+    std::vector<float>            depth;     // per pixel, 1/w of the nearest occluder; 0 = none
+    std::vector<float>            tileMin;   // per tile, its smallest (farthest) depth
+    std::vector<OcclusionPolygon> polygons;  // the occluders that reached the screen
+    std::vector<uint32_t>         order;     // into polygons, nearest first
+};
+
+// Takes a copy of the occluders; with none every test passes. Width and
+// height are rounded up to whole tiles.
+void Occlusion_Init(OcclusionBuffer& buf,
+                    std::span<const BSPOccluder> occluders,
+                    std::span<const BSPVec3> verts,
+                    int width = OCCLUSION_DEFAULT_WIDTH,
+                    int height = OCCLUSION_DEFAULT_HEIGHT);
+
+// Rasterizes every occluder as seen through `viewProj` (column-major, GL
+// clip space with z in [-w, w]).
+void Occlusion_Render(OcclusionBuffer& buf, const Matrix& viewProj);
+
+// False only when `box` is certainly behind the occluders. Boxes reaching
+// the near plane or off screen count as visible.
+bool Occlusion_TestAABB(const OcclusionBuffer& buf, const AABB& box);
@@ -16,11 +16,31 @@
 #define SOKOL_GLCORE
 #endif
 
-#include "shaders/generated/map.metal_dx11.h"
-#include "shaders/generated/normal.metal_dx11.h"
-#include "shaders/generated/pencil.metal_dx11.h"
+// Through the include path, so a build dir's regenerated headers win over
+// the committed ones.
+#include "render/shaders/generated/map.metal_dx11.h"
+#include "render/shaders/generated/normal.metal_dx11.h"
+#include "render/shaders/generated/pencil.metal_dx11.h"
+
+// Programs in map.glsl reach the renderer once sokol-shdc has regenerated
+// map.metal_dx11.h from it. Until then the renderer draws without them.
+#if defined(ATTR_warped_map_shader_map_mrt_a_pos)
+#define WARPED_MAP_MRT_SHADER 1
+#else
+#define WARPED_MAP_MRT_SHADER 0
+#endif
+#if defined(ATTR_warped_map_shader_map_array_a_pos)
+#define WARPED_MAP_ARRAY_SHADER 1
+#else
+#define WARPED_MAP_ARRAY_SHADER 0
+#endif
 #include "../compiler/map_parser.h"
 #include "../utils/bsp_loader.h"
+#include "../utils/bsp_vis.h"
+#include "../utils/lightmap_codec.h"
+#include "../utils/parallel_for.h"
+#include "../utils/parameters.h"
+#include "../utils/vertex_codec.h"
 #include "sokol_gfx.h"
 #include "sokol_glue.h"
 
@@ -28,19 +48,36 @@
 #include "stb_image.h"
 
 #include <algorithm>
+#include <chrono>
+#include <cmath>
 #include <cstddef>
 #include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <limits>
+#include <map>
+#include <span>
+#include <tuple>
+#include <unordered_set>
 
 // ---------------------------------------------------------------------------
 //  Internal state
 // ---------------------------------------------------------------------------
 static sg_shader   g_shader    = {};
 static sg_pipeline g_pipeline  = {};
+static sg_pipeline g_compactPipeline = {};   // same shader, BSPVertexCompact layout
+static sg_shader   g_arrayShader = {};       // TEXTURE_ARRAYS: layers per vertex
+static sg_pipeline g_arrayPipeline = {};
+static sg_pipeline g_compactArrayPipeline = {};
 static sg_sampler  g_sampler   = {};   // repeat, for diffuse
 static sg_sampler  g_lmSampler = {};   // clamp, for lightmap
 static sg_image    g_whiteLm   = {};   // 1×1 white fallback lightmap
 static sg_view     g_whiteLmV  = {};
+static sg_image    g_whiteArray = {};  // 1×1×1 white, for the array slots a draw leaves unused
+static sg_view     g_whiteArrayV = {};
 static bool        g_logged_bind_diagnostics = false;
+static DrawStats   g_drawStats = {};
 
 struct PencilPostVertex {
     float x;
@@ -54,6 +91,16 @@ static sg_pipeline g_pencilPipeline      = {};
 static sg_buffer   g_pencilVertexBuffer  = {};
 static sg_shader   g_normalShader        = {};
 static sg_pipeline g_normalPipeline      = {};
+static sg_pipeline g_compactNormalPipeline = {};
+// Map colour, normals and view distance in one pass; null when normals get
+// their own pass.
+static sg_shader   g_mapMrtShader        = {};
+static sg_pipeline g_mapMrtPipeline      = {};
+static sg_pipeline g_compactMapMrtPipeline = {};
+static int         g_mapMrtSampleCount   = 0;
+static sg_shader   g_mapArrayMrtShader   = {};
+static sg_pipeline g_mapArrayMrtPipeline = {};
+static sg_pipeline g_compactMapArrayMrtPipeline = {};
 static sg_sampler  g_postSceneSampler    = {};
 static sg_sampler  g_postNormalSampler   = {};
 
@@ -76,6 +123,15 @@ static sg_view  g_normalDepthAttView = {};
 static sg_view  g_normalDepthColorAttView = {};
 static sg_view  g_normalTextureView = {};
 static sg_view  g_normalDepthTextureView = {};
+// Multisampled normal targets of the MRT scene pass, resolved into
+// g_normalColor and g_normalDepthColor.
+static sg_image g_sceneNormalColor = {};
+static sg_image g_sceneNormalDepthColor = {};
+static sg_view  g_sceneNormalColorAttView = {};
+static sg_view  g_sceneNormalDepthColorAttView = {};
+static sg_view  g_normalResolveAttView = {};
+static sg_view  g_normalDepthResolveAttView = {};
+static bool     g_sceneWritesNormals = false;
 
 static const char* RendererBackendName(sg_backend backend) {
     switch (backend) {
@@ -92,6 +148,24 @@ static const char* RendererBackendName(sg_backend backend) {
     }
 }
 
+// The backend whose generated shader descs the renderer makes its shaders
+// from. sokol's dummy backend compiles nothing, so headless runs take the
+// descs of the backend the headers were built for.
+static sg_backend RendererShaderDescBackend(sg_backend backend) {
+    if (backend != SG_BACKEND_DUMMY) {
+        return backend;
+    }
+#if defined(SOKOL_METAL)
+    return SG_BACKEND_METAL_MACOS;
+#elif defined(SOKOL_D3D11)
+    return SG_BACKEND_D3D11;
+#elif defined(SOKOL_GLCORE)
+    return SG_BACKEND_GLCORE;
+#else
+    return backend;
+#endif
+}
+
 static const char* RendererResourceStateName(sg_resource_state state) {
     switch (state) {
         case SG_RESOURCESTATE_INITIAL: return "INITIAL";
@@ -107,10 +181,56 @@ static sg_pixel_format Renderer_LightmapPixelFormat(uint32_t format) {
     switch (format) {
         case BSP_LIGHTMAP_FORMAT_RGBA8_UNORM: return SG_PIXELFORMAT_RGBA8;
         case BSP_LIGHTMAP_FORMAT_RGBA16F:     return SG_PIXELFORMAT_RGBA16F;
+        case BSP_LIGHTMAP_FORMAT_RGB9E5:      return SG_PIXELFORMAT_RGB9E5;
+        case BSP_LIGHTMAP_FORMAT_BC6H_UF16:   return SG_PIXELFORMAT_BC6H_RGBUF;
         default:                              return SG_PIXELFORMAT_NONE;
     }
 }
 
+static sg_pixel_format Renderer_TexturePixelFormat(uint32_t format) {
+    switch (format) {
+        case TEXTURE_PIXEL_RGBA8: return SG_PIXELFORMAT_RGBA8;
+        case TEXTURE_PIXEL_BC1:   return SG_PIXELFORMAT_BC1_RGBA;
+        case TEXTURE_PIXEL_BC3:   return SG_PIXELFORMAT_BC3_RGBA;
+        case TEXTURE_PIXEL_BC7:   return SG_PIXELFORMAT_BC7_RGBA;
+        default:                  return SG_PIXELFORMAT_NONE;
+    }
+}
+
+static bool Renderer_TextureArraysReady(void)
+{
+    return TEXTURE_ARRAYS &&
+           sg_query_pipeline_state(g_arrayPipeline) == SG_RESOURCESTATE_VALID &&
+           sg_query_pipeline_state(g_compactArrayPipeline) == SG_RESOURCESTATE_VALID;
+}
+
+static MapUploadCaps Renderer_QueryUploadCaps(void) {
+    MapUploadCaps caps;
+    caps.backend = sg_query_backend();
+    for (uint32_t f = 0; f < 4; ++f) {
+        const sg_pixel_format texture = Renderer_TexturePixelFormat(f);
+        const sg_pixel_format lightmap = Renderer_LightmapPixelFormat(f);
+        caps.textureSampleable[f] = texture != SG_PIXELFORMAT_NONE && sg_query_pixelformat(texture).sample;
+        caps.lightmapSampleable[f] = lightmap != SG_PIXELFORMAT_NONE && sg_query_pixelformat(lightmap).sample;
+    }
+    caps.rgba16f = sg_query_pixelformat(SG_PIXELFORMAT_RGBA16F).sample;
+    caps.arrays = Renderer_TextureArraysReady();
+    caps.maxArrayLayers = std::max(1, sg_query_limits().max_image_array_layers);
+    return caps;
+}
+
+// Backends without BCn sampling get the blocks decoded to RGBA8.
+static sg_pixel_format Renderer_TextureUploadFormat(const MapUploadCaps& caps, uint32_t format, const std::string& name) {
+    const sg_pixel_format pixelFormat = Renderer_TexturePixelFormat(format);
+    if (pixelFormat != SG_PIXELFORMAT_RGBA8 &&
+        (pixelFormat == SG_PIXELFORMAT_NONE || !caps.textureSampleable[format])) {
+        printf("[Renderer] %s textures are not sampleable on backend %s; decoding '%s' to RGBA8.\n",
+               TexturePixelFormatName(format), RendererBackendName(caps.backend), name.c_str());
+        return SG_PIXELFORMAT_RGBA8;
+    }
+    return pixelFormat;
+}
+
 static void Renderer_LogTextureState(const char* label, const TextureEntry& entry) {
     printf("[Renderer] %s image=%s view=%s size=%dx%d\n",
            label,
@@ -139,6 +259,42 @@ static sg_shader Renderer_MakePlatformPencilShader(sg_backend backend) {
     return sg_make_shader(desc);
 }
 
+#if WARPED_MAP_MRT_SHADER
+static sg_shader Renderer_MakePlatformMapMrtShader(sg_backend backend) {
+    const sg_shader_desc* desc = warped_map_shader_map_mrt_shader_desc(backend);
+    if (!desc) {
+        printf("[Renderer] No generated map MRT shader descriptor for backend %s.\n",
+               RendererBackendName(backend));
+        return {};
+    }
+    return sg_make_shader(desc);
+}
+#endif
+
+#if WARPED_MAP_ARRAY_SHADER
+static sg_shader Renderer_MakePlatformMapArrayShader(sg_backend backend) {
+    const sg_shader_desc* desc = warped_map_shader_map_array_shader_desc(backend);
+    if (!desc) {
+        printf("[Renderer] No generated map array shader descriptor for backend %s.\n",
+               RendererBackendName(backend));
+        return {};
+    }
+    return sg_make_shader(desc);
+}
+#endif
+
+#if WARPED_MAP_ARRAY_SHADER && WARPED_MAP_MRT_SHADER
+static sg_shader Renderer_MakePlatformMapArrayMrtShader(sg_backend backend) {
+    const sg_shader_desc* desc = warped_map_shader_map_array_mrt_shader_desc(backend);
+    if (!desc) {
+        printf("[Renderer] No generated map array MRT shader descriptor for backend %s.\n",
+               RendererBackendName(backend));
+        return {};
+    }
+    return sg_make_shader(desc);
+}
+#endif
+
 static sg_shader Renderer_MakePlatformNormalShader(sg_backend backend) {
     const sg_shader_desc* desc = warped_normal_shader_normal_pass_shader_desc(backend);
     if (!desc) {
@@ -154,21 +310,29 @@ static sg_shader Renderer_MakePlatformNormalShader(sg_backend backend) {
 // ---------------------------------------------------------------------------
 void InitTextureManager(TextureManager& mgr) {
     mgr.textures.clear();
+    mgr.names.clear();
+    mgr.mapSerial = 0;
     mgr.activePackPath.clear();
+    TextureStreaming_Init(mgr.streamer, (size_t)std::max(TEXTURE_BUDGET_MB, 1) * 1024 * 1024);
+    CloseAssetPack(mgr.pack);
 }
 
-static TextureEntry MakeFallbackTexture(void) {
-    // 8×8 magenta/black checker – obvious "missing texture".
+// 8×8 magenta/black checker – obvious "missing texture".
+static const uint32_t* FallbackCheckerPixels(void) {
     static uint32_t pix[8*8];
     for (int y=0; y<8; ++y)
         for (int x=0; x<8; ++x)
             pix[y*8+x] = ((x^y)&1) ? 0xFF000000 : 0xFFFF00FF;
+    return pix;
+}
 
+static TextureEntry MakeFallbackTexture(void) {
+    const uint32_t* pix = FallbackCheckerPixels();
     sg_image_desc id = {};
     id.width  = 8;
     id.height = 8;
     id.pixel_format = SG_PIXELFORMAT_RGBA8;
-    id.data.mip_levels[0] = { pix, sizeof(pix) };
+    id.data.mip_levels[0] = { pix, 8 * 8 * sizeof(uint32_t) };
     id.label = "fallback-checker";
     sg_image img = sg_make_image(&id);
 
@@ -198,15 +362,159 @@ static bool ParseLightBrushTextureName(const std::string& name, uint8_t& r, uint
     return true;
 }
 
-static TextureEntry MakeSolidColorTexture(uint8_t r, uint8_t g, uint8_t b, const char* label) {
-    const uint8_t pixel[4] = { r, g, b, 255 };
+static std::string LooseTexturePath(const std::string& name) {
+    return "../../assets/textures/" + name + ".png";
+}
+
+// Maps the active pack the first time a texture needs it.
+static void OpenActivePack(TextureManager& mgr) {
+    if (mgr.activePackPath.empty() || mgr.pack.path == mgr.activePackPath) return;
+    if (!OpenAssetPack(mgr.pack, mgr.activePackPath)) {
+        mgr.pack.path = mgr.activePackPath;   // don't retry for every texture
+    }
+}
+
+// Content key of a texture read into memory: its format, level sizes and
+// pixels. Pack chains carry theirs (MipmapChainView::contentHash).
+static uint64_t HashTextureLevels(uint32_t format, std::span<const MipmapLevelView> levels) {
+    uint64_t hash = ContentHash(&format, sizeof(format));
+    for (const MipmapLevelView& level : levels) {
+        hash = ContentHash(&level.width, sizeof(level.width), hash);
+        hash = ContentHash(&level.height, sizeof(level.height), hash);
+        hash = ContentHash(level.pixels, level.size, hash);
+    }
+    return hash;
+}
 
+static void SetPixelsTexture(PreparedTexture& tex) {
+    const MipmapLevelView level = { tex.width, tex.height, tex.pixels.data(), tex.pixels.size() };
+    tex.kind = PREPARED_TEXTURE_PIXELS;
+    tex.contentHash = HashTextureLevels(TEXTURE_PIXEL_RGBA8, { &level, 1 });
+}
+
+// Reads and decodes `name` without touching sokol or `mgr`, so it can run
+// off the frame thread. Content `mgr` already holds, say from the previous
+// map, comes back RESIDENT without being decoded again.
+static PreparedTexture PrepareTexture(const TextureManager& mgr, const MapUploadCaps& caps, const std::string& name) {
+    PreparedTexture tex;
+    tex.name = name;
+    auto it = mgr.names.find(name);
+    if (it != mgr.names.end()) {
+        tex.kind = PREPARED_TEXTURE_RESIDENT;
+        tex.contentHash = it->second->contentHash;
+        // Streamed entries keep their chain, for TEXTURE_ARRAYS; the
+        // others are read again below for it.
+        const int id = it->second->streamId;
+        if (id >= 0 && id < (int)mgr.streamer.textures.size()) {
+            const StreamedTexture& streamed = mgr.streamer.textures[id];
+            tex.mips.format = streamed.format;
+            tex.mips.levels = streamed.levels;
+            tex.uploadFormat = streamed.uploadFormat;
+        }
+        if (!caps.arrays || !tex.mips.levels.empty()) {
+            return tex;
+        }
+    }
+
+    uint8_t lr = 0, lg = 0, lb = 0;
+    if (ParseLightBrushTextureName(name, lr, lg, lb)) {
+        tex.pixels = { lr, lg, lb, 255 };
+        tex.width = 1;
+        tex.height = 1;
+        SetPixelsTexture(tex);
+        if (mgr.textures.count(tex.contentHash)) {
+            tex.kind = PREPARED_TEXTURE_RESIDENT;
+        }
+        return tex;
+    }
+
+    // Pack textures stream: only their small mips are uploaded up front,
+    // straight from the mapped pack, and the streamer brings in the rest on
+    // demand. Legacy resources are copied out through rres and uploaded in
+    // full.
+    if (!mgr.activePackPath.empty()) {
+        const std::string logicalPath = "textures/" + name + ".png";
+        if (FindMipmappedAssetInPack(mgr.pack, logicalPath, tex.mips) && !tex.mips.levels.empty()) {
+            // Shared content keeps the chain, to rebind the streamer to this
+            // pack and for TEXTURE_ARRAYS.
+            tex.contentHash = tex.mips.contentHash;
+            tex.uploadFormat = Renderer_TextureUploadFormat(caps, tex.mips.format, name);
+            if (mgr.textures.count(tex.contentHash)) {
+                tex.kind = PREPARED_TEXTURE_RESIDENT;
+                return tex;
+            }
+            tex.kind = PREPARED_TEXTURE_STREAMED;
+            tex.resident = TextureStreaming_PrepareResident(tex.mips, tex.uploadFormat);
+            return tex;
+        }
+        tex.mips = MipmapChainView{};
+
+        if (LoadMipmappedAssetFromPack(mgr.activePackPath, logicalPath, tex.chain)) {
+            tex.mips.format = tex.chain.format;
+            for (const MipmapLevel& level : tex.chain.levels) {
+                tex.mips.levels.push_back({ level.width, level.height, level.pixels.data(), level.pixels.size() });
+            }
+        }
+        if (!tex.mips.levels.empty()) {
+            tex.contentHash = HashTextureLevels(tex.mips.format, tex.mips.levels);
+            if (mgr.textures.count(tex.contentHash)) {
+                tex.kind = PREPARED_TEXTURE_RESIDENT;
+                // TEXTURE_ARRAYS packs the levels again.
+                if (caps.arrays) {
+                    tex.uploadFormat = Renderer_TextureUploadFormat(caps, tex.mips.format, name);
+                } else {
+                    tex.mips = MipmapChainView{};
+                    tex.chain = MipmapChain{};
+                }
+                return tex;
+            }
+            const int numMips = std::min((int)tex.mips.levels.size(), (int)SG_MAX_MIPMAPS);
+            tex.mips.levels.resize(numMips);
+            tex.uploadFormat = Renderer_TextureUploadFormat(caps, tex.mips.format, name);
+            if (tex.uploadFormat == SG_PIXELFORMAT_RGBA8 && tex.mips.format != TEXTURE_PIXEL_RGBA8) {
+                tex.decoded.resize(numMips);
+                for (int m = 0; m < numMips; ++m) {
+                    MipmapLevelView& level = tex.mips.levels[m];
+                    if (!DecodeTextureLevelRGBA8(tex.mips.format, level.width, level.height,
+                                                 level.pixels, level.size, &tex.decoded[m])) {
+                        tex.decoded[m].assign((size_t)level.width * level.height * 4, 255);
+                    }
+                    level.pixels = tex.decoded[m].data();
+                    level.size = tex.decoded[m].size();
+                }
+                tex.mips.format = TEXTURE_PIXEL_RGBA8;
+            }
+            tex.kind = PREPARED_TEXTURE_MIPMAPPED;
+            return tex;
+        }
+    }
+
+    // Fallback: load single-level texture from filesystem (no mipmaps)
+    int w = 0, h = 0, comp = 0;
+    unsigned char* pixels = stbi_load(LooseTexturePath(name).c_str(), &w, &h, &comp, 4);
+    if (pixels) {
+        tex.pixels.assign(pixels, pixels + (size_t)w * h * 4);
+        tex.width = w;
+        tex.height = h;
+        stbi_image_free(pixels);
+        SetPixelsTexture(tex);
+        if (mgr.textures.count(tex.contentHash)) {
+            tex.kind = PREPARED_TEXTURE_RESIDENT;
+            if (!caps.arrays) {
+                tex.pixels.clear();
+            }
+        }
+    }
+    return tex;
+}
+
+static TextureEntry MakePixelsTexture(const PreparedTexture& tex) {
     sg_image_desc id = {};
-    id.width = 1;
-    id.height = 1;
+    id.width  = tex.width;
+    id.height = tex.height;
     id.pixel_format = SG_PIXELFORMAT_RGBA8;
-    id.data.mip_levels[0] = { pixel, sizeof(pixel) };
-    id.label = label;
+    id.data.mip_levels[0] = { tex.pixels.data(), tex.pixels.size() };
+    id.label = tex.name.c_str();
     sg_image img = sg_make_image(&id);
 
     sg_view_desc vd = {};
@@ -214,49 +522,64 @@ static TextureEntry MakeSolidColorTexture(uint8_t r, uint8_t g, uint8_t b, const
     sg_view view = sg_make_view(&vd);
 
     TextureEntry e;
-    e.image = img;
-    e.view = view;
-    e.width = 1;
-    e.height = 1;
+    e.image  = img;
+    e.view   = view;
+    e.width  = tex.width;
+    e.height = tex.height;
     return e;
 }
 
-const TextureEntry* LoadTextureByName(TextureManager& mgr, const std::string& name) {
-    auto it = mgr.textures.find(name);
-    if (it != mgr.textures.end()) return &it->second;
+// Gives the current map's `name` to `entry` and marks it used by this map.
+static const TextureEntry* AdoptTexture(TextureManager& mgr, const std::string& name, TextureEntry& entry) {
+    entry.mapSerial = mgr.mapSerial;
+    mgr.names[name] = &entry;
+    return &entry;
+}
 
-    uint8_t lr = 0, lg = 0, lb = 0;
-    if (ParseLightBrushTextureName(name, lr, lg, lb)) {
-        TextureEntry entry = MakeSolidColorTexture(lr, lg, lb, name.c_str());
-        Renderer_LogTextureState(name.c_str(), entry);
-        auto [ins, ok] = mgr.textures.emplace(name, entry);
-        (void)ok;
-        return &ins->second;
+// Makes the GPU side of a prepared texture and adds it to `mgr`; frame
+// thread only.
+static const TextureEntry* UploadPreparedTexture(TextureManager& mgr, PreparedTexture& tex) {
+    auto named = mgr.names.find(tex.name);
+    if (named != mgr.names.end()) return named->second;
+
+    const std::string& name = tex.name;
+    // The same pixels under another name, or from the previous map's pack.
+    // Nothing streams between maps, so the streamer can move to this pack.
+    auto shared = mgr.textures.find(tex.contentHash);
+    if (tex.kind != PREPARED_TEXTURE_MISSING && shared != mgr.textures.end()) {
+        if (shared->second.streamId >= 0 && !tex.mips.levels.empty()) {
+            TextureStreaming_Rebind(mgr.streamer, shared->second.streamId, name, tex.mips);
+        }
+        return AdoptTexture(mgr, name, shared->second);
     }
 
-    std::string path = "../../assets/textures/" + name + ".png";
-
     TextureEntry entry;
     bool loaded = false;
-
-    // Try loading mipmapped asset from pack
-    if (!mgr.activePackPath.empty()) {
-        MipmapChain mipChain;
-        if (LoadMipmappedAssetFromPack(mgr.activePackPath, "textures/" + name + ".png", mipChain) &&
-            !mipChain.levels.empty()) {
-            const int numMips = std::min((int)mipChain.levels.size(), (int)SG_MAX_MIPMAPS);
-            printf("[Renderer] Loaded mipmapped texture '%s': %dx%d, %d mip levels\n",
-                   name.c_str(), mipChain.levels[0].width, mipChain.levels[0].height, numMips);
+    switch (tex.kind) {
+        case PREPARED_TEXTURE_STREAMED: {
+            auto [ins, ok] = mgr.textures.emplace(tex.contentHash, TextureEntry{});
+            (void)ok;
+            TextureEntry& streamed = ins->second;
+            if (TextureStreaming_Register(mgr.streamer, name, &streamed, tex.mips, tex.uploadFormat, &tex.resident) >= 0) {
+                streamed.contentHash = tex.contentHash;
+                Renderer_LogTextureState(name.c_str(), streamed);
+                return AdoptTexture(mgr, name, streamed);
+            }
+            mgr.textures.erase(ins);
+            break;
+        }
+        case PREPARED_TEXTURE_MIPMAPPED: {
+            const int numMips = (int)tex.mips.levels.size();
+            printf("[Renderer] Loaded mipmapped texture '%s': %dx%d, %d mip levels, %s\n",
+                   name.c_str(), tex.mips.levels[0].width, tex.mips.levels[0].height, numMips,
+                   TexturePixelFormatName(tex.mips.format));
             sg_image_desc id = {};
-            id.width = mipChain.levels[0].width;
-            id.height = mipChain.levels[0].height;
+            id.width = tex.mips.levels[0].width;
+            id.height = tex.mips.levels[0].height;
             id.num_mipmaps = numMips;
-            id.pixel_format = SG_PIXELFORMAT_RGBA8;
+            id.pixel_format = tex.uploadFormat;
             for (int m = 0; m < numMips; ++m) {
-                id.data.mip_levels[m] = {
-                    mipChain.levels[m].pixels.data(),
-                    (size_t)(mipChain.levels[m].width * mipChain.levels[m].height * 4)
-                };
+                id.data.mip_levels[m] = { tex.mips.levels[m].pixels, tex.mips.levels[m].size };
             }
             id.label = name.c_str();
             sg_image img = sg_make_image(&id);
@@ -269,58 +592,98 @@ const TextureEntry* LoadTextureByName(TextureManager& mgr, const std::string& na
             entry.view = view;
             entry.width = id.width;
             entry.height = id.height;
-            Renderer_LogTextureState(name.c_str(), entry);
             loaded = true;
+            break;
         }
-    }
-
-    // Fallback: load single-level texture from filesystem (no mipmaps)
-    if (!loaded) {
-        int w = 0, h = 0, comp = 0;
-        unsigned char* pixels = stbi_load(path.c_str(), &w, &h, &comp, 4);
-        if (pixels) {
-            sg_image_desc id = {};
-            id.width  = w;
-            id.height = h;
-            id.pixel_format = SG_PIXELFORMAT_RGBA8;
-            id.data.mip_levels[0] = { pixels, (size_t)(w * h * 4) };
-            id.label = name.c_str();
-            sg_image img = sg_make_image(&id);
-            stbi_image_free(pixels);
-
-            sg_view_desc vd = {};
-            vd.texture.image = img;
-            sg_view view = sg_make_view(&vd);
-
-            entry.image  = img;
-            entry.view   = view;
-            entry.width  = w;
-            entry.height = h;
-            Renderer_LogTextureState(name.c_str(), entry);
+        case PREPARED_TEXTURE_PIXELS:
+            entry = MakePixelsTexture(tex);
             loaded = true;
-        }
+            break;
+        default:
+            break;
     }
 
-    if (!loaded) {
-        printf("[Renderer] Failed to load '%s' – using fallback.\n", path.c_str());
+    if (loaded) {
+        Renderer_LogTextureState(name.c_str(), entry);
+        entry.contentHash = tex.contentHash;
+    } else {
+        // Every missing texture shares the one checker, content hash 0.
+        printf("[Renderer] Failed to load '%s' – using fallback.\n", LooseTexturePath(name).c_str());
+        auto fallback = mgr.textures.find(0);
+        if (fallback != mgr.textures.end()) {
+            return AdoptTexture(mgr, name, fallback->second);
+        }
         entry = MakeFallbackTexture();
         Renderer_LogTextureState("fallback-checker", entry);
     }
 
-    auto [ins, ok] = mgr.textures.emplace(name, entry);
+    auto [ins, ok] = mgr.textures.emplace(entry.contentHash, entry);
     (void)ok;
-    return &ins->second;
+    return AdoptTexture(mgr, name, ins->second);
+}
+
+const TextureEntry* LoadTextureByName(TextureManager& mgr, const std::string& name) {
+    auto it = mgr.names.find(name);
+    if (it != mgr.names.end()) return it->second;
+
+    OpenActivePack(mgr);
+    PreparedTexture tex = PrepareTexture(mgr, Renderer_QueryUploadCaps(), name);
+    return UploadPreparedTexture(mgr, tex);
 }
 
 void UnloadAllTextures(TextureManager& mgr) {
+    TextureStreaming_Shutdown(mgr.streamer);
     for (auto& kv : mgr.textures) {
         sg_destroy_view (kv.second.view);
         sg_destroy_image(kv.second.image);
     }
     mgr.textures.clear();
+    mgr.names.clear();
+    CloseAssetPack(mgr.pack);
+}
+
+void BeginMapTextures(TextureManager& mgr) {
+    TextureStreaming_Flush(mgr.streamer);
+    mgr.names.clear();
+    ++mgr.mapSerial;
+}
+
+void DropUnusedTextures(TextureManager& mgr) {
+    size_t dropped = 0;
+    for (auto it = mgr.textures.begin(); it != mgr.textures.end();) {
+        TextureEntry& entry = it->second;
+        if (entry.mapSerial == mgr.mapSerial) {
+            ++it;
+            continue;
+        }
+        TextureStreaming_Remove(mgr.streamer, entry.streamId);
+        sg_destroy_view(entry.view);
+        sg_destroy_image(entry.image);
+        it = mgr.textures.erase(it);
+        ++dropped;
+    }
+    printf("[Renderer] %zu textures in use, %zu dropped with the previous map.\n", mgr.textures.size(), dropped);
 }
 
 static void Renderer_DestroyScenePostTargets(void) {
+    if (g_normalDepthResolveAttView.id) {
+        sg_destroy_view(g_normalDepthResolveAttView);
+    }
+    if (g_normalResolveAttView.id) {
+        sg_destroy_view(g_normalResolveAttView);
+    }
+    if (g_sceneNormalDepthColorAttView.id) {
+        sg_destroy_view(g_sceneNormalDepthColorAttView);
+    }
+    if (g_sceneNormalColorAttView.id) {
+        sg_destroy_view(g_sceneNormalColorAttView);
+    }
+    if (g_sceneNormalDepthColor.id) {
+        sg_destroy_image(g_sceneNormalDepthColor);
+    }
+    if (g_sceneNormalColor.id) {
+        sg_destroy_image(g_sceneNormalColor);
+    }
     if (g_sceneTextureView.id) {
         sg_destroy_view(g_sceneTextureView);
     }
@@ -382,11 +745,36 @@ static void Renderer_DestroyScenePostTargets(void) {
     g_normalDepthColor = {};
     g_normalDepth = {};
     g_normalColor = {};
+    g_normalDepthResolveAttView = {};
+    g_normalResolveAttView = {};
+    g_sceneNormalDepthColorAttView = {};
+    g_sceneNormalColorAttView = {};
+    g_sceneNormalDepthColor = {};
+    g_sceneNormalColor = {};
+    g_sceneWritesNormals = false;
     g_sceneWidth = 0;
     g_sceneHeight = 0;
     g_sceneSampleCount = 0;
 }
 
+// The MRT pipelines are made for the swapchain's sample count, and the view
+// distances need a renderable R16F, multisampled for a multisampled scene. With
+// array pipelines ready, the array variants must have been made too.
+static bool Renderer_SceneCanWriteNormals(int sampleCount) {
+    if (sg_query_pipeline_state(g_mapMrtPipeline) != SG_RESOURCESTATE_VALID ||
+        sg_query_pipeline_state(g_compactMapMrtPipeline) != SG_RESOURCESTATE_VALID ||
+        sampleCount != g_mapMrtSampleCount) {
+        return false;
+    }
+    if (Renderer_TextureArraysReady() &&
+        (sg_query_pipeline_state(g_mapArrayMrtPipeline) != SG_RESOURCESTATE_VALID ||
+         sg_query_pipeline_state(g_compactMapArrayMrtPipeline) != SG_RESOURCESTATE_VALID)) {
+        return false;
+    }
+    const sg_pixelformat_info r16f = sg_query_pixelformat(SG_PIXELFORMAT_R16F);
+    return r16f.render && (sampleCount <= 1 || r16f.msaa);
+}
+
 static bool Renderer_EnsureScenePostTargets(int width, int height, int sampleCount) {
     if (width <= 0 || height <= 0) {
         return false;
@@ -457,8 +845,15 @@ static bool Renderer_EnsureScenePostTargets(int width, int height, int sampleCou
     textureViewDesc.label = "scene-post-texture-view";
     g_sceneTextureView = sg_make_view(&textureViewDesc);
 
+    // With the MRT pipeline the scene pass writes the normal targets too,
+    // through multisampled attachments resolved into them when the scene
+    // is multisampled; otherwise the normal pass draws them on its own.
+    const bool writeNormals = Renderer_SceneCanWriteNormals(sampleCount);
+    const bool resolveNormals = writeNormals && sampleCount > 1;
+
     sg_image_desc normalColorDesc = {};
-    normalColorDesc.usage.color_attachment = true;
+    normalColorDesc.usage.color_attachment = !resolveNormals;
+    normalColorDesc.usage.resolve_attachment = resolveNormals;
     normalColorDesc.width = width;
     normalColorDesc.height = height;
     normalColorDesc.pixel_format = env.defaults.color_format;
@@ -467,7 +862,8 @@ static bool Renderer_EnsureScenePostTargets(int width, int height, int sampleCou
     g_normalColor = sg_make_image(&normalColorDesc);
 
     sg_image_desc normalDepthColorDesc = {};
-    normalDepthColorDesc.usage.color_attachment = true;
+    normalDepthColorDesc.usage.color_attachment = !resolveNormals;
+    normalDepthColorDesc.usage.resolve_attachment = resolveNormals;
     normalDepthColorDesc.width = width;
     normalDepthColorDesc.height = height;
     normalDepthColorDesc.pixel_format = SG_PIXELFORMAT_R16F;
@@ -475,29 +871,68 @@ static bool Renderer_EnsureScenePostTargets(int width, int height, int sampleCou
     normalDepthColorDesc.label = "normal-depth-color";
     g_normalDepthColor = sg_make_image(&normalDepthColorDesc);
 
-    sg_image_desc normalDepthDesc = {};
-    normalDepthDesc.usage.depth_stencil_attachment = true;
-    normalDepthDesc.width = width;
-    normalDepthDesc.height = height;
-    normalDepthDesc.pixel_format = env.defaults.depth_format;
-    normalDepthDesc.sample_count = 1;
-    normalDepthDesc.label = "normal-post-depth";
-    g_normalDepth = sg_make_image(&normalDepthDesc);
-
-    sg_view_desc normalColorViewDesc = {};
-    normalColorViewDesc.color_attachment.image = g_normalColor;
-    normalColorViewDesc.label = "normal-post-color-view";
-    g_normalColorAttView = sg_make_view(&normalColorViewDesc);
-
-    sg_view_desc normalDepthColorViewDesc = {};
-    normalDepthColorViewDesc.color_attachment.image = g_normalDepthColor;
-    normalDepthColorViewDesc.label = "normal-depth-color-view";
-    g_normalDepthColorAttView = sg_make_view(&normalDepthColorViewDesc);
-
-    sg_view_desc normalDepthViewDesc = {};
-    normalDepthViewDesc.depth_stencil_attachment.image = g_normalDepth;
-    normalDepthViewDesc.label = "normal-post-depth-view";
-    g_normalDepthAttView = sg_make_view(&normalDepthViewDesc);
+    if (resolveNormals) {
+        sg_image_desc sceneNormalDesc = normalColorDesc;
+        sceneNormalDesc.usage = {};
+        sceneNormalDesc.usage.color_attachment = true;
+        sceneNormalDesc.sample_count = sampleCount;
+        sceneNormalDesc.label = "scene-post-normal";
+        g_sceneNormalColor = sg_make_image(&sceneNormalDesc);
+
+        sg_image_desc sceneNormalDepthDesc = normalDepthColorDesc;
+        sceneNormalDepthDesc.usage = {};
+        sceneNormalDepthDesc.usage.color_attachment = true;
+        sceneNormalDepthDesc.sample_count = sampleCount;
+        sceneNormalDepthDesc.label = "scene-post-normal-depth";
+        g_sceneNormalDepthColor = sg_make_image(&sceneNormalDepthDesc);
+
+        sg_view_desc sceneNormalViewDesc = {};
+        sceneNormalViewDesc.color_attachment.image = g_sceneNormalColor;
+        sceneNormalViewDesc.label = "scene-post-normal-view";
+        g_sceneNormalColorAttView = sg_make_view(&sceneNormalViewDesc);
+
+        sg_view_desc sceneNormalDepthViewDesc = {};
+        sceneNormalDepthViewDesc.color_attachment.image = g_sceneNormalDepthColor;
+        sceneNormalDepthViewDesc.label = "scene-post-normal-depth-view";
+        g_sceneNormalDepthColorAttView = sg_make_view(&sceneNormalDepthViewDesc);
+
+        sg_view_desc normalResolveViewDesc = {};
+        normalResolveViewDesc.resolve_attachment.image = g_normalColor;
+        normalResolveViewDesc.label = "normal-post-resolve-view";
+        g_normalResolveAttView = sg_make_view(&normalResolveViewDesc);
+
+        sg_view_desc normalDepthResolveViewDesc = {};
+        normalDepthResolveViewDesc.resolve_attachment.image = g_normalDepthColor;
+        normalDepthResolveViewDesc.label = "normal-depth-resolve-view";
+        g_normalDepthResolveAttView = sg_make_view(&normalDepthResolveViewDesc);
+    } else {
+        sg_view_desc normalColorViewDesc = {};
+        normalColorViewDesc.color_attachment.image = g_normalColor;
+        normalColorViewDesc.label = "normal-post-color-view";
+        g_normalColorAttView = sg_make_view(&normalColorViewDesc);
+
+        sg_view_desc normalDepthColorViewDesc = {};
+        normalDepthColorViewDesc.color_attachment.image = g_normalDepthColor;
+        normalDepthColorViewDesc.label = "normal-depth-color-view";
+        g_normalDepthColorAttView = sg_make_view(&normalDepthColorViewDesc);
+    }
+
+    // The MRT scene pass shares the scene's depth buffer.
+    if (!writeNormals) {
+        sg_image_desc normalDepthDesc = {};
+        normalDepthDesc.usage.depth_stencil_attachment = true;
+        normalDepthDesc.width = width;
+        normalDepthDesc.height = height;
+        normalDepthDesc.pixel_format = env.defaults.depth_format;
+        normalDepthDesc.sample_count = 1;
+        normalDepthDesc.label = "normal-post-depth";
+        g_normalDepth = sg_make_image(&normalDepthDesc);
+
+        sg_view_desc normalDepthViewDesc = {};
+        normalDepthViewDesc.depth_stencil_attachment.image = g_normalDepth;
+        normalDepthViewDesc.label = "normal-post-depth-view";
+        g_normalDepthAttView = sg_make_view(&normalDepthViewDesc);
+    }
 
     sg_view_desc normalTextureViewDesc = {};
     normalTextureViewDesc.texture.image = g_normalColor;
@@ -509,18 +944,24 @@ static bool Renderer_EnsureScenePostTargets(int width, int height, int sampleCou
     normalDepthTextureViewDesc.label = "normal-depth-texture-view";
     g_normalDepthTextureView = sg_make_view(&normalDepthTextureViewDesc);
 
+    const bool normalAttachmentsOk = resolveNormals
+        ? (sg_query_view_state(g_sceneNormalColorAttView) == SG_RESOURCESTATE_VALID) &&
+          (sg_query_view_state(g_sceneNormalDepthColorAttView) == SG_RESOURCESTATE_VALID) &&
+          (sg_query_view_state(g_normalResolveAttView) == SG_RESOURCESTATE_VALID) &&
+          (sg_query_view_state(g_normalDepthResolveAttView) == SG_RESOURCESTATE_VALID)
+        : (sg_query_view_state(g_normalColorAttView) == SG_RESOURCESTATE_VALID) &&
+          (sg_query_view_state(g_normalDepthColorAttView) == SG_RESOURCESTATE_VALID);
     const bool ok =
         (sg_query_image_state(g_sceneColor) == SG_RESOURCESTATE_VALID) &&
         (sg_query_image_state(g_sceneDepth) == SG_RESOURCESTATE_VALID) &&
         (sg_query_image_state(g_normalColor) == SG_RESOURCESTATE_VALID) &&
         (sg_query_image_state(g_normalDepthColor) == SG_RESOURCESTATE_VALID) &&
-        (sg_query_image_state(g_normalDepth) == SG_RESOURCESTATE_VALID) &&
+        (writeNormals || sg_query_image_state(g_normalDepth) == SG_RESOURCESTATE_VALID) &&
         (sampleCount <= 1 || sg_query_image_state(g_sceneResolve) == SG_RESOURCESTATE_VALID) &&
         (sg_query_view_state(g_sceneColorAttView) == SG_RESOURCESTATE_VALID) &&
         (sg_query_view_state(g_sceneDepthAttView) == SG_RESOURCESTATE_VALID) &&
-        (sg_query_view_state(g_normalColorAttView) == SG_RESOURCESTATE_VALID) &&
-        (sg_query_view_state(g_normalDepthColorAttView) == SG_RESOURCESTATE_VALID) &&
-        (sg_query_view_state(g_normalDepthAttView) == SG_RESOURCESTATE_VALID) &&
+        normalAttachmentsOk &&
+        (writeNormals || sg_query_view_state(g_normalDepthAttView) == SG_RESOURCESTATE_VALID) &&
         (sg_query_view_state(g_normalTextureView) == SG_RESOURCESTATE_VALID) &&
         (sg_query_view_state(g_normalDepthTextureView) == SG_RESOURCESTATE_VALID) &&
         (sampleCount <= 1 || sg_query_view_state(g_sceneResolveAttView) == SG_RESOURCESTATE_VALID) &&
@@ -542,9 +983,62 @@ static bool Renderer_EnsureScenePostTargets(int width, int height, int sampleCou
     g_sceneWidth = width;
     g_sceneHeight = height;
     g_sceneSampleCount = sampleCount;
+    g_sceneWritesNormals = writeNormals;
     return true;
 }
 
+// Vertex layout for either map vertex format. Pass -1 for attributes the
+// shader does not declare.
+static void Renderer_SetMapVertexLayout(sg_vertex_layout_state& layout,
+                                        MapVertexFormat format,
+                                        int posAttr,
+                                        int nrmAttr,
+                                        int uvAttr,
+                                        int lmuvAttr)
+{
+    if (format == MAP_VERTEX_FORMAT_COMPACT) {
+        layout.buffers[0].stride = sizeof(BSPVertexCompact);
+        layout.attrs[posAttr].format = SG_VERTEXFORMAT_FLOAT3;
+        layout.attrs[posAttr].offset = offsetof(BSPVertexCompact, x);
+        layout.attrs[nrmAttr].format = SG_VERTEXFORMAT_BYTE4N;
+        layout.attrs[nrmAttr].offset = offsetof(BSPVertexCompact, nx);
+        if (uvAttr >= 0) {
+            layout.attrs[uvAttr].format = SG_VERTEXFORMAT_HALF2;
+            layout.attrs[uvAttr].offset = offsetof(BSPVertexCompact, u);
+        }
+        if (lmuvAttr >= 0) {
+            layout.attrs[lmuvAttr].format = SG_VERTEXFORMAT_USHORT2N;
+            layout.attrs[lmuvAttr].offset = offsetof(BSPVertexCompact, lu);
+        }
+        return;
+    }
+    layout.buffers[0].stride = sizeof(MapVertex);
+    layout.attrs[posAttr].format = SG_VERTEXFORMAT_FLOAT3;
+    layout.attrs[posAttr].offset = offsetof(MapVertex, x);
+    layout.attrs[nrmAttr].format = SG_VERTEXFORMAT_FLOAT3;
+    layout.attrs[nrmAttr].offset = offsetof(MapVertex, nx);
+    if (uvAttr >= 0) {
+        layout.attrs[uvAttr].format = SG_VERTEXFORMAT_FLOAT2;
+        layout.attrs[uvAttr].offset = offsetof(MapVertex, u);
+    }
+    if (lmuvAttr >= 0) {
+        layout.attrs[lmuvAttr].format = SG_VERTEXFORMAT_FLOAT2;
+        layout.attrs[lmuvAttr].offset = offsetof(MapVertex, lu);
+    }
+}
+
+#if WARPED_MAP_ARRAY_SHADER
+// The array pipelines' second vertex buffer: MapModel::layerBuf, four
+// normalized uint16 per vertex.
+static void Renderer_SetMapLayerLayout(sg_vertex_layout_state& layout, int layersAttr)
+{
+    layout.buffers[1].stride = 4 * sizeof(uint16_t);
+    layout.attrs[layersAttr].buffer_index = 1;
+    layout.attrs[layersAttr].format = SG_VERTEXFORMAT_USHORT4N;
+    layout.attrs[layersAttr].offset = 0;
+}
+#endif
+
 static void Renderer_InitPencilPostProcess(sg_backend backend) {
     sg_sampler_desc sceneSamplerDesc = {};
     sceneSamplerDesc.min_filter = SG_FILTER_LINEAR;
@@ -615,11 +1109,9 @@ static void Renderer_InitPencilPostProcess(sg_backend backend) {
     sg_pipeline_desc npd = {};
     npd.label = "normal-post-pipeline";
     npd.shader = g_normalShader;
-    npd.layout.buffers[0].stride = sizeof(MapVertex);
-    npd.layout.attrs[ATTR_warped_normal_shader_normal_pass_a_pos].format = SG_VERTEXFORMAT_FLOAT3;
-    npd.layout.attrs[ATTR_warped_normal_shader_normal_pass_a_pos].offset = offsetof(MapVertex, x);
-    npd.layout.attrs[ATTR_warped_normal_shader_normal_pass_a_nrm].format = SG_VERTEXFORMAT_FLOAT3;
-    npd.layout.attrs[ATTR_warped_normal_shader_normal_pass_a_nrm].offset = offsetof(MapVertex, nx);
+    Renderer_SetMapVertexLayout(npd.layout, MAP_VERTEX_FORMAT_FULL,
+                                ATTR_warped_normal_shader_normal_pass_a_pos,
+                                ATTR_warped_normal_shader_normal_pass_a_nrm, -1, -1);
     npd.index_type = SG_INDEXTYPE_UINT32;
     npd.cull_mode = SG_CULLMODE_BACK;
     npd.face_winding = SG_FACEWINDING_CCW;
@@ -633,8 +1125,103 @@ static void Renderer_InitPencilPostProcess(sg_backend backend) {
     npd.primitive_type = SG_PRIMITIVETYPE_TRIANGLES;
     g_normalPipeline = sg_make_pipeline(&npd);
 
+    npd.label = "normal-post-compact-pipeline";
+    npd.layout = {};
+    Renderer_SetMapVertexLayout(npd.layout, MAP_VERTEX_FORMAT_COMPACT,
+                                ATTR_warped_normal_shader_normal_pass_a_pos,
+                                ATTR_warped_normal_shader_normal_pass_a_nrm, -1, -1);
+    g_compactNormalPipeline = sg_make_pipeline(&npd);
+
     printf("[Renderer] Normal post pipeline state: %s\n",
            RendererResourceStateName(sg_query_pipeline_state(g_normalPipeline)));
+
+    if (getenv("WARPED_SEPARATE_NORMAL_PASS")) {
+        printf("[Renderer] WARPED_SEPARATE_NORMAL_PASS set; drawing normals in their own pass.\n");
+        return;
+    }
+#if WARPED_MAP_MRT_SHADER
+    g_mapMrtShader = Renderer_MakePlatformMapMrtShader(backend);
+    if (!g_mapMrtShader.id) {
+        printf("[Renderer] Failed to create map MRT shader for backend %s; drawing normals in their own pass.\n",
+               RendererBackendName(backend));
+        return;
+    }
+
+    sg_pipeline_desc mpd = {};
+    mpd.label = "map-mrt-pipeline";
+    mpd.shader = g_mapMrtShader;
+    Renderer_SetMapVertexLayout(mpd.layout, MAP_VERTEX_FORMAT_FULL,
+                                ATTR_warped_map_shader_map_mrt_a_pos,
+                                ATTR_warped_map_shader_map_mrt_a_nrm,
+                                ATTR_warped_map_shader_map_mrt_a_uv,
+                                ATTR_warped_map_shader_map_mrt_a_lmuv);
+    mpd.index_type = SG_INDEXTYPE_UINT32;
+    mpd.cull_mode = SG_CULLMODE_BACK;
+    mpd.face_winding = SG_FACEWINDING_CCW;
+    mpd.color_count = 3;
+    mpd.colors[0].pixel_format = env.defaults.color_format;
+    mpd.colors[1].pixel_format = env.defaults.color_format;
+    mpd.colors[2].pixel_format = SG_PIXELFORMAT_R16F;
+    mpd.depth.pixel_format = env.defaults.depth_format;
+    mpd.depth.compare = SG_COMPAREFUNC_LESS_EQUAL;
+    mpd.depth.write_enabled = true;
+    mpd.sample_count = env.defaults.sample_count;
+    mpd.primitive_type = SG_PRIMITIVETYPE_TRIANGLES;
+    g_mapMrtPipeline = sg_make_pipeline(&mpd);
+
+    mpd.label = "map-mrt-compact-pipeline";
+    mpd.layout = {};
+    Renderer_SetMapVertexLayout(mpd.layout, MAP_VERTEX_FORMAT_COMPACT,
+                                ATTR_warped_map_shader_map_mrt_a_pos,
+                                ATTR_warped_map_shader_map_mrt_a_nrm,
+                                ATTR_warped_map_shader_map_mrt_a_uv,
+                                ATTR_warped_map_shader_map_mrt_a_lmuv);
+    g_compactMapMrtPipeline = sg_make_pipeline(&mpd);
+    g_mapMrtSampleCount = std::max(1, env.defaults.sample_count);
+
+    printf("[Renderer] Map MRT pipeline state: %s\n",
+           RendererResourceStateName(sg_query_pipeline_state(g_mapMrtPipeline)));
+    if (sg_query_pipeline_state(g_mapMrtPipeline) != SG_RESOURCESTATE_VALID ||
+        !sg_query_pixelformat(SG_PIXELFORMAT_R16F).render) {
+        printf("[Renderer] Backend %s cannot draw the MRT scene pass; drawing normals in their own pass.\n",
+               RendererBackendName(backend));
+        return;
+    }
+
+#if WARPED_MAP_ARRAY_SHADER
+    if (!TEXTURE_ARRAYS) {
+        return;
+    }
+    g_mapArrayMrtShader = Renderer_MakePlatformMapArrayMrtShader(backend);
+    if (!g_mapArrayMrtShader.id) {
+        printf("[Renderer] Failed to create map array MRT shader for backend %s; drawing normals in their own pass.\n",
+               RendererBackendName(backend));
+        return;
+    }
+    mpd.label = "map-array-mrt-pipeline";
+    mpd.shader = g_mapArrayMrtShader;
+    mpd.layout = {};
+    Renderer_SetMapVertexLayout(mpd.layout, MAP_VERTEX_FORMAT_FULL,
+                                ATTR_warped_map_shader_map_array_mrt_a_pos,
+                                ATTR_warped_map_shader_map_array_mrt_a_nrm,
+                                ATTR_warped_map_shader_map_array_mrt_a_uv,
+                                ATTR_warped_map_shader_map_array_mrt_a_lmuv);
+    Renderer_SetMapLayerLayout(mpd.layout, ATTR_warped_map_shader_map_array_mrt_a_layers);
+    g_mapArrayMrtPipeline = sg_make_pipeline(&mpd);
+
+    mpd.label = "map-array-mrt-compact-pipeline";
+    mpd.layout = {};
+    Renderer_SetMapVertexLayout(mpd.layout, MAP_VERTEX_FORMAT_COMPACT,
+                                ATTR_warped_map_shader_map_array_mrt_a_pos,
+                                ATTR_warped_map_shader_map_array_mrt_a_nrm,
+                                ATTR_warped_map_shader_map_array_mrt_a_uv,
+                                ATTR_warped_map_shader_map_array_mrt_a_lmuv);
+    Renderer_SetMapLayerLayout(mpd.layout, ATTR_warped_map_shader_map_array_mrt_a_layers);
+    g_compactMapArrayMrtPipeline = sg_make_pipeline(&mpd);
+#endif
+#else
+    printf("[Renderer] map.metal_dx11.h predates the map_mrt program; drawing normals in their own pass.\n");
+#endif
 }
 
 static void Renderer_DestroyPencilPostProcess(void) {
@@ -652,9 +1239,30 @@ static void Renderer_DestroyPencilPostProcess(void) {
     if (g_normalPipeline.id) {
         sg_destroy_pipeline(g_normalPipeline);
     }
+    if (g_compactNormalPipeline.id) {
+        sg_destroy_pipeline(g_compactNormalPipeline);
+    }
     if (g_normalShader.id) {
         sg_destroy_shader(g_normalShader);
     }
+    if (g_mapMrtPipeline.id) {
+        sg_destroy_pipeline(g_mapMrtPipeline);
+    }
+    if (g_compactMapMrtPipeline.id) {
+        sg_destroy_pipeline(g_compactMapMrtPipeline);
+    }
+    if (g_mapMrtShader.id) {
+        sg_destroy_shader(g_mapMrtShader);
+    }
+    if (g_mapArrayMrtPipeline.id) {
+        sg_destroy_pipeline(g_mapArrayMrtPipeline);
+    }
+    if (g_compactMapArrayMrtPipeline.id) {
+        sg_destroy_pipeline(g_compactMapArrayMrtPipeline);
+    }
+    if (g_mapArrayMrtShader.id) {
+        sg_destroy_shader(g_mapArrayMrtShader);
+    }
     if (g_postSceneSampler.id) {
         sg_destroy_sampler(g_postSceneSampler);
     }
@@ -666,7 +1274,15 @@ static void Renderer_DestroyPencilPostProcess(void) {
     g_pencilShader = {};
     g_pencilVertexBuffer = {};
     g_normalPipeline = {};
+    g_compactNormalPipeline = {};
     g_normalShader = {};
+    g_mapMrtPipeline = {};
+    g_compactMapMrtPipeline = {};
+    g_mapMrtShader = {};
+    g_mapMrtSampleCount = 0;
+    g_mapArrayMrtPipeline = {};
+    g_compactMapArrayMrtPipeline = {};
+    g_mapArrayMrtShader = {};
     g_postSceneSampler = {};
     g_postNormalSampler = {};
 }
@@ -675,7 +1291,7 @@ static void Renderer_DestroyPencilPostProcess(void) {
 //  Renderer init / shutdown
 // ---------------------------------------------------------------------------
 void Renderer_Init(void) {
-    sg_backend backend = sg_query_backend();
+    sg_backend backend = RendererShaderDescBackend(sg_query_backend());
 
     /*
     sg_pixel_format
@@ -752,6 +1368,12 @@ void Renderer_Init(void) {
     g_whiteLm = sg_make_image(&wid);
     sg_view_desc wvd = {}; wvd.texture.image = g_whiteLm;
     g_whiteLmV = sg_make_view(&wvd);
+    wid.type = SG_IMAGETYPE_ARRAY;
+    wid.num_slices = 1;
+    wid.label = "array-white";
+    g_whiteArray = sg_make_image(&wid);
+    wvd.texture.image = g_whiteArray;
+    g_whiteArrayV = sg_make_view(&wvd);
 
     // --- shader ---------------------------------------------------------
     g_shader = Renderer_MakePlatformMapShader(backend);
@@ -768,15 +1390,11 @@ void Renderer_Init(void) {
     pd.label  = "map-pipeline";
     pd.shader = g_shader;
 
-    pd.layout.buffers[0].stride = sizeof(MapVertex);
-    pd.layout.attrs[ATTR_warped_map_shader_map_a_pos].format  = SG_VERTEXFORMAT_FLOAT3;
-    pd.layout.attrs[ATTR_warped_map_shader_map_a_pos].offset  = offsetof(MapVertex, x);
-    pd.layout.attrs[ATTR_warped_map_shader_map_a_nrm].format  = SG_VERTEXFORMAT_FLOAT3;
-    pd.layout.attrs[ATTR_warped_map_shader_map_a_nrm].offset  = offsetof(MapVertex, nx);
-    pd.layout.attrs[ATTR_warped_map_shader_map_a_uv].format   = SG_VERTEXFORMAT_FLOAT2;
-    pd.layout.attrs[ATTR_warped_map_shader_map_a_uv].offset   = offsetof(MapVertex, u);
-    pd.layout.attrs[ATTR_warped_map_shader_map_a_lmuv].format = SG_VERTEXFORMAT_FLOAT2;
-    pd.layout.attrs[ATTR_warped_map_shader_map_a_lmuv].offset = offsetof(MapVertex, lu);
+    Renderer_SetMapVertexLayout(pd.layout, MAP_VERTEX_FORMAT_FULL,
+                                ATTR_warped_map_shader_map_a_pos,
+                                ATTR_warped_map_shader_map_a_nrm,
+                                ATTR_warped_map_shader_map_a_uv,
+                                ATTR_warped_map_shader_map_a_lmuv);
 
     pd.index_type           = SG_INDEXTYPE_UINT32;
     pd.cull_mode            = SG_CULLMODE_BACK;
@@ -788,19 +1406,68 @@ void Renderer_Init(void) {
     printf("[Renderer] Pipeline state: %s\n",
            RendererResourceStateName(sg_query_pipeline_state(g_pipeline)));
 
+    pd.label  = "map-compact-pipeline";
+    pd.layout = {};
+    Renderer_SetMapVertexLayout(pd.layout, MAP_VERTEX_FORMAT_COMPACT,
+                                ATTR_warped_map_shader_map_a_pos,
+                                ATTR_warped_map_shader_map_a_nrm,
+                                ATTR_warped_map_shader_map_a_uv,
+                                ATTR_warped_map_shader_map_a_lmuv);
+    g_compactPipeline = sg_make_pipeline(&pd);
+
+    // --- texture-array pipelines (TEXTURE_ARRAYS) -------------------------
+    if (TEXTURE_ARRAYS) {
+#if WARPED_MAP_ARRAY_SHADER
+        g_arrayShader = Renderer_MakePlatformMapArrayShader(backend);
+        if (g_arrayShader.id) {
+            pd.label  = "map-array-pipeline";
+            pd.shader = g_arrayShader;
+            pd.layout = {};
+            Renderer_SetMapVertexLayout(pd.layout, MAP_VERTEX_FORMAT_FULL,
+                                        ATTR_warped_map_shader_map_array_a_pos,
+                                        ATTR_warped_map_shader_map_array_a_nrm,
+                                        ATTR_warped_map_shader_map_array_a_uv,
+                                        ATTR_warped_map_shader_map_array_a_lmuv);
+            Renderer_SetMapLayerLayout(pd.layout, ATTR_warped_map_shader_map_array_a_layers);
+            g_arrayPipeline = sg_make_pipeline(&pd);
+
+            pd.label  = "map-array-compact-pipeline";
+            pd.layout = {};
+            Renderer_SetMapVertexLayout(pd.layout, MAP_VERTEX_FORMAT_COMPACT,
+                                        ATTR_warped_map_shader_map_array_a_pos,
+                                        ATTR_warped_map_shader_map_array_a_nrm,
+                                        ATTR_warped_map_shader_map_array_a_uv,
+                                        ATTR_warped_map_shader_map_array_a_lmuv);
+            Renderer_SetMapLayerLayout(pd.layout, ATTR_warped_map_shader_map_array_a_layers);
+            g_compactArrayPipeline = sg_make_pipeline(&pd);
+        }
+        printf("[Renderer] Array pipeline state: %s\n",
+               RendererResourceStateName(sg_query_pipeline_state(g_arrayPipeline)));
+#else
+        printf("[Renderer] map.metal_dx11.h predates the map_array program; drawing without texture arrays.\n");
+#endif
+    }
+
     Renderer_InitPencilPostProcess(backend);
 }
 
 void Renderer_Shutdown(void) {
     Renderer_DestroyPencilPostProcess();
     if (g_pipeline.id)  sg_destroy_pipeline(g_pipeline);
+    if (g_compactPipeline.id) sg_destroy_pipeline(g_compactPipeline);
     if (g_shader.id)    sg_destroy_shader(g_shader);
+    if (g_arrayPipeline.id) sg_destroy_pipeline(g_arrayPipeline);
+    if (g_compactArrayPipeline.id) sg_destroy_pipeline(g_compactArrayPipeline);
+    if (g_arrayShader.id) sg_destroy_shader(g_arrayShader);
     if (g_sampler.id)   sg_destroy_sampler(g_sampler);
     if (g_lmSampler.id) sg_destroy_sampler(g_lmSampler);
     if (g_whiteLmV.id)  sg_destroy_view(g_whiteLmV);
     if (g_whiteLm.id)   sg_destroy_image(g_whiteLm);
-    g_pipeline = {}; g_shader = {}; g_sampler = {};
-    g_lmSampler = {}; g_whiteLm = {}; g_whiteLmV = {};
+    if (g_whiteArrayV.id) sg_destroy_view(g_whiteArrayV);
+    if (g_whiteArray.id)  sg_destroy_image(g_whiteArray);
+    g_pipeline = {}; g_compactPipeline = {}; g_shader = {}; g_sampler = {};
+    g_arrayPipeline = {}; g_compactArrayPipeline = {}; g_arrayShader = {};
+    g_lmSampler = {}; g_whiteLm = {}; g_whiteLmV = {}; g_whiteArray = {}; g_whiteArrayV = {};
 }
 
 sg_sampler Renderer_DefaultSampler(void) { return g_sampler; }
@@ -813,6 +1480,15 @@ bool Renderer_PencilPostProcessReady(void) {
            (sg_query_sampler_state(g_postNormalSampler) == SG_RESOURCESTATE_VALID);
 }
 
+// Clears the normal target at colour attachment `first` and the view
+// distance target after it, in whichever pass writes them.
+static void Renderer_SetNormalClear(sg_pass_action& action, int first) {
+    action.colors[first].load_action = SG_LOADACTION_CLEAR;
+    action.colors[first].clear_value = { 0.5f, 0.5f, 1.0f, 0.0f };
+    action.colors[first + 1].load_action = SG_LOADACTION_CLEAR;
+    action.colors[first + 1].clear_value = { 0.0f, 0.0f, 0.0f, 0.0f };
+}
+
 bool Renderer_BeginScenePostPass(const sg_pass_action& action,
                                  int width,
                                  int height,
@@ -831,12 +1507,28 @@ bool Renderer_BeginScenePostPass(const sg_pass_action& action,
     if (g_sceneResolveAttView.id) {
         pass.attachments.resolves[0] = g_sceneResolveAttView;
     }
+    if (g_sceneWritesNormals) {
+        Renderer_SetNormalClear(pass.action, 1);
+        if (g_normalResolveAttView.id) {
+            pass.attachments.colors[1] = g_sceneNormalColorAttView;
+            pass.attachments.colors[2] = g_sceneNormalDepthColorAttView;
+            pass.attachments.resolves[1] = g_normalResolveAttView;
+            pass.attachments.resolves[2] = g_normalDepthResolveAttView;
+        } else {
+            pass.attachments.colors[1] = g_normalColorAttView;
+            pass.attachments.colors[2] = g_normalDepthColorAttView;
+        }
+    }
     pass.attachments.depth_stencil = g_sceneDepthAttView;
     pass.label = "scene-post-pass";
     sg_begin_pass(&pass);
     return true;
 }
 
+bool Renderer_ScenePostPassWritesNormals(void) {
+    return g_sceneWritesNormals;
+}
+
 void Renderer_EndScenePostPass(void) {
     sg_end_pass();
 }
@@ -854,10 +1546,7 @@ bool Renderer_BeginNormalPostPass(int width, int height) {
     }
 
     sg_pass_action action = {};
-    action.colors[0].load_action = SG_LOADACTION_CLEAR;
-    action.colors[0].clear_value = { 0.5f, 0.5f, 1.0f, 0.0f };
-    action.colors[1].load_action = SG_LOADACTION_CLEAR;
-    action.colors[1].clear_value = { 0.0f, 0.0f, 0.0f, 0.0f };
+    Renderer_SetNormalClear(action, 0);
     action.depth.load_action = SG_LOADACTION_CLEAR;
     action.depth.clear_value = 1.0f;
 
@@ -911,150 +1600,854 @@ void Renderer_DrawPencilPostProcess(float timeSeconds) {
 // ---------------------------------------------------------------------------
 //  Bucket upload (shared by .map and .bsp paths)
 // ---------------------------------------------------------------------------
+// The full map pipeline's vertex layout is MapVertex; BSP vertices are
+// uploaded straight from the mapped lump, so the two must agree.
+static_assert(sizeof(BSPVertex) == sizeof(MapVertex), "BSPVertex and MapVertex layouts differ");
+
+template <typename Vertex>
+static Vector3 VertexPosition(const Vertex& v) { return (Vector3){ v.x, v.y, v.z }; }
+template <typename Vertex>
+static Vector2 VertexUV(const Vertex& v) { return (Vector2){ v.u, v.v }; }
+static Vector2 VertexUV(const BSPVertexCompact& v) {
+    return (Vector2){ HalfBitsToFloat32(v.u), HalfBitsToFloat32(v.v) };
+}
+
+// `vertices` and `indices` are the whole model's; the submesh draws
+// `indexCount` indices from `firstIndex`. Vertex is MapVertex, BSPVertex or
+// BSPVertexCompact. Without `clusters` the whole submesh is one cluster.
+// The texture is left to SetSubMeshTexture, which turns `uvPerWorldArea`
+// into texels per unit. Adds nothing and returns false for an empty range.
+template <typename Vertex>
+static bool AddSubMesh(MapModel& mdl,
+                       const std::string& texture,
+                       uint32_t lightmapPage,
+                       std::span<const Vertex> vertices,
+                       std::span<const uint32_t> indices,
+                       uint32_t firstIndex,
+                       uint32_t indexCount,
+                       std::span<const MapCluster> clusters,
+                       double& uvPerWorldArea)
+{
+    if (indexCount == 0) return false;
+    const std::span<const uint32_t> meshIndices = indices.subspan(firstIndex, indexCount);
+
+    uint8_t lr = 0, lg = 0, lb = 0;
+
+    AABB bounds = AABBInvalid();
+    for (uint32_t index : meshIndices) AABBExtend(&bounds, VertexPosition(vertices[index]));
+
+    // Average texel density over the bucket's triangles, in level-0
+    // texels per world unit; the streamer turns it into a mip request.
+    double worldArea = 0.0, uvArea = 0.0;
+    for (size_t i = 0; i + 2 < meshIndices.size(); i += 3) {
+        const Vertex& a = vertices[meshIndices[i]];
+        const Vertex& c1 = vertices[meshIndices[i + 1]];
+        const Vertex& c2 = vertices[meshIndices[i + 2]];
+        const Vector3 e1 = Vector3Subtract(VertexPosition(c1), VertexPosition(a));
+        const Vector3 e2 = Vector3Subtract(VertexPosition(c2), VertexPosition(a));
+        worldArea += Vector3Length(Vector3CrossProduct(e1, e2));
+        const Vector2 ta = VertexUV(a), t1 = VertexUV(c1), t2 = VertexUV(c2);
+        uvArea += std::fabs((t1.x - ta.x) * (t2.y - ta.y) - (t2.x - ta.x) * (t1.y - ta.y));
+    }
+    uvPerWorldArea = worldArea > 0.0 ? uvArea / worldArea : 0.0;
+
+    SubMesh sm;
+    sm.first_index=(int)firstIndex; sm.index_count=(int)indexCount; sm.bounds=bounds;
+    sm.lightmap_page = lightmapPage;
+    sm.fullbright = ParseLightBrushTextureName(texture, lr, lg, lb);
+    sm.first_cluster = (int)mdl.clusters.size();
+    if (clusters.empty()) {
+        mdl.clusters.push_back(MapCluster{ sm.first_index, sm.index_count, bounds });
+    } else {
+        mdl.clusters.insert(mdl.clusters.end(), clusters.begin(), clusters.end());
+    }
+    sm.cluster_count = (int)mdl.clusters.size() - sm.first_cluster;
+    mdl.meshes.push_back(sm);
+    return true;
+}
+
+static void SetSubMeshTexture(SubMesh& sm, const TextureEntry* tex, double uvPerWorldArea)
+{
+    sm.texture = tex;
+    if (uvPerWorldArea > 0.0) {
+        sm.texels_per_unit = (float)std::sqrt(uvPerWorldArea * tex->width * tex->height);
+    }
+}
+
+// One vertex and one index buffer for the whole model; `indices` are
+// absolute, so draws need no base vertex.
+template <typename Vertex>
+static void UploadMapBuffers(MapModel& mdl,
+                             std::span<const Vertex> vertices,
+                             std::span<const uint32_t> indices)
+{
+    if (vertices.empty() || indices.empty()) return;
+
+    sg_buffer_desc vbd = {};
+    vbd.data  = { vertices.data(), vertices.size_bytes() };
+    vbd.label = "map-vbuf";
+    mdl.vbuf = sg_make_buffer(&vbd);
+
+    sg_buffer_desc ibd = {};
+    ibd.usage.index_buffer = true;
+    ibd.data  = { indices.data(), indices.size_bytes() };
+    ibd.label = "map-ibuf";
+    mdl.ibuf = sg_make_buffer(&ibd);
+}
+
+// Gives every distinct texture binding, a texture's own view or an array,
+// a dense slot for the draw keys, in the order the submeshes first use them.
+static void AssignTextureSlots(MapModel& mdl)
+{
+    std::map<std::pair<const TextureEntry*, int>, uint16_t> slots;
+    for (SubMesh& sm : mdl.meshes) {
+        const auto binding = sm.texture_array >= 0
+                                 ? std::pair<const TextureEntry*, int>{ nullptr, sm.texture_array }
+                                 : std::pair<const TextureEntry*, int>{ sm.texture, -1 };
+        auto it = slots.try_emplace(binding, (uint16_t)slots.size()).first;
+        sm.texture_slot = it->second;
+    }
+    if (slots.size() > (1u << DRAW_KEY_TEXTURE_BITS)) {
+        printf("[Renderer] %zu textures exceed the draw key's %d bits; some draws will rebind.\n",
+               slots.size(), DRAW_KEY_TEXTURE_BITS);
+    }
+}
+
 static void UploadBuckets(MapModel& mdl,
                           const std::vector<MapMeshBucket>& buckets,
                           TextureManager& texMgr)
 {
-    mdl.meshes.reserve(buckets.size());
+    size_t vertexCount = 0, indexCount = 0;
     for (auto& b : buckets) {
-        if (b.indices.empty()) continue;
-
-        sg_buffer_desc vbd = {};
-        vbd.data  = { b.vertices.data(), b.vertices.size() * sizeof(MapVertex) };
-        vbd.label = "map-vbuf";
-        sg_buffer vbuf = sg_make_buffer(&vbd);
+        vertexCount += b.vertices.size();
+        indexCount += b.indices.size();
+    }
+    std::vector<MapVertex> vertices;
+    std::vector<uint32_t> indices;
+    vertices.reserve(vertexCount);
+    indices.reserve(indexCount);
+    std::vector<std::pair<uint32_t, uint32_t>> ranges;   // (firstIndex, indexCount) per bucket
+    ranges.reserve(buckets.size());
+    for (auto& b : buckets) {
+        const uint32_t baseVertex = (uint32_t)vertices.size();
+        ranges.push_back({ (uint32_t)indices.size(), (uint32_t)b.indices.size() });
+        vertices.insert(vertices.end(), b.vertices.begin(), b.vertices.end());
+        for (uint32_t index : b.indices) indices.push_back(baseVertex + index);
+    }
 
-        sg_buffer_desc ibd = {};
-        ibd.usage.index_buffer = true;
-        ibd.data  = { b.indices.data(), b.indices.size() * sizeof(uint32_t) };
-        ibd.label = "map-ibuf";
-        sg_buffer ibuf = sg_make_buffer(&ibd);
+    UploadMapBuffers<MapVertex>(mdl, vertices, indices);
+    mdl.meshes.reserve(buckets.size());
+    for (size_t i = 0; i < buckets.size(); ++i) {
+        double uvPerWorldArea = 0.0;
+        if (AddSubMesh<MapVertex>(mdl, buckets[i].texture, buckets[i].lightmapPage, vertices, indices,
+                                  ranges[i].first, ranges[i].second, {}, uvPerWorldArea)) {
+            SetSubMeshTexture(mdl.meshes.back(), LoadTextureByName(texMgr, buckets[i].texture), uvPerWorldArea);
+        }
+    }
+    AssignTextureSlots(mdl);
+}
 
-        const TextureEntry* tex = LoadTextureByName(texMgr, b.texture);
-        uint8_t lr = 0, lg = 0, lb = 0;
+// The levels TEXTURE_ARRAYS packs for a prepared texture: its chain, its
+// pixels, or the checker when it has neither.
+static MipmapChainView PreparedTextureLevels(const PreparedTexture& t, sg_pixel_format* uploadFormat)
+{
+    if (!t.mips.levels.empty()) {
+        *uploadFormat = t.uploadFormat;
+        MipmapChainView mips = t.mips;
+        mips.levels.resize(std::min(mips.levels.size(), (size_t)SG_MAX_MIPMAPS));
+        return mips;
+    }
+    MipmapChainView mips;
+    mips.format = TEXTURE_PIXEL_RGBA8;
+    *uploadFormat = SG_PIXELFORMAT_RGBA8;
+    if (!t.pixels.empty()) {
+        mips.levels.push_back({ t.width, t.height, t.pixels.data(), t.pixels.size() });
+    } else {
+        mips.levels.push_back({ 8, 8, (const uint8_t*)FallbackCheckerPixels(), 8 * 8 * sizeof(uint32_t) });
+    }
+    return mips;
+}
 
-        AABB bounds = AABBInvalid();
-        for (auto& v : b.vertices) AABBExtend(&bounds, (Vector3){v.x,v.y,v.z});
+// TEXTURE_ARRAYS: packs every texture of the map into array images, a
+// layer each, shared by the textures with the same size, upload format and
+// mip count; a texture without a partner gets an array of its own, so the
+// array pipelines never sample a 2D view. Arrays are uploaded in full and
+// left out of streaming.
+static void PrepareTextureArrays(MapUpload& up)
+{
+    std::vector<MipmapChainView> levels(up.textures.size());
+    std::map<std::tuple<int, int, int, int>, std::vector<uint32_t>> groups;
+    for (uint32_t i = 0; i < up.textures.size(); ++i) {
+        sg_pixel_format uploadFormat = SG_PIXELFORMAT_NONE;
+        levels[i] = PreparedTextureLevels(up.textures[i], &uploadFormat);
+        const MipmapLevelView& top = levels[i].levels[0];
+        groups[{ top.width, top.height, (int)uploadFormat, (int)levels[i].levels.size() }].push_back(i);
+    }
 
-        SubMesh sm;
-        sm.vbuf=vbuf; sm.ibuf=ibuf; sm.tex_view=tex->view;
-        sm.index_count=(int)b.indices.size(); sm.bounds=bounds;
-        sm.lightmap_page = b.lightmapPage;
-        sm.fullbright = ParseLightBrushTextureName(b.texture, lr, lg, lb);
-        mdl.meshes.push_back(sm);
+    const size_t maxLayers = (size_t)up.caps.maxArrayLayers;
+    std::vector<std::pair<int16_t, uint16_t>> layers(up.textures.size(), { (int16_t)-1, (uint16_t)0 });
+    for (const auto& [key, members] : groups) {
+        const auto [width, height, pixelFormat, numMips] = key;
+        for (size_t first = 0; first < members.size(); first += maxLayers) {
+            const size_t count = std::min(members.size() - first, maxLayers);
+            PreparedArray array;
+            array.width = width;
+            array.height = height;
+            array.layers = (int)count;
+            array.pixelFormat = (sg_pixel_format)pixelFormat;
+            array.levels.resize(numMips);
+            std::vector<unsigned char> decoded;
+            for (size_t k = 0; k < count; ++k) {
+                const MipmapChainView& mips = levels[members[first + k]];
+                for (int m = 0; m < numMips; ++m) {
+                    const MipmapLevelView& level = mips.levels[m];
+                    const uint8_t* pixels = level.pixels;
+                    size_t size = level.size;
+                    if (pixelFormat == SG_PIXELFORMAT_RGBA8 && mips.format != TEXTURE_PIXEL_RGBA8) {
+                        if (!DecodeTextureLevelRGBA8(mips.format, level.width, level.height,
+                                                     level.pixels, level.size, &decoded)) {
+                            decoded.assign((size_t)level.width * level.height * 4, 255);
+                        }
+                        pixels = decoded.data();
+                        size = decoded.size();
+                    }
+                    array.levels[m].insert(array.levels[m].end(), pixels, pixels + size);
+                }
+                layers[members[first + k]] = { (int16_t)up.textureArrays.size(), (uint16_t)k };
+            }
+            up.textureArrays.push_back(std::move(array));
+        }
+    }
+    for (size_t i = 0; i < up.model.meshes.size(); ++i) {
+        const auto [array, layer] = layers[up.meshTextures[i]];
+        up.model.meshes[i].texture_array = array;
+        up.model.meshes[i].texture_layer = layer;
     }
+    printf("[Renderer] Packing %zu textures into %zu texture arrays.\n",
+           up.textures.size(), up.textureArrays.size());
 }
 
-MapModel Renderer_UploadMap(const Map& map, TextureManager& texMgr) {
-    std::vector<MapMeshBucket> buckets = BuildMapGeometry(map, texMgr);
-    MapModel mdl;
-    UploadBuckets(mdl, buckets, texMgr);
-    mdl.lightmapViews.push_back(g_whiteLmV);  // no baked lm in legacy path
-    printf("[Renderer] Map uploaded: %zu submeshes (no lightmap).\n", mdl.meshes.size());
-    return mdl;
-}
+// Submeshes and clusters straight from the lumps, and the textures they use,
+// read and decoded on every worker since they are independent.
+static void PrepareBSPMeshes(MapUpload& up, const TextureManager& texMgr)
+{
+    const BSPData& bsp = *up.bsp;
+    MapModel& mdl = up.model;
+    mdl.vertexFormat = bsp.compactVertices.empty() ? MAP_VERTEX_FORMAT_FULL : MAP_VERTEX_FORMAT_COMPACT;
+
+    mdl.meshes.reserve(bsp.meshes.size());
+    mdl.clusters.reserve(bsp.meshClusters.empty() ? bsp.meshes.size() : bsp.meshClusters.size());
+    std::unordered_map<std::string, uint32_t> textureIndices;
+    std::vector<std::string> textureNames;
+    std::vector<MapCluster> meshClusters;
+    size_t nextCluster = 0;
+    for (size_t meshIndex = 0; meshIndex < bsp.meshes.size(); ++meshIndex) {
+        const BSPMesh& m = bsp.meshes[meshIndex];
+        // The loader has checked clusters are in mesh order and stay inside it.
+        meshClusters.clear();
+        for (; nextCluster < bsp.meshClusters.size() && bsp.meshClusters[nextCluster].meshIndex == meshIndex; ++nextCluster) {
+            const BSPMeshCluster& c = bsp.meshClusters[nextCluster];
+            MapCluster cluster;
+            cluster.first_index = (int)c.firstIndex;
+            cluster.index_count = (int)c.indexCount;
+            cluster.bounds = (AABB){ { c.minX, c.minY, c.minZ }, { c.maxX, c.maxY, c.maxZ } };
+            meshClusters.push_back(cluster);
+        }
+        const BSPTexture& texture = bsp.textures[m.textureIndex];
+        const std::string name(texture.name, strnlen(texture.name, sizeof(texture.name)));
+        double uvPerWorldArea = 0.0;
+        const bool added = mdl.vertexFormat == MAP_VERTEX_FORMAT_COMPACT
+            ? AddSubMesh<BSPVertexCompact>(mdl, name, m.lightmapPage, bsp.compactVertices, bsp.indices,
+                                           m.firstIndex, m.indexCount, meshClusters, uvPerWorldArea)
+            : AddSubMesh<BSPVertex>(mdl, name, m.lightmapPage, bsp.vertices, bsp.indices,
+                                    m.firstIndex, m.indexCount, meshClusters, uvPerWorldArea);
+        if (!added) continue;
+        auto [it, inserted] = textureIndices.try_emplace(name, (uint32_t)textureNames.size());
+        if (inserted) {
+            textureNames.push_back(name);
+        }
+        up.meshTextures.push_back(it->second);
+        up.meshUvPerWorldArea.push_back(uvPerWorldArea);
+    }
 
-MapModel Renderer_UploadBSP(const BSPData& bsp, TextureManager& texMgr) {
-    MapModel mdl;
-    texMgr.activePackPath = bsp.assetPackPath;
-    UploadBuckets(mdl, bsp.buckets, texMgr);
+    up.textures.resize(textureNames.size());
+    ParallelFor(textureNames.size(), [&](size_t i) {
+        up.textures[i] = PrepareTexture(texMgr, up.caps, textureNames[i]);
+    });
+    if (up.caps.arrays) {
+        PrepareTextureArrays(up);
+    }
+}
 
-    for (const BSPDataLightmapPage& page : bsp.lightmapPages) {
+// Checks every page and decodes the ones the backend cannot sample to
+// RGBA16F, on every worker. Skipped pages leave no gap.
+static void PrepareLightmapPages(MapUpload& up)
+{
+    const std::span<const BSPDataLightmapPage> bspPages = up.bsp->lightmapPages;
+    const MapUploadCaps& caps = up.caps;
+    std::vector<LightmapPageUpload> pages(bspPages.size());
+    std::vector<uint8_t> usable(bspPages.size(), 0);
+    ParallelFor(bspPages.size(), [&](size_t i) {
+        const BSPDataLightmapPage& page = bspPages[i];
         if (page.width <= 0 || page.height <= 0 || page.pixels.empty()) {
-            continue;
+            return;
         }
-        const sg_pixel_format pixelFormat = Renderer_LightmapPixelFormat(page.format);
+        sg_pixel_format pixelFormat = Renderer_LightmapPixelFormat(page.format);
         if (pixelFormat == SG_PIXELFORMAT_NONE) {
             printf("[Renderer] Skipping lightmap page with unsupported format %u.\n", page.format);
-            continue;
+            return;
         }
-        const sg_pixelformat_info pixelInfo = sg_query_pixelformat(pixelFormat);
-        if (!pixelInfo.sample) {
-            printf("[Renderer] Skipping lightmap page format %u on backend %s because it is not sampleable.\n",
-                   page.format, RendererBackendName(sg_query_backend()));
-            continue;
-        }
-        const size_t expectedBytes = (size_t)page.width * (size_t)page.height * pixelInfo.bytes_per_pixel;
+        const size_t expectedBytes = LightmapPageByteSize(page.format, page.width, page.height);
         if (page.pixels.size() != expectedBytes) {
             printf("[Renderer] Skipping malformed lightmap page: format=%u size=%zu expected=%zu.\n",
                    page.format, page.pixels.size(), expectedBytes);
-            continue;
+            return;
+        }
+        LightmapPageUpload& upload = pages[i];
+        upload.width = page.width;
+        upload.height = page.height;
+        upload.format = page.format;
+        upload.pixelFormat = pixelFormat;
+        upload.stored = page.pixels;
+        // Backends without the packed/compressed format get the page decoded
+        // to RGBA16F on the CPU instead.
+        if (!caps.lightmapSampleable[page.format]) {
+            if (!caps.rgba16f ||
+                !DecodeLightmapPageRGBA16F(page.format, page.width, page.height,
+                                           page.pixels.data(), page.pixels.size(), &upload.decoded)) {
+                printf("[Renderer] Skipping lightmap page format %s on backend %s because it is not sampleable.\n",
+                       LightmapFormatName(page.format), RendererBackendName(caps.backend));
+                return;
+            }
+            printf("[Renderer] Lightmap format %s is not sampleable on backend %s; decoded to RGBA16F.\n",
+                   LightmapFormatName(page.format), RendererBackendName(caps.backend));
+            upload.format = BSP_LIGHTMAP_FORMAT_RGBA16F;
+            upload.pixelFormat = SG_PIXELFORMAT_RGBA16F;
+        }
+        usable[i] = 1;
+    });
+    up.lightmapPages.reserve(pages.size());
+    for (size_t i = 0; i < pages.size(); ++i) {
+        if (usable[i]) {
+            up.lightmapPages.push_back(std::move(pages[i]));
+        }
+    }
+}
+
+// TEXTURE_ARRAYS: packs every page into an array shared with the pages of
+// the same width and format, as tall as their tallest page; a page without
+// a partner gets an array of its own. Shorter pages repeat their last row
+// below them, so clamped sampling along that edge is unchanged, and their
+// uvs are scaled to the part they fill.
+static void PrepareLightmapArrays(MapUpload& up)
+{
+    const std::vector<LightmapPageUpload>& pages = up.lightmapPages;
+    std::vector<MapLightmapLayer>& layers = up.model.lightmapLayers;
+    std::map<std::pair<int, uint32_t>, std::vector<size_t>> groups;
+    for (size_t i = 0; i < pages.size(); ++i) {
+        groups[{ pages[i].width, pages[i].format }].push_back(i);
+    }
+    const size_t maxLayers = (size_t)up.caps.maxArrayLayers;
+    for (const auto& [key, members] : groups) {
+        const auto [width, format] = key;
+        for (size_t first = 0; first < members.size(); first += maxLayers) {
+            const size_t count = std::min(members.size() - first, maxLayers);
+            int height = 0;
+            for (size_t k = 0; k < count; ++k) {
+                height = std::max(height, pages[members[first + k]].height);
+            }
+            // One row of texels, or of blocks for BC6H.
+            const size_t pitch = LightmapPageByteSize(format, width, 1);
+            const size_t layerBytes = LightmapPageByteSize(format, width, height);
+            PreparedArray array;
+            array.width = width;
+            array.height = height;
+            array.layers = (int)count;
+            array.pixelFormat = pages[members[first]].pixelFormat;
+            array.levels.resize(1);
+            std::vector<uint8_t>& pixels = array.levels[0];
+            pixels.resize(layerBytes * count);
+            const int16_t index = (int16_t)up.lightmapArrays.size();
+            for (size_t k = 0; k < count; ++k) {
+                const LightmapPageUpload& page = pages[members[first + k]];
+                const std::span<const uint8_t> src = page.Pixels();
+                uint8_t* dst = pixels.data() + k * layerBytes;
+                memcpy(dst, src.data(), src.size());
+                for (size_t offset = src.size(); offset + pitch <= layerBytes; offset += pitch) {
+                    memcpy(dst + offset, src.data() + src.size() - pitch, pitch);
+                }
+                layers[members[first + k]] = { index, (uint16_t)k, 1.0f, (float)page.height / (float)height };
+            }
+            up.lightmapArrays.push_back(std::move(array));
+        }
+    }
+}
+
+// The submesh's lightmap layer when its page went into an array.
+static const MapLightmapLayer* MapLightmapArrayLayer(const MapModel& mdl, const SubMesh& sm)
+{
+    if (sm.fullbright || sm.lightmap_page >= mdl.lightmapLayers.size()) {
+        return nullptr;
+    }
+    const MapLightmapLayer& layer = mdl.lightmapLayers[sm.lightmap_page];
+    return layer.array >= 0 ? &layer : nullptr;
+}
+
+// Each vertex's diffuse and lightmap layers and lightmap uv scale, for the
+// array pipelines; fullbright submeshes sample the white array's layer 0.
+// The meshes own disjoint vertex ranges, so every vertex gets one
+// submesh's values.
+static void PrepareMapLayers(MapUpload& up, std::span<const uint32_t> indices, size_t vertexCount)
+{
+    const MapModel& mdl = up.model;
+    std::vector<uint16_t>& layers = up.layers;
+    layers.assign(vertexCount * 4, 0);
+    for (const SubMesh& sm : mdl.meshes) {
+        const MapLightmapLayer* lm = MapLightmapArrayLayer(mdl, sm);
+        const uint16_t values[4] = {
+            sm.texture_layer,
+            (uint16_t)(lm ? lm->layer : 0),
+            (uint16_t)std::lround((lm ? lm->uScale : 1.0f) * 65535.0f),
+            (uint16_t)std::lround((lm ? lm->vScale : 1.0f) * 65535.0f),
+        };
+        for (uint32_t index : indices.subspan(sm.first_index, sm.index_count)) {
+            if (index < vertexCount) {
+                memcpy(&layers[(size_t)index * 4], values, sizeof(values));
+            }
+        }
+    }
+}
+
+// Copies what the per-frame leaf lookup needs and lists the empty leaves
+// around each cluster. Cluster bounds are grown a little so faces lying on a
+// leaf boundary pick up the leaf they face.
+static void UploadMapVisibility(MapModel& mdl, const BSPData& bsp)
+{
+    mdl.clusterVisible.assign(mdl.clusters.size(), 1);
+    const BSPVisRows& rows = bsp.visibility;
+    if (rows.header.leafCount == 0) return;
+
+    MapVisibility& vis = mdl.vis;
+    vis.nodes.assign(bsp.bspNodes.begin(), bsp.bspNodes.end());
+    vis.planes.assign(bsp.planes.begin(), bsp.planes.end());
+    vis.rootChild = bsp.tree.rootChild;
+    vis.rowBytes = rows.header.rowBytes;
+    vis.rowOffsets.assign(rows.rowOffsets.begin(), rows.rowOffsets.end());
+    vis.rows.assign(rows.rows.begin(), rows.rows.end());
+    vis.eyeRow.resize(vis.rowBytes);
+
+    std::vector<uint32_t> leaves;
+    for (MapCluster& c : mdl.clusters) {
+        const float mins[3] = { c.bounds.min.x - 1.0f, c.bounds.min.y - 1.0f, c.bounds.min.z - 1.0f };
+        const float maxs[3] = { c.bounds.max.x + 1.0f, c.bounds.max.y + 1.0f, c.bounds.max.z + 1.0f };
+        leaves.clear();
+        FindBSPLeavesInBox(vis.nodes, vis.planes, vis.rootChild, mins, maxs, &leaves);
+        c.first_leaf = (int)vis.clusterLeaves.size();
+        for (uint32_t leaf : leaves) {
+            if (leaf < bsp.bspLeaves.size() && bsp.bspLeaves[leaf].contents != BSP_CONTENTS_SOLID) {
+                vis.clusterLeaves.push_back(leaf);
+            }
         }
-        sg_image_desc id = {};
-        id.width = page.width;
-        id.height = page.height;
-        id.pixel_format = pixelFormat;
-        id.data.mip_levels[0] = { page.pixels.data(), page.pixels.size() };
-        id.label = "lightmap-page";
-        sg_image image = sg_make_image(&id);
-        sg_view_desc vd = {};
-        vd.texture.image = image;
-        mdl.lightmapImages.push_back(image);
-        mdl.lightmapViews.push_back(sg_make_view(&vd));
-    }
-
-    if (mdl.lightmapViews.empty()) {
-        mdl.lightmapViews.push_back(g_whiteLmV);
-    }
-    printf("[Renderer] BSP uploaded: %zu submeshes, %zu lightmap pages.\n",
-           mdl.meshes.size(), mdl.lightmapViews.size());
+        c.leaf_count = (int)vis.clusterLeaves.size() - c.first_leaf;
+    }
+}
+
+static void BuildMapCull(MapModel& mdl, std::span<const BSPNode> nodes,
+                         std::span<const BSPPlane> planes, int32_t rootChild)
+{
+    std::vector<AABB> bounds;
+    bounds.reserve(mdl.clusters.size());
+    for (const MapCluster& c : mdl.clusters) {
+        bounds.push_back(c.bounds);
+    }
+    MapCull_Build(mdl.cull, bounds, nodes, planes, rootChild);
+}
+
+MapModel Renderer_UploadMap(const Map& map, TextureManager& texMgr) {
+    std::vector<MapMeshBucket> buckets = BuildMapGeometry(map, texMgr);
+    MapModel mdl;
+    UploadBuckets(mdl, buckets, texMgr);
+    mdl.clusterVisible.assign(mdl.clusters.size(), 1);
+    BuildMapCull(mdl, {}, {}, -1);
+    Occlusion_Init(mdl.occlusion, {}, {});
+    mdl.lightmapViews.push_back(g_whiteLmV);  // no baked lm in legacy path
+    printf("[Renderer] Map uploaded: %zu submeshes (no lightmap).\n", mdl.meshes.size());
     return mdl;
 }
 
+void Renderer_BeginBSPUpload(MapUpload& up, TextureManager& texMgr) {
+    up = MapUpload{};
+    up.caps = Renderer_QueryUploadCaps();
+    BeginMapTextures(texMgr);
+}
+
+void Renderer_PrepareBSPUpload(MapUpload& up, const BSPData& bsp, TextureManager& texMgr) {
+    up.bsp = &bsp;
+    texMgr.activePackPath = bsp.assetPackPath;
+    OpenActivePack(texMgr);
+    PrepareBSPMeshes(up, texMgr);
+    UploadMapVisibility(up.model, bsp);
+    BuildMapCull(up.model, bsp.bspNodes, bsp.planes, bsp.tree.rootChild);
+    Occlusion_Init(up.model.occlusion, bsp.occluders, bsp.occluderVerts);
+
+    PrepareLightmapPages(up);
+    // Arrayed pages keep an empty slot here so page indices still line up.
+    up.model.lightmapLayers.assign(up.lightmapPages.size(), MapLightmapLayer{});
+    if (up.caps.arrays) {
+        PrepareLightmapArrays(up);
+    }
+    if (!up.textureArrays.empty() || !up.lightmapArrays.empty()) {
+        PrepareMapLayers(up, bsp.indices,
+                         up.model.vertexFormat == MAP_VERTEX_FORMAT_COMPACT ? bsp.compactVertices.size() : bsp.vertices.size());
+    }
+    // The buffers, then one per texture, array and page, then the layers.
+    up.uploadsTotal = 2 + up.textures.size() + up.textureArrays.size() + up.lightmapArrays.size() +
+                      up.lightmapPages.size();
+}
+
+static void MakeArrayImage(const PreparedArray& array, const char* label,
+                           std::vector<sg_image>& images, std::vector<sg_view>& views)
+{
+    sg_image_desc id = {};
+    id.type = SG_IMAGETYPE_ARRAY;
+    id.width = array.width;
+    id.height = array.height;
+    id.num_slices = array.layers;
+    id.num_mipmaps = (int)array.levels.size();
+    id.pixel_format = array.pixelFormat;
+    for (size_t m = 0; m < array.levels.size(); ++m) {
+        id.data.mip_levels[m] = { array.levels[m].data(), array.levels[m].size() };
+    }
+    id.label = label;
+    sg_image image = sg_make_image(&id);
+    sg_view_desc vd = {};
+    vd.texture.image = image;
+    images.push_back(image);
+    views.push_back(sg_make_view(&vd));
+}
+
+// Makes the next GPU resource of the upload, or moves on to the next stage
+// and returns false when the current one has nothing left.
+static bool UploadNextBSPItem(MapUpload& up, TextureManager& texMgr)
+{
+    MapModel& mdl = up.model;
+    const BSPData& bsp = *up.bsp;
+    switch (up.stage) {
+        case MAP_UPLOAD_BUFFERS:
+            // The vertex and index lumps go to the GPU as-is, straight from
+            // the mapping; BSP indices are already absolute into the vertex
+            // lump.
+            if (mdl.vertexFormat == MAP_VERTEX_FORMAT_COMPACT) {
+                UploadMapBuffers<BSPVertexCompact>(mdl, bsp.compactVertices, bsp.indices);
+            } else {
+                UploadMapBuffers<BSPVertex>(mdl, bsp.vertices, bsp.indices);
+            }
+            up.stage = MAP_UPLOAD_TEXTURES;
+            return true;
+        case MAP_UPLOAD_TEXTURES:
+            if (up.item < up.textures.size()) {
+                up.textureEntries.push_back(UploadPreparedTexture(texMgr, up.textures[up.item]));
+                up.textures[up.item].decoded.clear();
+                ++up.item;
+                return true;
+            }
+            for (size_t i = 0; i < mdl.meshes.size(); ++i) {
+                SetSubMeshTexture(mdl.meshes[i], up.textureEntries[up.meshTextures[i]], up.meshUvPerWorldArea[i]);
+            }
+            AssignTextureSlots(mdl);
+            up.stage = MAP_UPLOAD_TEXTURE_ARRAYS;
+            up.item = 0;
+            return false;
+        case MAP_UPLOAD_TEXTURE_ARRAYS:
+            if (up.item < up.textureArrays.size()) {
+                MakeArrayImage(up.textureArrays[up.item], "map-texture-array", mdl.textureArrayImages, mdl.textureArrayViews);
+                up.textureArrays[up.item++] = PreparedArray{};
+                return true;
+            }
+            up.stage = MAP_UPLOAD_LIGHTMAP_ARRAYS;
+            up.item = 0;
+            return false;
+        case MAP_UPLOAD_LIGHTMAP_ARRAYS:
+            if (up.item < up.lightmapArrays.size()) {
+                MakeArrayImage(up.lightmapArrays[up.item], "lightmap-array", mdl.lightmapArrayImages, mdl.lightmapArrayViews);
+                up.lightmapArrays[up.item++] = PreparedArray{};
+                return true;
+            }
+            up.stage = MAP_UPLOAD_LIGHTMAPS;
+            up.item = 0;
+            return false;
+        case MAP_UPLOAD_LIGHTMAPS:
+            if (up.item < up.lightmapPages.size()) {
+                const size_t i = up.item++;
+                if (mdl.lightmapLayers[i].array >= 0) {
+                    mdl.lightmapImages.push_back({});
+                    mdl.lightmapViews.push_back({});
+                    return true;
+                }
+                const std::span<const uint8_t> pixels = up.lightmapPages[i].Pixels();
+                sg_image_desc id = {};
+                id.width = up.lightmapPages[i].width;
+                id.height = up.lightmapPages[i].height;
+                id.pixel_format = up.lightmapPages[i].pixelFormat;
+                id.data.mip_levels[0] = { pixels.data(), pixels.size() };
+                id.label = "lightmap-page";
+                sg_image image = sg_make_image(&id);
+                sg_view_desc vd = {};
+                vd.texture.image = image;
+                mdl.lightmapImages.push_back(image);
+                mdl.lightmapViews.push_back(sg_make_view(&vd));
+                up.lightmapPages[i].decoded.clear();
+                return true;
+            }
+            if (mdl.lightmapViews.empty()) {
+                mdl.lightmapViews.push_back(g_whiteLmV);
+            }
+            up.stage = MAP_UPLOAD_LAYERS;
+            up.item = 0;
+            return false;
+        case MAP_UPLOAD_LAYERS:
+            if (!up.layers.empty()) {
+                sg_buffer_desc bd = {};
+                bd.data  = { up.layers.data(), up.layers.size() * sizeof(uint16_t) };
+                bd.label = "map-layer-buf";
+                mdl.layerBuf = sg_make_buffer(&bd);
+                up.layers.clear();
+            }
+            printf("[Renderer] BSP uploaded: %zu submeshes in %zu clusters (%zu cull nodes, %zu occluders), %zu lightmap pages (%zu arrays), %s.\n",
+                   mdl.meshes.size(), mdl.clusters.size(), mdl.cull.nodes.size(), mdl.occlusion.occluders.size(),
+                   mdl.lightmapViews.size(), mdl.lightmapArrayViews.size(),
+                   mdl.vis.rowOffsets.empty() ? "no leaf vis" : "leaf vis");
+            DropUnusedTextures(texMgr);
+            up.stage = MAP_UPLOAD_DONE;
+            return true;
+        case MAP_UPLOAD_DONE:
+            break;
+    }
+    return false;
+}
+
+bool Renderer_StepBSPUpload(MapUpload& up, TextureManager& texMgr, double budgetMs) {
+    using clock = std::chrono::steady_clock;
+    const clock::time_point start = clock::now();
+    while (up.stage != MAP_UPLOAD_DONE) {
+        if (!UploadNextBSPItem(up, texMgr)) continue;
+        ++up.uploadsDone;
+        if (std::chrono::duration<double, std::milli>(clock::now() - start).count() >= budgetMs) break;
+    }
+    return up.stage == MAP_UPLOAD_DONE;
+}
+
+float Renderer_BSPUploadProgress(const MapUpload& up) {
+    return up.uploadsTotal > 0 ? std::min(1.0f, (float)up.uploadsDone / (float)up.uploadsTotal) : 1.0f;
+}
+
+MapModel Renderer_UploadBSP(const BSPData& bsp, TextureManager& texMgr) {
+    MapUpload up;
+    Renderer_BeginBSPUpload(up, texMgr);
+    Renderer_PrepareBSPUpload(up, bsp, texMgr);
+    while (!Renderer_StepBSPUpload(up, texMgr, std::numeric_limits<double>::infinity())) {
+    }
+    return std::move(up.model);
+}
+
 // ---------------------------------------------------------------------------
 //  Draw
 // ---------------------------------------------------------------------------
-void Renderer_DrawMap(const MapModel& mdl,
-                      const Matrix&   mvp,
-                      const Matrix&   model,
-                      const Frustum&  frustum)
+// The only map pipeline so far; the key's pipeline field leaves room for
+// cut-out and translucent ones.
+static constexpr uint32_t MAP_DRAW_PIPELINE_OPAQUE = 0;
+
+static sg_view MapLightmapView(const MapModel& mdl, const SubMesh& sm)
 {
-    if (!g_pipeline.id) {
-        return;
+    const bool hasPage = sm.lightmap_page < mdl.lightmapViews.size() && mdl.lightmapViews[sm.lightmap_page].id;
+    return (sm.fullbright || !hasPage) ? g_whiteLmV : mdl.lightmapViews[sm.lightmap_page];
+}
+
+// A lightmap slot per page and per array; 0 for the white fallback.
+static uint32_t MapLightmapSlot(const MapModel& mdl, const SubMesh& sm)
+{
+    if (sm.fullbright || sm.lightmap_page >= mdl.lightmapViews.size()) {
+        return 0u;
     }
+    const MapLightmapLayer* layer = MapLightmapArrayLayer(mdl, sm);
+    return layer ? (uint32_t)(mdl.lightmapViews.size() + 1 + layer->array) : sm.lightmap_page + 1u;
+}
 
-    warped_map_shader_vs_params_t vs = {};
-    float16 m = MatrixToFloat16(mvp);
-    float16 n = MatrixToFloat16(model);
-    for (int i=0;i<16;++i) { vs.u_mvp[i]=m.v[i]; vs.u_model[i]=n.v[i]; }
+// The views a submesh samples: its 2D views, or for models drawn with the
+// array pipelines its arrays, with the white array where it has no page.
+struct MapViews {
+    sg_view tex{};
+    sg_view lm{};
+    sg_view texArray{};
+    sg_view lmArray{};
+
+    bool operator==(const MapViews& o) const
+    {
+        return tex.id == o.tex.id && lm.id == o.lm.id && texArray.id == o.texArray.id && lmArray.id == o.lmArray.id;
+    }
+};
+
+static MapViews MapSubMeshViews(const MapModel& mdl, const SubMesh& sm)
+{
+    MapViews views;
+    if (!mdl.layerBuf.id) {
+        views.tex = sm.texture->view;
+        views.lm = MapLightmapView(mdl, sm);
+        return views;
+    }
+    views.texArray = sm.texture_array >= 0 ? mdl.textureArrayViews[sm.texture_array] : g_whiteArrayV;
+    const MapLightmapLayer* layer = MapLightmapArrayLayer(mdl, sm);
+    views.lmArray = layer ? mdl.lightmapArrayViews[layer->array] : g_whiteArrayV;
+    return views;
+}
+
+// Joins commands whose index ranges meet into one sg_draw.
+struct MapDrawRun {
+    int first_index = 0;
+    int index_count = 0;
+
+    void Add(const DrawCommand& cmd)
+    {
+        if (index_count > 0 && first_index + index_count == cmd.first_index) {
+            index_count += cmd.index_count;
+            return;
+        }
+        Flush();
+        first_index = cmd.first_index;
+        index_count = cmd.index_count;
+    }
+    void Flush()
+    {
+        if (index_count > 0) {
+            sg_draw(first_index, index_count, 1);
+            ++g_drawStats.draws;
+            index_count = 0;
+        }
+    }
+};
+
+// Draws the list with any textured map pipeline; all programs take their
+// vertex uniforms in the same slot, and the array programs read the layers
+// from their own attribute slot in the model's second vertex buffer.
+#if WARPED_MAP_MRT_SHADER
+static_assert(UB_warped_map_shader_vs_params == UB_warped_map_shader_vs_mrt_params);
+#endif
+#if WARPED_MAP_ARRAY_SHADER
+static_assert(ATTR_warped_map_shader_map_array_a_layers != ATTR_warped_map_shader_map_array_a_pos &&
+              ATTR_warped_map_shader_map_array_a_layers != ATTR_warped_map_shader_map_array_a_nrm &&
+              ATTR_warped_map_shader_map_array_a_layers != ATTR_warped_map_shader_map_array_a_uv &&
+              ATTR_warped_map_shader_map_array_a_layers != ATTR_warped_map_shader_map_array_a_lmuv);
+#endif
+#if WARPED_MAP_ARRAY_SHADER && WARPED_MAP_MRT_SHADER
+static_assert(ATTR_warped_map_shader_map_array_a_layers == ATTR_warped_map_shader_map_array_mrt_a_layers);
+#endif
+static void Renderer_DrawMapCommands(const MapModel& mdl, sg_pipeline pipeline, const sg_range& uniforms)
+{
+    const std::vector<DrawCommand>& commands = mdl.drawList.commands;
+    if (commands.empty() || !pipeline.id) {
+        return;
+    }
 
-    sg_apply_pipeline(g_pipeline);
+    sg_apply_pipeline(pipeline);
+    sg_apply_uniforms(UB_warped_map_shader_vs_params, uniforms);
+    ++g_drawStats.pipelines;
+    ++g_drawStats.uniforms;
 
-    for (auto& sm : mdl.meshes) {
-        // CPU frustum cull — skip submeshes fully outside view + render-distance
-        if (!FrustumAABB(&frustum, sm.bounds)) continue;
-        const bool hasPage = sm.lightmap_page < mdl.lightmapViews.size();
-        const sg_view lightmap_view = (sm.fullbright || !hasPage) ? g_whiteLmV : mdl.lightmapViews[sm.lightmap_page];
+    // Commands come sorted by binding, so the views change once per group.
+    // The views are compared rather than the keys in case slots collided.
+    MapViews bound;
+    MapDrawRun run;
+    for (const DrawCommand& cmd : commands) {
+        const SubMesh& sm = mdl.meshes[cmd.mesh];
+        const MapViews views = MapSubMeshViews(mdl, sm);
 
         if (!g_logged_bind_diagnostics) {
             printf("[Renderer] Draw bind states: diffuse_view=%s lightmap_view=%s diffuse_sampler=%s lightmap_sampler=%s\n",
-                   RendererResourceStateName(sg_query_view_state(sm.tex_view)),
-                   RendererResourceStateName(sg_query_view_state(lightmap_view)),
+                   RendererResourceStateName(sg_query_view_state(mdl.layerBuf.id ? views.texArray : views.tex)),
+                   RendererResourceStateName(sg_query_view_state(mdl.layerBuf.id ? views.lmArray : views.lm)),
                    RendererResourceStateName(sg_query_sampler_state(g_sampler)),
                    RendererResourceStateName(sg_query_sampler_state(g_lmSampler)));
             g_logged_bind_diagnostics = true;
         }
 
-        sg_bindings bnd = {};
-        bnd.vertex_buffers[0] = sm.vbuf;
-        bnd.index_buffer      = sm.ibuf;
-        bnd.views[VIEW_warped_map_shader_u_tex]       = sm.tex_view;
-        bnd.views[VIEW_warped_map_shader_u_lm]        = lightmap_view;
-        bnd.samplers[SMP_warped_map_shader_u_tex_smp] = g_sampler;
-        bnd.samplers[SMP_warped_map_shader_u_lm_smp]  = g_lmSampler;
+        if (views != bound) {
+            run.Flush();
+            sg_bindings bnd = {};
+            bnd.vertex_buffers[0] = mdl.vbuf;
+            bnd.index_buffer      = mdl.ibuf;
+#if WARPED_MAP_ARRAY_SHADER
+            if (mdl.layerBuf.id) {
+                bnd.vertex_buffers[1] = mdl.layerBuf;
+                bnd.views[VIEW_warped_map_shader_u_tex_array] = views.texArray;
+                bnd.views[VIEW_warped_map_shader_u_lm_array]  = views.lmArray;
+            } else
+#endif
+            {
+                bnd.views[VIEW_warped_map_shader_u_tex] = views.tex;
+                bnd.views[VIEW_warped_map_shader_u_lm]  = views.lm;
+            }
+            bnd.samplers[SMP_warped_map_shader_u_tex_smp] = g_sampler;
+            bnd.samplers[SMP_warped_map_shader_u_lm_smp]  = g_lmSampler;
+            sg_apply_bindings(&bnd);
+            ++g_drawStats.bindings;
+            bound = views;
+        }
+        run.Add(cmd);
+    }
+    run.Flush();
+}
+
+void Renderer_DrawMap(const MapModel& mdl,
+                      const Matrix&   mvp,
+                      const Matrix&   model)
+{
+    warped_map_shader_vs_params_t vs = {};
+    float16 m = MatrixToFloat16(mvp);
+    float16 n = MatrixToFloat16(model);
+    for (int i=0;i<16;++i) { vs.u_mvp[i]=m.v[i]; vs.u_model[i]=n.v[i]; }
+
+    const bool compact = mdl.vertexFormat == MAP_VERTEX_FORMAT_COMPACT;
+    const sg_pipeline pipeline = mdl.layerBuf.id ? (compact ? g_compactArrayPipeline : g_arrayPipeline)
+                                                 : (compact ? g_compactPipeline : g_pipeline);
+    Renderer_DrawMapCommands(mdl, pipeline, { &vs, sizeof(vs) });
+}
 
-        sg_apply_bindings(&bnd);
-        sg_apply_uniforms(UB_warped_map_shader_vs_params, { &vs, sizeof(vs) });
-        sg_draw(0, sm.index_count, 1);
+void Renderer_DrawMapWithNormals(const MapModel& mdl,
+                                 const Matrix&   mvp,
+                                 const Matrix&   normalModel)
+{
+#if WARPED_MAP_MRT_SHADER
+    warped_map_shader_vs_mrt_params_t vs = {};
+    float16 m = MatrixToFloat16(mvp);
+    float16 n = MatrixToFloat16(normalModel);
+    for (int i = 0; i < 16; ++i) {
+        vs.u_mvp[i] = m.v[i];
+        vs.u_normal_model[i] = n.v[i];
     }
+
+    const bool compact = mdl.vertexFormat == MAP_VERTEX_FORMAT_COMPACT;
+    const sg_pipeline pipeline = mdl.layerBuf.id ? (compact ? g_compactMapArrayMrtPipeline : g_mapArrayMrtPipeline)
+                                                 : (compact ? g_compactMapMrtPipeline : g_mapMrtPipeline);
+    Renderer_DrawMapCommands(mdl, pipeline, { &vs, sizeof(vs) });
+#else
+    // Never reached: without the program the scene pass writes no normals.
+    (void)mdl;
+    (void)mvp;
+    (void)normalModel;
+#endif
 }
 
 void Renderer_DrawMapNormals(const MapModel& mdl,
                              const Matrix&   mvp,
-                             const Matrix&   normalModel,
-                             const Frustum&  frustum)
+                             const Matrix&   normalModel)
 {
-    if (!g_normalPipeline.id) {
+    const std::vector<DrawCommand>& commands = mdl.drawList.commands;
+    if (commands.empty()) {
+        return;
+    }
+
+    const sg_pipeline pipeline = mdl.vertexFormat == MAP_VERTEX_FORMAT_COMPACT ? g_compactNormalPipeline : g_normalPipeline;
+    if (!pipeline.id) {
         return;
     }
 
@@ -1066,29 +2459,165 @@ void Renderer_DrawMapNormals(const MapModel& mdl,
         vs.u_normal_model[i] = n.v[i];
     }
 
-    sg_apply_pipeline(g_normalPipeline);
+    sg_apply_pipeline(pipeline);
 
-    for (auto& sm : mdl.meshes) {
-        if (!FrustumAABB(&frustum, sm.bounds)) {
-            continue;
+    sg_bindings bnd = {};
+    bnd.vertex_buffers[0] = mdl.vbuf;
+    bnd.index_buffer = mdl.ibuf;
+
+    sg_apply_bindings(&bnd);
+    sg_apply_uniforms(UB_warped_normal_shader_vs_params, { &vs, sizeof(vs) });
+    ++g_drawStats.pipelines;
+    ++g_drawStats.bindings;
+    ++g_drawStats.uniforms;
+    // No textures here, so one binding covers the whole list, in the same
+    // front-to-back order as the scene pass.
+    MapDrawRun run;
+    for (const DrawCommand& cmd : commands) {
+        run.Add(cmd);
+    }
+    run.Flush();
+}
+
+void Renderer_CullMap(MapModel& mdl, const Matrix& viewProj, const Frustum& frustum)
+{
+    MapDrawList& list = mdl.drawList;
+    list.clusterDrawn.resize(mdl.clusters.size());
+    MapCull_Frustum(mdl.cull, frustum, list.clusterDrawn.data());
+    // Occlusion last: it is the dearest test, so only clusters that passed
+    // the other two reach it.
+    if (!mdl.occlusion.occluders.empty()) {
+        Occlusion_Render(mdl.occlusion, viewProj);
+        for (size_t i = 0; i < list.clusterDrawn.size(); ++i) {
+            if (list.clusterDrawn[i] && mdl.clusterVisible[i] &&
+                !Occlusion_TestAABB(mdl.occlusion, mdl.clusters[i].bounds)) {
+                list.clusterDrawn[i] = 0;
+            }
+        }
+    }
+
+    // One command per run of neighbouring drawn clusters, at the view
+    // depth of its nearest cluster centre (clip w, the matrix's last row).
+    // Models drawn from arrays share bindings across many submeshes, so
+    // their groups go in index order instead, where ranges that meet merge
+    // into one draw; with the state shared, depth order would only split
+    // those ranges.
+    const bool inIndexOrder = mdl.layerBuf.id != SG_INVALID_ID;
+    list.commands.clear();
+    for (size_t meshIndex = 0; meshIndex < mdl.meshes.size(); ++meshIndex) {
+        const SubMesh& sm = mdl.meshes[meshIndex];
+        const uint32_t lightmapSlot = MapLightmapSlot(mdl, sm);
+        DrawCommand cmd;
+        float depth = 0.0f;
+        auto keyOf = [&]() {
+            return inIndexOrder
+                       ? DrawKeyInOrder(MAP_DRAW_PIPELINE_OPAQUE, lightmapSlot, sm.texture_slot, (uint32_t)cmd.first_index)
+                       : DrawKey(MAP_DRAW_PIPELINE_OPAQUE, lightmapSlot, sm.texture_slot, depth);
+        };
+        for (int i = sm.first_cluster; i < sm.first_cluster + sm.cluster_count; ++i) {
+            list.clusterDrawn[i] &= mdl.clusterVisible[i];
+            if (!list.clusterDrawn[i]) continue;
+            const MapCluster& c = mdl.clusters[i];
+            const Vector3 centre = Vector3Scale(Vector3Add(c.bounds.min, c.bounds.max), 0.5f);
+            const float w = viewProj.m3 * centre.x + viewProj.m7 * centre.y + viewProj.m11 * centre.z + viewProj.m15;
+            if (cmd.index_count > 0 && cmd.first_index + cmd.index_count == c.first_index) {
+                cmd.index_count += c.index_count;
+                depth = std::min(depth, w);
+                continue;
+            }
+            if (cmd.index_count > 0) {
+                cmd.key = keyOf();
+                list.commands.push_back(cmd);
+            }
+            cmd = DrawCommand{ 0, (uint32_t)meshIndex, c.first_index, c.index_count };
+            depth = w;
         }
+        if (cmd.index_count > 0) {
+            cmd.key = keyOf();
+            list.commands.push_back(cmd);
+        }
+    }
+    DrawList_Sort(list.commands, list.scratch);
+
+    g_drawStats = DrawStats{};
+    g_drawStats.commands = (uint32_t)list.commands.size();
+}
+
+const DrawStats& Renderer_GetDrawStats(void)
+{
+    return g_drawStats;
+}
 
-        sg_bindings bnd = {};
-        bnd.vertex_buffers[0] = sm.vbuf;
-        bnd.index_buffer = sm.ibuf;
+void Renderer_UpdateTextureStreaming(TextureManager& texMgr,
+                                     const MapModel& mdl,
+                                     Vector3         eye,
+                                     float           pixelsPerUnit)
+{
+    const MapDrawList& list = mdl.drawList;
+    if (list.clusterDrawn.size() != mdl.clusters.size()) {
+        TextureStreaming_Update(texMgr.streamer);
+        return;
+    }
+    for (const SubMesh& sm : mdl.meshes) {
+        if (sm.texture->streamId < 0 || sm.texture_array >= 0 || sm.texels_per_unit <= 0.0f) continue;
+        // Nearest point of the closest drawn cluster; from inside one the
+        // full chain is wanted.
+        float distance = -1.0f;
+        for (int i = 0; i < sm.cluster_count; ++i) {
+            const AABB& b = mdl.clusters[sm.first_cluster + i].bounds;
+            if (!list.clusterDrawn[sm.first_cluster + i]) continue;
+            const Vector3 nearest = {
+                std::max(b.min.x, std::min(eye.x, b.max.x)),
+                std::max(b.min.y, std::min(eye.y, b.max.y)),
+                std::max(b.min.z, std::min(eye.z, b.max.z)),
+            };
+            const float d = Vector3Length(Vector3Subtract(nearest, eye));
+            if (distance < 0.0f || d < distance) distance = d;
+        }
+        if (distance < 0.0f) continue;
+        TextureStreaming_Request(texMgr.streamer, sm.texture->streamId,
+                                 sm.texels_per_unit * std::max(distance, 1.0f) / pixelsPerUnit);
+    }
+    TextureStreaming_Update(texMgr.streamer);
+}
 
-        sg_apply_bindings(&bnd);
-        sg_apply_uniforms(UB_warped_normal_shader_vs_params, { &vs, sizeof(vs) });
-        sg_draw(0, sm.index_count, 1);
+void Renderer_UpdateMapVisibility(MapModel& mdl, Vector3 eye)
+{
+    MapVisibility& vis = mdl.vis;
+    if (vis.rowOffsets.empty()) return;
+
+    const float point[3] = { eye.x, eye.y, eye.z };
+    const int32_t leaf = FindBSPLeaf(vis.nodes, vis.planes, vis.rootChild, point);
+    if (leaf == vis.eyeLeaf) return;
+    vis.eyeLeaf = leaf;
+
+    // Solid leaves have no row: from inside a wall, draw everything.
+    const bool seesAll = leaf < 0 || (size_t)leaf >= vis.rowOffsets.size() ||
+                         vis.rowOffsets[leaf] == BSP_VIS_NO_ROW ||
+                         !DecompressVisRow(vis.rows, vis.rowOffsets[leaf], vis.eyeRow.data(), vis.eyeRow.size());
+    for (size_t i = 0; i < mdl.clusters.size(); ++i) {
+        const MapCluster& c = mdl.clusters[i];
+        bool visible = seesAll || c.leaf_count == 0;
+        for (int k = 0; k < c.leaf_count && !visible; ++k) {
+            const uint32_t l = vis.clusterLeaves[c.first_leaf + k];
+            visible = (vis.eyeRow[l >> 3] >> (l & 7)) & 1;
+        }
+        mdl.clusterVisible[i] = visible ? 1 : 0;
     }
 }
 
 void Renderer_DestroyMap(MapModel& mdl) {
-    for (auto& sm : mdl.meshes) {
-        sg_destroy_buffer(sm.vbuf);
-        sg_destroy_buffer(sm.ibuf);
-    }
+    sg_destroy_buffer(mdl.vbuf);
+    sg_destroy_buffer(mdl.ibuf);
+    mdl.vbuf = {};
+    mdl.ibuf = {};
     mdl.meshes.clear();
+    mdl.clusters.clear();
+    mdl.clusterVisible.clear();
+    mdl.vis = MapVisibility{};
+    mdl.cull = MapCullTree{};
+    mdl.drawList = MapDrawList{};
+    mdl.occlusion = OcclusionBuffer{};
     for (size_t i = 0; i < mdl.lightmapImages.size(); ++i) {
         if (i < mdl.lightmapViews.size() && mdl.lightmapViews[i].id) {
             sg_destroy_view(mdl.lightmapViews[i]);
@@ -1099,4 +2628,21 @@ void Renderer_DestroyMap(MapModel& mdl) {
     }
     mdl.lightmapImages.clear();
     mdl.lightmapViews.clear();
+    for (size_t i = 0; i < mdl.textureArrayImages.size(); ++i) {
+        sg_destroy_view(mdl.textureArrayViews[i]);
+        sg_destroy_image(mdl.textureArrayImages[i]);
+    }
+    for (size_t i = 0; i < mdl.lightmapArrayImages.size(); ++i) {
+        sg_destroy_view(mdl.lightmapArrayViews[i]);
+        sg_destroy_image(mdl.lightmapArrayImages[i]);
+    }
+    mdl.textureArrayImages.clear();
+    mdl.textureArrayViews.clear();
+    mdl.lightmapArrayImages.clear();
+    mdl.lightmapArrayViews.clear();
+    mdl.lightmapLayers.clear();
+    if (mdl.layerBuf.id) {
+        sg_destroy_buffer(mdl.layerBuf);
+    }
+    mdl.layerBuf = {};
 }
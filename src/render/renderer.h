@@ -2,8 +2,15 @@
 #pragma once
 
 #include "sokol_gfx.h"
+#include "draw_list.h"
+#include "map_cull.h"
+#include "occlusion.h"
+#include "texture_streaming.h"
 #include "../math/wmath.h"
+#include "../utils/asset_pack.h"
+#include "../utils/bsp_format.h"
 #include "../utils/map_types.h"
+#include <span>
 #include <vector>
 #include <string>
 #include <unordered_map>
@@ -18,34 +25,209 @@ struct TextureEntry {
     sg_view   view;
     int       width  = 0;
     int       height = 0;
+    int       streamId = -1;    // TextureStreamer slot; -1 = fully resident
+    uint64_t  contentHash = 0;  // key in TextureManager::textures
+    uint32_t  mapSerial = 0;    // TextureManager::mapSerial of the last map to use it
 };
 
+// Entries never move once inserted, so submeshes keep pointers to them and
+// pick up the image the streamer swaps in. They are keyed by their pixels,
+// not their names, so a texture the next map's pack also has is adopted
+// as it is when maps switch; `names` resolves the current map's names.
 struct TextureManager {
-    std::unordered_map<std::string, TextureEntry> textures;
-    std::string activePackPath;
+    std::unordered_map<uint64_t, TextureEntry>     textures;
+    std::unordered_map<std::string, TextureEntry*> names;
+    uint32_t        mapSerial = 0;
+    std::string     activePackPath;
+    AssetPack       pack;       // mapped lazily from activePackPath
+    TextureStreamer streamer;   // mip residency of the pack textures
 };
 
 void                InitTextureManager(TextureManager& mgr);
 const TextureEntry* LoadTextureByName(TextureManager& mgr, const std::string& name);
 void                UnloadAllTextures(TextureManager& mgr);
+// A map switch: BeginMapTextures forgets the names and stops streaming from
+// the old pack before the next map loads; DropUnusedTextures frees what the
+// new map did not adopt once its upload is done. Frame thread only.
+void                BeginMapTextures(TextureManager& mgr);
+void                DropUnusedTextures(TextureManager& mgr);
 
 // ---------------------------------------------------------------------------
-//  GPU-resident map model (one submesh per texture)
+//  GPU-resident map model: one vertex and one index buffer, with a submesh
+//  per texture and lightmap page drawn from ranges of them, culled per cluster
 // ---------------------------------------------------------------------------
+// A spatially compact index range of one submesh.
+struct MapCluster {
+    int       first_index = 0;    // into MapModel::ibuf
+    int       index_count = 0;
+    AABB      bounds{};
+    int       first_leaf = 0;     // into MapVisibility::clusterLeaves; none = always drawn
+    int       leaf_count = 0;
+};
+
 struct SubMesh {
-    sg_buffer vbuf{};
-    sg_buffer ibuf{};
-    sg_view   tex_view{};
+    const TextureEntry* texture = nullptr;
+    float     texels_per_unit = 0.0f; // level-0 texels per world unit, for streaming
     uint32_t  lightmap_page = 0;
+    int       first_index = 0;    // into MapModel::ibuf, whose indices are absolute
     int       index_count = 0;
     bool      fullbright = false;
-    AABB      bounds{};           // world-space, for frustum culling
+    uint16_t  texture_slot = 0;   // dense per model, the texture's field of its draw keys
+    int16_t   texture_array = -1; // into MapModel::textureArrayViews; -1 = the texture's own view
+    uint16_t  texture_layer = 0;
+    AABB      bounds{};           // world-space, union of the clusters' bounds
+    int       first_cluster = 0;  // into MapModel::clusters; they tile the index range in order
+    int       cluster_count = 0;
+};
+
+enum MapVertexFormat : uint8_t {
+    MAP_VERTEX_FORMAT_FULL = 0,     // MapVertex / BSPVertex, 40 bytes
+    MAP_VERTEX_FORMAT_COMPACT,      // BSPVertexCompact, 24 bytes
+};
+
+// Leaf visibility, copied out of the .bsp since that is unloaded after
+// upload. Empty for maps compiled without vis.
+struct MapVisibility {
+    std::vector<BSPNode>  nodes;
+    std::vector<BSPPlane> planes;
+    int32_t               rootChild = -1;
+    uint32_t              rowBytes = 0;
+    std::vector<uint32_t> rowOffsets;     // per leaf, see bsp_vis.h
+    std::vector<uint8_t>  rows;
+    std::vector<uint32_t> clusterLeaves;  // empty leaves each cluster touches
+    int32_t               eyeLeaf = -2;   // leaf clusterVisible was last built for
+    std::vector<uint8_t>  eyeRow;         // that leaf's decompressed row
+};
+
+// What Renderer_CullMap found visible this frame, shared by every pass.
+struct MapDrawList {
+    std::vector<uint8_t>     clusterDrawn;  // per cluster: in the frustum, seen from the eye's leaf, not occluded
+    std::vector<DrawCommand> commands;      // runs of neighbouring drawn clusters, sorted by key
+    std::vector<DrawCommand> scratch;       // for the sort
+};
+
+// Where a lightmap page went when TEXTURE_ARRAYS packed it: pages are
+// padded to their array's size, so their uvs are scaled by the page's part.
+struct MapLightmapLayer {
+    int16_t   array = -1;         // into MapModel::lightmapArrayViews; -1 = the page's own view
+    uint16_t  layer = 0;
+    float     uScale = 1.0f;
+    float     vScale = 1.0f;
 };
 
 struct MapModel {
+    MapVertexFormat      vertexFormat = MAP_VERTEX_FORMAT_FULL;
+    sg_buffer            vbuf{};
+    sg_buffer            ibuf{};
     std::vector<SubMesh> meshes;
-    std::vector<sg_image> lightmapImages;
+    std::vector<MapCluster> clusters;
+    std::vector<uint8_t> clusterVisible;  // per cluster, from the eye's leaf
+    MapVisibility        vis;
+    MapCullTree          cull;      // cluster bounds along the BSP tree
+    MapDrawList          drawList;
+    OcclusionBuffer      occlusion; // the .bsp's occluders, rasterized per frame
+    std::vector<sg_image> lightmapImages;   // per page; none for arrayed pages
     std::vector<sg_view>  lightmapViews;
+    // TEXTURE_ARRAYS only: the arrays, each vertex's layers for the array
+    // pipelines, and per page where it went.
+    std::vector<sg_image> textureArrayImages;
+    std::vector<sg_view>  textureArrayViews;
+    std::vector<sg_image> lightmapArrayImages;
+    std::vector<sg_view>  lightmapArrayViews;
+    std::vector<MapLightmapLayer> lightmapLayers;
+    sg_buffer            layerBuf{};
+};
+
+// ---------------------------------------------------------------------------
+//  Staged BSP upload: Renderer_UploadBSP in three parts, so a loader thread
+//  can do the file reads and decodes and the GPU uploads can be spread over
+//  frames
+// ---------------------------------------------------------------------------
+// What the backend can sample, read on the frame thread so the preparation
+// never calls into sokol.
+struct MapUploadCaps {
+    sg_backend backend = SG_BACKEND_DUMMY;
+    bool       textureSampleable[4] = {};   // per TexturePixelFormat
+    bool       lightmapSampleable[4] = {};  // per BSPLightmapPageFormat
+    bool       rgba16f = false;             // for lightmap pages decoded on the CPU
+    bool       arrays = false;              // TEXTURE_ARRAYS, with working array pipelines
+    int        maxArrayLayers = 1;
+};
+
+enum PreparedTextureKind : uint8_t {
+    PREPARED_TEXTURE_RESIDENT = 0,  // already in the TextureManager, by name or content
+    PREPARED_TEXTURE_STREAMED,      // pack mip chain, registered with the streamer
+    PREPARED_TEXTURE_MIPMAPPED,     // legacy pack resource, uploaded in full
+    PREPARED_TEXTURE_PIXELS,        // a light brush colour or a loose .png, one level
+    PREPARED_TEXTURE_MISSING,       // the fallback checker
+};
+
+// A texture read and decoded ahead of its upload.
+struct PreparedTexture {
+    std::string         name;
+    PreparedTextureKind kind = PREPARED_TEXTURE_MISSING;
+    uint64_t            contentHash = 0;
+    sg_pixel_format     uploadFormat = SG_PIXELFORMAT_NONE;
+    MipmapChainView     mips;        // STREAMED and streamed RESIDENT: into the pack; MIPMAPPED: into `chain` or `decoded`
+    MipmapChain         chain;
+    std::vector<std::vector<uint8_t>> decoded;  // MIPMAPPED levels decoded to RGBA8
+    TextureStreamJob    resident;    // STREAMED: the always-resident mips
+    std::vector<uint8_t> pixels;     // PIXELS, RGBA8
+    int                 width = 0;
+    int                 height = 0;
+};
+
+// A lightmap page ready for upload: sampleable as stored, or decoded.
+struct LightmapPageUpload {
+    int                      width = 0;
+    int                      height = 0;
+    uint32_t                 format = 0;   // BSPLightmapFormat, after any decode
+    sg_pixel_format          pixelFormat = SG_PIXELFORMAT_NONE;
+    std::span<const uint8_t> stored;
+    std::vector<uint8_t>     decoded;
+
+    std::span<const uint8_t> Pixels() const
+    {
+        return decoded.empty() ? stored : std::span<const uint8_t>(decoded);
+    }
+};
+
+// An array image assembled on the CPU; each level holds every layer's level
+// back to back.
+struct PreparedArray {
+    int             width = 0;
+    int             height = 0;
+    int             layers = 0;
+    sg_pixel_format pixelFormat = SG_PIXELFORMAT_NONE;
+    std::vector<std::vector<uint8_t>> levels;
+};
+
+enum MapUploadStage : uint8_t {
+    MAP_UPLOAD_BUFFERS = 0,
+    MAP_UPLOAD_TEXTURES,
+    MAP_UPLOAD_TEXTURE_ARRAYS,
+    MAP_UPLOAD_LIGHTMAP_ARRAYS,
+    MAP_UPLOAD_LIGHTMAPS,
+    MAP_UPLOAD_LAYERS,
+    MAP_UPLOAD_DONE,
+};
+
+struct MapUpload {
+    const BSPData*  bsp = nullptr;      // must outlive the upload; the buffers and pages are read from it
+    MapUploadCaps   caps;
+    MapModel        model;              // CPU side from Prepare, GPU side from Step
+    std::vector<PreparedTexture>     textures;        // distinct, in the order the submeshes use them
+    std::vector<const TextureEntry*> textureEntries;  // per texture, once uploaded
+    std::vector<uint32_t>            meshTextures;    // per submesh, into `textures`
+    std::vector<double>              meshUvPerWorldArea;
+    std::vector<PreparedArray>       textureArrays;
+    std::vector<LightmapPageUpload>  lightmapPages;
+    std::vector<PreparedArray>       lightmapArrays;
+    std::vector<uint16_t>            layers;          // per vertex, for the array pipelines
+    MapUploadStage  stage = MAP_UPLOAD_BUFFERS;
+    size_t          item = 0;           // within the stage
+    size_t          uploadsDone = 0;
+    size_t          uploadsTotal = 1;
 };
 
 // ---------------------------------------------------------------------------
@@ -56,16 +238,61 @@ void      Renderer_Shutdown(void);
 
 MapModel  Renderer_UploadMap(const Map& map, TextureManager& texMgr);
 MapModel  Renderer_UploadBSP(const BSPData& bsp, TextureManager& texMgr);
+
+// Renderer_UploadBSP = Begin, Prepare, then Step until it returns true.
+// Begin runs on the frame thread, reads what the backend can sample and
+// starts a new map in texMgr (BeginMapTextures); the upload ends with
+// DropUnusedTextures, so the previous map must be destroyed by then.
+// Prepare makes no sokol calls and may run on any thread: it points texMgr
+// at the map's pack, builds the submeshes, clusters, vis and cull tree, and
+// reads and decodes the textures and lightmap pages. Nothing else may use
+// texMgr until it returns. Step runs on the frame thread and makes GPU
+// resources until `budgetMs` is spent, at least one per call; once it
+// returns true `up.model` is complete.
+void      Renderer_BeginBSPUpload(MapUpload& up, TextureManager& texMgr);
+void      Renderer_PrepareBSPUpload(MapUpload& up, const BSPData& bsp, TextureManager& texMgr);
+bool      Renderer_StepBSPUpload(MapUpload& up, TextureManager& texMgr, double budgetMs);
+// Fraction of the GPU uploads made, 0..1.
+float     Renderer_BSPUploadProgress(const MapUpload& up);
 void      Renderer_DrawMap(const MapModel& mdl,
                            const Matrix&   mvp,
-                           const Matrix&   model,
-                           const Frustum&  frustum);
+                           const Matrix&   model);
 void      Renderer_DrawMapNormals(const MapModel& mdl,
                                   const Matrix&   mvp,
-                                  const Matrix&   normalModel,
-                                  const Frustum&  frustum);
+                                  const Matrix&   normalModel);
+// Renderer_DrawMap plus the normal pass's normals and view distances, for
+// a scene post pass that Renderer_ScenePostPassWritesNormals says has the
+// targets for them.
+void      Renderer_DrawMapWithNormals(const MapModel& mdl,
+                                      const Matrix&   mvp,
+                                      const Matrix&   normalModel);
 void      Renderer_DestroyMap(MapModel& mdl);
 
+// Marks the clusters the leaf containing `eye` can see; the draw and
+// streaming calls skip the rest. Everything stays visible without vis data
+// or when the eye is outside the map. Call once per frame before them.
+void      Renderer_UpdateMapVisibility(MapModel& mdl, Vector3 eye);
+
+// Builds the frame's draw list from the clusters inside `frustum` that the
+// eye's leaf can see and the map's occluders do not hide, with `viewProj`
+// the matrix `frustum` came from. Call once per frame after
+// Renderer_UpdateMapVisibility; the streaming and draw calls all read the
+// list it leaves in `mdl`.
+void      Renderer_CullMap(MapModel& mdl, const Matrix& viewProj, const Frustum& frustum);
+
+// Draws and state changes of the map passes since the last
+// Renderer_CullMap.
+const DrawStats& Renderer_GetDrawStats(void);
+
+// Requests mips for the submeshes in the draw list and advances the texture
+// streamer; call once per frame before drawing. `pixelsPerUnit` is the
+// on-screen size of one world unit at distance 1
+// (viewport height / (2 * tan(fovy / 2))).
+void      Renderer_UpdateTextureStreaming(TextureManager& texMgr,
+                                          const MapModel& mdl,
+                                          Vector3         eye,
+                                          float           pixelsPerUnit);
+
 sg_sampler Renderer_DefaultSampler(void);
 
 bool      Renderer_BeginScenePostPass(const sg_pass_action& action,
@@ -73,6 +300,11 @@ bool      Renderer_BeginScenePostPass(const sg_pass_action& action,
                                       int height,
                                       int sampleCount);
 void      Renderer_EndScenePostPass(void);
+// True when the scene post pass also binds the normal targets, so the map
+// is drawn once with Renderer_DrawMapWithNormals and the normal pass is
+// skipped. False without a working MRT pipeline, or when the
+// WARPED_SEPARATE_NORMAL_PASS environment variable is set.
+bool      Renderer_ScenePostPassWritesNormals(void);
 bool      Renderer_BeginNormalPostPass(int width, int height);
 void      Renderer_EndNormalPostPass(void);
 void      Renderer_DrawPencilPostProcess(float timeSeconds);
@@ -43,3 +43,161 @@ void main() {
 @end
 
 @program map vs_map fs_map
+
+// Scene pass for the pencil post-process: the map colour plus the view-space
+// normal and distance the normal pass would write, from one geometry pass.
+@vs vs_map_mrt
+layout(binding=0) uniform vs_mrt_params {
+    mat4 u_mvp;
+    mat4 u_normal_model;
+};
+
+layout(location=0) in vec3 a_pos;
+layout(location=1) in vec3 a_nrm;
+layout(location=2) in vec2 a_uv;
+layout(location=3) in vec2 a_lmuv;
+
+out vec3 v_nrm;
+out float v_view_dist;
+out vec2 v_uv;
+out vec2 v_lmuv;
+
+void main() {
+    v_nrm = normalize(mat3(u_normal_model) * a_nrm);
+    vec4 view_pos = u_normal_model * vec4(a_pos, 1.0);
+    v_view_dist = max(-view_pos.z, 0.0);
+    v_uv = a_uv;
+    v_lmuv = a_lmuv;
+    gl_Position = u_mvp * vec4(a_pos, 1.0);
+}
+@end
+
+@fs fs_map_mrt
+layout(binding=0) uniform texture2D u_tex;
+layout(binding=1) uniform texture2D u_lm;
+layout(binding=0) uniform sampler u_tex_smp;
+layout(binding=1) uniform sampler u_lm_smp;
+
+in vec3 v_nrm;
+in float v_view_dist;
+in vec2 v_uv;
+in vec2 v_lmuv;
+
+layout(location=0) out vec4 frag_color;
+layout(location=1) out vec4 frag_normal;
+layout(location=2) out vec4 frag_depth_out;
+
+void main() {
+    vec4 c = texture(sampler2D(u_tex, u_tex_smp), v_uv);
+    vec3 lm = texture(sampler2D(u_lm, u_lm_smp), v_lmuv).rgb;
+    frag_color = vec4(c.rgb * lm * 2.0, c.a);
+    frag_normal = vec4(normalize(v_nrm) * 0.5 + 0.5, 1.0);
+    frag_depth_out = vec4(v_view_dist / 4096.0, 0.0, 0.0, 0.0);
+}
+@end
+
+@program map_mrt vs_map_mrt fs_map_mrt
+
+// Texture-array variants, for models with every texture and lightmap page
+// in an array: a_layers.xy picks each vertex's diffuse and lightmap layer,
+// so draws that only differ by layer share bindings, and a_layers.zw
+// scales the lightmap uv to a page padded out to its array's size.
+@vs vs_map_array
+layout(binding=0) uniform vs_params {
+    mat4 u_mvp;
+    mat4 u_model;
+};
+
+layout(location=0) in vec3 a_pos;
+layout(location=1) in vec3 a_nrm;
+layout(location=2) in vec2 a_uv;
+layout(location=3) in vec2 a_lmuv;
+layout(location=4) in vec4 a_layers;
+
+out vec3 v_nrm;
+out vec3 v_uv;
+out vec3 v_lmuv;
+
+void main() {
+    v_nrm = mat3(u_model) * a_nrm;
+    vec2 layers = floor(a_layers.xy * 65535.0 + 0.5);
+    v_uv = vec3(a_uv, layers.x);
+    v_lmuv = vec3(a_lmuv * a_layers.zw, layers.y);
+    gl_Position = u_mvp * vec4(a_pos, 1.0);
+}
+@end
+
+@fs fs_map_array
+layout(binding=0) uniform texture2DArray u_tex_array;
+layout(binding=1) uniform texture2DArray u_lm_array;
+layout(binding=0) uniform sampler u_tex_smp;
+layout(binding=1) uniform sampler u_lm_smp;
+
+in vec3 v_nrm;
+in vec3 v_uv;
+in vec3 v_lmuv;
+
+out vec4 frag_color;
+
+void main() {
+    vec4 c = texture(sampler2DArray(u_tex_array, u_tex_smp), v_uv);
+    vec3 lm = texture(sampler2DArray(u_lm_array, u_lm_smp), v_lmuv).rgb;
+    frag_color = vec4(c.rgb * lm * 2.0, c.a);
+}
+@end
+
+@program map_array vs_map_array fs_map_array
+
+@vs vs_map_array_mrt
+layout(binding=0) uniform vs_mrt_params {
+    mat4 u_mvp;
+    mat4 u_normal_model;
+};
+
+layout(location=0) in vec3 a_pos;
+layout(location=1) in vec3 a_nrm;
+layout(location=2) in vec2 a_uv;
+layout(location=3) in vec2 a_lmuv;
+layout(location=4) in vec4 a_layers;
+
+out vec3 v_nrm;
+out float v_view_dist;
+out vec3 v_uv;
+out vec3 v_lmuv;
+
+void main() {
+    v_nrm = normalize(mat3(u_normal_model) * a_nrm);
+    vec4 view_pos = u_normal_model * vec4(a_pos, 1.0);
+    v_view_dist = max(-view_pos.z, 0.0);
+    vec2 layers = floor(a_layers.xy * 65535.0 + 0.5);
+    v_uv = vec3(a_uv, layers.x);
+    v_lmuv = vec3(a_lmuv * a_layers.zw, layers.y);
+    gl_Position = u_mvp * vec4(a_pos, 1.0);
+}
+@end
+
+@fs fs_map_array_mrt
+layout(binding=0) uniform texture2DArray u_tex_array;
+layout(binding=1) uniform texture2DArray u_lm_array;
+layout(binding=0) uniform sampler u_tex_smp;
+layout(binding=1) uniform sampler u_lm_smp;
+
+in vec3 v_nrm;
+in float v_view_dist;
+in vec3 v_uv;
+in vec3 v_lmuv;
+
+layout(location=0) out vec4 frag_color;
+layout(location=1) out vec4 frag_normal;
+layout(location=2) out vec4 frag_depth_out;
+
+void main() {
+    vec4 c = texture(sampler2DArray(u_tex_array, u_tex_smp), v_uv);
+    vec3 lm = texture(sampler2DArray(u_lm_array, u_lm_smp), v_lmuv).rgb;
+    frag_color = vec4(c.rgb * lm * 2.0, c.a);
+    frag_normal = vec4(normalize(v_nrm) * 0.5 + 0.5, 1.0);
+    frag_depth_out = vec4(v_view_dist / 4096.0, 0.0, 0.0, 0.0);
+}
+@end
+
+@program map_array_mrt vs_map_array_mrt fs_map_array_mrt
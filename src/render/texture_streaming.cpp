@@ -0,0 +1,430 @@
+#include "texture_streaming.h"
+#include "renderer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <queue>
+
+namespace {
+
+// Range that stays allocated until pending work lands: a pending load adds
+// levels, a pending eviction frees them only once it is applied.
+int CommittedTop(const StreamedTexture& tex)
+{
+    return tex.pendingTop >= 0 ? std::min(tex.pendingTop, tex.residentTop) : tex.residentTop;
+}
+
+// Range the texture is heading for.
+int TargetTop(const StreamedTexture& tex)
+{
+    return tex.pendingTop >= 0 ? tex.pendingTop : tex.residentTop;
+}
+
+TextureStreamJob MakeJob(const StreamedTexture& tex, int id, int top)
+{
+    TextureStreamJob job;
+    job.texture = id;
+    job.top = top;
+    job.format = tex.format;
+    job.decodeToRGBA8 = tex.decodeToRGBA8;
+    job.levels.assign(tex.levels.begin() + top, tex.levels.end());
+    return job;
+}
+
+void PrepareJob(TextureStreamJob& job)
+{
+    for (const MipmapLevelView& level : job.levels) {
+        if (job.decodeToRGBA8) {
+            std::vector<uint8_t> rgba;
+            if (!DecodeTextureLevelRGBA8(job.format, level.width, level.height, level.pixels, level.size, &rgba)) {
+                rgba.assign((size_t)level.width * level.height * 4, 255);
+            }
+            job.decoded.push_back(std::move(rgba));
+        } else {
+            // Touch every page of the mapping here so sg_make_image on the
+            // frame thread does not take the faults.
+            volatile unsigned char sink = 0;
+            for (size_t i = 0; i < level.size; i += 4096) {
+                sink = sink ^ level.pixels[i];
+            }
+            (void)sink;
+        }
+    }
+}
+
+void TextureStreamingWorker(TextureStreamer* streamer)
+{
+    std::unique_lock<std::mutex> lock(streamer->mutex);
+    for (;;) {
+        streamer->wake.wait(lock, [streamer]() { return streamer->stopping || !streamer->queue.empty(); });
+        if (streamer->stopping) {
+            return;
+        }
+        TextureStreamJob job = std::move(streamer->queue.front());
+        streamer->queue.pop_front();
+        lock.unlock();
+        PrepareJob(job);
+        lock.lock();
+        streamer->completed.push_back(std::move(job));
+    }
+}
+
+// The texture as Register tracks it, with its always-resident range worked
+// out; no sokol calls.
+StreamedTexture MakeStreamedTexture(const std::string& name,
+                                    TextureEntry* entry,
+                                    const MipmapChainView& chain,
+                                    sg_pixel_format uploadFormat)
+{
+    StreamedTexture tex;
+    tex.name = name;
+    tex.entry = entry;
+    tex.format = chain.format;
+    tex.uploadFormat = uploadFormat;
+    tex.decodeToRGBA8 = uploadFormat == SG_PIXELFORMAT_RGBA8 && chain.format != TEXTURE_PIXEL_RGBA8;
+    tex.levels = chain.levels;
+    if (tex.levels.size() > (size_t)SG_MAX_MIPMAPS) {
+        tex.levels.resize(SG_MAX_MIPMAPS);
+    }
+
+    const int count = (int)tex.levels.size();
+    tex.rangeBytes.assign((size_t)count + 1, 0);
+    for (int m = count - 1; m >= 0; --m) {
+        const MipmapLevelView& level = tex.levels[m];
+        const size_t levelBytes = tex.decodeToRGBA8 ? (size_t)level.width * level.height * 4 : level.size;
+        tex.rangeBytes[m] = tex.rangeBytes[m + 1] + levelBytes;
+    }
+    tex.minTop = count - 1;
+    while (tex.minTop > 0 &&
+           std::max(tex.levels[tex.minTop - 1].width, tex.levels[tex.minTop - 1].height) <= STREAMING_MIN_RESIDENT_SIZE) {
+        --tex.minTop;
+    }
+    tex.residentTop = tex.minTop;
+    tex.wantedTop = tex.minTop;
+    return tex;
+}
+
+bool MakeStreamedImage(const StreamedTexture& tex, const TextureStreamJob& job, sg_image* outImage, sg_view* outView)
+{
+    sg_image_desc id = {};
+    id.width = job.levels[0].width;
+    id.height = job.levels[0].height;
+    id.num_mipmaps = (int)job.levels.size();
+    id.pixel_format = tex.uploadFormat;
+    for (size_t m = 0; m < job.levels.size(); ++m) {
+        if (job.decodeToRGBA8) {
+            id.data.mip_levels[m] = { job.decoded[m].data(), job.decoded[m].size() };
+        } else {
+            id.data.mip_levels[m] = { job.levels[m].pixels, job.levels[m].size };
+        }
+    }
+    id.label = tex.name.c_str();
+    sg_image image = sg_make_image(&id);
+    if (sg_query_image_state(image) != SG_RESOURCESTATE_VALID) {
+        sg_destroy_image(image);
+        return false;
+    }
+
+    sg_view_desc vd = {};
+    vd.texture.image = image;
+    *outImage = image;
+    *outView = sg_make_view(&vd);
+    return true;
+}
+
+} // namespace
+
+void TextureStreaming_Init(TextureStreamer& streamer, size_t budgetBytes)
+{
+    TextureStreaming_Shutdown(streamer);
+    streamer.budgetBytes = budgetBytes;
+}
+
+void TextureStreaming_Shutdown(TextureStreamer& streamer)
+{
+    TextureStreaming_Flush(streamer);
+    streamer.textures.clear();
+    streamer.frame = 1;
+    streamer.stats = TextureStreamingStats{};
+}
+
+void TextureStreaming_Flush(TextureStreamer& streamer)
+{
+    if (streamer.worker.joinable()) {
+        {
+            std::lock_guard<std::mutex> lock(streamer.mutex);
+            streamer.stopping = true;
+        }
+        streamer.wake.notify_all();
+        streamer.worker.join();
+    }
+    streamer.stopping = false;
+    streamer.queue.clear();
+    streamer.completed.clear();
+    for (StreamedTexture& tex : streamer.textures) {
+        tex.pendingTop = -1;
+    }
+    streamer.stats.committedBytes = streamer.stats.residentBytes;
+    streamer.stats.jobsInFlight = 0;
+}
+
+TextureStreamJob TextureStreaming_PrepareResident(const MipmapChainView& chain, sg_pixel_format uploadFormat)
+{
+    TextureStreamJob job;
+    if (chain.levels.empty() || uploadFormat == SG_PIXELFORMAT_NONE) {
+        return job;
+    }
+    const StreamedTexture tex = MakeStreamedTexture(std::string(), nullptr, chain, uploadFormat);
+    job = MakeJob(tex, -1, tex.minTop);
+    PrepareJob(job);
+    return job;
+}
+
+int TextureStreaming_Register(TextureStreamer& streamer,
+                              const std::string& name,
+                              TextureEntry* entry,
+                              const MipmapChainView& chain,
+                              sg_pixel_format uploadFormat,
+                              TextureStreamJob* prepared)
+{
+    if (chain.levels.empty() || uploadFormat == SG_PIXELFORMAT_NONE) {
+        return -1;
+    }
+
+    StreamedTexture tex = MakeStreamedTexture(name, entry, chain, uploadFormat);
+    const int count = (int)tex.levels.size();
+    // Slots TextureStreaming_Remove freed are taken first.
+    int id = 0;
+    while (id < (int)streamer.textures.size() && streamer.textures[id].entry) {
+        ++id;
+    }
+    TextureStreamJob job;
+    if (prepared && prepared->top == tex.minTop && !prepared->levels.empty()) {
+        job = std::move(*prepared);
+        job.texture = id;
+    } else {
+        job = MakeJob(tex, id, tex.minTop);
+        PrepareJob(job);
+    }
+    if (!MakeStreamedImage(tex, job, &entry->image, &entry->view)) {
+        printf("[TextureStreaming] Failed to create '%s' (%s)\n", name.c_str(), TexturePixelFormatName(tex.format));
+        return -1;
+    }
+    entry->width = tex.levels[0].width;
+    entry->height = tex.levels[0].height;
+    entry->streamId = id;
+
+    printf("[TextureStreaming] '%s': %dx%d, %d mip levels, %s%s, resident from %dx%d\n",
+           name.c_str(), entry->width, entry->height, count, TexturePixelFormatName(tex.format),
+           tex.decodeToRGBA8 ? " (decoded to RGBA8)" : "",
+           tex.levels[tex.minTop].width, tex.levels[tex.minTop].height);
+
+    streamer.stats.residentBytes += tex.rangeBytes[tex.minTop];
+    streamer.stats.committedBytes += tex.rangeBytes[tex.minTop];
+    if (id < (int)streamer.textures.size()) {
+        streamer.textures[id] = std::move(tex);
+    } else {
+        streamer.textures.push_back(std::move(tex));
+    }
+    return id;
+}
+
+void TextureStreaming_Rebind(TextureStreamer& streamer, int id, const std::string& name, const MipmapChainView& chain)
+{
+    if (id < 0 || id >= (int)streamer.textures.size()) {
+        return;
+    }
+    StreamedTexture& tex = streamer.textures[id];
+    if (chain.levels.size() < tex.levels.size()) {
+        return;
+    }
+    tex.name = name;
+    std::copy_n(chain.levels.begin(), tex.levels.size(), tex.levels.begin());
+}
+
+void TextureStreaming_Remove(TextureStreamer& streamer, int id)
+{
+    if (id < 0 || id >= (int)streamer.textures.size()) {
+        return;
+    }
+    StreamedTexture& tex = streamer.textures[id];
+    streamer.stats.residentBytes -= tex.rangeBytes[tex.residentTop];
+    streamer.stats.committedBytes -= tex.rangeBytes[CommittedTop(tex)];
+    // An empty slot plans to nothing: no levels, no bytes, never requested.
+    tex = StreamedTexture{};
+    tex.rangeBytes.assign(1, 0);
+}
+
+int TextureStreaming_LevelForTexelRate(const StreamedTexture& tex, float texelsPerPixel)
+{
+    if (!(texelsPerPixel > 1.0f)) {
+        return 0;
+    }
+    const int level = (int)std::floor(std::log2(texelsPerPixel));
+    return std::min(level, (int)tex.levels.size() - 1);
+}
+
+void TextureStreaming_Request(TextureStreamer& streamer, int id, float texelsPerPixel)
+{
+    if (id < 0 || id >= (int)streamer.textures.size()) {
+        return;
+    }
+    StreamedTexture& tex = streamer.textures[id];
+    const int level = TextureStreaming_LevelForTexelRate(tex, texelsPerPixel);
+    if (tex.lastWantedFrame != streamer.frame) {
+        tex.lastWantedFrame = streamer.frame;
+        tex.wantedTop = level;
+    } else {
+        tex.wantedTop = std::min(tex.wantedTop, level);
+    }
+}
+
+void PlanTextureResidency(const std::vector<StreamedTexture>& textures,
+                          size_t budgetBytes,
+                          uint64_t frame,
+                          std::vector<int>* outTop)
+{
+    std::vector<int>& top = *outTop;
+    top.resize(textures.size());
+    size_t total = 0;
+    for (size_t i = 0; i < textures.size(); ++i) {
+        const StreamedTexture& tex = textures[i];
+        int t = TargetTop(tex);
+        if (tex.lastWantedFrame == frame) {
+            t = std::min(t, tex.wantedTop);
+        }
+        top[i] = std::min(t, tex.minTop);
+        total += tex.rangeBytes[top[i]];
+    }
+    if (total <= budgetBytes) {
+        return;
+    }
+
+    // Drop order: least recently requested first, and among equals the
+    // texture whose current top level is the largest.
+    auto dropsLater = [&](size_t a, size_t b) {
+        const StreamedTexture& ta = textures[a];
+        const StreamedTexture& tb = textures[b];
+        if (ta.lastWantedFrame != tb.lastWantedFrame) {
+            return ta.lastWantedFrame > tb.lastWantedFrame;
+        }
+        const size_t bytesA = ta.rangeBytes[top[a]] - ta.rangeBytes[top[a] + 1];
+        const size_t bytesB = tb.rangeBytes[top[b]] - tb.rangeBytes[top[b] + 1];
+        return bytesA < bytesB;
+    };
+    std::priority_queue<size_t, std::vector<size_t>, decltype(dropsLater)> drop(dropsLater);
+    for (size_t i = 0; i < textures.size(); ++i) {
+        if (top[i] < textures[i].minTop) {
+            drop.push(i);
+        }
+    }
+    while (total > budgetBytes && !drop.empty()) {
+        const size_t i = drop.top();
+        drop.pop();
+        const StreamedTexture& tex = textures[i];
+        total -= tex.rangeBytes[top[i]] - tex.rangeBytes[top[i] + 1];
+        ++top[i];
+        if (top[i] < tex.minTop) {
+            drop.push(i);
+        }
+    }
+}
+
+void TextureStreaming_Update(TextureStreamer& streamer)
+{
+    std::vector<TextureStreamJob> finished;
+    {
+        std::lock_guard<std::mutex> lock(streamer.mutex);
+        const size_t take = std::min(streamer.completed.size(), (size_t)STREAMING_MAX_UPLOADS_PER_FRAME);
+        finished.assign(std::make_move_iterator(streamer.completed.begin()),
+                        std::make_move_iterator(streamer.completed.begin() + take));
+        streamer.completed.erase(streamer.completed.begin(), streamer.completed.begin() + take);
+    }
+    for (const TextureStreamJob& job : finished) {
+        StreamedTexture& tex = streamer.textures[job.texture];
+        sg_image image = {};
+        sg_view view = {};
+        if (MakeStreamedImage(tex, job, &image, &view)) {
+            sg_destroy_view(tex.entry->view);
+            sg_destroy_image(tex.entry->image);
+            tex.entry->image = image;
+            tex.entry->view = view;
+            if (job.top < tex.residentTop) {
+                ++streamer.stats.loads;
+            } else {
+                ++streamer.stats.evictions;
+            }
+            tex.residentTop = job.top;
+        } else {
+            printf("[TextureStreaming] Failed to upload '%s' from mip %d, keeping mip %d\n",
+                   tex.name.c_str(), job.top, tex.residentTop);
+        }
+        tex.pendingTop = -1;
+    }
+
+    std::vector<int> top;
+    PlanTextureResidency(streamer.textures, streamer.budgetBytes, streamer.frame, &top);
+
+    // Evictions go to the front of the queue; loads follow, biggest shortfall
+    // first, as long as they fit next to what is already committed.
+    std::vector<TextureStreamJob> evictions;
+    std::vector<int> loads;
+    size_t committed = 0;
+    size_t resident = 0;
+    int inFlight = 0;
+    for (size_t i = 0; i < streamer.textures.size(); ++i) {
+        StreamedTexture& tex = streamer.textures[i];
+        committed += tex.rangeBytes[CommittedTop(tex)];
+        resident += tex.rangeBytes[tex.residentTop];
+        if (tex.pendingTop >= 0) {
+            ++inFlight;
+        } else if (top[i] > tex.residentTop) {
+            tex.pendingTop = top[i];
+            evictions.push_back(MakeJob(tex, (int)i, top[i]));
+            ++inFlight;
+        } else if (top[i] < tex.residentTop) {
+            loads.push_back((int)i);
+        }
+    }
+    std::sort(loads.begin(), loads.end(), [&](int a, int b) {
+        return streamer.textures[a].residentTop - top[a] > streamer.textures[b].residentTop - top[b];
+    });
+
+    std::vector<TextureStreamJob> loadJobs;
+    for (int i : loads) {
+        if (inFlight >= STREAMING_MAX_JOBS_IN_FLIGHT) {
+            break;
+        }
+        StreamedTexture& tex = streamer.textures[i];
+        const size_t growth = tex.rangeBytes[top[i]] - tex.rangeBytes[tex.residentTop];
+        if (committed + growth > streamer.budgetBytes) {
+            continue;
+        }
+        committed += growth;
+        tex.pendingTop = top[i];
+        loadJobs.push_back(MakeJob(tex, i, top[i]));
+        ++inFlight;
+    }
+
+    if (!evictions.empty() || !loadJobs.empty()) {
+        if (!streamer.worker.joinable()) {
+            streamer.worker = std::thread(TextureStreamingWorker, &streamer);
+        }
+        {
+            std::lock_guard<std::mutex> lock(streamer.mutex);
+            for (TextureStreamJob& job : evictions) {
+                streamer.queue.push_front(std::move(job));
+            }
+            for (TextureStreamJob& job : loadJobs) {
+                streamer.queue.push_back(std::move(job));
+            }
+        }
+        streamer.wake.notify_one();
+    }
+
+    streamer.stats.residentBytes = resident;
+    streamer.stats.committedBytes = committed;
+    streamer.stats.jobsInFlight = inFlight;
+    ++streamer.frame;
+}
@@ -0,0 +1,135 @@
+// texture_streaming.h  —  mip residency for textures read from the asset pack.
+//
+// Pack textures start with only their small mips on the GPU. Every frame the
+// renderer reports the largest mip each visible submesh needs, derived from
+// its projected texel density; the planner then picks a residency for every
+// texture that fits the byte budget, dropping top mips of the least recently
+// needed textures first. A worker thread prepares each new mip range
+// (faulting in the mapped pack pages, or decoding BCn to RGBA8 for backends
+// that cannot sample it) and the frame thread swaps the finished image into
+// its TextureEntry.
+//
+// Only TextureStreaming_Register and TextureStreaming_Update create or
+// destroy sokol resources, so the planner, budget accounting and decode
+// queue run headless against the dummy backend.
+#pragma once
+
+#include "sokol_gfx.h"
+#include "../utils/asset_pack.h"
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+struct TextureEntry;     // renderer.h
+
+// Levels up to this size (largest side) are always resident.
+static constexpr int STREAMING_MIN_RESIDENT_SIZE = 32;
+static constexpr int STREAMING_MAX_JOBS_IN_FLIGHT = 8;
+static constexpr int STREAMING_MAX_UPLOADS_PER_FRAME = 4;
+
+struct StreamedTexture {
+    std::string                  name;
+    TextureEntry*                entry = nullptr;
+    uint32_t                     format = TEXTURE_PIXEL_RGBA8;  // as stored in the pack
+    sg_pixel_format              uploadFormat = SG_PIXELFORMAT_NONE;
+    bool                         decodeToRGBA8 = false;
+    std::vector<MipmapLevelView> levels;      // level 0 = full size, views into the pack
+    std::vector<size_t>          rangeBytes;  // GPU bytes of levels [top, count), count + 1 entries
+    int                          minTop = 0;       // first always-resident level
+    int                          residentTop = 0;  // levels [residentTop, count) are on the GPU
+    int                          pendingTop = -1;  // range being prepared, -1 if none
+    int                          wantedTop = 0;    // smallest level requested this frame
+    uint64_t                     lastWantedFrame = 0;
+};
+
+// Carries its own copy of the level views: the worker never reads
+// TextureStreamer::textures, which the frame thread may grow meanwhile.
+struct TextureStreamJob {
+    int                                texture = -1;
+    int                                top = 0;
+    uint32_t                           format = TEXTURE_PIXEL_RGBA8;
+    bool                               decodeToRGBA8 = false;
+    std::vector<MipmapLevelView>       levels;    // [top, count) of the texture
+    std::vector<std::vector<uint8_t>>  decoded;   // one per level when decodeToRGBA8
+};
+
+struct TextureStreamingStats {
+    size_t   residentBytes = 0;
+    size_t   committedBytes = 0;   // resident, or pending where that is larger
+    int      jobsInFlight = 0;
+    uint64_t loads = 0;
+    uint64_t evictions = 0;
+};
+
+struct TextureStreamer {
+    std::vector<StreamedTexture> textures;
+    size_t                       budgetBytes = 0;
+    uint64_t                     frame = 1;
+    TextureStreamingStats        stats;
+
+    // Worker. `queue` and `completed` are guarded by `mutex`.
+    std::thread                   worker;
+    std::mutex                    mutex;
+    std::condition_variable       wake;
+    std::deque<TextureStreamJob>  queue;
+    std::vector<TextureStreamJob> completed;
+    bool                          stopping = false;
+};
+
+void TextureStreaming_Init(TextureStreamer& streamer, size_t budgetBytes);
+// Joins the worker and forgets every texture. The entries themselves (and
+// their images) belong to the TextureManager. Must run before the pack the
+// views point into is closed.
+void TextureStreaming_Shutdown(TextureStreamer& streamer);
+// Waits out the job the worker is on and drops every queued and finished
+// one, so nothing reads the pack any more; each texture keeps the mips it
+// has. The worker starts again with the next update that queues work.
+void TextureStreaming_Flush(TextureStreamer& streamer);
+
+// Decodes or faults in the always-resident mips Register uploads, without
+// touching sokol, so a loader thread can do it ahead of the frame thread.
+TextureStreamJob TextureStreaming_PrepareResident(const MipmapChainView& chain,
+                                                  sg_pixel_format uploadFormat);
+
+// Creates the entry's image with the always-resident mips and returns the
+// stream id. `uploadFormat` is the sokol format for `chain.format`, or RGBA8
+// when the backend cannot sample it and the levels need decoding. `prepared`,
+// from TextureStreaming_PrepareResident with the same arguments, is consumed
+// instead of preparing the mips here.
+int  TextureStreaming_Register(TextureStreamer& streamer,
+                               const std::string& name,
+                               TextureEntry* entry,
+                               const MipmapChainView& chain,
+                               sg_pixel_format uploadFormat,
+                               TextureStreamJob* prepared = nullptr);
+
+// Points texture `id` at another copy of the same mips, such as the next
+// map's pack, and renames it. Only while nothing is pending, e.g. after
+// TextureStreaming_Flush.
+void TextureStreaming_Rebind(TextureStreamer& streamer, int id, const std::string& name, const MipmapChainView& chain);
+// Forgets texture `id` and frees its slot for the next Register; its entry
+// and image belong to the caller. Only while nothing is pending for it.
+void TextureStreaming_Remove(TextureStreamer& streamer, int id);
+
+// Mip level whose texels come closest to one per screen pixel, given how many
+// level-0 texels one pixel covers. Clamped to the chain.
+int  TextureStreaming_LevelForTexelRate(const StreamedTexture& tex, float texelsPerPixel);
+void TextureStreaming_Request(TextureStreamer& streamer, int id, float texelsPerPixel);
+
+// Residency each texture should move to: requests from this frame, textures
+// keep what they have otherwise, and while over budget the least recently
+// requested textures lose their top mips one level at a time.
+void PlanTextureResidency(const std::vector<StreamedTexture>& textures,
+                          size_t budgetBytes,
+                          uint64_t frame,
+                          std::vector<int>* outTop);
+
+// Once per frame, after the requests and before drawing: swaps in finished
+// ranges, plans, and queues loads (within the budget) and evictions.
+void TextureStreaming_Update(TextureStreamer& streamer);
@@ -0,0 +1,327 @@
+// map_draw_test.cpp  —  headless draw-call counts of the map's scene passes.
+//
+//   Usage:  ./map_draw_test
+//
+// Draws small synthetic map models through the pencil post-process passes
+// on sokol's dummy backend, once with the MRT scene pass writing the normals
+// and once with WARPED_SEPARATE_NORMAL_PASS, and with and without
+// TEXTURE_ARRAYS, and compares the sokol calls Renderer_GetDrawStats counts
+// for each frame. A map.metal_dx11.h without the map_mrt or map_array
+// program makes the renderer fall back, so the fallback's counts are
+// checked instead. Prints the counts and each failed check, and exits
+// non-zero on a failure.
+
+#include "../render/renderer.h"
+#include "../utils/parameters.h"
+#include "sokol_glue.h"
+
+// The same header and include path as the renderer, to see which programs
+// it was built with.
+#include "render/shaders/generated/map.metal_dx11.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+namespace {
+
+#if defined(ATTR_warped_map_shader_map_mrt_a_pos)
+constexpr bool kMapMrtProgram = true;
+#else
+constexpr bool kMapMrtProgram = false;
+#endif
+#if defined(ATTR_warped_map_shader_map_array_a_pos)
+constexpr bool kMapArrayProgram = true;
+#else
+constexpr bool kMapArrayProgram = false;
+#endif
+
+int g_failures = 0;
+
+void Check(bool ok, const char* what)
+{
+    if (!ok) {
+        printf("[map_draw_test] FAILED: %s\n", what);
+        ++g_failures;
+    }
+}
+
+constexpr int kWidth = 320;
+constexpr int kHeight = 180;
+constexpr int kQuadIndices = 6;
+
+// A row of quads ten units in front of the camera, one cluster each, split
+// into one submesh per texture. Only the index ranges and bounds matter to
+// the draw path, so the buffers hold zeros. With `arrays` the textures are
+// also layers of one array, as TEXTURE_ARRAYS packs same-size textures.
+struct TestMap {
+    std::vector<TextureEntry> textures;
+    MapModel                  model;
+};
+
+void BuildTestMap(TestMap& map, int textureCount, int clustersPerTexture, bool arrays = false)
+{
+    map.textures.resize((size_t)textureCount);
+    for (TextureEntry& entry : map.textures) {
+        sg_image_desc idesc = {};
+        idesc.width = 4;
+        idesc.height = 4;
+        idesc.pixel_format = SG_PIXELFORMAT_RGBA8;
+        entry.image = sg_make_image(&idesc);
+        sg_view_desc vdesc = {};
+        vdesc.texture.image = entry.image;
+        entry.view = sg_make_view(&vdesc);
+        entry.width = 4;
+        entry.height = 4;
+    }
+
+    MapModel& mdl = map.model;
+    const int clusterCount = textureCount * clustersPerTexture;
+    std::vector<AABB> bounds;
+    for (int t = 0; t < textureCount; ++t) {
+        SubMesh sm;
+        sm.texture = &map.textures[(size_t)t];
+        sm.texture_slot = arrays ? 0 : (uint16_t)t;
+        if (arrays) {
+            sm.texture_array = 0;
+            sm.texture_layer = (uint16_t)t;
+        }
+        sm.fullbright = true;
+        sm.first_index = t * clustersPerTexture * kQuadIndices;
+        sm.index_count = clustersPerTexture * kQuadIndices;
+        sm.first_cluster = (int)mdl.clusters.size();
+        sm.cluster_count = clustersPerTexture;
+        for (int c = 0; c < clustersPerTexture; ++c) {
+            const int i = (int)mdl.clusters.size();
+            const float x = -8.0f + 16.0f * ((float)i + 0.5f) / (float)clusterCount;
+            MapCluster cluster;
+            cluster.first_index = i * kQuadIndices;
+            cluster.index_count = kQuadIndices;
+            cluster.bounds = AABB{ { x - 0.2f, -1.0f, -10.0f }, { x + 0.2f, 1.0f, -10.0f } };
+            mdl.clusters.push_back(cluster);
+            bounds.push_back(cluster.bounds);
+        }
+        sm.bounds = mdl.clusters[(size_t)sm.first_cluster].bounds;
+        mdl.meshes.push_back(sm);
+    }
+    mdl.clusterVisible.assign(mdl.clusters.size(), 1);
+    MapCull_Build(mdl.cull, bounds, {}, {}, -1);
+
+    std::vector<uint8_t> vertices((size_t)clusterCount * 4 * sizeof(BSPVertex), 0);
+    std::vector<uint32_t> indices((size_t)clusterCount * kQuadIndices, 0);
+    sg_buffer_desc bdesc = {};
+    bdesc.data = { vertices.data(), vertices.size() };
+    mdl.vbuf = sg_make_buffer(&bdesc);
+    bdesc = {};
+    bdesc.usage.index_buffer = true;
+    bdesc.data = { indices.data(), indices.size() * sizeof(uint32_t) };
+    mdl.ibuf = sg_make_buffer(&bdesc);
+
+    if (arrays) {
+        sg_image_desc idesc = {};
+        idesc.type = SG_IMAGETYPE_ARRAY;
+        idesc.width = 4;
+        idesc.height = 4;
+        idesc.num_slices = textureCount;
+        idesc.pixel_format = SG_PIXELFORMAT_RGBA8;
+        mdl.textureArrayImages.push_back(sg_make_image(&idesc));
+        sg_view_desc vdesc = {};
+        vdesc.texture.image = mdl.textureArrayImages[0];
+        mdl.textureArrayViews.push_back(sg_make_view(&vdesc));
+        std::vector<uint16_t> layers((size_t)clusterCount * 4 * 4, 0);
+        bdesc = {};
+        bdesc.data = { layers.data(), layers.size() * sizeof(uint16_t) };
+        mdl.layerBuf = sg_make_buffer(&bdesc);
+    }
+}
+
+void DestroyTestMap(TestMap& map)
+{
+    sg_destroy_buffer(map.model.vbuf);
+    sg_destroy_buffer(map.model.ibuf);
+    if (map.model.layerBuf.id) {
+        sg_destroy_buffer(map.model.layerBuf);
+    }
+    for (sg_view view : map.model.textureArrayViews) {
+        sg_destroy_view(view);
+    }
+    for (sg_image image : map.model.textureArrayImages) {
+        sg_destroy_image(image);
+    }
+    for (TextureEntry& entry : map.textures) {
+        sg_destroy_view(entry.view);
+        sg_destroy_image(entry.image);
+    }
+}
+
+// One frame of the pencil post-process path, as main.cpp draws it.
+DrawStats DrawFrame(MapModel& mdl, bool* wroteNormals)
+{
+    const Matrix proj = MatrixPerspective(75.0f * DEG2RAD, (float)kWidth / (float)kHeight, 0.1f, 1000.0f);
+    const Matrix view = MatrixLookAt({ 0.0f, 0.0f, 0.0f }, { 0.0f, 0.0f, -1.0f }, { 0.0f, 1.0f, 0.0f });
+    const Matrix mvp = MatrixMultiply(proj, view);
+    Renderer_CullMap(mdl, mvp, FrustumFromVP(mvp));
+
+    *wroteNormals = false;
+    sg_pass_action action = {};
+    if (!Renderer_BeginScenePostPass(action, kWidth, kHeight, 1)) {
+        Check(false, "the scene post pass begins");
+        return Renderer_GetDrawStats();
+    }
+    *wroteNormals = Renderer_ScenePostPassWritesNormals();
+    if (*wroteNormals) {
+        Renderer_DrawMapWithNormals(mdl, mvp, view);
+    } else {
+        Renderer_DrawMap(mdl, mvp, MatrixIdentity());
+    }
+    Renderer_EndScenePostPass();
+    if (!*wroteNormals) {
+        Check(Renderer_BeginNormalPostPass(kWidth, kHeight), "the normal post pass begins");
+        Renderer_DrawMapNormals(mdl, mvp, view);
+        Renderer_EndNormalPostPass();
+    }
+    sg_commit();
+    return Renderer_GetDrawStats();
+}
+
+// Draws `map` under a freshly initialized renderer, with or without the
+// separate normal pass.
+DrawStats DrawWithRenderer(TestMap& map, bool separateNormalPass, bool* wroteNormals)
+{
+#if defined(_WIN32)
+    _putenv_s("WARPED_SEPARATE_NORMAL_PASS", separateNormalPass ? "1" : "");
+#else
+    if (separateNormalPass) {
+        setenv("WARPED_SEPARATE_NORMAL_PASS", "1", 1);
+    } else {
+        unsetenv("WARPED_SEPARATE_NORMAL_PASS");
+    }
+#endif
+    Renderer_Init();
+    const DrawStats stats = DrawFrame(map.model, wroteNormals);
+    Renderer_Shutdown();
+    return stats;
+}
+
+void PrintStats(const char* label, const DrawStats& stats)
+{
+    printf("[map_draw_test] %-31s %u cmds %u pipelines %u binds %u uniforms %u draws\n", label, stats.commands,
+           stats.pipelines, stats.bindings, stats.uniforms, stats.draws);
+}
+
+// One texture, every other cluster hidden: no draw merges in either pass,
+// so the normal pass repeats the scene pass call for call.
+void TestSingleTexture()
+{
+    TestMap map;
+    BuildTestMap(map, 1, 8);
+    for (size_t i = 1; i < map.model.clusterVisible.size(); i += 2) {
+        map.model.clusterVisible[i] = 0;
+    }
+
+    bool wroteNormals = false;
+    const DrawStats mrt = DrawWithRenderer(map, false, &wroteNormals);
+    Check(wroteNormals == kMapMrtProgram, "the scene pass writes the normals exactly when map_mrt exists");
+    const DrawStats separate = DrawWithRenderer(map, true, &wroteNormals);
+    Check(!wroteNormals, "WARPED_SEPARATE_NORMAL_PASS keeps the normals out of the scene pass");
+    PrintStats("one texture, MRT:", mrt);
+    PrintStats("one texture, separate pass:", separate);
+
+    Check(mrt.commands == 4 && separate.commands == 4, "four runs of clusters are drawn");
+    Check(separate.draws == 8, "the separate normal pass draws each run twice");
+    if (kMapMrtProgram) {
+        Check(mrt.draws == 4, "the MRT pass draws each run once");
+        Check(separate.bindings == 2 * mrt.bindings, "the separate normal pass doubles the bindings");
+        Check(separate.pipelines == 2 * mrt.pipelines, "the separate normal pass doubles the pipelines");
+    } else {
+        Check(mrt.draws == separate.draws && mrt.bindings == separate.bindings,
+              "without map_mrt both frames draw the normals in their own pass");
+    }
+    DestroyTestMap(map);
+}
+
+// Several textures: the scene pass rebinds per texture while the normal
+// pass binds once and merges neighbouring ranges, so the MRT pass saves
+// exactly the normal pass's calls rather than half.
+void TestSeveralTextures()
+{
+    TestMap map;
+    BuildTestMap(map, 3, 4);
+
+    bool wroteNormals = false;
+    const DrawStats mrt = DrawWithRenderer(map, false, &wroteNormals);
+    const DrawStats separate = DrawWithRenderer(map, true, &wroteNormals);
+    PrintStats("three textures, MRT:", mrt);
+    PrintStats("three textures, separate pass:", separate);
+
+    Check(separate.bindings == 4 && separate.draws == 4,
+          "the scene pass binds and draws once per texture, the normal pass once for the whole row");
+    if (kMapMrtProgram) {
+        Check(mrt.bindings == 3 && mrt.draws == 3, "the MRT pass binds and draws once per texture");
+    } else {
+        Check(mrt.bindings == separate.bindings && mrt.draws == separate.draws,
+              "without map_mrt both frames draw the normals in their own pass");
+    }
+    DestroyTestMap(map);
+}
+
+// Several textures in one array: every submesh shares the bindings and the
+// commands go in index order, so the whole row merges into one draw where
+// the per-texture views need one each. Without map_array the renderer makes
+// no array pipelines, so the map is built and drawn per texture.
+void TestTextureArrays()
+{
+    TestMap perTexture;
+    BuildTestMap(perTexture, 3, 4);
+    bool wroteNormals = false;
+    const DrawStats before = DrawWithRenderer(perTexture, false, &wroteNormals);
+    DestroyTestMap(perTexture);
+
+    TEXTURE_ARRAYS = true;
+    TestMap arrays;
+    BuildTestMap(arrays, 3, 4, kMapArrayProgram);
+    const DrawStats after = DrawWithRenderer(arrays, false, &wroteNormals);
+    Check(wroteNormals == kMapMrtProgram, "the array pipelines write the normals in the scene pass");
+    const DrawStats afterSeparate = DrawWithRenderer(arrays, true, &wroteNormals);
+    DestroyTestMap(arrays);
+    TEXTURE_ARRAYS = false;
+    PrintStats("three textures, per texture:", before);
+    PrintStats("three textures, arrays:", after);
+    PrintStats("three textures, arrays, separate:", afterSeparate);
+
+    // The separate normal pass binds and draws the merged row once more.
+    const uint32_t normalPass = kMapMrtProgram ? 0 : 1;
+    Check(before.bindings == 3 + normalPass && before.draws == 3 + normalPass,
+          "per-texture views bind and draw once per texture");
+    Check(after.commands == 3, "the arrays keep one command per submesh");
+    if (kMapArrayProgram) {
+        Check(after.bindings == 1 + normalPass && after.draws == 1 + normalPass,
+              "the arrays bind once and draw the row in one merged range");
+        Check(afterSeparate.draws == 2, "the arrays' separate normal pass adds one merged draw");
+    } else {
+        Check(after.bindings == before.bindings && after.draws == before.draws,
+              "without map_array TEXTURE_ARRAYS draws per texture");
+    }
+}
+
+} // namespace
+
+int main()
+{
+    sg_desc desc = {};
+    desc.environment = sglue_environment();
+    sg_setup(&desc);
+    Check(sg_query_backend() == SG_BACKEND_DUMMY, "sokol runs on the dummy backend");
+
+    TestSingleTexture();
+    TestSeveralTextures();
+    TestTextureArrays();
+    sg_shutdown();
+
+    if (g_failures > 0) {
+        printf("[map_draw_test] %d check%s failed\n", g_failures, g_failures == 1 ? "" : "s");
+        return 1;
+    }
+    printf("[map_draw_test] all checks passed\n");
+    return 0;
+}
@@ -0,0 +1,95 @@
+// occlusion_test.cpp  —  headless checks for the software occlusion buffer.
+//
+//   Usage:  ./occlusion_test
+//
+// Renders one large wall in front of a camera looking down -Z and tests
+// boxes against it: a box behind the wall is hidden, boxes in front of it,
+// across its edge or beside it stay visible, and a box reaching through the
+// near plane is never hidden. The same checks run again with enough small
+// far-away occluders on screen to take the banded, multi-threaded path.
+// Prints each failed check and exits non-zero.
+
+#include "../render/occlusion.h"
+
+#include <cstdio>
+#include <vector>
+
+namespace {
+
+int g_failures = 0;
+
+void Check(bool ok, const char* what)
+{
+    if (!ok) {
+        printf("[occlusion_test] FAILED: %s\n", what);
+        ++g_failures;
+    }
+}
+
+constexpr float kNearPlane = 0.1f;
+constexpr float kWallZ = -10.0f;
+constexpr float kWallHalfSize = 5.0f;
+
+void AddQuad(std::vector<BSPOccluder>& occluders, std::vector<BSPVec3>& verts,
+             float x0, float y0, float x1, float y1, float z)
+{
+    occluders.push_back({ (uint32_t)verts.size(), 4 });
+    verts.push_back({ x0, y0, z });
+    verts.push_back({ x1, y0, z });
+    verts.push_back({ x1, y1, z });
+    verts.push_back({ x0, y1, z });
+}
+
+AABB Box(float cx, float cy, float cz, float halfSize)
+{
+    return AABB{ { cx - halfSize, cy - halfSize, cz - halfSize }, { cx + halfSize, cy + halfSize, cz + halfSize } };
+}
+
+void RunCases(int clutter)
+{
+    std::vector<BSPOccluder> occluders;
+    std::vector<BSPVec3> verts;
+    AddQuad(occluders, verts, -kWallHalfSize, -kWallHalfSize, kWallHalfSize, kWallHalfSize, kWallZ);
+    // Small quads far behind the wall, along the bottom of the view where
+    // no test box reaches; they only add on-screen polygons.
+    for (int i = 0; i < clutter; ++i) {
+        const float x = -60.0f + 120.0f * (float)i / (float)clutter;
+        AddQuad(occluders, verts, x, -36.0f, x + 1.0f, -32.0f, -50.0f);
+    }
+
+    OcclusionBuffer buf;
+    Occlusion_Init(buf, occluders, verts);
+    const Matrix proj = MatrixPerspective(75.0f * DEG2RAD, (float)buf.width / (float)buf.height, kNearPlane, 1000.0f);
+    const Matrix view = MatrixLookAt({ 0.0f, 0.0f, 0.0f }, { 0.0f, 0.0f, -1.0f }, { 0.0f, 1.0f, 0.0f });
+    Occlusion_Render(buf, MatrixMultiply(proj, view));
+    Check(buf.polygons.size() == (size_t)clutter + 1, "every occluder reaches the screen");
+
+    Check(!Occlusion_TestAABB(buf, Box(0.0f, 0.0f, -20.0f, 1.0f)), "a box behind the wall is hidden");
+    Check(!Occlusion_TestAABB(buf, Box(3.0f, -3.0f, -12.0f, 0.5f)), "a box behind the wall off its centre is hidden");
+    Check(Occlusion_TestAABB(buf, Box(0.0f, 0.0f, -5.0f, 1.0f)), "a box in front of the wall is visible");
+    Check(Occlusion_TestAABB(buf, Box(0.0f, 0.0f, kWallZ, 1.0f)), "a box through the wall is visible");
+    // At z = -20 the wall's right edge projects to x = 10.
+    Check(Occlusion_TestAABB(buf, Box(10.0f, 0.0f, -20.0f, 1.0f)), "a box across the wall's edge is visible");
+    Check(Occlusion_TestAABB(buf, Box(14.0f, 0.0f, -20.0f, 1.0f)), "a box beside the wall is visible");
+
+    // Reaching through the near plane: its nearest depth is unbounded, so
+    // no occluder can be in front of it, however far back it extends.
+    const AABB straddling = { { -0.5f, -0.5f, -30.0f }, { 0.5f, 0.5f, 0.5f } };
+    Check(Occlusion_TestAABB(buf, straddling), "a box through the near plane is visible");
+    const AABB nearSliver = { { -0.05f, -0.05f, -0.2f }, { 0.05f, 0.05f, -0.05f } };
+    Check(Occlusion_TestAABB(buf, nearSliver), "a box just across the near plane is visible");
+}
+
+} // namespace
+
+int main()
+{
+    RunCases(0);
+    RunCases(80);
+    if (g_failures > 0) {
+        printf("[occlusion_test] %d check%s failed\n", g_failures, g_failures == 1 ? "" : "s");
+        return 1;
+    }
+    printf("[occlusion_test] all checks passed\n");
+    return 0;
+}
@@ -0,0 +1,21 @@
+/*
+ * Test-side sokol implementation TU.
+ *
+ * The headless tests create images and views without a window or GPU, so
+ * sokol_gfx is built against its dummy backend here instead of the app's.
+ * With no sokol_app either, sglue_environment is stood in for below.
+ */
+
+#define SOKOL_IMPL
+#define SOKOL_DUMMY_BACKEND
+
+#include "sokol_gfx.h"
+
+/* The renderer reads its default attachment formats from here. */
+sg_environment sglue_environment(void) {
+    sg_environment env = {0};
+    env.defaults.color_format = SG_PIXELFORMAT_RGBA8;
+    env.defaults.depth_format = SG_PIXELFORMAT_DEPTH_STENCIL;
+    env.defaults.sample_count = 1;
+    return env;
+}
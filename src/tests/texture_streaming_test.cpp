@@ -0,0 +1,216 @@
+// texture_streaming_test.cpp  —  headless checks for the texture streamer.
+//
+//   Usage:  ./texture_streaming_test
+//
+// Plans residency for synthetic textures: everything requested fits an
+// ample budget, the least recently requested texture loses its top mips
+// first, and no budget takes a texture past its always-resident levels.
+// Then runs one load and one eviction through TextureStreaming_Update on
+// sokol's dummy backend. Prints each failed check and exits non-zero.
+
+#include "../render/renderer.h"
+#include "../render/texture_streaming.h"
+
+#include <chrono>
+#include <cstdio>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace {
+
+int g_failures = 0;
+
+void Check(bool ok, const char* what)
+{
+    if (!ok) {
+        printf("[texture_streaming_test] FAILED: %s\n", what);
+        ++g_failures;
+    }
+}
+
+// A square RGBA8 chain from `size` down to 1x1, as Register would track it.
+// Only the level sizes matter to the planner, so no pixels are attached.
+StreamedTexture MakeTexture(int size, uint64_t lastWantedFrame, int wantedTop)
+{
+    StreamedTexture tex;
+    for (int s = size; s >= 1; s /= 2) {
+        tex.levels.push_back({ s, s, nullptr, (size_t)s * s * 4 });
+    }
+    const int count = (int)tex.levels.size();
+    tex.rangeBytes.assign((size_t)count + 1, 0);
+    for (int m = count - 1; m >= 0; --m) {
+        tex.rangeBytes[m] = tex.rangeBytes[m + 1] + tex.levels[m].size;
+    }
+    tex.minTop = count - 1;
+    while (tex.minTop > 0 && tex.levels[tex.minTop - 1].width <= STREAMING_MIN_RESIDENT_SIZE) {
+        --tex.minTop;
+    }
+    tex.residentTop = tex.minTop;
+    tex.lastWantedFrame = lastWantedFrame;
+    tex.wantedTop = wantedTop;
+    return tex;
+}
+
+size_t PlannedBytes(const std::vector<StreamedTexture>& textures, const std::vector<int>& top)
+{
+    size_t total = 0;
+    for (size_t i = 0; i < textures.size(); ++i) {
+        total += textures[i].rangeBytes[top[i]];
+    }
+    return total;
+}
+
+void TestFitsBudget()
+{
+    const uint64_t frame = 10;
+    std::vector<StreamedTexture> textures = {
+        MakeTexture(256, frame, 0),
+        MakeTexture(128, frame, 1),
+        MakeTexture(512, frame, 2),
+    };
+    std::vector<int> top;
+    PlanTextureResidency(textures, 64u << 20, frame, &top);
+    Check(top.size() == 3, "plan has one entry per texture");
+    Check(top[0] == 0 && top[1] == 1 && top[2] == 2, "an ample budget grants every request");
+
+    const size_t requested = PlannedBytes(textures, top);
+    PlanTextureResidency(textures, requested, frame, &top);
+    Check(top[0] == 0 && top[1] == 1 && top[2] == 2, "a budget of exactly the requested bytes grants every request");
+}
+
+void TestDropsLeastRecentFirst()
+{
+    // Three fully resident 256x256 textures; only the first is requested
+    // this frame. The budget is one top level short, so exactly one level
+    // has to go, and it must come from the texture wanted longest ago.
+    const uint64_t frame = 10;
+    std::vector<StreamedTexture> textures = {
+        MakeTexture(256, frame, 0),
+        MakeTexture(256, 4, 0),
+        MakeTexture(256, 8, 0),
+    };
+    for (StreamedTexture& tex : textures) {
+        tex.residentTop = 0;
+    }
+    const size_t full = textures[0].rangeBytes[0];
+    const size_t budget = 3 * full - textures[0].levels[0].size;
+    std::vector<int> top;
+    PlanTextureResidency(textures, budget, frame, &top);
+    Check(PlannedBytes(textures, top) <= budget, "plan fits the budget");
+    Check(top[0] == 0, "the texture requested this frame keeps its request");
+    Check(top[1] == 1, "the least recently requested texture loses its top level");
+    Check(top[2] == 0, "a more recently requested texture keeps every level");
+
+    // Tighter: the oldest texture goes all the way down to its resident
+    // floor before the next one loses anything.
+    const size_t tighter = 2 * full + textures[1].rangeBytes[textures[1].minTop];
+    PlanTextureResidency(textures, tighter, frame, &top);
+    Check(PlannedBytes(textures, top) <= tighter, "tighter plan fits the budget");
+    Check(top[1] == textures[1].minTop, "the oldest texture drops to its resident floor first");
+    Check(top[0] == 0 && top[2] == 0, "newer textures are untouched while the oldest can still give");
+}
+
+void TestNeverBelowMinTop()
+{
+    const uint64_t frame = 10;
+    std::vector<StreamedTexture> textures = {
+        MakeTexture(1024, frame, 0),
+        MakeTexture(64, 3, 0),
+        MakeTexture(16, frame, 0),
+    };
+    textures[1].residentTop = 0;
+    std::vector<int> top;
+    PlanTextureResidency(textures, 0, frame, &top);
+    for (size_t i = 0; i < textures.size(); ++i) {
+        Check(top[i] == textures[i].minTop, "a zero budget leaves every texture at its resident floor");
+    }
+    Check(textures[2].minTop == 0, "a texture no larger than the resident size is always whole");
+}
+
+// Polls until the worker has prepared every queued job.
+bool WaitForWorker(TextureStreamer& streamer)
+{
+    for (int i = 0; i < 2000; ++i) {
+        {
+            std::lock_guard<std::mutex> lock(streamer.mutex);
+            if (streamer.queue.empty() && (int)streamer.completed.size() == streamer.stats.jobsInFlight) {
+                return true;
+            }
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    return false;
+}
+
+void TestUpdateRoundTrip()
+{
+    sg_desc desc = {};
+    sg_setup(&desc);
+    Check(sg_query_backend() == SG_BACKEND_DUMMY, "sokol runs on the dummy backend");
+
+    // 256x256 RGBA8 down to 1x1, pixels owned here in place of a pack.
+    std::vector<std::vector<unsigned char>> pixels;
+    MipmapChainView chain;
+    chain.format = TEXTURE_PIXEL_RGBA8;
+    for (int s = 256; s >= 1; s /= 2) {
+        pixels.emplace_back((size_t)s * s * 4, (unsigned char)s);
+    }
+    for (size_t m = 0; m < pixels.size(); ++m) {
+        const int s = 256 >> m;
+        chain.levels.push_back({ s, s, pixels[m].data(), pixels[m].size() });
+    }
+
+    TextureStreamer streamer;
+    TextureStreaming_Init(streamer, 16u << 20);
+    TextureEntry entry = {};
+    const int id = TextureStreaming_Register(streamer, "synthetic", &entry, chain, SG_PIXELFORMAT_RGBA8);
+    Check(id == 0 && entry.streamId == id, "Register hands out the first slot");
+    const StreamedTexture& tex = streamer.textures[(size_t)id];
+    Check(tex.residentTop == tex.minTop && tex.levels[tex.minTop].width == STREAMING_MIN_RESIDENT_SIZE,
+          "a new texture is resident from the minimum resident size");
+    Check(streamer.stats.residentBytes == tex.rangeBytes[tex.minTop], "resident bytes count the small mips");
+
+    // Load: one texel per pixel wants level 0.
+    const sg_image smallImage = entry.image;
+    TextureStreaming_Request(streamer, id, 1.0f);
+    TextureStreaming_Update(streamer);
+    Check(tex.pendingTop == 0 && streamer.stats.jobsInFlight == 1, "a request queues one load to level 0");
+    Check(WaitForWorker(streamer), "the worker prepares the load");
+    TextureStreaming_Request(streamer, id, 1.0f);
+    TextureStreaming_Update(streamer);
+    Check(tex.residentTop == 0 && tex.pendingTop == -1, "the load lands on the next update");
+    Check(entry.image.id != smallImage.id, "the entry's image is swapped for the full chain");
+    Check(streamer.stats.loads == 1 && streamer.stats.residentBytes == tex.rangeBytes[0], "stats count the load");
+
+    // Eviction: with no requests and a budget of the small mips only, the
+    // texture goes back to its resident floor.
+    streamer.budgetBytes = tex.rangeBytes[tex.minTop];
+    TextureStreaming_Update(streamer);
+    Check(tex.pendingTop == tex.minTop, "over budget queues an eviction to the resident floor");
+    Check(WaitForWorker(streamer), "the worker prepares the eviction");
+    TextureStreaming_Update(streamer);
+    Check(tex.residentTop == tex.minTop && streamer.stats.evictions == 1, "the eviction lands on the next update");
+    Check(streamer.stats.residentBytes <= streamer.budgetBytes, "resident bytes are back within the budget");
+
+    TextureStreaming_Shutdown(streamer);
+    sg_destroy_view(entry.view);
+    sg_destroy_image(entry.image);
+    sg_shutdown();
+}
+
+} // namespace
+
+int main()
+{
+    TestFitsBudget();
+    TestDropsLeastRecentFirst();
+    TestNeverBelowMinTop();
+    TestUpdateRoundTrip();
+    if (g_failures > 0) {
+        printf("[texture_streaming_test] %d check%s failed\n", g_failures, g_failures == 1 ? "" : "s");
+        return 1;
+    }
+    printf("[texture_streaming_test] all checks passed\n");
+    return 0;
+}
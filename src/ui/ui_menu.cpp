@@ -53,6 +53,7 @@ static void*                g_clayMemory               = nullptr;
 static Clay_RenderCommandArray g_lastCommands          = {};
 
 static int s_requestedMapIndex = -1;
+static int s_hoveredMapIndex   = -1;
 
 static Clay_String ClayString(const std::string& str) {
     return Clay_String{ false, (int32_t)str.size(), str.c_str() };
@@ -63,13 +64,15 @@ static void HandleClayError(Clay_ErrorData errorData) {
 }
 
 static void HandleMapButtonInteraction(Clay_ElementId, Clay_PointerData pointerData, void* userData) {
+    s_hoveredMapIndex = (int)(intptr_t)userData;
     if (pointerData.state != CLAY_POINTER_DATA_PRESSED_THIS_FRAME) return;
     s_requestedMapIndex = (int)(intptr_t)userData;
 }
 
 static Clay_RenderCommandArray BuildMainMenuLayout(
     const std::vector<MapEntry>& maps,
-    const std::string& status)
+    const std::string& status,
+    float progress)
 {
     const Clay_Color bg          = {  18,  20,  24, 255 };
     const Clay_Color panel       = {  32,  36,  44, 255 };
@@ -125,11 +128,13 @@ static Clay_RenderCommandArray BuildMainMenuLayout(
                 }));
             }
 
-            if (!status.empty()) {
+            if (!status.empty() || progress >= 0.0f) {
                 CLAY(CLAY_ID("Status"), {
                     .backgroundColor = { 44, 49, 58, 255 },
                     .cornerRadius = CLAY_CORNER_RADIUS(12),
                     .layout = {
+                        .layoutDirection = CLAY_TOP_TO_BOTTOM,
+                        .childGap = 10,
                         .padding = CLAY_PADDING_ALL(14),
                         .sizing = { CLAY_SIZING_GROW(0), CLAY_SIZING_FIT(0, 0) },
                     }
@@ -139,6 +144,23 @@ static Clay_RenderCommandArray BuildMainMenuLayout(
                         .fontSize = 16,
                         .textColor = text,
                     }));
+                    if (progress >= 0.0f) {
+                        CLAY(CLAY_ID("Progress"), {
+                            .backgroundColor = bg,
+                            .cornerRadius = CLAY_CORNER_RADIUS(4),
+                            .layout = {
+                                .sizing = { CLAY_SIZING_GROW(0), CLAY_SIZING_FIXED(8) },
+                            }
+                        }) {
+                            CLAY(CLAY_ID("ProgressFill"), {
+                                .backgroundColor = accent,
+                                .cornerRadius = CLAY_CORNER_RADIUS(4),
+                                .layout = {
+                                    .sizing = { CLAY_SIZING_PERCENT(std::min(progress, 1.0f)), CLAY_SIZING_GROW(0) },
+                                }
+                            }) {}
+                        }
+                    }
                 }
             }
 
@@ -211,6 +233,7 @@ void UI_Shutdown() {
 
 void UI_NewFrame() {
     s_requestedMapIndex = -1;
+    s_hoveredMapIndex = -1;
     sclay_new_frame();
 }
 
@@ -286,11 +309,15 @@ void UI_RefreshMapList(std::vector<MapEntry>& maps, std::string& status) {
     }
 }
 
-int UI_UpdateMenu(const std::vector<MapEntry>& maps, const std::string& status) {
-    g_lastCommands = BuildMainMenuLayout(maps, status);
+int UI_UpdateMenu(const std::vector<MapEntry>& maps, const std::string& status, float progress) {
+    g_lastCommands = BuildMainMenuLayout(maps, status, progress);
     return s_requestedMapIndex;
 }
 
+int UI_HoveredMapIndex() {
+    return s_hoveredMapIndex;
+}
+
 void UI_RenderMenu() {
     sclay_render(g_lastCommands, g_clayFonts);
 }
@@ -28,5 +28,9 @@ void UI_Shutdown();
 void UI_NewFrame();
 void UI_HandleEvent(const sapp_event* ev);
 void UI_RefreshMapList(std::vector<MapEntry>& maps, std::string& status);
-int  UI_UpdateMenu(const std::vector<MapEntry>& maps, const std::string& status);
+// `progress` in [0, 1] draws a bar under the status while a map loads;
+// negative hides it.
+int  UI_UpdateMenu(const std::vector<MapEntry>& maps, const std::string& status, float progress = -1.0f);
+// Map button under the pointer in the last UI_UpdateMenu, or -1.
+int  UI_HoveredMapIndex();
 void UI_RenderMenu();
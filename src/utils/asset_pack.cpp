@@ -1,9 +1,13 @@
 #include "asset_pack.h"
+#include "parallel_for.h"
 
 #include <algorithm>
 #include <cmath>
+#include <condition_variable>
 #include <cstdio>
 #include <cstring>
+#include <deque>
+#include <mutex>
 #include <unordered_set>
 
 #include "stb_image.h"
@@ -99,6 +103,60 @@ static std::vector<unsigned char> BuildRawChunkBuffer(const std::vector<unsigned
     return packed;
 }
 
+struct PackDirEntry {
+    uint32_t id = 0;
+    uint32_t offset = 0;   // file offset of the resource's first chunk
+    std::string fileName;
+};
+
+// rres central directory chunk: props { entryCount }, then per entry
+// { id, offset, reserved, fileNameSize, fileName } with the name
+// zero-padded to a multiple of 4 bytes.
+static std::vector<unsigned char> BuildCentralDirChunkBuffer(const std::vector<PackDirEntry> &entries)
+{
+    std::vector<unsigned char> packed;
+    auto putU32 = [&packed](unsigned int value) {
+        const size_t at = packed.size();
+        packed.resize(at + sizeof(value));
+        std::memcpy(packed.data() + at, &value, sizeof(value));
+    };
+
+    putU32(1);
+    putU32((unsigned int)entries.size());
+    for (const PackDirEntry &entry : entries)
+    {
+        const unsigned int nameSize = (unsigned int)((entry.fileName.size() + 1 + 3) & ~(size_t)3);
+        putU32(entry.id);
+        putU32(entry.offset);
+        putU32(0);
+        putU32(nameSize);
+        const size_t at = packed.size();
+        packed.resize(at + nameSize, 0);
+        std::memcpy(packed.data() + at, entry.fileName.data(), entry.fileName.size());
+    }
+    return packed;
+}
+
+// Appends the CDIR chunk and returns its offset for rresFileHeader::cdOffset.
+static unsigned int WriteCentralDirectory(FILE *f, const std::vector<PackDirEntry> &entries)
+{
+    const long cdOffset = ftell(f);
+    std::vector<unsigned char> packed = BuildCentralDirChunkBuffer(entries);
+
+    rresResourceChunkInfo info = { 0 };
+    info.type[0] = 'C'; info.type[1] = 'D'; info.type[2] = 'I'; info.type[3] = 'R';
+    info.id = 0;
+    info.compType = RRES_COMP_NONE;
+    info.cipherType = RRES_CIPHER_NONE;
+    info.packedSize = (unsigned int)packed.size();
+    info.baseSize = (unsigned int)packed.size();
+    info.crc32 = rresComputeCRC32(packed.data(), info.packedSize);
+
+    fwrite(&info, sizeof(info), 1, f);
+    fwrite(packed.data(), 1, packed.size(), f);
+    return (unsigned int)cdOffset;
+}
+
 } // namespace
 
 std::string GetCompanionRresPath(const std::string &path)
@@ -139,9 +197,11 @@ bool WriteAssetPackRres(const std::string &outputPath,
     header.id[2] = 'e';
     header.id[3] = 's';
     header.version = 100;
-    header.chunkCount = (unsigned short)uniqueEntries.size();
+    header.chunkCount = (unsigned short)(uniqueEntries.size() + 1);
     fwrite(&header, sizeof(header), 1, f);
 
+    std::vector<PackDirEntry> dirEntries;
+    dirEntries.reserve(uniqueEntries.size());
     for (const PackagedAssetEntry &entry : uniqueEntries)
     {
         std::vector<unsigned char> rawBytes;
@@ -169,10 +229,14 @@ bool WriteAssetPackRres(const std::string &outputPath,
         info.reserved = 0;
         info.crc32 = rresComputeCRC32(packed.data(), info.packedSize);
 
+        dirEntries.push_back({ info.id, (uint32_t)ftell(f), entry.logicalPath });
         fwrite(&info, sizeof(info), 1, f);
         fwrite(packed.data(), 1, packed.size(), f);
     }
 
+    header.cdOffset = WriteCentralDirectory(f, dirEntries);
+    fseek(f, 0, SEEK_SET);
+    fwrite(&header, sizeof(header), 1, f);
     fclose(f);
     return true;
 }
@@ -266,15 +330,16 @@ static MipmapChain GenerateMipmaps(const unsigned char *rgba, int w, int h)
     return chain;
 }
 
-static std::vector<unsigned char> BuildMipChunkBuffer(int width, int height, int mipCount,
+static std::vector<unsigned char> BuildMipChunkBuffer(int width, int height, int mipCount, uint32_t format,
                                                        const unsigned char *pixels, size_t pixelBytes)
 {
-    const unsigned int propCount = 4;
-    const unsigned int props[4] = {
+    const unsigned int propCount = 5;
+    const unsigned int props[5] = {
         (unsigned int)width,
         (unsigned int)height,
         (unsigned int)mipCount,
-        0
+        format,
+        (unsigned int)pixelBytes
     };
 
     std::vector<unsigned char> packed(sizeof(unsigned int) + sizeof(props) + pixelBytes);
@@ -288,118 +353,351 @@ static std::vector<unsigned char> BuildMipChunkBuffer(int width, int height, int
     return packed;
 }
 
-bool WriteAssetPackRresWithMipmaps(const std::string &outputPath,
-                                   const std::vector<PackagedAssetEntry> &entries,
-                                   std::string *errorMessage)
+static uint32_t ChooseTextureFormat(uint32_t requested, const unsigned char *rgba, int w, int h)
 {
-    std::unordered_set<std::string> seen;
-    std::vector<PackagedAssetEntry> uniqueEntries;
-    uniqueEntries.reserve(entries.size());
-
-    for (const PackagedAssetEntry &entry : entries)
-    {
-        if (entry.logicalPath.empty() || entry.sourcePath.empty()) continue;
-        if (!seen.insert(entry.logicalPath).second) continue;
-        uniqueEntries.push_back(entry);
+    if (requested != ASSET_PACK_TEXTURE_FORMAT_AUTO) return requested;
+    const size_t texelCount = (size_t)w * h;
+    for (size_t i = 0; i < texelCount; ++i) {
+        if (rgba[i * 4 + 3] != 255) return TEXTURE_PIXEL_BC7;
     }
+    return TEXTURE_PIXEL_BC1;
+}
 
-    // Pre-generate all mipmap chains and count total chunks
-    struct TextureMips {
-        MipmapChain chain;
-        std::string logicalPath;
-    };
-    std::vector<TextureMips> allMips;
-    allMips.reserve(uniqueEntries.size());
-    unsigned int totalChunks = 0;
+// One texture's mip chunks, fully built (props, pixels, CRC) on a worker so
+// the writer only has to link and fwrite them. Between the decode and its
+// last encode job the texture also holds its RGBA mips and the BCn levels the
+// block-row jobs fill in.
+struct PackedTextureChunks {
+    std::string logicalPath;
+    int width = 0;
+    int height = 0;
+    uint32_t format = TEXTURE_PIXEL_RGBA8;
+    std::vector<std::vector<unsigned char>> chunks;
+    std::vector<unsigned int> crcs;
+    size_t rgbaBytes = 0;
+    size_t packedBytes = 0;
+    std::string error;
 
-    for (const PackagedAssetEntry &entry : uniqueEntries) {
-        std::vector<unsigned char> rawBytes;
-        if (!ReadFileBytes(entry.sourcePath, rawBytes)) {
-            if (errorMessage) *errorMessage = "Failed to read source asset: " + entry.sourcePath;
-            return false;
+    MipmapChain chain;
+    std::vector<std::vector<unsigned char>> encoded;
+    size_t jobsLeft = 0;
+};
+
+// Block rows of one mip level. Small levels are a single job; a 2048² BC7
+// base level is 32 of them, so one large texture spreads over the pool.
+struct TextureEncodeJob {
+    size_t texture = 0;
+    int level = 0;
+    int firstBlockRow = 0;
+    int blockRowCount = 0;
+};
+
+static const int kEncodeJobBlockRows = 16;
+
+static void PrepareTextureLevels(const unsigned char *rgba, int w, int h, uint32_t textureFormat,
+                                 PackedTextureChunks &out)
+{
+    out.chain = GenerateMipmaps(rgba, w, h);
+    out.chain.format = ChooseTextureFormat(textureFormat, rgba, w, h);
+    out.width = w;
+    out.height = h;
+    out.format = out.chain.format;
+    if (out.format == TEXTURE_PIXEL_RGBA8) return;
+
+    out.encoded.resize(out.chain.levels.size());
+    for (size_t m = 0; m < out.chain.levels.size(); ++m) {
+        const MipmapLevel &level = out.chain.levels[m];
+        out.encoded[m].assign(TextureLevelByteSize(out.format, level.width, level.height), 0);
+    }
+}
+
+static void AppendTextureEncodeJobs(size_t texture, const PackedTextureChunks &tex,
+                                    std::deque<TextureEncodeJob> &jobs)
+{
+    for (size_t m = 0; m < tex.encoded.size(); ++m) {
+        const int blockRows = (tex.chain.levels[m].height + 3) / 4;
+        for (int row = 0; row < blockRows; row += kEncodeJobBlockRows) {
+            jobs.push_back({ texture, (int)m, row, std::min(kEncodeJobBlockRows, blockRows - row) });
         }
+    }
+}
 
-        int w = 0, h = 0, comp = 0;
-        unsigned char *pixels = stbi_load_from_memory(rawBytes.data(), (int)rawBytes.size(), &w, &h, &comp, 4);
-        if (!pixels) {
-            if (errorMessage) *errorMessage = "Failed to decode PNG: " + entry.sourcePath;
-            return false;
+static bool RunTextureEncodeJob(const TextureEncodeJob &job, PackedTextureChunks &tex)
+{
+    const MipmapLevel &level = tex.chain.levels[job.level];
+    return EncodeTextureBlockRows(tex.format, level.width, level.height, level.pixels.data(),
+                                  job.firstBlockRow, job.blockRowCount, tex.encoded[job.level].data());
+}
+
+// Once every level is encoded (or right after the decode for RGBA8).
+static void FinishPackedTextureChunks(PackedTextureChunks &out)
+{
+    const int mipCount = (int)out.chain.levels.size();
+    out.chunks.resize(mipCount);
+    out.crcs.resize(mipCount);
+    for (int m = 0; m < mipCount; ++m) {
+        MipmapLevel &level = out.chain.levels[m];
+        out.rgbaBytes += level.pixels.size();
+        if (out.format != TEXTURE_PIXEL_RGBA8) {
+            level.pixels.swap(out.encoded[m]);
         }
+        out.packedBytes += level.pixels.size();
+
+        // Base chunk stores total mipCount; subsequent chunks store 1
+        out.chunks[m] = BuildMipChunkBuffer(level.width, level.height, (m == 0) ? mipCount : 1, out.format,
+                                            level.pixels.data(), level.pixels.size());
+        out.crcs[m] = rresComputeCRC32(out.chunks[m].data(), (int)out.chunks[m].size());
+    }
+    out.chain = MipmapChain{};
+    std::vector<std::vector<unsigned char>>().swap(out.encoded);
+}
 
-        TextureMips tm;
-        tm.logicalPath = entry.logicalPath;
-        tm.chain = GenerateMipmaps(pixels, w, h);
-        stbi_image_free(pixels);
+// Chunks of one resource are contiguous, so each nextOffset is known before
+// the chunk is written. Returns the offset of the first chunk.
+static uint32_t WritePackedTextureChunks(FILE *f, const PackedTextureChunks &tex)
+{
+    const uint32_t firstOffset = (uint32_t)ftell(f);
+    const uint32_t resId = AssetPackResourceId(tex.logicalPath);
+    for (size_t m = 0; m < tex.chunks.size(); ++m) {
+        const std::vector<unsigned char> &packed = tex.chunks[m];
+        const long chunkInfoPos = ftell(f);
+
+        rresResourceChunkInfo info = { 0 };
+        info.type[0] = 'R'; info.type[1] = 'A'; info.type[2] = 'W'; info.type[3] = 'D';
+        info.id = resId;
+        info.compType = RRES_COMP_NONE;
+        info.cipherType = RRES_CIPHER_NONE;
+        info.flags = 0;
+        info.packedSize = (unsigned int)packed.size();
+        info.baseSize = (unsigned int)packed.size();
+        info.nextOffset = (m + 1 < tex.chunks.size())
+            ? (unsigned int)(chunkInfoPos + (long)sizeof(info) + (long)packed.size())
+            : 0;
+        info.reserved = 0;
+        info.crc32 = tex.crcs[m];
 
-        totalChunks += (unsigned int)tm.chain.levels.size();
-        printf("[AssetPack] %s: %dx%d, %zu mip levels\n",
-               entry.logicalPath.c_str(), w, h, tm.chain.levels.size());
+        fwrite(&info, sizeof(info), 1, f);
+        fwrite(packed.data(), 1, packed.size(), f);
+    }
+    return firstOffset;
+}
 
-        allMips.push_back(std::move(tm));
+bool IngestTextures(const std::vector<PackagedAssetEntry> &entries,
+                    const std::string &packPath,
+                    uint32_t textureFormat,
+                    const TextureInspectFn &inspect,
+                    std::vector<TextureIngestInfo> *outInfo,
+                    std::string *errorMessage)
+{
+    std::vector<TextureIngestInfo> info(entries.size());
+    std::vector<unsigned char> packEntry(entries.size(), 0);
+    std::unordered_set<std::string> seen;
+    for (size_t i = 0; i < entries.size(); ++i) {
+        const std::string &logicalPath = entries[i].logicalPath;
+        packEntry[i] = !logicalPath.empty() && seen.insert(logicalPath).second;
     }
 
-    FILE *f = fopen(outputPath.c_str(), "wb");
-    if (!f) {
-        if (errorMessage) *errorMessage = "Failed to open output pack for write: " + outputPath;
+    FILE *f = packPath.empty() ? nullptr : fopen(packPath.c_str(), "wb");
+    if (!packPath.empty() && !f) {
+        if (errorMessage) *errorMessage = "Failed to open output pack for write: " + packPath;
+        if (outInfo) *outInfo = std::move(info);
         return false;
     }
 
     rresFileHeader header = { 0 };
     header.id[0] = 'r'; header.id[1] = 'r'; header.id[2] = 'e'; header.id[3] = 's';
     header.version = 100;
-    header.chunkCount = (unsigned short)totalChunks;
-    fwrite(&header, sizeof(header), 1, f);
+    if (f) fwrite(&header, sizeof(header), 1, f);
+
+    // Workers finish in any order; whoever completes the next texture in
+    // entry order writes it (and any finished ones behind it), so the pack
+    // layout is deterministic and chunks leave memory as soon as possible.
+    std::vector<PackedTextureChunks> pending(entries.size());
+    std::vector<unsigned char> done(entries.size(), 0);
+    std::mutex writeMutex;
+    size_t nextToWrite = 0;
+    unsigned int totalChunks = 0;
+    size_t rgbaBytes = 0;
+    size_t packedBytes = 0;
+    std::string firstError;
+    std::vector<PackDirEntry> dirEntries;
+
+    auto writeReady = [&]() {
+        while (nextToWrite < entries.size() && done[nextToWrite]) {
+            PackedTextureChunks &tex = pending[nextToWrite];
+            if (!tex.error.empty() && firstError.empty()) {
+                firstError = tex.error;
+            }
+            if (f && firstError.empty() && !tex.chunks.empty()) {
+                const uint32_t offset = WritePackedTextureChunks(f, tex);
+                dirEntries.push_back({ AssetPackResourceId(tex.logicalPath), offset, tex.logicalPath });
+                totalChunks += (unsigned int)tex.chunks.size();
+                rgbaBytes += tex.rgbaBytes;
+                packedBytes += tex.packedBytes;
+                printf("[AssetPack] %s: %dx%d, %zu mip levels, %s\n",
+                       tex.logicalPath.c_str(), tex.width, tex.height, tex.chunks.size(),
+                       TexturePixelFormatName(tex.format));
+            }
+            tex = PackedTextureChunks{};
+            ++nextToWrite;
+        }
+    };
+
+    auto finishTexture = [&](size_t i) {
+        std::lock_guard<std::mutex> lock(writeMutex);
+        done[i] = 1;
+        writeReady();
+    };
+
+    // Each texture is read and decoded once, by one worker; its BCn levels
+    // are then split into block-row jobs that any worker can pick up, and
+    // whichever finishes the texture's last job builds its chunks. Encode
+    // jobs go first so decoded mips do not pile up behind new decodes.
+    std::mutex queueMutex;
+    std::condition_variable wake;
+    std::deque<TextureEncodeJob> encodeJobs;
+    size_t nextToDecode = 0;
+    size_t decodesInFlight = 0;
+
+    auto decodeTexture = [&](size_t i) {
+        const PackagedAssetEntry &entry = entries[i];
+        PackedTextureChunks &tex = pending[i];
+        tex.logicalPath = entry.logicalPath;
+
+        std::vector<unsigned char> rawBytes;
+        unsigned char *pixels = nullptr;
+        if (entry.sourcePath.empty() || !ReadFileBytes(entry.sourcePath, rawBytes)) {
+            if (packEntry[i]) tex.error = "Failed to read source asset: " + entry.sourcePath;
+        } else {
+            int w = 0, h = 0, comp = 0;
+            pixels = stbi_load_from_memory(rawBytes.data(), (int)rawBytes.size(), &w, &h, &comp, 4);
+            if (!pixels) {
+                if (packEntry[i]) tex.error = "Failed to decode PNG: " + entry.sourcePath;
+            } else {
+                info[i].loaded = true;
+                info[i].width = w;
+                info[i].height = h;
+                info[i].channels = comp;
+            }
+        }
+
+        bool encodeQueued = false;
+        if (pixels) {
+            if (inspect) inspect(i, info[i], pixels);
+            if (packEntry[i] && f) {
+                PrepareTextureLevels(pixels, info[i].width, info[i].height, textureFormat, tex);
+            }
+            stbi_image_free(pixels);
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(queueMutex);
+            const size_t queued = encodeJobs.size();
+            AppendTextureEncodeJobs(i, tex, encodeJobs);
+            tex.jobsLeft = encodeJobs.size() - queued;
+            encodeQueued = tex.jobsLeft > 0;
+            --decodesInFlight;
+        }
+        wake.notify_all();
+
+        if (!encodeQueued) {
+            if (!tex.chain.levels.empty()) FinishPackedTextureChunks(tex);
+            finishTexture(i);
+        }
+    };
 
-    for (const TextureMips &tm : allMips) {
-        const uint32_t resId = AssetPackResourceId(tm.logicalPath);
-        const int mipCount = (int)tm.chain.levels.size();
-
-        // We need to write all mip chunks with nextOffset linking.
-        // Strategy: write each chunk, then go back and patch nextOffset of the previous chunk.
-        long prevInfoPos = -1;
-
-        for (int m = 0; m < mipCount; ++m) {
-            const MipmapLevel &level = tm.chain.levels[m];
-            const size_t pixelBytes = (size_t)level.width * level.height * 4;
-
-            // Base chunk stores total mipCount; subsequent chunks store 1
-            std::vector<unsigned char> packed = BuildMipChunkBuffer(
-                level.width, level.height, (m == 0) ? mipCount : 1,
-                level.pixels.data(), pixelBytes);
-
-            // Patch previous chunk's nextOffset to point here
-            long chunkInfoPos = ftell(f);
-            if (prevInfoPos >= 0) {
-                long savedPos = ftell(f);
-                fseek(f, prevInfoPos + offsetof(rresResourceChunkInfo, nextOffset), SEEK_SET);
-                unsigned int offset = (unsigned int)chunkInfoPos;
-                fwrite(&offset, sizeof(offset), 1, f);
-                fseek(f, savedPos, SEEK_SET);
+    auto encodeBlockRows = [&](const TextureEncodeJob &job) {
+        PackedTextureChunks &tex = pending[job.texture];
+        const bool encoded = RunTextureEncodeJob(job, tex);
+        bool last = false;
+        {
+            std::lock_guard<std::mutex> lock(queueMutex);
+            if (!encoded && tex.error.empty()) {
+                tex.error = std::string("Failed to encode ") + TexturePixelFormatName(tex.format) +
+                            " texture: " + tex.logicalPath;
             }
+            last = --tex.jobsLeft == 0;
+        }
+        if (!last) return;
+
+        if (tex.error.empty()) {
+            FinishPackedTextureChunks(tex);
+        } else {
+            tex.chain = MipmapChain{};
+            std::vector<std::vector<unsigned char>>().swap(tex.encoded);
+        }
+        finishTexture(job.texture);
+    };
 
-            rresResourceChunkInfo info = { 0 };
-            info.type[0] = 'R'; info.type[1] = 'A'; info.type[2] = 'W'; info.type[3] = 'D';
-            info.id = resId;
-            info.compType = RRES_COMP_NONE;
-            info.cipherType = RRES_CIPHER_NONE;
-            info.flags = 0;
-            info.packedSize = (unsigned int)packed.size();
-            info.baseSize = (unsigned int)packed.size();
-            info.nextOffset = 0; // Will be patched by next iteration if not last
-            info.reserved = 0;
-            info.crc32 = rresComputeCRC32(packed.data(), info.packedSize);
-
-            fwrite(&info, sizeof(info), 1, f);
-            fwrite(packed.data(), 1, packed.size(), f);
-
-            prevInfoPos = chunkInfoPos;
+    ParallelFor(ParallelWorkerCount(), [&](size_t) {
+        for (;;) {
+            TextureEncodeJob job;
+            bool haveJob = false;
+            size_t decode = entries.size();
+            {
+                std::unique_lock<std::mutex> lock(queueMutex);
+                wake.wait(lock, [&]() {
+                    return !encodeJobs.empty() || nextToDecode < entries.size() || decodesInFlight == 0;
+                });
+                if (!encodeJobs.empty()) {
+                    job = encodeJobs.front();
+                    encodeJobs.pop_front();
+                    haveJob = true;
+                } else if (nextToDecode < entries.size()) {
+                    decode = nextToDecode++;
+                    ++decodesInFlight;
+                } else {
+                    // Nothing queued and no decode left to queue more; jobs
+                    // already taken finish on the workers that hold them.
+                    return;
+                }
+            }
+            if (haveJob) {
+                encodeBlockRows(job);
+            } else {
+                decodeTexture(decode);
+            }
+        }
+    });
+
+    if (f) {
+        if (firstError.empty()) {
+            header.cdOffset = WriteCentralDirectory(f, dirEntries);
+            header.chunkCount = (unsigned short)(totalChunks + 1);
+        } else {
+            header.chunkCount = (unsigned short)totalChunks;
+        }
+        fseek(f, 0, SEEK_SET);
+        fwrite(&header, sizeof(header), 1, f);
+        fclose(f);
+        if (firstError.empty()) {
+            printf("[AssetPack] %u mip chunks: %.1f KB of mips as RGBA8 -> %.1f KB packed\n",
+                   totalChunks, (double)rgbaBytes / 1024.0, (double)packedBytes / 1024.0);
         }
     }
 
-    fclose(f);
+    if (outInfo) *outInfo = std::move(info);
+    if (!firstError.empty()) {
+        if (errorMessage) *errorMessage = firstError;
+        return false;
+    }
     return true;
 }
 
+bool WriteAssetPackRresWithMipmaps(const std::string &outputPath,
+                                   const std::vector<PackagedAssetEntry> &entries,
+                                   std::string *errorMessage,
+                                   uint32_t textureFormat)
+{
+    std::vector<PackagedAssetEntry> packedEntries;
+    packedEntries.reserve(entries.size());
+    for (const PackagedAssetEntry &entry : entries) {
+        if (entry.logicalPath.empty() || entry.sourcePath.empty()) continue;
+        packedEntries.push_back(entry);
+    }
+    return IngestTextures(packedEntries, outputPath, textureFormat, nullptr, nullptr, errorMessage);
+}
+
 bool LoadMipmappedAssetFromPack(const std::string &packPath,
                                 const std::string &logicalPath,
                                 MipmapChain &chain)
@@ -427,6 +725,7 @@ bool LoadMipmappedAssetFromPack(const std::string &packPath,
 
     if (multi.count > 1 && prop2 > 1) {
         // New-style mipmapped resource
+        chain.format = first.data.props[3];
         for (unsigned int i = 0; i < multi.count; ++i) {
             const rresResourceChunk &chunk = multi.chunks[i];
             if (chunk.data.propCount < 4 || chunk.data.props == nullptr || chunk.data.raw == nullptr) continue;
@@ -434,7 +733,16 @@ bool LoadMipmappedAssetFromPack(const std::string &packPath,
             MipmapLevel level;
             level.width = (int)chunk.data.props[0];
             level.height = (int)chunk.data.props[1];
-            const size_t pixelBytes = (size_t)level.width * level.height * 4;
+            const size_t pixelBytes = TextureLevelByteSize(chain.format, level.width, level.height);
+            const size_t headerBytes = sizeof(unsigned int) * (1 + chunk.data.propCount);
+            if (chunk.data.props[3] != chain.format || pixelBytes == 0 ||
+                (chunk.data.propCount >= 5 && chunk.data.props[4] != pixelBytes) ||
+                chunk.info.baseSize < headerBytes + pixelBytes) {
+                printf("[AssetPack] %s: mip %u is malformed (format %u), dropping the chain\n",
+                       logicalPath.c_str(), i, chunk.data.props[3]);
+                chain.levels.clear();
+                break;
+            }
 
             // The raw data starts after propCount + props in the packed buffer,
             // but rresLoadResourceChunkData already parses this for us.
@@ -466,3 +774,194 @@ bool LoadMipmappedAssetFromPack(const std::string &packPath,
     chain.levels.push_back(std::move(level));
     return true;
 }
+
+// ---------------------------------------------------------------------------
+// Memory-mapped reader
+// ---------------------------------------------------------------------------
+
+static unsigned int ReadPackU32(const unsigned char *ptr)
+{
+    unsigned int value = 0;
+    std::memcpy(&value, ptr, sizeof(value));
+    return value;
+}
+
+// Chunk header plus bounds check of its payload against the mapping.
+static bool ReadPackChunkInfo(const MappedFile &file, size_t offset, rresResourceChunkInfo &info)
+{
+    if (offset < sizeof(rresFileHeader) || offset > file.size || file.size - offset < sizeof(info)) return false;
+    std::memcpy(&info, file.data + offset, sizeof(info));
+    return info.packedSize <= file.size - offset - sizeof(info);
+}
+
+static bool ParseCentralDirectory(AssetPack &pack, size_t cdOffset)
+{
+    rresResourceChunkInfo info;
+    if (!ReadPackChunkInfo(pack.file, cdOffset, info) ||
+        std::memcmp(info.type, "CDIR", 4) != 0 ||
+        info.compType != RRES_COMP_NONE || info.cipherType != RRES_CIPHER_NONE) {
+        return false;
+    }
+
+    const unsigned char *ptr = pack.file.data + cdOffset + sizeof(info);
+    const unsigned char *end = ptr + info.packedSize;
+    if (end - ptr < 8) return false;
+    const unsigned int propCount = ReadPackU32(ptr);
+    if (propCount < 1 || (size_t)(end - ptr) < sizeof(unsigned int) * (1 + (size_t)propCount)) return false;
+    const unsigned int entryCount = ReadPackU32(ptr + sizeof(unsigned int));
+    ptr += sizeof(unsigned int) * (1 + (size_t)propCount);
+
+    pack.chunkOffsets.reserve(entryCount);
+    for (unsigned int i = 0; i < entryCount; ++i) {
+        if (end - ptr < 16) return false;
+        const unsigned int id = ReadPackU32(ptr);
+        const unsigned int offset = ReadPackU32(ptr + 4);
+        const unsigned int nameSize = ReadPackU32(ptr + 12);
+        ptr += 16;
+        if ((size_t)(end - ptr) < nameSize) return false;
+        ptr += nameSize;
+        pack.chunkOffsets.emplace(id, offset);
+    }
+    return true;
+}
+
+// Packs without a central directory: chunks are stored back to back, so one
+// pass over the headers finds the first chunk of every resource.
+static bool IndexPackChunks(AssetPack &pack, unsigned int chunkCount)
+{
+    size_t offset = sizeof(rresFileHeader);
+    for (unsigned int i = 0; i < chunkCount; ++i) {
+        rresResourceChunkInfo info;
+        if (!ReadPackChunkInfo(pack.file, offset, info)) return false;
+        if (std::memcmp(info.type, "CDIR", 4) != 0) {
+            pack.chunkOffsets.emplace(info.id, (uint32_t)offset);
+        }
+        offset += sizeof(info) + info.packedSize;
+    }
+    return true;
+}
+
+bool OpenAssetPack(AssetPack &pack, const std::string &path)
+{
+    CloseAssetPack(pack);
+    if (!MapFileReadOnly(path, pack.file)) {
+        printf("[AssetPack] Failed to map %s\n", path.c_str());
+        return false;
+    }
+
+    rresFileHeader header;
+    if (pack.file.size < sizeof(header)) {
+        printf("[AssetPack] %s is too small for an rres header\n", path.c_str());
+        CloseAssetPack(pack);
+        return false;
+    }
+    std::memcpy(&header, pack.file.data, sizeof(header));
+    if (std::memcmp(header.id, "rres", 4) != 0) {
+        printf("[AssetPack] %s is not an rres file\n", path.c_str());
+        CloseAssetPack(pack);
+        return false;
+    }
+
+    bool indexed = false;
+    if (header.cdOffset != 0) {
+        indexed = ParseCentralDirectory(pack, header.cdOffset);
+        if (!indexed) {
+            printf("[AssetPack] %s: central directory is malformed, scanning chunks\n", path.c_str());
+            pack.chunkOffsets.clear();
+        }
+    }
+    if (!indexed) {
+        indexed = IndexPackChunks(pack, header.chunkCount);
+        if (indexed) {
+            printf("[AssetPack] %s has no central directory; indexed %zu resources from chunk headers\n",
+                   path.c_str(), pack.chunkOffsets.size());
+        }
+    }
+    if (!indexed) {
+        printf("[AssetPack] %s: chunk headers run past the end of the file\n", path.c_str());
+        CloseAssetPack(pack);
+        return false;
+    }
+
+    pack.path = path;
+    return true;
+}
+
+void CloseAssetPack(AssetPack &pack)
+{
+    UnmapFile(pack.file);
+    pack.chunkOffsets.clear();
+    pack.path.clear();
+}
+
+uint64_t ContentHash(const void *data, size_t size, uint64_t hash)
+{
+    const unsigned char *bytes = (const unsigned char *)data;
+    for (size_t i = 0; i < size; ++i) {
+        hash = (hash ^ bytes[i]) * 0x100000001b3ull;
+    }
+    return hash;
+}
+
+bool FindMipmappedAssetInPack(const AssetPack &pack,
+                              const std::string &logicalPath,
+                              MipmapChainView &chain)
+{
+    chain.levels.clear();
+    chain.contentHash = CONTENT_HASH_SEED;
+
+    const uint32_t resId = AssetPackResourceId(logicalPath);
+    auto it = pack.chunkOffsets.find(resId);
+    if (it == pack.chunkOffsets.end()) return false;
+
+    size_t offset = it->second;
+    unsigned int mipCount = 1;
+    for (unsigned int m = 0; m < mipCount; ++m) {
+        rresResourceChunkInfo info;
+        if (!ReadPackChunkInfo(pack.file, offset, info) ||
+            std::memcmp(info.type, "RAWD", 4) != 0 || info.id != resId ||
+            info.compType != RRES_COMP_NONE || info.cipherType != RRES_CIPHER_NONE ||
+            info.packedSize < sizeof(unsigned int)) {
+            break;
+        }
+
+        const unsigned char *data = pack.file.data + offset + sizeof(info);
+        const unsigned int propCount = ReadPackU32(data);
+        const size_t headerBytes = sizeof(unsigned int) * (1 + (size_t)propCount);
+        // Raw-file chunks have 4 props, as did mip chunks before the byte size.
+        if (propCount < 5 || info.packedSize < headerBytes) break;
+
+        unsigned int props[5];
+        for (int p = 0; p < 5; ++p) props[p] = ReadPackU32(data + sizeof(unsigned int) * (1 + p));
+        if (m == 0) {
+            mipCount = props[2];
+            chain.format = props[3];
+            if (mipCount == 0 || mipCount > 32) break;
+        }
+
+        MipmapLevelView level;
+        level.width = (int)props[0];
+        level.height = (int)props[1];
+        level.size = TextureLevelByteSize(chain.format, level.width, level.height);
+        if (props[3] != chain.format || level.size == 0 || props[4] != level.size ||
+            info.packedSize - headerBytes < level.size) {
+            printf("[AssetPack] %s: mip %u is malformed (format %u), dropping the chain\n",
+                   logicalPath.c_str(), m, props[3]);
+            break;
+        }
+        level.pixels = data + headerBytes;
+        chain.levels.push_back(level);
+        chain.contentHash = ContentHash(&info.crc32, sizeof(info.crc32), chain.contentHash);
+
+        if (m + 1 < mipCount) {
+            if (info.nextOffset == 0) break;
+            offset = info.nextOffset;
+        }
+    }
+
+    if (chain.levels.size() != mipCount) {
+        chain.levels.clear();
+        return false;
+    }
+    return true;
+}
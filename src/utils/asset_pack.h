@@ -1,7 +1,12 @@
 #pragma once
 
+#include "mapped_file.h"
+#include "texture_codec.h"
+
 #include <cstdint>
+#include <functional>
 #include <string>
+#include <unordered_map>
 #include <vector>
 
 struct PackagedAssetEntry {
@@ -24,17 +29,96 @@ bool LoadRawAssetFromPack(const std::string &packPath,
 struct MipmapLevel {
     int width = 0;
     int height = 0;
-    std::vector<unsigned char> pixels; // RGBA8
+    std::vector<unsigned char> pixels; // encoded in the chain's format
 };
 
 struct MipmapChain {
+    uint32_t format = TEXTURE_PIXEL_RGBA8; // TexturePixelFormat
     std::vector<MipmapLevel> levels;
 };
 
+// Writer-only texture format choice: BC1 for opaque textures, BC7 once any
+// texel has alpha below 255.
+static constexpr uint32_t ASSET_PACK_TEXTURE_FORMAT_AUTO = 0xFFFFFFFFu;
+
+// Both writers finish the pack with an rres central directory (CDIR chunk,
+// referenced by rresFileHeader::cdOffset) mapping each resource id to the
+// file offset of its first chunk.
+//
+// Mip chunks carry props { width, height, mipCount (base chunk) or 1,
+// TexturePixelFormat, level byte size }. Packs written before the format
+// prop existed have 0 (RGBA8) there and no byte size.
 bool WriteAssetPackRresWithMipmaps(const std::string &outputPath,
                                    const std::vector<PackagedAssetEntry> &entries,
-                                   std::string *errorMessage = nullptr);
+                                   std::string *errorMessage = nullptr,
+                                   uint32_t textureFormat = ASSET_PACK_TEXTURE_FORMAT_AUTO);
+
+struct TextureIngestInfo {
+    bool loaded = false;  // source read and decoded
+    int  width = 0;
+    int  height = 0;
+    int  channels = 0;    // channel count of the source image
+};
+
+// Called on a worker thread with the decoded level 0 (RGBA8) of every entry
+// that loaded.
+using TextureInspectFn = std::function<void(size_t index, const TextureIngestInfo &info, const unsigned char *rgba)>;
+
+// Single pass over texture sources: every entry is read and decoded once on
+// the ParallelFor pool and shown to `inspect`; entries with a logical path
+// also get their mip chain encoded (see WriteAssetPackRresWithMipmaps), each
+// BCn level split into block-row jobs on the same pool, and streamed into the
+// pack at `packPath` in entry order. Entries without a
+// logical path are only inspected and may be missing. Fails if a packed
+// entry cannot be read or encoded; `outInfo` is filled either way.
+bool IngestTextures(const std::vector<PackagedAssetEntry> &entries,
+                    const std::string &packPath,
+                    uint32_t textureFormat,
+                    const TextureInspectFn &inspect,
+                    std::vector<TextureIngestInfo> *outInfo,
+                    std::string *errorMessage = nullptr);
 
 bool LoadMipmappedAssetFromPack(const std::string &packPath,
                                 const std::string &logicalPath,
                                 MipmapChain &chain);
+
+// Memory-mapped, indexed view of a pack. The index comes from the central
+// directory, or from one walk over the chunk headers for packs written
+// without one. Pointers handed out by FindMipmappedAssetInPack stay valid
+// until CloseAssetPack.
+struct AssetPack {
+    std::string path;
+    MappedFile file;
+    std::unordered_map<uint32_t, uint32_t> chunkOffsets; // resource id -> first chunk
+};
+
+bool OpenAssetPack(AssetPack &pack, const std::string &path);
+void CloseAssetPack(AssetPack &pack);
+
+struct MipmapLevelView {
+    int width = 0;
+    int height = 0;
+    const unsigned char *pixels = nullptr; // points into the mapping
+    size_t size = 0;
+};
+
+struct MipmapChainView {
+    uint32_t format = TEXTURE_PIXEL_RGBA8; // TexturePixelFormat
+    std::vector<MipmapLevelView> levels;
+    uint64_t contentHash = 0; // same pixels, same hash, whatever pack or name they come from
+};
+
+// 64-bit FNV-1a of `size` bytes, continuing from `hash`.
+static constexpr uint64_t CONTENT_HASH_SEED = 0xcbf29ce484222325ull;
+uint64_t ContentHash(const void *data, size_t size, uint64_t hash = CONTENT_HASH_SEED);
+
+// Zero-copy lookup of a mip chain, stored as RGBA8 texels or as BC1/BC3/BC7
+// blocks: `chain.format` (a TexturePixelFormat) says which, and each level's
+// `size` is its byte count in that format. Returns false for missing
+// resources and for legacy raw-file resources or mip chunks without the
+// byte-size prop; LoadMipmappedAssetFromPack still reads those. The chain's
+// content hash comes from the CRC32 the writer stored with each mip chunk
+// (props and pixels), so working it out reads no pixels.
+bool FindMipmappedAssetInPack(const AssetPack &pack,
+                              const std::string &logicalPath,
+                              MipmapChainView &chain);
@@ -6,7 +6,12 @@
 #include <cstdint>
 
 #define WBSP_MAGIC    0x50534257u   // 'WBSP' little-endian
-#define WBSP_VERSION  5u
+#define WBSP_VERSION  10u
+#define WBSP_VERSION_OCCLUDERS 10u
+#define WBSP_VERSION_VISIBILITY 9u
+#define WBSP_VERSION_MESH_CLUSTERS 8u
+#define WBSP_VERSION_COMPACT_VERTICES 7u
+#define WBSP_VERSION_ENTITY_DATA 6u
 #define WBSP_VERSION_LIGHTMAP_FORMAT 4u
 #define WBSP_VERSION_HULL_ENTITY_REFS 5u
 #define WBSP_VERSION_LIGHTMAP_RGBA8 3u
@@ -14,16 +19,18 @@
 enum BSPLightmapPageFormat : uint32_t {
     BSP_LIGHTMAP_FORMAT_RGBA8_UNORM = 0u,
     BSP_LIGHTMAP_FORMAT_RGBA16F     = 1u,
+    BSP_LIGHTMAP_FORMAT_RGB9E5      = 2u,   // uint32 per texel, shared exponent
+    BSP_LIGHTMAP_FORMAT_BC6H_UF16   = 3u,   // 16-byte blocks of 4x4 texels
 };
 
 enum {
     LUMP_TEXTURES = 0,   // BSPTexture[]
-    LUMP_VERTICES,       // BSPVertex[]
+    LUMP_VERTICES,       // BSPVertex[]  (empty when LUMP_VERTICES_COMPACT is used)
     LUMP_INDICES,        // uint32_t[]
     LUMP_MESHES,         // BSPMesh[]
     LUMP_HULLS,          // BSPHull[]
     LUMP_HULL_PTS,       // BSPVec3[]
-    LUMP_ENTITIES,       // char[]  (key/value text, \0-terminated)
+    LUMP_ENTITIES,       // char[]  (key/value text, \0-terminated; kept for older tools)
     LUMP_LIGHTMAP,       // BSPLightmapLumpHeader + BSPLightmapPageHeader[] + format-specific page data
     LUMP_BSP_TREE,       // BSPTreeHeader
     LUMP_BSP_PLANES,     // BSPPlane[]
@@ -32,9 +39,44 @@ enum {
     LUMP_BSP_NODES,      // BSPNode[]
     LUMP_BSP_LEAVES,     // BSPLeaf[]
     LUMP_BSP_FACE_REFS,  // uint32_t[]
+    LUMP_ENTITY_DATA,    // BSPEntityLumpHeader + BSPEntity[] + BSPEntityProperty[] + uint32_t keys[] + char strings[]
+    LUMP_VERTICES_COMPACT, // BSPVertexCompact[]
+    LUMP_MESH_CLUSTERS,  // BSPMeshCluster[], ordered by mesh
+    LUMP_VISIBILITY,     // BSPVisHeader + uint32_t rowOffsets[leafCount] + compressed rows
+    LUMP_OCCLUDERS,      // BSPOccluder[], largest first
+    LUMP_OCCLUDER_VERTS, // BSPVec3[]
     LUMP_COUNT
 };
 
+enum BSPLeafContents : int32_t {
+    BSP_CONTENTS_EMPTY = 0,
+    BSP_CONTENTS_SOLID = 1,
+};
+
+enum BSPFaceFlags : uint32_t {
+    BSP_FACE_DETAIL = 1u << 0,   // not part of the solid/empty partition
+};
+
+// BSPFace::textureIndex of a face the outside fill culled whose texture no
+// surviving face uses, so it was never packed.
+#define BSP_FACE_TEXTURE_NONE 0xFFFFFFFFu
+
+enum BSPVisMode : uint32_t {
+    BSP_VIS_MODE_FAST = 1u,   // portal flood only; conservative
+    BSP_VIS_MODE_FULL = 2u,   // portal flood clipped to separating planes
+};
+
+// Rows have one bit per leaf. A zero byte is followed by a count of zero
+// bytes it stands for (1..255); every other byte is literal.
+#define BSP_VIS_NO_ROW 0xFFFFFFFFu   // rowOffsets entry: leaf sees everything
+
+enum BSPEntityValueType : uint32_t {
+    BSP_ENTITY_VALUE_STRING = 0u,
+    BSP_ENTITY_VALUE_INT    = 1u,   // intValue, and value[0] as a float
+    BSP_ENTITY_VALUE_FLOAT  = 2u,   // value[0]
+    BSP_ENTITY_VALUE_VEC3   = 3u,   // value[0..2]
+};
+
 #pragma pack(push, 1)
 
 struct BSPLump {
@@ -61,6 +103,17 @@ struct BSPVertex {
     float lu, lv;         // lightmap UV (normalised into atlas)
 };
 
+// LUMP_VERTICES in 24 bytes. Every attribute is a format the map shaders'
+// float inputs read directly (FLOAT3, BYTE4N, HALF2, USHORT2N), so the lump
+// is uploaded as-is. Diffuse UVs are shifted by whole texture repeats per
+// polygon to keep them near zero, where half floats are precise.
+struct BSPVertexCompact {
+    float    x, y, z;
+    int8_t   nx, ny, nz, nw;  // snorm8 normal, nw = 0
+    uint16_t u, v;            // half-float diffuse UV
+    uint16_t lu, lv;          // unorm16 lightmap UV within the mesh's page
+};
+
 struct BSPMesh {
     uint32_t textureIndex;
     uint32_t lightmapPage;
@@ -70,10 +123,37 @@ struct BSPMesh {
     uint32_t vertexCount;
 };
 
+// A spatially compact piece of one mesh, culled on its own. A mesh's
+// clusters are consecutive in the lump and tile its index and vertex
+// ranges in order, so visible neighbours draw as one index range.
+struct BSPMeshCluster {
+    uint32_t meshIndex;
+    uint32_t firstIndex;     // absolute, like BSPMesh
+    uint32_t indexCount;
+    uint32_t firstVertex;
+    uint32_t vertexCount;
+    float    minX, minY, minZ;
+    float    maxX, maxY, maxZ;
+};
+
+struct BSPVisHeader {
+    uint32_t leafCount;
+    uint32_t rowBytes;    // (leafCount + 7) / 8 once decompressed
+    uint32_t mode;        // BSPVisMode
+    uint32_t dataBytes;   // compressed rows following the offset table
+};
+
 struct BSPVec3 {
     float x, y, z;
 };
 
+// A large opaque world polygon, convex, that the engine rasterizes into its
+// occlusion buffer. Its vertices are consecutive in LUMP_OCCLUDER_VERTS.
+struct BSPOccluder {
+    uint32_t firstVertex;
+    uint32_t vertexCount;
+};
+
 struct BSPHull {
     uint32_t firstPoint;
     uint32_t pointCount;
@@ -94,7 +174,8 @@ struct BSPLightmapPageHeader {
 
 struct BSPTreeHeader {
     int32_t  rootChild;   // node index >= 0, leaf encoded as (-1 - leafIndex)
-    int32_t  outsideLeaf; // reserved for future outside-space classification
+    int32_t  outsideLeaf; // solid leaf standing for the filled void around a sealed
+                          // map; no node leads to it. -1 if the map leaks
     uint32_t reserved0;
     uint32_t reserved1;
 };
@@ -133,4 +214,28 @@ struct BSPLeaf {
     uint32_t faceRefCount;
 };
 
+// Entities with their values parsed at compile time. Keys and values live
+// \0-terminated in one deduplicated string pool; properties name their key
+// by index into the key table, so lookups compare integers. Every property
+// keeps its original text whatever its type.
+struct BSPEntityLumpHeader {
+    uint32_t entityCount;
+    uint32_t propertyCount;
+    uint32_t keyCount;
+    uint32_t stringBytes;
+};
+
+struct BSPEntity {
+    uint32_t firstProperty;
+    uint32_t propertyCount;
+};
+
+struct BSPEntityProperty {
+    uint32_t key;        // index into the key table
+    uint32_t type;       // BSPEntityValueType
+    uint32_t text;       // string pool offset of the value as written in the .map
+    int32_t  intValue;
+    float    value[3];
+};
+
 #pragma pack(pop)
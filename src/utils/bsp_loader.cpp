@@ -2,9 +2,13 @@
 #include "bsp_loader.h"
 #include "bsp_format.h"
 #include "asset_pack.h"
-#include "../compiler/map_parser.h"
+#include "bsp_vis.h"
+#include "lightmap_codec.h"
+#include "../compiler/map_entity_props.h"
+#include "../compiler/map_geometry.h"
 #include <cstdio>
 #include <cstring>
+#include <span>
 #include <sstream>
 
 namespace {
@@ -12,15 +16,8 @@ namespace {
 static constexpr uint32_t kLegacyBspVersion = 2u;
 static constexpr uint32_t kRgba8LightmapBspVersion = WBSP_VERSION_LIGHTMAP_RGBA8;
 static constexpr uint32_t kLightmapFormatBspVersion = WBSP_VERSION_LIGHTMAP_FORMAT;
-static constexpr size_t kLegacyLumpCount = 8;
 
 #pragma pack(push, 1)
-struct BSPHeaderV2Compat {
-    uint32_t magic;
-    uint32_t version;
-    BSPLump  lumps[kLegacyLumpCount];
-};
-
 struct BSPLightmapPageHeaderV3Compat {
     uint32_t width;
     uint32_t height;
@@ -34,206 +31,343 @@ struct BSPHullV4Compat {
 };
 #pragma pack(pop)
 
-static bool ReadHeader(FILE* f, BSPHeader* out) {
+// Each version only ever appended lumps; older headers are shorter and the
+// lumps they lack stay empty.
+static size_t LumpCountForVersion(uint32_t version) {
+    if (version == WBSP_VERSION) return LUMP_COUNT;
+    if (version == WBSP_VERSION_VISIBILITY) return LUMP_VISIBILITY + 1;
+    if (version == WBSP_VERSION_MESH_CLUSTERS) return LUMP_MESH_CLUSTERS + 1;
+    if (version == WBSP_VERSION_COMPACT_VERTICES) return LUMP_VERTICES_COMPACT + 1;
+    if (version == WBSP_VERSION_ENTITY_DATA) return LUMP_ENTITY_DATA + 1;
+    if (version == WBSP_VERSION_HULL_ENTITY_REFS ||
+        version == kLightmapFormatBspVersion ||
+        version == kRgba8LightmapBspVersion) return LUMP_BSP_FACE_REFS + 1;
+    if (version == kLegacyBspVersion) return LUMP_LIGHTMAP + 1;
+    return 0;
+}
+
+static bool ReadHeader(const uint8_t* data, size_t size, BSPHeader* out) {
     uint32_t magic = 0;
     uint32_t version = 0;
-    if (fread(&magic, sizeof(magic), 1, f) != 1 ||
-        fread(&version, sizeof(version), 1, f) != 1)
-    {
+    if (size < sizeof(magic) + sizeof(version)) {
         return false;
     }
+    memcpy(&magic, data, sizeof(magic));
+    memcpy(&version, data + sizeof(magic), sizeof(version));
     if (magic != WBSP_MAGIC) {
         return false;
     }
 
-    fseek(f, 0, SEEK_SET);
-    if (version == WBSP_VERSION || version == kLightmapFormatBspVersion || version == kRgba8LightmapBspVersion) {
-        return fread(out, sizeof(*out), 1, f) == 1;
+    const size_t lumpCount = LumpCountForVersion(version);
+    const size_t headerSize = sizeof(magic) + sizeof(version) + lumpCount * sizeof(BSPLump);
+    if (lumpCount == 0 || size < headerSize) {
+        return false;
+    }
+    memset(out, 0, sizeof(*out));
+    out->magic = magic;
+    out->version = version;
+    memcpy(out->lumps, data + sizeof(magic) + sizeof(version), lumpCount * sizeof(BSPLump));
+    return true;
+}
+
+// The on-disk structs are packed, so only the uint32_t lumps care where they
+// start; files written before lumps were 4-byte aligned get those copied.
+template<typename T>
+static std::span<const T> LumpSpan(BSPData& out, const uint8_t* base, const BSPLump& l) {
+    static_assert(alignof(T) <= alignof(uint32_t), "aligned copies are uint32_t storage");
+    const size_t count = l.length / sizeof(T);
+    if (count == 0) {
+        return {};
+    }
+    const uint8_t* data = base + l.offset;
+    if ((uintptr_t)data % alignof(T) != 0) {
+        std::vector<uint32_t>& copy = out.alignedLumps.emplace_back((count * sizeof(T) + 3) / 4);
+        memcpy(copy.data(), data, count * sizeof(T));
+        data = (const uint8_t*)copy.data();
+    }
+    return { reinterpret_cast<const T*>(data), count };
+}
+
+static bool ReadLightmapPages(const uint8_t* base, const BSPLump& l, uint32_t version, BSPData& out) {
+    if (l.length < sizeof(BSPLightmapLumpHeader)) {
+        return true;
+    }
+    const uint8_t* lump = base + l.offset;
+    BSPLightmapLumpHeader lh{};
+    memcpy(&lh, lump, sizeof(lh));
+
+    const bool hasFormat = version >= kLightmapFormatBspVersion;
+    const size_t pageHeaderSize = hasFormat ? sizeof(BSPLightmapPageHeader) : sizeof(BSPLightmapPageHeaderV3Compat);
+    if ((l.length - sizeof(lh)) / pageHeaderSize < lh.pageCount) {
+        return false;
     }
-    if (version == kLegacyBspVersion) {
-        BSPHeaderV2Compat legacy{};
-        if (fread(&legacy, sizeof(legacy), 1, f) != 1) {
+
+    size_t pixelOffset = sizeof(lh) + (size_t)lh.pageCount * pageHeaderSize;
+    out.lightmapPages.resize(lh.pageCount);
+    for (uint32_t i = 0; i < lh.pageCount; ++i) {
+        BSPLightmapPageHeader ph{};
+        memcpy(&ph, lump + sizeof(lh) + (size_t)i * pageHeaderSize, pageHeaderSize);
+        if (!hasFormat) {
+            ph.format = BSP_LIGHTMAP_FORMAT_RGBA8_UNORM;
+        }
+        if (ph.byteLength > l.length - pixelOffset) {
             return false;
         }
-        memset(out, 0, sizeof(*out));
-        out->magic = legacy.magic;
-        out->version = legacy.version;
-        for (size_t i = 0; i < kLegacyLumpCount; ++i) {
-            out->lumps[i] = legacy.lumps[i];
+
+        BSPDataLightmapPage& page = out.lightmapPages[i];
+        page.width = (int)ph.width;
+        page.height = (int)ph.height;
+        page.format = ph.format;
+        page.pixels = { lump + pixelOffset, ph.byteLength };
+        pixelOffset += ph.byteLength;
+
+        // Unknown formats pass through for the renderer to reject; known
+        // ones must match their exact encoded size.
+        const size_t expectedBytes = LightmapPageByteSize(page.format, page.width, page.height);
+        if (hasFormat && expectedBytes != 0 && page.pixels.size() != expectedBytes) {
+            printf("[BSP] lightmap page %u (%s) is %zu bytes, expected %zu; dropping its pixels\n",
+                   i, LightmapFormatName(page.format), page.pixels.size(), expectedBytes);
+            page.pixels = {};
         }
-        return true;
     }
-    return false;
+    return true;
 }
 
-} // namespace
+// Entity text as compile_map wrote it before LUMP_ENTITY_DATA: one
+// `"key" "value"` pair per line between braces.
+static void ParseEntityText(const char* data, size_t length, EntityTableStorage* out) {
+    std::vector<Entity> entities;
+    std::istringstream ss(std::string(data, length));
+    std::string line; Entity cur; bool in=false;
+    while (std::getline(ss,line)) {
+        if (line=="{") { cur=Entity(); in=true; continue; }
+        if (line=="}") { if(in){entities.push_back(cur);in=false;} continue; }
+        if (!in) continue;
+        size_t q1=line.find('"'); if(q1==std::string::npos) continue;
+        size_t q2=line.find('"',q1+1); if(q2==std::string::npos) continue;
+        size_t q3=line.find('"',q2+1); if(q3==std::string::npos) continue;
+        size_t q4=line.find('"',q3+1); if(q4==std::string::npos) continue;
+        cur.properties[line.substr(q1+1,q2-q1-1)] = line.substr(q3+1,q4-q3-1);
+    }
+    BuildEntityTable(entities, out);
+}
 
-template<typename T>
-static std::vector<T> ReadLump(FILE* f, const BSPLump& l) {
-    std::vector<T> v(l.length / sizeof(T));
-    if (l.length) { fseek(f, l.offset, SEEK_SET); fread(v.data(), 1, l.length, f); }
-    return v;
+static bool ValidateRanges(const BSPData& bsp, const char* path) {
+    const size_t vertexCount = BSPVertexCount(bsp);
+    for (size_t i = 0; i < bsp.meshes.size(); ++i) {
+        const BSPMesh& m = bsp.meshes[i];
+        if (m.textureIndex >= bsp.textures.size() ||
+            m.firstVertex > vertexCount || m.vertexCount > vertexCount - m.firstVertex ||
+            m.firstIndex > bsp.indices.size() || m.indexCount > bsp.indices.size() - m.firstIndex) {
+            printf("[BSP] %s: mesh %zu references data outside its lumps\n", path, i);
+            return false;
+        }
+    }
+    // The renderer draws straight from the index lump.
+    for (size_t i = 0; i < bsp.indices.size(); ++i) {
+        if (bsp.indices[i] >= vertexCount) {
+            printf("[BSP] %s: index %zu references vertex %u past the vertex lump\n", path, i, bsp.indices[i]);
+            return false;
+        }
+    }
+    for (size_t i = 0; i < bsp.meshClusters.size(); ++i) {
+        const BSPMeshCluster& c = bsp.meshClusters[i];
+        if (c.meshIndex >= bsp.meshes.size() ||
+            (i > 0 && c.meshIndex < bsp.meshClusters[i - 1].meshIndex)) {
+            printf("[BSP] %s: mesh cluster %zu is out of mesh order\n", path, i);
+            return false;
+        }
+        const BSPMesh& m = bsp.meshes[c.meshIndex];
+        if (c.firstIndex < m.firstIndex || (uint64_t)c.firstIndex + c.indexCount > (uint64_t)m.firstIndex + m.indexCount ||
+            c.firstVertex < m.firstVertex || (uint64_t)c.firstVertex + c.vertexCount > (uint64_t)m.firstVertex + m.vertexCount) {
+            printf("[BSP] %s: mesh cluster %zu reaches outside mesh %u\n", path, i, c.meshIndex);
+            return false;
+        }
+    }
+    for (size_t i = 0; i < bsp.hulls.size(); ++i) {
+        const BSPHull& h = bsp.hulls[i];
+        if (h.firstPoint > bsp.hullPoints.size() || h.pointCount > bsp.hullPoints.size() - h.firstPoint) {
+            printf("[BSP] %s: hull %zu references points outside the hull point lump\n", path, i);
+            return false;
+        }
+    }
+    return true;
 }
 
+} // namespace
+
 bool LoadBSP(const char* path, BSPData& out)
 {
-    out = {};
+    UnloadBSP(out);
     out.tree.rootChild = -1;
     out.tree.outsideLeaf = -1;
 
-    FILE* f = fopen(path, "rb");
-    if (!f) { printf("[BSP] cannot open %s\n", path); return false; }
+    const uint8_t* base = nullptr;
+    size_t size = 0;
+    if (MapFileReadOnly(path, out.file)) {
+        base = out.file.data;
+        size = out.file.size;
+    } else {
+        FILE* f = fopen(path, "rb");
+        if (!f) { printf("[BSP] cannot open %s\n", path); return false; }
+        fseek(f, 0, SEEK_END);
+        const long length = ftell(f);
+        fseek(f, 0, SEEK_SET);
+        if (length > 0) {
+            out.fileBytes.resize((size_t)length);
+            out.fileBytes.resize(fread(out.fileBytes.data(), 1, out.fileBytes.size(), f));
+        }
+        fclose(f);
+        base = out.fileBytes.data();
+        size = out.fileBytes.size();
+    }
 
     BSPHeader hdr{};
-    if (!ReadHeader(f, &hdr)) {
+    if (!ReadHeader(base, size, &hdr)) {
         printf("[BSP] bad or unsupported header in %s\n", path);
-        fclose(f);
+        UnloadBSP(out);
         return false;
     }
+    for (int i = 0; i < LUMP_COUNT; ++i) {
+        const BSPLump& l = hdr.lumps[i];
+        if (l.offset > size || l.length > size - l.offset) {
+            printf("[BSP] %s: lump %d runs past the end of the file\n", path, i);
+            UnloadBSP(out);
+            return false;
+        }
+    }
 
-    auto textures = ReadLump<BSPTexture>(f, hdr.lumps[LUMP_TEXTURES]);
-    auto verts    = ReadLump<BSPVertex> (f, hdr.lumps[LUMP_VERTICES]);
-    auto idx      = ReadLump<uint32_t>  (f, hdr.lumps[LUMP_INDICES]);
-    auto meshes   = ReadLump<BSPMesh>   (f, hdr.lumps[LUMP_MESHES]);
-    auto hullPts  = ReadLump<BSPVec3>   (f, hdr.lumps[LUMP_HULL_PTS]);
-    std::vector<BSPHull> hulls;
+    out.textures   = LumpSpan<BSPTexture>(out, base, hdr.lumps[LUMP_TEXTURES]);
+    out.compactVertices = LumpSpan<BSPVertexCompact>(out, base, hdr.lumps[LUMP_VERTICES_COMPACT]);
+    if (out.compactVertices.empty()) {
+        out.vertices = LumpSpan<BSPVertex>(out, base, hdr.lumps[LUMP_VERTICES]);
+    }
+    out.indices    = LumpSpan<uint32_t>  (out, base, hdr.lumps[LUMP_INDICES]);
+    out.meshes     = LumpSpan<BSPMesh>   (out, base, hdr.lumps[LUMP_MESHES]);
+    out.meshClusters = LumpSpan<BSPMeshCluster>(out, base, hdr.lumps[LUMP_MESH_CLUSTERS]);
+    out.hullPoints = LumpSpan<BSPVec3>   (out, base, hdr.lumps[LUMP_HULL_PTS]);
     if (hdr.version >= WBSP_VERSION_HULL_ENTITY_REFS) {
-        hulls = ReadLump<BSPHull>(f, hdr.lumps[LUMP_HULLS]);
+        out.hulls = LumpSpan<BSPHull>(out, base, hdr.lumps[LUMP_HULLS]);
     } else {
-        std::vector<BSPHullV4Compat> legacyHulls = ReadLump<BSPHullV4Compat>(f, hdr.lumps[LUMP_HULLS]);
-        hulls.reserve(legacyHulls.size());
+        std::span<const BSPHullV4Compat> legacyHulls = LumpSpan<BSPHullV4Compat>(out, base, hdr.lumps[LUMP_HULLS]);
+        out.upgradedHulls.reserve(legacyHulls.size());
         for (const BSPHullV4Compat& legacyHull : legacyHulls) {
             BSPHull hull{};
             hull.firstPoint = legacyHull.firstPoint;
             hull.pointCount = legacyHull.pointCount;
             hull.collisionType = legacyHull.collisionType;
             hull.entityIndex = -1;
-            hulls.push_back(hull);
+            out.upgradedHulls.push_back(hull);
         }
+        out.hulls = out.upgradedHulls;
     }
-
-    // ----- render buckets -------------------------------------------------
-    out.buckets.reserve(meshes.size());
-    for (auto& m : meshes) {
-        MapMeshBucket b;
-        b.texture = textures[m.textureIndex].name;
-        b.lightmapPage = m.lightmapPage;
-        b.vertices.reserve(m.vertexCount);
-        for (uint32_t i=0;i<m.vertexCount;++i) {
-            const BSPVertex& v = verts[m.firstVertex+i];
-            b.vertices.push_back({v.x,v.y,v.z, v.nx,v.ny,v.nz, v.u,v.v, v.lu,v.lv});
-        }
-        b.indices.reserve(m.indexCount);
-        for (uint32_t i=0;i<m.indexCount;++i)
-            b.indices.push_back(idx[m.firstIndex+i] - m.firstVertex);
-        out.buckets.push_back(std::move(b));
+    if (!ValidateRanges(out, path)) {
+        UnloadBSP(out);
+        return false;
     }
 
-    // ----- collision hulls -----------------------------------------------
-    out.hulls.reserve(hulls.size());
-    for (auto& h : hulls) {
-        MeshCollisionData mcd;
-        mcd.collisionType = (CollisionType)h.collisionType;
-        mcd.entityIndex = h.entityIndex;
-        mcd.vertices.reserve(h.pointCount);
-        for (uint32_t i=0;i<h.pointCount;++i) {
-            const BSPVec3& p = hullPts[h.firstPoint+i];
-            mcd.vertices.push_back({p.x,p.y,p.z});
+    // ----- entities ------------------------------------------------------
+    const BSPLump& entityData = hdr.lumps[LUMP_ENTITY_DATA];
+    if (entityData.length == 0 || !ReadEntityTable(base + entityData.offset, entityData.length, &out.entities)) {
+        if (entityData.length != 0) {
+            printf("[BSP] %s: entity data lump is malformed; parsing the entity text instead\n", path);
         }
-        out.hulls.push_back(std::move(mcd));
-    }
-
-    // ----- entities (re-parse simple key/value text) ---------------------
-    {
         const BSPLump& l = hdr.lumps[LUMP_ENTITIES];
-        std::string text(l.length, '\0');
-        if (l.length) { fseek(f,l.offset,SEEK_SET); fread(&text[0],1,l.length,f); }
-
-        std::istringstream ss(text);
-        std::string line; Entity cur; bool in=false;
-        while (std::getline(ss,line)) {
-            if (line=="{") { cur=Entity(); in=true; continue; }
-            if (line=="}") { if(in){out.entities.push_back(cur);in=false;} continue; }
-            if (!in) continue;
-            size_t q1=line.find('"'); if(q1==std::string::npos) continue;
-            size_t q2=line.find('"',q1+1); if(q2==std::string::npos) continue;
-            size_t q3=line.find('"',q2+1); if(q3==std::string::npos) continue;
-            size_t q4=line.find('"',q3+1); if(q4==std::string::npos) continue;
-            cur.properties[line.substr(q1+1,q2-q1-1)] = line.substr(q3+1,q4-q3-1);
-        }
+        ParseEntityText((const char*)base + l.offset, l.length, &out.entityStorage);
+        out.entities = ViewEntityTable(out.entityStorage);
     }
 
     // ----- lightmap ------------------------------------------------------
-    {
-        const BSPLump& l = hdr.lumps[LUMP_LIGHTMAP];
-        if (l.length >= sizeof(BSPLightmapLumpHeader)) {
-            fseek(f, l.offset, SEEK_SET);
-
-            BSPLightmapLumpHeader lh{};
-            fread(&lh, sizeof(lh), 1, f);
-
-            if (hdr.version >= kLightmapFormatBspVersion) {
-                std::vector<BSPLightmapPageHeader> pageHeaders(lh.pageCount);
-                if (!pageHeaders.empty()) {
-                    fread(pageHeaders.data(), sizeof(BSPLightmapPageHeader), pageHeaders.size(), f);
-                }
-
-                out.lightmapPages.resize(lh.pageCount);
-                for (uint32_t i = 0; i < lh.pageCount; ++i) {
-                    BSPDataLightmapPage& page = out.lightmapPages[i];
-                    page.width = (int)pageHeaders[i].width;
-                    page.height = (int)pageHeaders[i].height;
-                    page.format = pageHeaders[i].format;
-                    page.pixels.resize(pageHeaders[i].byteLength);
-                    if (!page.pixels.empty()) {
-                        fread(page.pixels.data(), 1, page.pixels.size(), f);
-                    }
-                }
-            } else {
-                std::vector<BSPLightmapPageHeaderV3Compat> pageHeaders(lh.pageCount);
-                if (!pageHeaders.empty()) {
-                    fread(pageHeaders.data(), sizeof(BSPLightmapPageHeaderV3Compat), pageHeaders.size(), f);
-                }
-
-                out.lightmapPages.resize(lh.pageCount);
-                for (uint32_t i = 0; i < lh.pageCount; ++i) {
-                    BSPDataLightmapPage& page = out.lightmapPages[i];
-                    page.width = (int)pageHeaders[i].width;
-                    page.height = (int)pageHeaders[i].height;
-                    page.format = BSP_LIGHTMAP_FORMAT_RGBA8_UNORM;
-                    page.pixels.resize(pageHeaders[i].byteLength);
-                    if (!page.pixels.empty()) {
-                        fread(page.pixels.data(), 1, page.pixels.size(), f);
-                    }
-                }
-            }
-        }
+    if (!ReadLightmapPages(base, hdr.lumps[LUMP_LIGHTMAP], hdr.version, out)) {
+        printf("[BSP] %s: lightmap pages run past the end of the lightmap lump\n", path);
+        UnloadBSP(out);
+        return false;
     }
 
     // ----- structural bsp -----------------------------------------------
     if (hdr.version >= WBSP_VERSION_LIGHTMAP_RGBA8) {
         const BSPLump& treeLump = hdr.lumps[LUMP_BSP_TREE];
         if (treeLump.length >= sizeof(BSPTreeHeader)) {
-            fseek(f, treeLump.offset, SEEK_SET);
-            fread(&out.tree, sizeof(out.tree), 1, f);
+            memcpy(&out.tree, base + treeLump.offset, sizeof(out.tree));
+        }
+        out.planes = LumpSpan<BSPPlane>(out, base, hdr.lumps[LUMP_BSP_PLANES]);
+        out.bspFaces = LumpSpan<BSPFace>(out, base, hdr.lumps[LUMP_BSP_FACES]);
+        out.bspFaceVerts = LumpSpan<BSPVec3>(out, base, hdr.lumps[LUMP_BSP_FACE_VERTS]);
+        out.bspNodes = LumpSpan<BSPNode>(out, base, hdr.lumps[LUMP_BSP_NODES]);
+        out.bspLeaves = LumpSpan<BSPLeaf>(out, base, hdr.lumps[LUMP_BSP_LEAVES]);
+        out.bspFaceRefs = LumpSpan<uint32_t>(out, base, hdr.lumps[LUMP_BSP_FACE_REFS]);
+    }
+    // Bad visibility only costs culling, so it is dropped rather than failing
+    // the load.
+    const BSPLump& visLump = hdr.lumps[LUMP_VISIBILITY];
+    if (visLump.length != 0) {
+        const uint8_t* visData = base + visLump.offset;
+        if ((uintptr_t)visData % alignof(uint32_t) != 0) {
+            std::vector<uint32_t>& copy = out.alignedLumps.emplace_back((visLump.length + 3) / 4);
+            memcpy(copy.data(), visData, visLump.length);
+            visData = (const uint8_t*)copy.data();
+        }
+        if (!ReadVisRows(visData, visLump.length, &out.visibility) ||
+            out.visibility.header.leafCount != out.bspLeaves.size()) {
+            printf("[BSP] %s: visibility lump is malformed or does not match the leaves; drawing without it\n", path);
+            out.visibility = BSPVisRows{};
+        }
+    }
+
+    // Occluders, likewise, only cost culling when they are bad.
+    out.occluders = LumpSpan<BSPOccluder>(out, base, hdr.lumps[LUMP_OCCLUDERS]);
+    out.occluderVerts = LumpSpan<BSPVec3>(out, base, hdr.lumps[LUMP_OCCLUDER_VERTS]);
+    for (const BSPOccluder& occluder : out.occluders) {
+        if (occluder.vertexCount < 3 || occluder.firstVertex > out.occluderVerts.size() ||
+            occluder.vertexCount > out.occluderVerts.size() - occluder.firstVertex) {
+            printf("[BSP] %s: occluder lump is malformed; drawing without occlusion culling\n", path);
+            out.occluders = {};
+            out.occluderVerts = {};
+            break;
         }
-        out.planes = ReadLump<BSPPlane>(f, hdr.lumps[LUMP_BSP_PLANES]);
-        out.bspFaces = ReadLump<BSPFace>(f, hdr.lumps[LUMP_BSP_FACES]);
-        out.bspFaceVerts = ReadLump<BSPVec3>(f, hdr.lumps[LUMP_BSP_FACE_VERTS]);
-        out.bspNodes = ReadLump<BSPNode>(f, hdr.lumps[LUMP_BSP_NODES]);
-        out.bspLeaves = ReadLump<BSPLeaf>(f, hdr.lumps[LUMP_BSP_LEAVES]);
-        out.bspFaceRefs = ReadLump<uint32_t>(f, hdr.lumps[LUMP_BSP_FACE_REFS]);
     }
 
-    fclose(f);
     out.assetPackPath = GetCompanionRresPath(path);
-    printf("[BSP] loaded %s: %zu meshes, %zu hulls, %zu ents, %zu lightmap pages, %zu bsp faces, %zu bsp nodes, %zu bsp leaves\n",
-           path, out.buckets.size(), out.hulls.size(), out.entities.size(),
-           out.lightmapPages.size(), out.bspFaces.size(), out.bspNodes.size(), out.bspLeaves.size());
+    printf("[BSP] loaded %s (%s): %zu %s vertices, %zu meshes, %zu mesh clusters, %zu hulls, %zu ents, %zu lightmap pages, %zu bsp faces, %zu bsp nodes, %zu bsp leaves, %zu vis bytes, %zu occluders\n",
+           path, out.file.data ? "mapped" : "read", BSPVertexCount(out), out.compactVertices.empty() ? "full" : "compact", out.meshes.size(), out.meshClusters.size(), out.hulls.size(), out.entities.entities.size(),
+           out.lightmapPages.size(), out.bspFaces.size(), out.bspNodes.size(), out.bspLeaves.size(), out.visibility.rows.size(), out.occluders.size());
     return true;
 }
 
+size_t BSPVertexCount(const BSPData& bsp)
+{
+    return bsp.compactVertices.empty() ? bsp.vertices.size() : bsp.compactVertices.size();
+}
+
+void UnloadBSP(BSPData& bsp)
+{
+    UnmapFile(bsp.file);
+    bsp = BSPData{};
+}
+
 std::vector<PlayerStart> GetPlayerStarts(const BSPData& bsp) {
-    Map tmp; tmp.entities = bsp.entities;
-    return GetPlayerStarts(tmp);
+    std::vector<PlayerStart> starts;
+    const EntityTable& table = bsp.entities;
+    const uint32_t classnameKey = FindEntityKey(table, "classname");
+    const uint32_t originKey = FindEntityKey(table, "origin");
+    for (size_t i = 0; i < table.entities.size(); ++i) {
+        const BSPEntityProperty* classname = FindEntityProperty(table, i, classnameKey);
+        if (!classname || strcmp(EntityPropertyText(table, *classname), "info_player_start") != 0) {
+            continue;
+        }
+        const BSPEntityProperty* origin = FindEntityProperty(table, i, originKey);
+        Vector3 posTB{};
+        if (!origin || !EntityPropertyVec3(*origin, posTB)) {
+            continue;
+        }
+
+        PlayerStart ps;
+        ps.position = ConvertTBPointEntityToWorld(posTB);
+        ParsePointEntityFacing(table, i, ps.yaw, ps.pitch);
+        starts.push_back(ps);
+
+        printf("PlayerStart TB:(%.1f, %.1f, %.1f)  RL:(%.1f, %.1f, %.1f) yaw=%.1f pitch=%.1f\n",
+               posTB.x, posTB.y, posTB.z, ps.position.x, ps.position.y, ps.position.z, ps.yaw, ps.pitch);
+    }
+    return starts;
 }
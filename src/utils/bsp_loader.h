@@ -1,34 +1,62 @@
 // bsp_loader.h  —  runtime .bsp reader.
+//
+// The file is memory-mapped and its lumps are exposed as typed spans over
+// the mapping; render meshes and collision hulls stay (offset, count) ranges
+// into the shared vertex/index and hull-point arrays. Only what older file
+// versions need converted is copied. Every span stays valid until UnloadBSP.
 #pragma once
 #include "bsp_format.h"
-#include "map_types.h"               // MapMeshBucket, Entity, PlayerStart
-#include "../physx/collision_data.h" // MeshCollisionData
-#include <vector>
+#include "bsp_vis.h"
+#include "entity_table.h"
+#include "mapped_file.h"
+#include "map_types.h"               // PlayerStart
 #include <cstdint>
+#include <span>
+#include <string>
+#include <vector>
 
 struct BSPDataLightmapPage {
-    int                  width = 0;
-    int                  height = 0;
-    uint32_t             format = BSP_LIGHTMAP_FORMAT_RGBA8_UNORM;
-    std::vector<uint8_t> pixels;
+    int                      width = 0;
+    int                      height = 0;
+    uint32_t                 format = BSP_LIGHTMAP_FORMAT_RGBA8_UNORM;
+    std::span<const uint8_t> pixels;
 };
 
 struct BSPData {
-    std::vector<MapMeshBucket>     buckets;    // per-texture, ready for upload
-    std::vector<MeshCollisionData> hulls;
-    std::vector<Entity>            entities;   // point and brush entities, properties only
+    std::span<const BSPTexture>      textures;
+    std::span<const BSPVertex>       vertices;
+    std::span<const BSPVertexCompact> compactVertices; // used instead of `vertices` when non-empty
+    std::span<const uint32_t>        indices;     // absolute into the vertex lump
+    std::span<const BSPMesh>         meshes;      // per-texture ranges of vertices/indices
+    std::span<const BSPMeshCluster>  meshClusters; // empty before v8: cull whole meshes
+    std::span<const BSPHull>         hulls;       // ranges of hullPoints
+    std::span<const BSPVec3>         hullPoints;
+    EntityTable                      entities;    // point and brush entities, properties only
     std::vector<BSPDataLightmapPage> lightmapPages;
-    BSPTreeHeader                  tree{};
-    std::vector<BSPPlane>          planes;
-    std::vector<BSPFace>           bspFaces;
-    std::vector<BSPVec3>           bspFaceVerts;
-    std::vector<BSPNode>           bspNodes;
-    std::vector<BSPLeaf>           bspLeaves;
-    std::vector<uint32_t>          bspFaceRefs;
-    std::string                    assetPackPath;
+    BSPTreeHeader                    tree{};
+    std::span<const BSPPlane>        planes;
+    std::span<const BSPFace>         bspFaces;
+    std::span<const BSPVec3>         bspFaceVerts;
+    std::span<const BSPNode>         bspNodes;
+    std::span<const BSPLeaf>         bspLeaves;
+    std::span<const uint32_t>        bspFaceRefs;
+    BSPVisRows                       visibility;  // header.leafCount == 0 without vis
+    std::span<const BSPOccluder>     occluders;   // empty before v10
+    std::span<const BSPVec3>         occluderVerts;
+    std::string                      assetPackPath;
+
+    // Backing storage for the spans above.
+    MappedFile                         file;
+    std::vector<uint8_t>               fileBytes;    // whole file, when it cannot be mapped
+    std::vector<BSPHull>               upgradedHulls; // pre-v5 hulls with entityIndex = -1
+    std::vector<std::vector<uint32_t>> alignedLumps; // uint32 lumps written unaligned
+    EntityTableStorage                 entityStorage; // built from the entity text of pre-v6 files
 };
 
 bool LoadBSP(const char* path, BSPData& out);
+void UnloadBSP(BSPData& bsp);
+// Vertices in whichever vertex lump the file uses.
+size_t BSPVertexCount(const BSPData& bsp);
 
 // Convenience: pull player starts from the loaded entity list.
 std::vector<PlayerStart> GetPlayerStarts(const BSPData& bsp);
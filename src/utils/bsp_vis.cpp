@@ -0,0 +1,148 @@
+// bsp_vis.cpp
+#include "bsp_vis.h"
+#include <cstring>
+
+void CompressVisRow(const uint8_t* row, size_t rowBytes, std::vector<uint8_t>* out)
+{
+    for (size_t i = 0; i < rowBytes; ++i) {
+        if (row[i] != 0) {
+            out->push_back(row[i]);
+            continue;
+        }
+        size_t run = 1;
+        while (i + run < rowBytes && row[i + run] == 0 && run < 255) {
+            ++run;
+        }
+        out->push_back(0);
+        out->push_back((uint8_t)run);
+        i += run - 1;
+    }
+}
+
+bool DecompressVisRow(std::span<const uint8_t> rows, uint32_t offset, uint8_t* row, size_t rowBytes)
+{
+    size_t in = offset;
+    size_t outBytes = 0;
+    while (outBytes < rowBytes) {
+        if (in >= rows.size()) {
+            return false;
+        }
+        const uint8_t b = rows[in++];
+        if (b != 0) {
+            row[outBytes++] = b;
+            continue;
+        }
+        if (in >= rows.size()) {
+            return false;
+        }
+        const size_t run = rows[in++];
+        if (run == 0 || run > rowBytes - outBytes) {
+            return false;
+        }
+        memset(row + outBytes, 0, run);
+        outBytes += run;
+    }
+    return true;
+}
+
+std::vector<uint8_t> SerializeVisRows(const BSPVisHeader& header,
+                                      const std::vector<uint32_t>& rowOffsets,
+                                      const std::vector<uint8_t>& rows)
+{
+    std::vector<uint8_t> out(sizeof(header) + rowOffsets.size() * sizeof(uint32_t) + rows.size());
+    uint8_t* dst = out.data();
+    memcpy(dst, &header, sizeof(header));
+    dst += sizeof(header);
+    if (!rowOffsets.empty()) {
+        memcpy(dst, rowOffsets.data(), rowOffsets.size() * sizeof(uint32_t));
+        dst += rowOffsets.size() * sizeof(uint32_t);
+    }
+    if (!rows.empty()) {
+        memcpy(dst, rows.data(), rows.size());
+    }
+    return out;
+}
+
+bool ReadVisRows(const uint8_t* lump, size_t length, BSPVisRows* out)
+{
+    BSPVisHeader header{};
+    if (length < sizeof(header)) {
+        return false;
+    }
+    memcpy(&header, lump, sizeof(header));
+    const size_t offsetBytes = (size_t)header.leafCount * sizeof(uint32_t);
+    if (header.rowBytes != (header.leafCount + 7) / 8 ||
+        length - sizeof(header) < offsetBytes ||
+        length - sizeof(header) - offsetBytes != header.dataBytes) {
+        return false;
+    }
+    const uint32_t* offsets = reinterpret_cast<const uint32_t*>(lump + sizeof(header));
+    for (uint32_t i = 0; i < header.leafCount; ++i) {
+        if (offsets[i] != BSP_VIS_NO_ROW && offsets[i] >= header.dataBytes) {
+            return false;
+        }
+    }
+    out->header = header;
+    out->rowOffsets = { offsets, header.leafCount };
+    out->rows = { lump + sizeof(header) + offsetBytes, header.dataBytes };
+    return true;
+}
+
+static float PlaneDistance(const BSPPlane& plane, const float p[3])
+{
+    return plane.nx * p[0] + plane.ny * p[1] + plane.nz * p[2] + plane.d;
+}
+
+int32_t FindBSPLeaf(std::span<const BSPNode> nodes, std::span<const BSPPlane> planes,
+                    int32_t rootChild, const float point[3])
+{
+    int32_t child = rootChild;
+    while (child >= 0) {
+        if ((size_t)child >= nodes.size()) {
+            return -1;
+        }
+        const BSPNode& node = nodes[(size_t)child];
+        if ((size_t)node.planeIndex >= planes.size()) {
+            return -1;
+        }
+        child = PlaneDistance(planes[(size_t)node.planeIndex], point) >= 0.0f ? node.frontChild : node.backChild;
+    }
+    return -1 - child;
+}
+
+void FindBSPLeavesInBox(std::span<const BSPNode> nodes, std::span<const BSPPlane> planes,
+                        int32_t rootChild, const float mins[3], const float maxs[3],
+                        std::vector<uint32_t>* out)
+{
+    std::vector<int32_t> stack{ rootChild };
+    while (!stack.empty()) {
+        const int32_t child = stack.back();
+        stack.pop_back();
+        if (child < 0) {
+            out->push_back((uint32_t)(-1 - child));
+            continue;
+        }
+        if ((size_t)child >= nodes.size()) {
+            continue;
+        }
+        const BSPNode& node = nodes[(size_t)child];
+        if ((size_t)node.planeIndex >= planes.size()) {
+            continue;
+        }
+        const BSPPlane& plane = planes[(size_t)node.planeIndex];
+        // Box corners nearest to and farthest along the plane normal.
+        float nearest[3];
+        float farthest[3];
+        const float n[3] = { plane.nx, plane.ny, plane.nz };
+        for (int axis = 0; axis < 3; ++axis) {
+            nearest[axis] = n[axis] >= 0.0f ? mins[axis] : maxs[axis];
+            farthest[axis] = n[axis] >= 0.0f ? maxs[axis] : mins[axis];
+        }
+        if (PlaneDistance(plane, farthest) >= 0.0f) {
+            stack.push_back(node.frontChild);
+        }
+        if (PlaneDistance(plane, nearest) < 0.0f) {
+            stack.push_back(node.backChild);
+        }
+    }
+}
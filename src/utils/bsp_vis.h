@@ -0,0 +1,39 @@
+// bsp_vis.h  —  leaf visibility rows (LUMP_VISIBILITY) and leaf lookups.
+//
+// compile_map stores one potentially-visible-set row per empty leaf of the
+// structural tree, run-length compressed; the engine finds the leaf the eye
+// is in by walking the tree's planes and decompresses that leaf's row.
+#pragma once
+#include "bsp_format.h"
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+struct BSPVisRows {
+    BSPVisHeader              header{};
+    std::span<const uint32_t> rowOffsets;  // one per leaf, or BSP_VIS_NO_ROW
+    std::span<const uint8_t>  rows;
+};
+
+// Appends `row` compressed: zero bytes become (0, run length).
+void CompressVisRow(const uint8_t* row, size_t rowBytes, std::vector<uint8_t>* out);
+// Expands the row starting at `offset` into `row` (rowBytes long). Fails if
+// the data ends early or a zero run overshoots the row.
+bool DecompressVisRow(std::span<const uint8_t> rows, uint32_t offset, uint8_t* row, size_t rowBytes);
+
+std::vector<uint8_t> SerializeVisRows(const BSPVisHeader& header,
+                                      const std::vector<uint32_t>& rowOffsets,
+                                      const std::vector<uint8_t>& rows);
+// Views a LUMP_VISIBILITY lump in place. `lump` must be 4-byte aligned.
+// Fails when the sizes disagree or a row offset points past the rows.
+bool ReadVisRows(const uint8_t* lump, size_t length, BSPVisRows* out);
+
+// Leaf containing the point, or -1 for an empty tree. Points on a plane go
+// to its front.
+int32_t FindBSPLeaf(std::span<const BSPNode> nodes, std::span<const BSPPlane> planes,
+                    int32_t rootChild, const float point[3]);
+// Appends every leaf the box touches, of any contents.
+void FindBSPLeavesInBox(std::span<const BSPNode> nodes, std::span<const BSPPlane> planes,
+                        int32_t rootChild, const float mins[3], const float maxs[3],
+                        std::vector<uint32_t>* out);
@@ -0,0 +1,266 @@
+// entity_table.cpp
+#include "entity_table.h"
+#include <algorithm>
+#include <cerrno>
+#include <climits>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <unordered_map>
+
+namespace {
+
+static const char* SkipSpaces(const char* s) {
+    while (*s == ' ' || *s == '\t') ++s;
+    return s;
+}
+
+static bool ParseWholeInt(const char* text, int32_t* out) {
+    const char* s = SkipSpaces(text);
+    if (*s == '\0') return false;
+    char* end = nullptr;
+    errno = 0;
+    const long value = strtol(s, &end, 10);
+    if (end == s || errno != 0 || value < INT32_MIN || value > INT32_MAX) return false;
+    if (*SkipSpaces(end) != '\0') return false;
+    *out = (int32_t)value;
+    return true;
+}
+
+// Parses up to `maxCount` leading floats separated by spaces and ignores
+// whatever follows, as stof and sscanf("%f %f %f") did on the text.
+// Returns how many were read.
+static int ParseLeadingFloats(const char* text, float* out, int maxCount) {
+    const char* s = SkipSpaces(text);
+    int count = 0;
+    while (count < maxCount && *s != '\0') {
+        char* end = nullptr;
+        const float value = strtof(s, &end);
+        if (end == s || !std::isfinite(value)) break;
+        out[count++] = value;
+        s = SkipSpaces(end);
+    }
+    return count;
+}
+
+struct StringPool {
+    std::string*                              strings;
+    std::unordered_map<std::string, uint32_t> offsets;
+
+    uint32_t Intern(const std::string& s) {
+        auto it = offsets.find(s);
+        if (it != offsets.end()) return it->second;
+        const uint32_t offset = (uint32_t)strings->size();
+        strings->append(s);
+        strings->push_back('\0');
+        offsets.emplace(s, offset);
+        return offset;
+    }
+};
+
+} // namespace
+
+void BuildEntityTable(const std::vector<Entity>& entities, EntityTableStorage* out)
+{
+    *out = EntityTableStorage{};
+    StringPool pool{ &out->strings, {} };
+    std::unordered_map<std::string, uint32_t> keyIndices;
+
+    out->entities.reserve(entities.size());
+    std::vector<const std::pair<const std::string, std::string>*> sorted;
+    for (const Entity& entity : entities) {
+        // The source map is unordered; sort by key so output is stable.
+        sorted.clear();
+        for (const auto& kv : entity.properties) sorted.push_back(&kv);
+        std::sort(sorted.begin(), sorted.end(), [](const auto* a, const auto* b) { return a->first < b->first; });
+
+        BSPEntity bspEntity{};
+        bspEntity.firstProperty = (uint32_t)out->properties.size();
+        bspEntity.propertyCount = (uint32_t)sorted.size();
+        for (const auto* kv : sorted) {
+            auto keyIt = keyIndices.find(kv->first);
+            if (keyIt == keyIndices.end()) {
+                keyIt = keyIndices.emplace(kv->first, (uint32_t)out->keys.size()).first;
+                out->keys.push_back(pool.Intern(kv->first));
+            }
+
+            BSPEntityProperty property{};
+            property.key = keyIt->second;
+            property.type = BSP_ENTITY_VALUE_STRING;
+            property.text = pool.Intern(kv->second);
+            const char* text = kv->second.c_str();
+            if (ParseWholeInt(text, &property.intValue)) {
+                property.type = BSP_ENTITY_VALUE_INT;
+                property.value[0] = (float)property.intValue;
+            } else {
+                const int floats = ParseLeadingFloats(text, property.value, 3);
+                if (floats == 3) {
+                    property.type = BSP_ENTITY_VALUE_VEC3;
+                } else if (floats >= 1) {
+                    property.type = BSP_ENTITY_VALUE_FLOAT;
+                    property.value[1] = property.value[2] = 0.0f;
+                } else {
+                    memset(property.value, 0, sizeof(property.value));
+                }
+            }
+            out->properties.push_back(property);
+        }
+        out->entities.push_back(bspEntity);
+    }
+}
+
+EntityTable ViewEntityTable(const EntityTableStorage& storage)
+{
+    EntityTable table;
+    table.entities = storage.entities;
+    table.properties = storage.properties;
+    table.keys = storage.keys;
+    table.strings = { storage.strings.data(), storage.strings.size() };
+    return table;
+}
+
+std::vector<uint8_t> SerializeEntityTable(const EntityTableStorage& storage)
+{
+    BSPEntityLumpHeader header{};
+    header.entityCount = (uint32_t)storage.entities.size();
+    header.propertyCount = (uint32_t)storage.properties.size();
+    header.keyCount = (uint32_t)storage.keys.size();
+    header.stringBytes = (uint32_t)storage.strings.size();
+
+    std::vector<uint8_t> bytes;
+    auto append = [&bytes](const void* data, size_t size) {
+        if (size == 0) return;
+        const uint8_t* p = (const uint8_t*)data;
+        bytes.insert(bytes.end(), p, p + size);
+    };
+    append(&header, sizeof(header));
+    append(storage.entities.data(), storage.entities.size() * sizeof(BSPEntity));
+    append(storage.properties.data(), storage.properties.size() * sizeof(BSPEntityProperty));
+    append(storage.keys.data(), storage.keys.size() * sizeof(uint32_t));
+    append(storage.strings.data(), storage.strings.size());
+    return bytes;
+}
+
+bool ReadEntityTable(const uint8_t* lump, size_t length, EntityTable* out)
+{
+    *out = EntityTable{};
+    if (length < sizeof(BSPEntityLumpHeader) || (uintptr_t)lump % alignof(uint32_t) != 0) {
+        return false;
+    }
+    BSPEntityLumpHeader header{};
+    memcpy(&header, lump, sizeof(header));
+
+    const size_t entityBytes = (size_t)header.entityCount * sizeof(BSPEntity);
+    const size_t propertyBytes = (size_t)header.propertyCount * sizeof(BSPEntityProperty);
+    const size_t keyBytes = (size_t)header.keyCount * sizeof(uint32_t);
+    const size_t needed = sizeof(header) + entityBytes + propertyBytes + keyBytes + header.stringBytes;
+    if (needed > length) {
+        return false;
+    }
+
+    const uint8_t* p = lump + sizeof(header);
+    EntityTable table;
+    table.entities = { (const BSPEntity*)p, header.entityCount };
+    p += entityBytes;
+    table.properties = { (const BSPEntityProperty*)p, header.propertyCount };
+    p += propertyBytes;
+    table.keys = { (const uint32_t*)p, header.keyCount };
+    p += keyBytes;
+    table.strings = { (const char*)p, header.stringBytes };
+
+    // A terminated pool makes every in-range offset a valid C string.
+    if (!table.strings.empty() && table.strings.back() != '\0') {
+        return false;
+    }
+    for (const BSPEntity& entity : table.entities) {
+        if (entity.firstProperty > table.properties.size() ||
+            entity.propertyCount > table.properties.size() - entity.firstProperty) {
+            return false;
+        }
+    }
+    for (const BSPEntityProperty& property : table.properties) {
+        if (property.key >= table.keys.size() || property.text >= table.strings.size()) {
+            return false;
+        }
+    }
+    for (uint32_t keyOffset : table.keys) {
+        if (keyOffset >= table.strings.size()) {
+            return false;
+        }
+    }
+    *out = table;
+    return true;
+}
+
+uint32_t FindEntityKey(const EntityTable& table, const char* name)
+{
+    for (size_t i = 0; i < table.keys.size(); ++i) {
+        if (strcmp(table.strings.data() + table.keys[i], name) == 0) {
+            return (uint32_t)i;
+        }
+    }
+    return ENTITY_KEY_NONE;
+}
+
+const BSPEntityProperty* FindEntityProperty(const EntityTable& table, size_t entityIndex, uint32_t key)
+{
+    if (key == ENTITY_KEY_NONE || entityIndex >= table.entities.size()) {
+        return nullptr;
+    }
+    const BSPEntity& entity = table.entities[entityIndex];
+    for (uint32_t i = 0; i < entity.propertyCount; ++i) {
+        const BSPEntityProperty& property = table.properties[entity.firstProperty + i];
+        if (property.key == key) {
+            return &property;
+        }
+    }
+    return nullptr;
+}
+
+const BSPEntityProperty* FindEntityProperty(const EntityTable& table, size_t entityIndex, const char* name)
+{
+    return FindEntityProperty(table, entityIndex, FindEntityKey(table, name));
+}
+
+const char* EntityPropertyText(const EntityTable& table, const BSPEntityProperty& property)
+{
+    return table.strings.data() + property.text;
+}
+
+const char* EntityClassname(const EntityTable& table, size_t entityIndex)
+{
+    const BSPEntityProperty* classname = FindEntityProperty(table, entityIndex, "classname");
+    return classname ? EntityPropertyText(table, *classname) : "";
+}
+
+bool EntityPropertyVec3(const BSPEntityProperty& property, Vector3& out)
+{
+    if (property.type != BSP_ENTITY_VALUE_VEC3) {
+        return false;
+    }
+    out = { property.value[0], property.value[1], property.value[2] };
+    return true;
+}
+
+bool EntityPropertyFloat(const BSPEntityProperty& property, float& out)
+{
+    if (property.type == BSP_ENTITY_VALUE_STRING) {
+        return false;
+    }
+    out = property.value[0];
+    return true;
+}
+
+bool EntityPropertyInt(const BSPEntityProperty& property, int& out)
+{
+    if (property.type == BSP_ENTITY_VALUE_INT) {
+        out = property.intValue;
+        return true;
+    }
+    if (property.type != BSP_ENTITY_VALUE_STRING &&
+        property.value[0] >= -2147483648.0f && property.value[0] < 2147483648.0f) {
+        out = (int)std::lround(property.value[0]);
+        return true;
+    }
+    return false;
+}
@@ -0,0 +1,58 @@
+// entity_table.h  —  typed entity properties (LUMP_ENTITY_DATA).
+//
+// compile_map builds the table from the parsed .map entities and writes it
+// as one lump; the engine views that lump in place. Lookups resolve a key
+// name to its interned index once and then compare integers, so walking the
+// entities at load time allocates nothing. BSP files from before the lump
+// existed get the same table built from their entity text.
+#pragma once
+#include "bsp_format.h"
+#include "map_types.h"               // Entity, Vector3
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <string>
+#include <vector>
+
+static constexpr uint32_t ENTITY_KEY_NONE = 0xFFFFFFFFu;
+
+struct EntityTable {
+    std::span<const BSPEntity>         entities;
+    std::span<const BSPEntityProperty> properties;
+    std::span<const uint32_t>          keys;      // string pool offsets, one per interned key
+    std::span<const char>              strings;   // \0-terminated, deduplicated
+};
+
+// Owned tables: what compile_map serializes, and what the loader builds
+// for older files.
+struct EntityTableStorage {
+    std::vector<BSPEntity>         entities;
+    std::vector<BSPEntityProperty> properties;
+    std::vector<uint32_t>          keys;
+    std::string                    strings;
+};
+
+// Each value becomes the narrowest type its whole text parses as:
+// int, float, three floats, or string.
+void        BuildEntityTable(const std::vector<Entity>& entities, EntityTableStorage* out);
+EntityTable ViewEntityTable(const EntityTableStorage& storage);
+
+std::vector<uint8_t> SerializeEntityTable(const EntityTableStorage& storage);
+// Views a LUMP_ENTITY_DATA lump in place. `lump` must be 4-byte aligned.
+// Fails on truncated lumps and out-of-range key or string references.
+bool        ReadEntityTable(const uint8_t* lump, size_t length, EntityTable* out);
+
+uint32_t    FindEntityKey(const EntityTable& table, const char* name);
+const BSPEntityProperty* FindEntityProperty(const EntityTable& table, size_t entityIndex, uint32_t key);
+const BSPEntityProperty* FindEntityProperty(const EntityTable& table, size_t entityIndex, const char* name);
+const char* EntityPropertyText(const EntityTable& table, const BSPEntityProperty& property);
+// The entity's classname, or "" when it has none.
+const char* EntityClassname(const EntityTable& table, size_t entityIndex);
+
+// Typed reads. Values are typed from their leading numbers, as the text
+// parsing they replace did: trailing text is ignored, so "1 2" is the float
+// 1 and "0 90 0 x" a vec3. Int and float reads take the first component of
+// any number, rounding to nearest for ints; vec3 reads need three.
+bool        EntityPropertyVec3(const BSPEntityProperty& property, Vector3& out);
+bool        EntityPropertyFloat(const BSPEntityProperty& property, float& out);
+bool        EntityPropertyInt(const BSPEntityProperty& property, int& out);
@@ -0,0 +1,524 @@
+#include "lightmap_codec.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstring>
+
+namespace {
+
+static constexpr int kRGB9E5MantissaBits = 9;
+static constexpr int kRGB9E5ExponentBias = 15;
+static constexpr int kRGB9E5MaxExponent = 31;
+
+static constexpr int kBC6HMode11 = 0x03;
+static constexpr int kBC6HEndpointBits = 10;
+static constexpr int kBC6HMaxEndpoint = (1 << kBC6HEndpointBits) - 1;
+static constexpr int kBC6HMaxHalf = 0x7BFF;
+static constexpr int kBC6HWeights[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+static constexpr int kBC6HRefineIterations = 2;
+
+static bool EqualsIgnoreCase(const char* a, const char* b)
+{
+    for (; *a && *b; ++a, ++b) {
+        if (std::tolower((unsigned char)*a) != std::tolower((unsigned char)*b)) {
+            return false;
+        }
+    }
+    return *a == *b;
+}
+
+// --------------------------------------------------------------------------
+//  BC6H mode 11. All endpoint and palette math happens on half-float bit
+//  patterns, which is the space the hardware interpolates in.
+// --------------------------------------------------------------------------
+static int UnquantizeBC6HEndpoint(int comp)
+{
+    if (comp == 0) {
+        return 0;
+    }
+    if (comp == kBC6HMaxEndpoint) {
+        return 0xFFFF;
+    }
+    return ((comp << 16) + 0x8000) >> kBC6HEndpointBits;
+}
+
+static int FinishBC6HUnsigned(int value)
+{
+    return (value * 31) >> 6;
+}
+
+static void BuildBC6HPalette(const int endpoints[2][3], int palette[16][3])
+{
+    for (int c = 0; c < 3; ++c) {
+        const int a = UnquantizeBC6HEndpoint(endpoints[0][c]);
+        const int b = UnquantizeBC6HEndpoint(endpoints[1][c]);
+        for (int i = 0; i < 16; ++i) {
+            palette[i][c] = FinishBC6HUnsigned(((64 - kBC6HWeights[i]) * a + kBC6HWeights[i] * b + 32) >> 6);
+        }
+    }
+}
+
+// 10-bit endpoint whose decoded half is closest to `halfValue`.
+static int QuantizeBC6HEndpoint(float halfValue)
+{
+    const float v = std::clamp(halfValue, 0.0f, (float)kBC6HMaxHalf);
+    const int guess = (int)floorf(v / 31.0f - 0.5f);
+    int best = 0;
+    float bestError = -1.0f;
+    for (int comp = std::max(0, guess - 1); comp <= std::min(kBC6HMaxEndpoint, guess + 2); ++comp) {
+        const float error = fabsf((float)FinishBC6HUnsigned(UnquantizeBC6HEndpoint(comp)) - v);
+        if (bestError < 0.0f || error < bestError) {
+            best = comp;
+            bestError = error;
+        }
+    }
+    return best;
+}
+
+static int64_t AssignBC6HIndices(const int texels[16][3], const int endpoints[2][3], uint8_t indices[16])
+{
+    int palette[16][3];
+    BuildBC6HPalette(endpoints, palette);
+    int64_t total = 0;
+    for (int t = 0; t < 16; ++t) {
+        int64_t bestError = INT64_MAX;
+        for (int i = 0; i < 16; ++i) {
+            int64_t error = 0;
+            for (int c = 0; c < 3; ++c) {
+                const int64_t d = (int64_t)palette[i][c] - texels[t][c];
+                error += d * d;
+            }
+            if (error < bestError) {
+                bestError = error;
+                indices[t] = (uint8_t)i;
+            }
+        }
+        total += bestError;
+    }
+    return total;
+}
+
+static void PutBits(uint8_t* block, int* bitPos, uint32_t value, int count)
+{
+    for (int i = 0; i < count; ++i, ++*bitPos) {
+        if (value & (1u << i)) {
+            block[*bitPos >> 3] |= (uint8_t)(1u << (*bitPos & 7));
+        }
+    }
+}
+
+static uint32_t GetBits(const uint8_t* block, int* bitPos, int count)
+{
+    uint32_t value = 0;
+    for (int i = 0; i < count; ++i, ++*bitPos) {
+        value |= (uint32_t)((block[*bitPos >> 3] >> (*bitPos & 7)) & 1u) << i;
+    }
+    return value;
+}
+
+} // namespace
+
+const char* LightmapFormatName(uint32_t format)
+{
+    switch (format) {
+    case BSP_LIGHTMAP_FORMAT_RGBA8_UNORM: return "RGBA8";
+    case BSP_LIGHTMAP_FORMAT_RGBA16F:     return "RGBA16F";
+    case BSP_LIGHTMAP_FORMAT_RGB9E5:      return "RGB9E5";
+    case BSP_LIGHTMAP_FORMAT_BC6H_UF16:   return "BC6H";
+    default:                              return "unknown";
+    }
+}
+
+bool LightmapFormatFromName(const char* name, uint32_t* outFormat)
+{
+    static const struct { const char* name; uint32_t format; } kFormats[] = {
+        { "rgba8",   BSP_LIGHTMAP_FORMAT_RGBA8_UNORM },
+        { "rgba16f", BSP_LIGHTMAP_FORMAT_RGBA16F },
+        { "rgb9e5",  BSP_LIGHTMAP_FORMAT_RGB9E5 },
+        { "bc6h",    BSP_LIGHTMAP_FORMAT_BC6H_UF16 },
+    };
+    if (!name || !outFormat) {
+        return false;
+    }
+    for (const auto& entry : kFormats) {
+        if (EqualsIgnoreCase(name, entry.name)) {
+            *outFormat = entry.format;
+            return true;
+        }
+    }
+    return false;
+}
+
+bool LightmapFormatIsBlockCompressed(uint32_t format)
+{
+    return format == BSP_LIGHTMAP_FORMAT_BC6H_UF16;
+}
+
+size_t LightmapPageByteSize(uint32_t format, int width, int height)
+{
+    const size_t w = (size_t)std::max(0, width);
+    const size_t h = (size_t)std::max(0, height);
+    switch (format) {
+    case BSP_LIGHTMAP_FORMAT_RGBA8_UNORM: return w * h * 4;
+    case BSP_LIGHTMAP_FORMAT_RGBA16F:     return w * h * 4 * sizeof(uint16_t);
+    case BSP_LIGHTMAP_FORMAT_RGB9E5:      return w * h * sizeof(uint32_t);
+    case BSP_LIGHTMAP_FORMAT_BC6H_UF16:   return ((w + 3) / 4) * ((h + 3) / 4) * BC6H_BLOCK_BYTES;
+    default:                              return 0;
+    }
+}
+
+uint16_t Float32ToHalfBits(float value)
+{
+    uint32_t bits = 0;
+    memcpy(&bits, &value, sizeof(bits));
+
+    const uint32_t sign = (bits >> 16u) & 0x8000u;
+    const uint32_t absBits = bits & 0x7FFFFFFFu;
+
+    if (absBits >= 0x7F800000u) {
+        const uint32_t mantissa = absBits & 0x007FFFFFu;
+        if (mantissa != 0u) {
+            return (uint16_t)(sign | 0x7C00u | std::max<uint32_t>(1u, mantissa >> 13u));
+        }
+        return (uint16_t)(sign | 0x7C00u);
+    }
+
+    if (absBits > 0x477FEFFFu) {
+        return (uint16_t)(sign | 0x7BFFu);
+    }
+
+    if (absBits < 0x38800000u) {
+        if (absBits < 0x33000000u) {
+            return (uint16_t)sign;
+        }
+
+        uint32_t mantissa = (absBits & 0x007FFFFFu) | 0x00800000u;
+        const uint32_t exp = absBits >> 23u;
+        const uint32_t shift = 126u - exp;
+        mantissa = (mantissa + (1u << (shift - 1u))) >> shift;
+        return (uint16_t)(sign | mantissa);
+    }
+
+    uint32_t rounded = absBits + 0x00001000u;
+    if (rounded >= 0x47800000u) {
+        return (uint16_t)(sign | 0x7BFFu);
+    }
+    return (uint16_t)(sign | ((rounded - 0x38000000u) >> 13u));
+}
+
+float HalfBitsToFloat32(uint16_t bits)
+{
+    const uint32_t sign = (uint32_t)(bits & 0x8000u) << 16u;
+    const uint32_t exp = (bits >> 10u) & 0x1Fu;
+    uint32_t mantissa = bits & 0x3FFu;
+    uint32_t out = 0;
+    if (exp == 0u) {
+        if (mantissa == 0u) {
+            out = sign;
+        } else {
+            int shift = 0;
+            while ((mantissa & 0x400u) == 0u) {
+                mantissa <<= 1u;
+                ++shift;
+            }
+            mantissa &= 0x3FFu;
+            out = sign | ((uint32_t)(113 - shift) << 23u) | (mantissa << 13u);
+        }
+    } else if (exp == 0x1Fu) {
+        out = sign | 0x7F800000u | (mantissa << 13u);
+    } else {
+        out = sign | ((exp + 112u) << 23u) | (mantissa << 13u);
+    }
+    float value = 0.0f;
+    memcpy(&value, &out, sizeof(value));
+    return value;
+}
+
+uint32_t EncodeRGB9E5(float r, float g, float b)
+{
+    const int mantissaMax = (1 << kRGB9E5MantissaBits) - 1;
+    const float sharedMax = (float)mantissaMax / (float)(1 << kRGB9E5MantissaBits) *
+                            ldexpf(1.0f, kRGB9E5MaxExponent - kRGB9E5ExponentBias);
+    // NaN fails every comparison and lands on zero.
+    const float rc = (r > 0.0f) ? std::min(r, sharedMax) : 0.0f;
+    const float gc = (g > 0.0f) ? std::min(g, sharedMax) : 0.0f;
+    const float bc = (b > 0.0f) ? std::min(b, sharedMax) : 0.0f;
+    const float maxRGB = std::max(rc, std::max(gc, bc));
+    if (maxRGB <= 0.0f) {
+        return 0u;
+    }
+
+    int maxExp = 0;
+    frexpf(maxRGB, &maxExp); // maxRGB = m * 2^maxExp, m in [0.5, 1)
+    int sharedExp = std::max(-kRGB9E5ExponentBias - 1, maxExp - 1) + 1 + kRGB9E5ExponentBias;
+    float scale = ldexpf(1.0f, sharedExp - kRGB9E5ExponentBias - kRGB9E5MantissaBits);
+    if ((int)floorf(maxRGB / scale + 0.5f) > mantissaMax) {
+        scale *= 2.0f;
+        ++sharedExp;
+    }
+
+    const uint32_t rm = (uint32_t)std::min(mantissaMax, (int)floorf(rc / scale + 0.5f));
+    const uint32_t gm = (uint32_t)std::min(mantissaMax, (int)floorf(gc / scale + 0.5f));
+    const uint32_t bm = (uint32_t)std::min(mantissaMax, (int)floorf(bc / scale + 0.5f));
+    return rm | (gm << 9u) | (bm << 18u) | ((uint32_t)sharedExp << 27u);
+}
+
+void DecodeRGB9E5(uint32_t packed, float outRGB[3])
+{
+    const int sharedExp = (int)(packed >> 27u);
+    const float scale = ldexpf(1.0f, sharedExp - kRGB9E5ExponentBias - kRGB9E5MantissaBits);
+    outRGB[0] = (float)(packed & 0x1FFu) * scale;
+    outRGB[1] = (float)((packed >> 9u) & 0x1FFu) * scale;
+    outRGB[2] = (float)((packed >> 18u) & 0x1FFu) * scale;
+}
+
+void EncodeLightmapTexel(uint32_t format, const float rgba[4], uint8_t* dst)
+{
+    switch (format) {
+    case BSP_LIGHTMAP_FORMAT_RGBA8_UNORM:
+        for (int c = 0; c < 4; ++c) {
+            dst[c] = (uint8_t)std::clamp((int)lrintf(std::max(0.0f, rgba[c]) * 255.0f), 0, 255);
+        }
+        break;
+    case BSP_LIGHTMAP_FORMAT_RGBA16F: {
+        uint16_t halves[4];
+        for (int c = 0; c < 4; ++c) {
+            halves[c] = Float32ToHalfBits(std::max(0.0f, rgba[c]));
+        }
+        memcpy(dst, halves, sizeof(halves));
+        break;
+    }
+    case BSP_LIGHTMAP_FORMAT_RGB9E5: {
+        const uint32_t packed = EncodeRGB9E5(rgba[0], rgba[1], rgba[2]);
+        memcpy(dst, &packed, sizeof(packed));
+        break;
+    }
+    default:
+        break;
+    }
+}
+
+void DecodeLightmapTexel(uint32_t format, const uint8_t* src, float outRGB[3])
+{
+    switch (format) {
+    case BSP_LIGHTMAP_FORMAT_RGBA8_UNORM:
+        for (int c = 0; c < 3; ++c) {
+            outRGB[c] = (float)src[c] / 255.0f;
+        }
+        break;
+    case BSP_LIGHTMAP_FORMAT_RGBA16F: {
+        uint16_t halves[4];
+        memcpy(halves, src, sizeof(halves));
+        for (int c = 0; c < 3; ++c) {
+            outRGB[c] = HalfBitsToFloat32(halves[c]);
+        }
+        break;
+    }
+    case BSP_LIGHTMAP_FORMAT_RGB9E5: {
+        uint32_t packed = 0;
+        memcpy(&packed, src, sizeof(packed));
+        DecodeRGB9E5(packed, outRGB);
+        break;
+    }
+    default:
+        outRGB[0] = outRGB[1] = outRGB[2] = 0.0f;
+        break;
+    }
+}
+
+// Endpoints start at the ends of the block's principal axis, then a couple of
+// least-squares refits against the chosen indices tighten them.
+void EncodeBC6HBlock(const float rgb[16 * 3], uint8_t outBlock[BC6H_BLOCK_BYTES])
+{
+    int texels[16][3];
+    float mean[3] = { 0.0f, 0.0f, 0.0f };
+    for (int t = 0; t < 16; ++t) {
+        for (int c = 0; c < 3; ++c) {
+            texels[t][c] = std::min<int>(kBC6HMaxHalf, Float32ToHalfBits(std::max(0.0f, rgb[t * 3 + c])));
+            mean[c] += (float)texels[t][c] / 16.0f;
+        }
+    }
+
+    float cov[3][3] = {};
+    for (int t = 0; t < 16; ++t) {
+        float d[3];
+        for (int c = 0; c < 3; ++c) {
+            d[c] = (float)texels[t][c] - mean[c];
+        }
+        for (int i = 0; i < 3; ++i) {
+            for (int j = 0; j < 3; ++j) {
+                cov[i][j] += d[i] * d[j];
+            }
+        }
+    }
+    float axis[3] = { 1.0f, 1.0f, 1.0f };
+    for (int iter = 0; iter < 8; ++iter) {
+        float next[3];
+        for (int i = 0; i < 3; ++i) {
+            next[i] = cov[i][0] * axis[0] + cov[i][1] * axis[1] + cov[i][2] * axis[2];
+        }
+        const float len = sqrtf(next[0] * next[0] + next[1] * next[1] + next[2] * next[2]);
+        if (len <= 1e-6f) {
+            break;
+        }
+        for (int i = 0; i < 3; ++i) {
+            axis[i] = next[i] / len;
+        }
+    }
+
+    float tMin = 0.0f;
+    float tMax = 0.0f;
+    for (int t = 0; t < 16; ++t) {
+        float proj = 0.0f;
+        for (int c = 0; c < 3; ++c) {
+            proj += ((float)texels[t][c] - mean[c]) * axis[c];
+        }
+        tMin = std::min(tMin, proj);
+        tMax = std::max(tMax, proj);
+    }
+
+    int endpoints[2][3];
+    for (int c = 0; c < 3; ++c) {
+        endpoints[0][c] = QuantizeBC6HEndpoint(mean[c] + axis[c] * tMin);
+        endpoints[1][c] = QuantizeBC6HEndpoint(mean[c] + axis[c] * tMax);
+    }
+    uint8_t indices[16];
+    int64_t bestError = AssignBC6HIndices(texels, endpoints, indices);
+
+    for (int iter = 0; iter < kBC6HRefineIterations && bestError > 0; ++iter) {
+        float a = 0.0f, b = 0.0f, d = 0.0f;
+        float x0[3] = {}, x1[3] = {};
+        for (int t = 0; t < 16; ++t) {
+            const float w = (float)kBC6HWeights[indices[t]] / 64.0f;
+            a += (1.0f - w) * (1.0f - w);
+            b += w * (1.0f - w);
+            d += w * w;
+            for (int c = 0; c < 3; ++c) {
+                x0[c] += (1.0f - w) * (float)texels[t][c];
+                x1[c] += w * (float)texels[t][c];
+            }
+        }
+        const float det = a * d - b * b;
+        if (fabsf(det) < 1e-6f) {
+            break;
+        }
+        int refined[2][3];
+        for (int c = 0; c < 3; ++c) {
+            refined[0][c] = QuantizeBC6HEndpoint((d * x0[c] - b * x1[c]) / det);
+            refined[1][c] = QuantizeBC6HEndpoint((a * x1[c] - b * x0[c]) / det);
+        }
+        uint8_t refinedIndices[16];
+        const int64_t refinedError = AssignBC6HIndices(texels, refined, refinedIndices);
+        if (refinedError >= bestError) {
+            break;
+        }
+        bestError = refinedError;
+        memcpy(endpoints, refined, sizeof(endpoints));
+        memcpy(indices, refinedIndices, sizeof(indices));
+    }
+
+    // The first index is stored without its top bit, so it must be < 8. The
+    // weight table is symmetric, so swapping endpoints and mirroring every
+    // index decodes to the same texels.
+    if (indices[0] >= 8) {
+        for (int c = 0; c < 3; ++c) {
+            std::swap(endpoints[0][c], endpoints[1][c]);
+        }
+        for (uint8_t& index : indices) {
+            index = (uint8_t)(15 - index);
+        }
+    }
+
+    memset(outBlock, 0, BC6H_BLOCK_BYTES);
+    int bitPos = 0;
+    PutBits(outBlock, &bitPos, kBC6HMode11, 5);
+    for (int e = 0; e < 2; ++e) {
+        for (int c = 0; c < 3; ++c) {
+            PutBits(outBlock, &bitPos, (uint32_t)endpoints[e][c], kBC6HEndpointBits);
+        }
+    }
+    PutBits(outBlock, &bitPos, indices[0], 3);
+    for (int t = 1; t < 16; ++t) {
+        PutBits(outBlock, &bitPos, indices[t], 4);
+    }
+}
+
+bool DecodeBC6HBlock(const uint8_t block[BC6H_BLOCK_BYTES], float outRGB[16 * 3])
+{
+    int bitPos = 0;
+    if ((int)GetBits(block, &bitPos, 5) != kBC6HMode11) {
+        return false;
+    }
+    int endpoints[2][3];
+    for (int e = 0; e < 2; ++e) {
+        for (int c = 0; c < 3; ++c) {
+            endpoints[e][c] = (int)GetBits(block, &bitPos, kBC6HEndpointBits);
+        }
+    }
+    int palette[16][3];
+    BuildBC6HPalette(endpoints, palette);
+    for (int t = 0; t < 16; ++t) {
+        const uint32_t index = GetBits(block, &bitPos, t == 0 ? 3 : 4);
+        for (int c = 0; c < 3; ++c) {
+            outRGB[t * 3 + c] = HalfBitsToFloat32((uint16_t)palette[index][c]);
+        }
+    }
+    return true;
+}
+
+bool DecodeLightmapPageRGBA16F(uint32_t format,
+                               int width,
+                               int height,
+                               const uint8_t* data,
+                               size_t dataSize,
+                               std::vector<uint8_t>* outRGBA16F)
+{
+    const size_t expected = LightmapPageByteSize(format, width, height);
+    if (!outRGBA16F || !data || expected == 0 || dataSize != expected) {
+        return false;
+    }
+
+    const uint16_t one = Float32ToHalfBits(1.0f);
+    outRGBA16F->assign(LightmapPageByteSize(BSP_LIGHTMAP_FORMAT_RGBA16F, width, height), 0);
+    uint16_t* dst = reinterpret_cast<uint16_t*>(outRGBA16F->data());
+    auto storeTexel = [&](int x, int y, const float rgb[3]) {
+        uint16_t* texel = dst + ((size_t)y * (size_t)width + (size_t)x) * 4;
+        texel[0] = Float32ToHalfBits(rgb[0]);
+        texel[1] = Float32ToHalfBits(rgb[1]);
+        texel[2] = Float32ToHalfBits(rgb[2]);
+        texel[3] = one;
+    };
+
+    if (format == BSP_LIGHTMAP_FORMAT_BC6H_UF16) {
+        const int blocksX = (width + 3) / 4;
+        const int blocksY = (height + 3) / 4;
+        float rgb[16 * 3];
+        for (int by = 0; by < blocksY; ++by) {
+            for (int bx = 0; bx < blocksX; ++bx) {
+                const uint8_t* block = data + ((size_t)by * (size_t)blocksX + (size_t)bx) * BC6H_BLOCK_BYTES;
+                if (!DecodeBC6HBlock(block, rgb)) {
+                    return false;
+                }
+                for (int t = 0; t < 16; ++t) {
+                    const int x = bx * 4 + (t & 3);
+                    const int y = by * 4 + (t >> 2);
+                    if (x < width && y < height) {
+                        storeTexel(x, y, rgb + t * 3);
+                    }
+                }
+            }
+        }
+        return true;
+    }
+
+    const size_t texelBytes = expected / ((size_t)width * (size_t)height);
+    for (int y = 0; y < height; ++y) {
+        for (int x = 0; x < width; ++x) {
+            float rgb[3];
+            DecodeLightmapTexel(format, data + ((size_t)y * (size_t)width + (size_t)x) * texelBytes, rgb);
+            storeTexel(x, y, rgb);
+        }
+    }
+    return true;
+}
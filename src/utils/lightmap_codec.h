@@ -0,0 +1,46 @@
+// lightmap_codec.h  —  lightmap page formats (BSPLightmapPageFormat).
+//
+// Shared by compile_map, which encodes the baked float pages, and the engine,
+// which validates page sizes and decodes formats the GPU backend cannot
+// sample into RGBA16F.
+#pragma once
+#include "bsp_format.h"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+static constexpr size_t BC6H_BLOCK_BYTES = 16;
+
+const char* LightmapFormatName(uint32_t format);
+// Accepts "rgba8", "rgba16f", "rgb9e5" and "bc6h" (case-insensitive).
+bool        LightmapFormatFromName(const char* name, uint32_t* outFormat);
+bool        LightmapFormatIsBlockCompressed(uint32_t format);
+// 0 for unknown formats.
+size_t      LightmapPageByteSize(uint32_t format, int width, int height);
+
+uint16_t    Float32ToHalfBits(float value);
+float       HalfBitsToFloat32(uint16_t bits);
+
+// GL_EXT_texture_shared_exponent packing: 9-bit mantissas, 5-bit exponent.
+uint32_t    EncodeRGB9E5(float r, float g, float b);
+void        DecodeRGB9E5(uint32_t packed, float outRGB[3]);
+
+// Per-texel formats only (not BC6H). `rgba` is linear float; negative values
+// clamp to zero. Decoding returns RGB.
+void        EncodeLightmapTexel(uint32_t format, const float rgba[4], uint8_t* dst);
+void        DecodeLightmapTexel(uint32_t format, const uint8_t* src, float outRGB[3]);
+
+// BC6H_UF16 block from 16 texels in row-major order, 3 floats each. Always
+// writes a mode 11 block (one region, 10-bit endpoints, 4-bit indices).
+void        EncodeBC6HBlock(const float rgb[16 * 3], uint8_t outBlock[BC6H_BLOCK_BYTES]);
+// Decodes mode 11 blocks, which is every block compile_map writes; returns
+// false for the other BC6H modes.
+bool        DecodeBC6HBlock(const uint8_t block[BC6H_BLOCK_BYTES], float outRGB[16 * 3]);
+
+// Whole-page decode to RGBA16F for backends that cannot sample `format`.
+bool        DecodeLightmapPageRGBA16F(uint32_t format,
+                                      int width,
+                                      int height,
+                                      const uint8_t* data,
+                                      size_t dataSize,
+                                      std::vector<uint8_t>* outRGBA16F);
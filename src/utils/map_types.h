@@ -1,6 +1,7 @@
 #pragma once
 
 #include "../math/wmath.h"
+#include "bsp_format.h"
 
 #include <cstdint>
 #include <string>
@@ -128,6 +129,7 @@ struct LightBakeSettings {
     int lmAAScale = 0;
     int extraSamples = 0;
     int soften = 0;
+    uint32_t lightmapFormat = BSP_LIGHTMAP_FORMAT_RGBA16F; // BSPLightmapPageFormat
 };
 
 struct MapVertex {
@@ -0,0 +1,95 @@
+#include "mapped_file.h"
+
+#if defined(_WIN32)
+    #ifndef WIN32_LEAN_AND_MEAN
+        #define WIN32_LEAN_AND_MEAN
+    #endif
+    #include <windows.h>
+#else
+    #include <fcntl.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <unistd.h>
+#endif
+
+#if defined(_WIN32)
+
+bool MapFileReadOnly(const std::string& path, MappedFile& file)
+{
+    UnmapFile(file);
+    HANDLE fileHandle = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+                                    OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (fileHandle == INVALID_HANDLE_VALUE) {
+        return false;
+    }
+    LARGE_INTEGER fileSize{};
+    if (!GetFileSizeEx(fileHandle, &fileSize) || fileSize.QuadPart <= 0) {
+        CloseHandle(fileHandle);
+        return false;
+    }
+    HANDLE mappingHandle = CreateFileMappingA(fileHandle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (!mappingHandle) {
+        CloseHandle(fileHandle);
+        return false;
+    }
+    const void* view = MapViewOfFile(mappingHandle, FILE_MAP_READ, 0, 0, 0);
+    if (!view) {
+        CloseHandle(mappingHandle);
+        CloseHandle(fileHandle);
+        return false;
+    }
+    file.data = (const unsigned char*)view;
+    file.size = (size_t)fileSize.QuadPart;
+    file.fileHandle = fileHandle;
+    file.mappingHandle = mappingHandle;
+    return true;
+}
+
+void UnmapFile(MappedFile& file)
+{
+    if (file.data) {
+        UnmapViewOfFile(file.data);
+    }
+    if (file.mappingHandle) {
+        CloseHandle((HANDLE)file.mappingHandle);
+    }
+    if (file.fileHandle) {
+        CloseHandle((HANDLE)file.fileHandle);
+    }
+    file = MappedFile{};
+}
+
+#else
+
+bool MapFileReadOnly(const std::string& path, MappedFile& file)
+{
+    UnmapFile(file);
+    const int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        return false;
+    }
+    struct stat st{};
+    if (fstat(fd, &st) != 0 || st.st_size <= 0) {
+        close(fd);
+        return false;
+    }
+    void* view = mmap(nullptr, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    // The mapping keeps its own reference to the file.
+    close(fd);
+    if (view == MAP_FAILED) {
+        return false;
+    }
+    file.data = (const unsigned char*)view;
+    file.size = (size_t)st.st_size;
+    return true;
+}
+
+void UnmapFile(MappedFile& file)
+{
+    if (file.data) {
+        munmap((void*)file.data, file.size);
+    }
+    file = MappedFile{};
+}
+
+#endif
@@ -0,0 +1,18 @@
+// mapped_file.h  —  read-only memory-mapped files (mmap / MapViewOfFile).
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+struct MappedFile {
+    const unsigned char* data = nullptr;
+    size_t               size = 0;
+#if defined(_WIN32)
+    void*                fileHandle = nullptr;
+    void*                mappingHandle = nullptr;
+#endif
+};
+
+// Maps the whole file. Fails (leaving `file` empty) for missing or empty files.
+bool MapFileReadOnly(const std::string& path, MappedFile& file);
+void UnmapFile(MappedFile& file);
@@ -0,0 +1,63 @@
+// parallel_for.h  —  minimal fork/join helper for the offline tools and the map loader.
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdlib>
+#include <thread>
+#include <vector>
+
+// Worker count used by ParallelFor. Defaults to the hardware thread count;
+// WARPED_THREADS=<n> overrides it (WARPED_THREADS=1 runs everything inline).
+inline size_t ParallelWorkerCount()
+{
+    static const size_t count = []() -> size_t {
+        const char* value = std::getenv("WARPED_THREADS");
+        if (value && value[0] != '\0') {
+            const int requested = atoi(value);
+            if (requested > 0) {
+                return (size_t)requested;
+            }
+        }
+        return std::max<size_t>(1, (size_t)std::thread::hardware_concurrency());
+    }();
+    return count;
+}
+
+// Calls fn(i) for every i in [0, count), spreading indices over up to
+// ParallelWorkerCount() threads and returning once all of them are done.
+// Indices are handed out one at a time, so uneven work items balance out;
+// callers are responsible for keeping the items independent.
+template <typename Fn>
+void ParallelFor(size_t count, const Fn& fn)
+{
+    const size_t workerCount = std::min(ParallelWorkerCount(), count);
+    if (workerCount <= 1) {
+        for (size_t i = 0; i < count; ++i) {
+            fn(i);
+        }
+        return;
+    }
+
+    std::atomic<size_t> next{0};
+    auto worker = [&]() {
+        for (;;) {
+            const size_t i = next.fetch_add(1, std::memory_order_relaxed);
+            if (i >= count) {
+                break;
+            }
+            fn(i);
+        }
+    };
+
+    std::vector<std::thread> threads;
+    threads.reserve(workerCount - 1);
+    for (size_t t = 1; t < workerCount; ++t) {
+        threads.emplace_back(worker);
+    }
+    worker();
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+}
@@ -12,3 +12,16 @@ int SIM_TICK_RATE = 144;
 bool DEVMODE = false;
 float deltaTime = 1.0f / 144.0f; // denominator must match tick rate so we dont simulate faster than we update.
 float RENDER_DISTANCE = 32768.0f;
+
+// Streamed texture mips are kept under this; the smallest mips of every
+// texture stay resident regardless.
+int TEXTURE_BUDGET_MB = 256;
+
+// Packs a .bsp's same-size textures and its lightmap pages into array
+// textures so neighbouring draws share bindings and merge. Arrayed textures
+// are uploaded in full rather than streamed.
+bool TEXTURE_ARRAYS = false;
+
+// While a map loads, the menu keeps drawing and the frame thread makes the
+// map's GPU resources for about this long per frame.
+float MAP_LOAD_BUDGET_MS = 4.0f;
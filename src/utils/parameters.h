@@ -7,3 +7,6 @@ extern int SIM_TICK_RATE;       // fixed gameplay tick rate (Hz) — never 0
 extern bool DEVMODE;
 extern float deltaTime;
 extern float RENDER_DISTANCE;   // far-clip plane, world units
+extern int TEXTURE_BUDGET_MB;   // GPU memory for streamed texture mips
+extern bool TEXTURE_ARRAYS;     // pack .bsp textures and lightmap pages into array textures
+extern float MAP_LOAD_BUDGET_MS; // GPU upload time per frame while a map loads
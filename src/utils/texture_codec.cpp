@@ -0,0 +1,699 @@
+#include "texture_codec.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstring>
+
+namespace {
+
+static constexpr int kBC7Mode6 = 0x40;
+static constexpr int kBC7Weights[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+static constexpr int kRefineIterations = 2;
+
+static bool EqualsIgnoreCase(const char* a, const char* b)
+{
+    for (; *a && *b; ++a, ++b) {
+        if (std::tolower((unsigned char)*a) != std::tolower((unsigned char)*b)) {
+            return false;
+        }
+    }
+    return *a == *b;
+}
+
+static void PutBits(uint8_t* block, int* bitPos, uint32_t value, int count)
+{
+    for (int i = 0; i < count; ++i, ++*bitPos) {
+        if (value & (1u << i)) {
+            block[*bitPos >> 3] |= (uint8_t)(1u << (*bitPos & 7));
+        }
+    }
+}
+
+static uint32_t GetBits(const uint8_t* block, int* bitPos, int count)
+{
+    uint32_t value = 0;
+    for (int i = 0; i < count; ++i, ++*bitPos) {
+        value |= (uint32_t)((block[*bitPos >> 3] >> (*bitPos & 7)) & 1u) << i;
+    }
+    return value;
+}
+
+// --------------------------------------------------------------------------
+//  Endpoint fitting shared by the BC1 colour block and BC7: start from the
+//  ends of the principal axis, then refit by least squares against the
+//  chosen palette weights.
+// --------------------------------------------------------------------------
+static void PrincipalAxisEndpoints(const float points[16][4], int count, int channels, float outLo[4], float outHi[4])
+{
+    float mean[4] = {};
+    for (int t = 0; t < count; ++t) {
+        for (int c = 0; c < channels; ++c) {
+            mean[c] += points[t][c] / (float)count;
+        }
+    }
+
+    float cov[4][4] = {};
+    for (int t = 0; t < count; ++t) {
+        for (int i = 0; i < channels; ++i) {
+            for (int j = 0; j < channels; ++j) {
+                cov[i][j] += (points[t][i] - mean[i]) * (points[t][j] - mean[j]);
+            }
+        }
+    }
+    float axis[4] = { 1.0f, 1.0f, 1.0f, 1.0f };
+    for (int iter = 0; iter < 8; ++iter) {
+        float next[4] = {};
+        float lenSq = 0.0f;
+        for (int i = 0; i < channels; ++i) {
+            for (int j = 0; j < channels; ++j) {
+                next[i] += cov[i][j] * axis[j];
+            }
+            lenSq += next[i] * next[i];
+        }
+        if (lenSq <= 1e-12f) {
+            break;
+        }
+        const float invLen = 1.0f / sqrtf(lenSq);
+        for (int i = 0; i < channels; ++i) {
+            axis[i] = next[i] * invLen;
+        }
+    }
+
+    float tMin = 0.0f;
+    float tMax = 0.0f;
+    for (int t = 0; t < count; ++t) {
+        float proj = 0.0f;
+        for (int c = 0; c < channels; ++c) {
+            proj += (points[t][c] - mean[c]) * axis[c];
+        }
+        tMin = std::min(tMin, proj);
+        tMax = std::max(tMax, proj);
+    }
+    for (int c = 0; c < channels; ++c) {
+        outLo[c] = std::clamp(mean[c] + axis[c] * tMin, 0.0f, 255.0f);
+        outHi[c] = std::clamp(mean[c] + axis[c] * tMax, 0.0f, 255.0f);
+    }
+}
+
+// `weights[t]` is how far texel t sits from e0 towards e1; texels with a
+// negative weight are left out.
+static bool LeastSquaresEndpoints(const float points[16][4],
+                                  const float weights[16],
+                                  int count,
+                                  int channels,
+                                  float outE0[4],
+                                  float outE1[4])
+{
+    float a = 0.0f, b = 0.0f, d = 0.0f;
+    float x0[4] = {}, x1[4] = {};
+    for (int t = 0; t < count; ++t) {
+        const float w = weights[t];
+        if (w < 0.0f) {
+            continue;
+        }
+        a += (1.0f - w) * (1.0f - w);
+        b += w * (1.0f - w);
+        d += w * w;
+        for (int c = 0; c < channels; ++c) {
+            x0[c] += (1.0f - w) * points[t][c];
+            x1[c] += w * points[t][c];
+        }
+    }
+    const float det = a * d - b * b;
+    if (fabsf(det) < 1e-6f) {
+        return false;
+    }
+    for (int c = 0; c < channels; ++c) {
+        outE0[c] = std::clamp((d * x0[c] - b * x1[c]) / det, 0.0f, 255.0f);
+        outE1[c] = std::clamp((a * x1[c] - b * x0[c]) / det, 0.0f, 255.0f);
+    }
+    return true;
+}
+
+// --------------------------------------------------------------------------
+//  BC1 colour block (also the colour half of BC3)
+// --------------------------------------------------------------------------
+static uint16_t PackRGB565(const float rgb[3])
+{
+    const int r = std::clamp((int)lrintf(rgb[0] * 31.0f / 255.0f), 0, 31);
+    const int g = std::clamp((int)lrintf(rgb[1] * 63.0f / 255.0f), 0, 63);
+    const int b = std::clamp((int)lrintf(rgb[2] * 31.0f / 255.0f), 0, 31);
+    return (uint16_t)((r << 11) | (g << 5) | b);
+}
+
+static void UnpackRGB565(uint16_t packed, int outRGB[3])
+{
+    const int r = (packed >> 11) & 31;
+    const int g = (packed >> 5) & 63;
+    const int b = packed & 31;
+    outRGB[0] = (r << 3) | (r >> 2);
+    outRGB[1] = (g << 2) | (g >> 4);
+    outRGB[2] = (b << 3) | (b >> 2);
+}
+
+static void BuildBC1Palette(uint16_t c0, uint16_t c1, bool fourColor, int palette[4][3])
+{
+    UnpackRGB565(c0, palette[0]);
+    UnpackRGB565(c1, palette[1]);
+    for (int c = 0; c < 3; ++c) {
+        if (fourColor) {
+            palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+            palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+        } else {
+            palette[2][c] = (palette[0][c] + palette[1][c]) / 2;
+            palette[3][c] = 0;
+        }
+    }
+}
+
+// Puts the endpoints in the order that selects the wanted mode (c0 > c1 is
+// four-colour), then picks the nearest palette entry per texel.
+static int64_t AssignBC1Indices(const uint8_t rgba[16 * 4],
+                                const bool transparent[16],
+                                bool fourColor,
+                                uint16_t* c0,
+                                uint16_t* c1,
+                                uint8_t indices[16])
+{
+    if ((fourColor && *c0 < *c1) || (!fourColor && *c0 > *c1)) {
+        std::swap(*c0, *c1);
+    }
+    // Equal endpoints decode in three-colour mode; index 0 is still exact.
+    const bool degenerate = *c0 == *c1;
+    int palette[4][3];
+    BuildBC1Palette(*c0, *c1, fourColor && !degenerate, palette);
+
+    int64_t total = 0;
+    for (int t = 0; t < 16; ++t) {
+        if (transparent[t]) {
+            indices[t] = 3;
+            continue;
+        }
+        const int candidates = degenerate ? 1 : (fourColor ? 4 : 3);
+        int64_t bestError = INT64_MAX;
+        for (int i = 0; i < candidates; ++i) {
+            int64_t error = 0;
+            for (int c = 0; c < 3; ++c) {
+                const int64_t d = (int64_t)palette[i][c] - rgba[t * 4 + c];
+                error += d * d;
+            }
+            if (error < bestError) {
+                bestError = error;
+                indices[t] = (uint8_t)i;
+            }
+        }
+        total += bestError;
+    }
+    return total;
+}
+
+static void EncodeBC1ColorBlock(const uint8_t rgba[16 * 4], bool allowTransparent, uint8_t outBlock[BC1_BLOCK_BYTES])
+{
+    bool transparent[16] = {};
+    float points[16][4] = {};
+    int opaqueTexels[16];
+    int count = 0;
+    for (int t = 0; t < 16; ++t) {
+        if (allowTransparent && rgba[t * 4 + 3] < 128) {
+            transparent[t] = true;
+            continue;
+        }
+        for (int c = 0; c < 3; ++c) {
+            points[count][c] = (float)rgba[t * 4 + c];
+        }
+        opaqueTexels[count++] = t;
+    }
+    const bool fourColor = count == 16;
+
+    uint16_t c0 = 0;
+    uint16_t c1 = 0;
+    uint8_t indices[16] = {};
+    if (count == 0) {
+        AssignBC1Indices(rgba, transparent, false, &c0, &c1, indices);
+    } else {
+        float lo[4], hi[4];
+        PrincipalAxisEndpoints(points, count, 3, lo, hi);
+        c0 = PackRGB565(hi);
+        c1 = PackRGB565(lo);
+        int64_t bestError = AssignBC1Indices(rgba, transparent, fourColor, &c0, &c1, indices);
+
+        static constexpr float kFourColorWeights[4] = { 0.0f, 1.0f, 1.0f / 3.0f, 2.0f / 3.0f };
+        static constexpr float kThreeColorWeights[4] = { 0.0f, 1.0f, 0.5f, -1.0f };
+        for (int iter = 0; iter < kRefineIterations && bestError > 0 && c0 != c1; ++iter) {
+            float weights[16];
+            for (int i = 0; i < count; ++i) {
+                const uint8_t index = indices[opaqueTexels[i]];
+                weights[i] = fourColor ? kFourColorWeights[index] : kThreeColorWeights[index];
+            }
+            float e0[4], e1[4];
+            if (!LeastSquaresEndpoints(points, weights, count, 3, e0, e1)) {
+                break;
+            }
+            uint16_t r0 = PackRGB565(e0);
+            uint16_t r1 = PackRGB565(e1);
+            uint8_t refinedIndices[16];
+            const int64_t refinedError = AssignBC1Indices(rgba, transparent, fourColor, &r0, &r1, refinedIndices);
+            if (refinedError >= bestError) {
+                break;
+            }
+            bestError = refinedError;
+            c0 = r0;
+            c1 = r1;
+            memcpy(indices, refinedIndices, sizeof(indices));
+        }
+    }
+
+    uint32_t packedIndices = 0;
+    for (int t = 0; t < 16; ++t) {
+        packedIndices |= (uint32_t)indices[t] << (t * 2);
+    }
+    memcpy(outBlock + 0, &c0, sizeof(c0));
+    memcpy(outBlock + 2, &c1, sizeof(c1));
+    memcpy(outBlock + 4, &packedIndices, sizeof(packedIndices));
+}
+
+static void DecodeBC1ColorBlock(const uint8_t block[BC1_BLOCK_BYTES], bool alwaysFourColor, uint8_t outRGBA[16 * 4])
+{
+    uint16_t c0 = 0;
+    uint16_t c1 = 0;
+    uint32_t packedIndices = 0;
+    memcpy(&c0, block + 0, sizeof(c0));
+    memcpy(&c1, block + 2, sizeof(c1));
+    memcpy(&packedIndices, block + 4, sizeof(packedIndices));
+    const bool fourColor = alwaysFourColor || c0 > c1;
+    int palette[4][3];
+    BuildBC1Palette(c0, c1, fourColor, palette);
+    for (int t = 0; t < 16; ++t) {
+        const uint32_t index = (packedIndices >> (t * 2)) & 3u;
+        for (int c = 0; c < 3; ++c) {
+            outRGBA[t * 4 + c] = (uint8_t)palette[index][c];
+        }
+        outRGBA[t * 4 + 3] = (!fourColor && index == 3) ? 0 : 255;
+    }
+}
+
+// --------------------------------------------------------------------------
+//  BC3 alpha block: two 8-bit endpoints, 3-bit indices
+// --------------------------------------------------------------------------
+static void BuildBC3AlphaPalette(int a0, int a1, int palette[8])
+{
+    palette[0] = a0;
+    palette[1] = a1;
+    if (a0 > a1) {
+        for (int i = 1; i < 7; ++i) {
+            palette[i + 1] = ((7 - i) * a0 + i * a1) / 7;
+        }
+    } else {
+        for (int i = 1; i < 5; ++i) {
+            palette[i + 1] = ((5 - i) * a0 + i * a1) / 5;
+        }
+        palette[6] = 0;
+        palette[7] = 255;
+    }
+}
+
+static void EncodeBC3AlphaBlock(const uint8_t rgba[16 * 4], uint8_t outBlock[8])
+{
+    int aMin = 255;
+    int aMax = 0;
+    for (int t = 0; t < 16; ++t) {
+        aMin = std::min<int>(aMin, rgba[t * 4 + 3]);
+        aMax = std::max<int>(aMax, rgba[t * 4 + 3]);
+    }
+
+    uint64_t packedIndices = 0;
+    if (aMax > aMin) {
+        int palette[8];
+        BuildBC3AlphaPalette(aMax, aMin, palette);
+        for (int t = 0; t < 16; ++t) {
+            int best = 0;
+            for (int i = 1; i < 8; ++i) {
+                if (abs(palette[i] - rgba[t * 4 + 3]) < abs(palette[best] - rgba[t * 4 + 3])) {
+                    best = i;
+                }
+            }
+            packedIndices |= (uint64_t)best << (t * 3);
+        }
+    }
+    outBlock[0] = (uint8_t)aMax;
+    outBlock[1] = (uint8_t)aMin;
+    for (int i = 0; i < 6; ++i) {
+        outBlock[2 + i] = (uint8_t)(packedIndices >> (i * 8));
+    }
+}
+
+static void DecodeBC3AlphaBlock(const uint8_t block[8], uint8_t outRGBA[16 * 4])
+{
+    int palette[8];
+    BuildBC3AlphaPalette(block[0], block[1], palette);
+    uint64_t packedIndices = 0;
+    for (int i = 0; i < 6; ++i) {
+        packedIndices |= (uint64_t)block[2 + i] << (i * 8);
+    }
+    for (int t = 0; t < 16; ++t) {
+        outRGBA[t * 4 + 3] = (uint8_t)palette[(packedIndices >> (t * 3)) & 7u];
+    }
+}
+
+// --------------------------------------------------------------------------
+//  BC7 mode 6
+// --------------------------------------------------------------------------
+struct BC7Endpoint {
+    int q[4] = {};   // 7-bit
+    int p = 0;       // shared p-bit
+};
+
+static BC7Endpoint QuantizeBC7Endpoint(const float v[4], int p)
+{
+    BC7Endpoint e;
+    e.p = p;
+    for (int c = 0; c < 4; ++c) {
+        e.q[c] = std::clamp((int)lrintf((v[c] - (float)p) * 0.5f), 0, 127);
+    }
+    return e;
+}
+
+static void BuildBC7Palette(const BC7Endpoint& e0, const BC7Endpoint& e1, int palette[16][4])
+{
+    for (int c = 0; c < 4; ++c) {
+        const int a = (e0.q[c] << 1) | e0.p;
+        const int b = (e1.q[c] << 1) | e1.p;
+        for (int i = 0; i < 16; ++i) {
+            palette[i][c] = ((64 - kBC7Weights[i]) * a + kBC7Weights[i] * b + 32) >> 6;
+        }
+    }
+}
+
+static int64_t AssignBC7Indices(const uint8_t rgba[16 * 4], const BC7Endpoint& e0, const BC7Endpoint& e1, uint8_t indices[16])
+{
+    int palette[16][4];
+    BuildBC7Palette(e0, e1, palette);
+    int64_t total = 0;
+    for (int t = 0; t < 16; ++t) {
+        int64_t bestError = INT64_MAX;
+        for (int i = 0; i < 16; ++i) {
+            int64_t error = 0;
+            for (int c = 0; c < 4; ++c) {
+                const int64_t d = (int64_t)palette[i][c] - rgba[t * 4 + c];
+                error += d * d;
+            }
+            if (error < bestError) {
+                bestError = error;
+                indices[t] = (uint8_t)i;
+            }
+        }
+        total += bestError;
+    }
+    return total;
+}
+
+// The p-bits shift every channel of an endpoint at once, so all four
+// combinations are tried against the actual texels.
+static int64_t FitBC7Endpoints(const uint8_t rgba[16 * 4],
+                               const float lo[4],
+                               const float hi[4],
+                               BC7Endpoint* outE0,
+                               BC7Endpoint* outE1,
+                               uint8_t indices[16])
+{
+    int64_t bestError = INT64_MAX;
+    for (int p = 0; p < 4; ++p) {
+        const BC7Endpoint e0 = QuantizeBC7Endpoint(lo, p & 1);
+        const BC7Endpoint e1 = QuantizeBC7Endpoint(hi, p >> 1);
+        uint8_t candidate[16];
+        const int64_t error = AssignBC7Indices(rgba, e0, e1, candidate);
+        if (error < bestError) {
+            bestError = error;
+            *outE0 = e0;
+            *outE1 = e1;
+            memcpy(indices, candidate, sizeof(candidate));
+        }
+    }
+    return bestError;
+}
+
+static void ForEachBlock(int width, int height, int firstBlockRow, int blockRowCount, size_t blockBytes,
+                         uint8_t* blocks, const uint8_t* rgba, void (*encode)(const uint8_t*, uint8_t*))
+{
+    const int blocksX = (width + 3) / 4;
+    const int blocksY = std::min((height + 3) / 4, firstBlockRow + blockRowCount);
+    uint8_t texels[16 * 4];
+    for (int by = firstBlockRow; by < blocksY; ++by) {
+        for (int bx = 0; bx < blocksX; ++bx) {
+            for (int t = 0; t < 16; ++t) {
+                const int x = std::min(width - 1, bx * 4 + (t & 3));
+                const int y = std::min(height - 1, by * 4 + (t >> 2));
+                memcpy(texels + t * 4, rgba + ((size_t)y * (size_t)width + (size_t)x) * 4, 4);
+            }
+            encode(texels, blocks + ((size_t)by * (size_t)blocksX + (size_t)bx) * blockBytes);
+        }
+    }
+}
+
+} // namespace
+
+const char* TexturePixelFormatName(uint32_t format)
+{
+    switch (format) {
+    case TEXTURE_PIXEL_RGBA8: return "RGBA8";
+    case TEXTURE_PIXEL_BC1:   return "BC1";
+    case TEXTURE_PIXEL_BC3:   return "BC3";
+    case TEXTURE_PIXEL_BC7:   return "BC7";
+    default:                  return "unknown";
+    }
+}
+
+bool TexturePixelFormatFromName(const char* name, uint32_t* outFormat)
+{
+    static const struct { const char* name; uint32_t format; } kFormats[] = {
+        { "rgba8", TEXTURE_PIXEL_RGBA8 },
+        { "bc1",   TEXTURE_PIXEL_BC1 },
+        { "bc3",   TEXTURE_PIXEL_BC3 },
+        { "bc7",   TEXTURE_PIXEL_BC7 },
+    };
+    if (!name || !outFormat) {
+        return false;
+    }
+    for (const auto& entry : kFormats) {
+        if (EqualsIgnoreCase(name, entry.name)) {
+            *outFormat = entry.format;
+            return true;
+        }
+    }
+    return false;
+}
+
+bool TexturePixelFormatIsBlockCompressed(uint32_t format)
+{
+    return format == TEXTURE_PIXEL_BC1 || format == TEXTURE_PIXEL_BC3 || format == TEXTURE_PIXEL_BC7;
+}
+
+size_t TextureLevelByteSize(uint32_t format, int width, int height)
+{
+    const size_t w = (size_t)std::max(0, width);
+    const size_t h = (size_t)std::max(0, height);
+    const size_t blocks = ((w + 3) / 4) * ((h + 3) / 4);
+    switch (format) {
+    case TEXTURE_PIXEL_RGBA8: return w * h * 4;
+    case TEXTURE_PIXEL_BC1:   return blocks * BC1_BLOCK_BYTES;
+    case TEXTURE_PIXEL_BC3:   return blocks * BC3_BLOCK_BYTES;
+    case TEXTURE_PIXEL_BC7:   return blocks * BC7_BLOCK_BYTES;
+    default:                  return 0;
+    }
+}
+
+void EncodeBC1Block(const uint8_t rgba[16 * 4], uint8_t outBlock[BC1_BLOCK_BYTES])
+{
+    EncodeBC1ColorBlock(rgba, true, outBlock);
+}
+
+void EncodeBC3Block(const uint8_t rgba[16 * 4], uint8_t outBlock[BC3_BLOCK_BYTES])
+{
+    EncodeBC3AlphaBlock(rgba, outBlock);
+    EncodeBC1ColorBlock(rgba, false, outBlock + 8);
+}
+
+void EncodeBC7Block(const uint8_t rgba[16 * 4], uint8_t outBlock[BC7_BLOCK_BYTES])
+{
+    float points[16][4];
+    for (int t = 0; t < 16; ++t) {
+        for (int c = 0; c < 4; ++c) {
+            points[t][c] = (float)rgba[t * 4 + c];
+        }
+    }
+    float lo[4], hi[4];
+    PrincipalAxisEndpoints(points, 16, 4, lo, hi);
+    BC7Endpoint e0;
+    BC7Endpoint e1;
+    uint8_t indices[16];
+    int64_t bestError = FitBC7Endpoints(rgba, lo, hi, &e0, &e1, indices);
+
+    for (int iter = 0; iter < kRefineIterations && bestError > 0; ++iter) {
+        float weights[16];
+        for (int t = 0; t < 16; ++t) {
+            weights[t] = (float)kBC7Weights[indices[t]] / 64.0f;
+        }
+        float f0[4], f1[4];
+        if (!LeastSquaresEndpoints(points, weights, 16, 4, f0, f1)) {
+            break;
+        }
+        BC7Endpoint r0;
+        BC7Endpoint r1;
+        uint8_t refinedIndices[16];
+        const int64_t refinedError = FitBC7Endpoints(rgba, f0, f1, &r0, &r1, refinedIndices);
+        if (refinedError >= bestError) {
+            break;
+        }
+        bestError = refinedError;
+        e0 = r0;
+        e1 = r1;
+        memcpy(indices, refinedIndices, sizeof(indices));
+    }
+
+    // The anchor index drops its top bit; the weights are symmetric, so
+    // swapping the endpoints and mirroring every index is lossless.
+    if (indices[0] >= 8) {
+        std::swap(e0, e1);
+        for (uint8_t& index : indices) {
+            index = (uint8_t)(15 - index);
+        }
+    }
+
+    memset(outBlock, 0, BC7_BLOCK_BYTES);
+    int bitPos = 0;
+    PutBits(outBlock, &bitPos, kBC7Mode6, 7);
+    for (int c = 0; c < 4; ++c) {
+        PutBits(outBlock, &bitPos, (uint32_t)e0.q[c], 7);
+        PutBits(outBlock, &bitPos, (uint32_t)e1.q[c], 7);
+    }
+    PutBits(outBlock, &bitPos, (uint32_t)e0.p, 1);
+    PutBits(outBlock, &bitPos, (uint32_t)e1.p, 1);
+    PutBits(outBlock, &bitPos, indices[0], 3);
+    for (int t = 1; t < 16; ++t) {
+        PutBits(outBlock, &bitPos, indices[t], 4);
+    }
+}
+
+void DecodeBC1Block(const uint8_t block[BC1_BLOCK_BYTES], uint8_t outRGBA[16 * 4])
+{
+    DecodeBC1ColorBlock(block, false, outRGBA);
+}
+
+void DecodeBC3Block(const uint8_t block[BC3_BLOCK_BYTES], uint8_t outRGBA[16 * 4])
+{
+    DecodeBC1ColorBlock(block + 8, true, outRGBA);
+    DecodeBC3AlphaBlock(block, outRGBA);
+}
+
+bool DecodeBC7Block(const uint8_t block[BC7_BLOCK_BYTES], uint8_t outRGBA[16 * 4])
+{
+    int bitPos = 0;
+    if ((int)GetBits(block, &bitPos, 7) != kBC7Mode6) {
+        return false;
+    }
+    BC7Endpoint e0;
+    BC7Endpoint e1;
+    for (int c = 0; c < 4; ++c) {
+        e0.q[c] = (int)GetBits(block, &bitPos, 7);
+        e1.q[c] = (int)GetBits(block, &bitPos, 7);
+    }
+    e0.p = (int)GetBits(block, &bitPos, 1);
+    e1.p = (int)GetBits(block, &bitPos, 1);
+    int palette[16][4];
+    BuildBC7Palette(e0, e1, palette);
+    for (int t = 0; t < 16; ++t) {
+        const uint32_t index = GetBits(block, &bitPos, t == 0 ? 3 : 4);
+        for (int c = 0; c < 4; ++c) {
+            outRGBA[t * 4 + c] = (uint8_t)palette[index][c];
+        }
+    }
+    return true;
+}
+
+bool EncodeTextureBlockRows(uint32_t format,
+                            int width,
+                            int height,
+                            const uint8_t* rgba,
+                            int firstBlockRow,
+                            int blockRowCount,
+                            uint8_t* outData)
+{
+    if (!outData || !rgba || width <= 0 || height <= 0) {
+        return false;
+    }
+    switch (format) {
+    case TEXTURE_PIXEL_BC1:
+        ForEachBlock(width, height, firstBlockRow, blockRowCount, BC1_BLOCK_BYTES, outData, rgba, EncodeBC1Block);
+        return true;
+    case TEXTURE_PIXEL_BC3:
+        ForEachBlock(width, height, firstBlockRow, blockRowCount, BC3_BLOCK_BYTES, outData, rgba, EncodeBC3Block);
+        return true;
+    case TEXTURE_PIXEL_BC7:
+        ForEachBlock(width, height, firstBlockRow, blockRowCount, BC7_BLOCK_BYTES, outData, rgba, EncodeBC7Block);
+        return true;
+    default:
+        return false;
+    }
+}
+
+bool EncodeTextureLevel(uint32_t format,
+                        int width,
+                        int height,
+                        const uint8_t* rgba,
+                        std::vector<uint8_t>* outData)
+{
+    const size_t byteSize = TextureLevelByteSize(format, width, height);
+    if (!outData || !rgba || byteSize == 0) {
+        return false;
+    }
+    outData->assign(byteSize, 0);
+    if (format == TEXTURE_PIXEL_RGBA8) {
+        memcpy(outData->data(), rgba, byteSize);
+        return true;
+    }
+    return EncodeTextureBlockRows(format, width, height, rgba, 0, (height + 3) / 4, outData->data());
+}
+
+bool DecodeTextureLevelRGBA8(uint32_t format,
+                             int width,
+                             int height,
+                             const uint8_t* data,
+                             size_t dataSize,
+                             std::vector<uint8_t>* outRGBA)
+{
+    const size_t byteSize = TextureLevelByteSize(format, width, height);
+    if (!outRGBA || !data || byteSize == 0 || dataSize != byteSize) {
+        return false;
+    }
+    if (format == TEXTURE_PIXEL_RGBA8) {
+        outRGBA->assign(data, data + dataSize);
+        return true;
+    }
+
+    const size_t blockBytes = format == TEXTURE_PIXEL_BC1 ? BC1_BLOCK_BYTES : BC3_BLOCK_BYTES;
+    const int blocksX = (width + 3) / 4;
+    const int blocksY = (height + 3) / 4;
+    outRGBA->assign((size_t)width * (size_t)height * 4, 0);
+    uint8_t texels[16 * 4];
+    for (int by = 0; by < blocksY; ++by) {
+        for (int bx = 0; bx < blocksX; ++bx) {
+            const uint8_t* block = data + ((size_t)by * (size_t)blocksX + (size_t)bx) * blockBytes;
+            if (format == TEXTURE_PIXEL_BC1) {
+                DecodeBC1Block(block, texels);
+            } else if (format == TEXTURE_PIXEL_BC3) {
+                DecodeBC3Block(block, texels);
+            } else if (!DecodeBC7Block(block, texels)) {
+                return false;
+            }
+            for (int t = 0; t < 16; ++t) {
+                const int x = bx * 4 + (t & 3);
+                const int y = by * 4 + (t >> 2);
+                if (x < width && y < height) {
+                    memcpy(outRGBA->data() + ((size_t)y * (size_t)width + (size_t)x) * 4, texels + t * 4, 4);
+                }
+            }
+        }
+    }
+    return true;
+}
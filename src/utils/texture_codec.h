@@ -0,0 +1,65 @@
+// texture_codec.h  —  diffuse texture pixel formats for the asset pack.
+//
+// compile_map encodes mip levels into BC1/BC3/BC7 blocks when it writes the
+// .rres pack; the engine uploads the blocks as-is and falls back to the
+// RGBA8 decoders here on backends without BCn sampling.
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Stored in the mip chunk props, so the values are part of the pack format.
+enum TexturePixelFormat : uint32_t {
+    TEXTURE_PIXEL_RGBA8 = 0u,
+    TEXTURE_PIXEL_BC1   = 1u,   // RGB + 1-bit alpha, 8 bytes per 4x4 block
+    TEXTURE_PIXEL_BC3   = 2u,   // RGB + interpolated alpha, 16 bytes per block
+    TEXTURE_PIXEL_BC7   = 3u,   // RGBA, 16 bytes per block
+};
+
+static constexpr size_t BC1_BLOCK_BYTES = 8;
+static constexpr size_t BC3_BLOCK_BYTES = 16;
+static constexpr size_t BC7_BLOCK_BYTES = 16;
+
+const char* TexturePixelFormatName(uint32_t format);
+// Accepts "rgba8", "bc1", "bc3" and "bc7" (case-insensitive).
+bool        TexturePixelFormatFromName(const char* name, uint32_t* outFormat);
+bool        TexturePixelFormatIsBlockCompressed(uint32_t format);
+// 0 for unknown formats.
+size_t      TextureLevelByteSize(uint32_t format, int width, int height);
+
+// Blocks take 16 RGBA8 texels in row-major order.
+void        EncodeBC1Block(const uint8_t rgba[16 * 4], uint8_t outBlock[BC1_BLOCK_BYTES]);
+void        EncodeBC3Block(const uint8_t rgba[16 * 4], uint8_t outBlock[BC3_BLOCK_BYTES]);
+// Always writes a mode 6 block (one subset, 7.7.7.7 endpoints + p-bits,
+// 4-bit indices).
+void        EncodeBC7Block(const uint8_t rgba[16 * 4], uint8_t outBlock[BC7_BLOCK_BYTES]);
+
+void        DecodeBC1Block(const uint8_t block[BC1_BLOCK_BYTES], uint8_t outRGBA[16 * 4]);
+void        DecodeBC3Block(const uint8_t block[BC3_BLOCK_BYTES], uint8_t outRGBA[16 * 4]);
+// Decodes mode 6, which is every block compile_map writes; returns false
+// for the other BC7 modes.
+bool        DecodeBC7Block(const uint8_t block[BC7_BLOCK_BYTES], uint8_t outRGBA[16 * 4]);
+
+// Whole mip level. Edge blocks of levels that are not a multiple of 4 repeat
+// the last row/column.
+bool        EncodeTextureLevel(uint32_t format,
+                               int width,
+                               int height,
+                               const uint8_t* rgba,
+                               std::vector<uint8_t>* outData);
+// BCn only: encodes block rows [firstBlockRow, firstBlockRow + blockRowCount)
+// of a level into their place in `outData`, which holds the whole level, so
+// disjoint row ranges can be encoded on different threads.
+bool        EncodeTextureBlockRows(uint32_t format,
+                                   int width,
+                                   int height,
+                                   const uint8_t* rgba,
+                                   int firstBlockRow,
+                                   int blockRowCount,
+                                   uint8_t* outData);
+bool        DecodeTextureLevelRGBA8(uint32_t format,
+                                    int width,
+                                    int height,
+                                    const uint8_t* data,
+                                    size_t dataSize,
+                                    std::vector<uint8_t>* outRGBA);
@@ -0,0 +1,70 @@
+// vertex_codec.cpp
+#include "vertex_codec.h"
+#include "lightmap_codec.h"
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+static int8_t EncodeSnorm8(float value) {
+    return (int8_t)std::lround(std::clamp(value, -1.0f, 1.0f) * 127.0f);
+}
+
+static float DecodeSnorm8(int8_t value) {
+    return std::max((float)value / 127.0f, -1.0f);
+}
+
+static uint16_t EncodeUnorm16(float value) {
+    return (uint16_t)std::lround(std::clamp(value, 0.0f, 1.0f) * 65535.0f);
+}
+
+} // namespace
+
+BSPVertexCompact EncodeCompactVertex(const BSPVertex& v)
+{
+    BSPVertexCompact c{};
+    c.x = v.x;
+    c.y = v.y;
+    c.z = v.z;
+    c.nx = EncodeSnorm8(v.nx);
+    c.ny = EncodeSnorm8(v.ny);
+    c.nz = EncodeSnorm8(v.nz);
+    c.nw = 0;
+    c.u = Float32ToHalfBits(v.u);
+    c.v = Float32ToHalfBits(v.v);
+    c.lu = EncodeUnorm16(v.lu);
+    c.lv = EncodeUnorm16(v.lv);
+    return c;
+}
+
+BSPVertex DecodeCompactVertex(const BSPVertexCompact& c)
+{
+    BSPVertex v{};
+    v.x = c.x;
+    v.y = c.y;
+    v.z = c.z;
+    v.nx = DecodeSnorm8(c.nx);
+    v.ny = DecodeSnorm8(c.ny);
+    v.nz = DecodeSnorm8(c.nz);
+    v.u = HalfBitsToFloat32(c.u);
+    v.v = HalfBitsToFloat32(c.v);
+    v.lu = (float)c.lu / 65535.0f;
+    v.lv = (float)c.lv / 65535.0f;
+    return v;
+}
+
+void ShiftPolygonUVs(BSPVertex* vertices, size_t count)
+{
+    if (count == 0) return;
+    double sumU = 0.0, sumV = 0.0;
+    for (size_t i = 0; i < count; ++i) {
+        sumU += vertices[i].u;
+        sumV += vertices[i].v;
+    }
+    const float shiftU = (float)std::round(sumU / (double)count);
+    const float shiftV = (float)std::round(sumV / (double)count);
+    for (size_t i = 0; i < count; ++i) {
+        vertices[i].u -= shiftU;
+        vertices[i].v -= shiftV;
+    }
+}
@@ -0,0 +1,16 @@
+// vertex_codec.h  —  BSPVertex <-> BSPVertexCompact.
+//
+// compile_map encodes (and checks the round trip against its tolerances);
+// the engine only decodes where it needs positions and UVs on the CPU.
+#pragma once
+#include "bsp_format.h"
+#include <cstddef>
+
+// `v.u`/`v.v` should already be shifted near zero; see ShiftPolygonUVs.
+BSPVertexCompact EncodeCompactVertex(const BSPVertex& v);
+BSPVertex        DecodeCompactVertex(const BSPVertexCompact& v);
+
+// Moves a polygon's diffuse UVs by the whole number of repeats closest to
+// their mean. Sampling with wrap-repeat is unchanged.
+void             ShiftPolygonUVs(BSPVertex* vertices, size_t count);
+
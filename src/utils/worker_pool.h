@@ -0,0 +1,139 @@
+// worker_pool.h  —  long-lived worker threads for fork/join work issued every frame.
+//
+// ParallelFor starts and joins its threads on every call, which is fine for
+// the loader and the offline tools but costs more than a small per-frame job
+// saves. WorkerPool keeps ParallelWorkerCount() - 1 threads parked on a
+// condition variable and hands them one job at a time; the calling thread
+// works on the job too and returns once every index is done.
+#pragma once
+
+#include "parallel_for.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class WorkerPool {
+public:
+    explicit WorkerPool(size_t workerCount = ParallelWorkerCount())
+    {
+        const size_t threads = workerCount > 1 ? workerCount - 1 : 0;
+        threads_.reserve(threads);
+        for (size_t t = 0; t < threads; ++t) {
+            threads_.emplace_back([this]() { WorkerLoop(); });
+        }
+    }
+
+    ~WorkerPool()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stopping_ = true;
+        }
+        wake_.notify_all();
+        for (std::thread& thread : threads_) {
+            thread.join();
+        }
+    }
+
+    WorkerPool(const WorkerPool&) = delete;
+    WorkerPool& operator=(const WorkerPool&) = delete;
+
+    // Threads working on a job, the caller included.
+    size_t WorkerCount() const { return threads_.size() + 1; }
+
+    // Calls fn(i) for every i in [0, count) and returns once all of them are
+    // done, with the same contract as ParallelFor. One job runs at a time;
+    // calls from several threads at once are not supported.
+    template <typename Fn>
+    void Run(size_t count, const Fn& fn)
+    {
+        if (count <= 1 || threads_.empty()) {
+            for (size_t i = 0; i < count; ++i) {
+                fn(i);
+            }
+            return;
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            job_ = &fn;
+            call_ = [](const void* job, size_t i) { (*static_cast<const Fn*>(job))(i); };
+            count_ = count;
+            next_.store(0, std::memory_order_relaxed);
+            busy_ = threads_.size();
+            ++generation_;
+        }
+        wake_.notify_all();
+
+        Work(&fn, call_, count);
+
+        std::unique_lock<std::mutex> lock(mutex_);
+        done_.wait(lock, [this]() { return busy_ == 0; });
+        job_ = nullptr;
+    }
+
+private:
+    using Call = void (*)(const void*, size_t);
+
+    void Work(const void* job, Call call, size_t count)
+    {
+        for (;;) {
+            const size_t i = next_.fetch_add(1, std::memory_order_relaxed);
+            if (i >= count) {
+                break;
+            }
+            call(job, i);
+        }
+    }
+
+    void WorkerLoop()
+    {
+        uint64_t seen = 0;
+        for (;;) {
+            const void* job = nullptr;
+            Call call = nullptr;
+            size_t count = 0;
+            {
+                std::unique_lock<std::mutex> lock(mutex_);
+                wake_.wait(lock, [&]() { return stopping_ || generation_ != seen; });
+                if (stopping_) {
+                    return;
+                }
+                seen = generation_;
+                job = job_;
+                call = call_;
+                count = count_;
+            }
+            Work(job, call, count);
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                --busy_;
+            }
+            done_.notify_one();
+        }
+    }
+
+    std::vector<std::thread> threads_;
+    std::mutex mutex_;
+    std::condition_variable wake_;
+    std::condition_variable done_;
+    const void* job_ = nullptr;
+    Call call_ = nullptr;
+    size_t count_ = 0;
+    std::atomic<size_t> next_{0};
+    size_t busy_ = 0;
+    uint64_t generation_ = 0;
+    bool stopping_ = false;
+};
+
+// The process-wide pool for per-frame work, started on first use.
+inline WorkerPool& FrameWorkerPool()
+{
+    static WorkerPool pool;
+    return pool;
+}